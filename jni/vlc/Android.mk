@@ -88,6 +88,7 @@ LOCAL_SRC_FILES := \
     src/input/stream_filter.c \
     src/input/stream_memory.c \
     src/input/subtitles.c \
+    src/input/thumbnailer.c \
     src/input/var.c \
     src/interface/dialog.c \
     src/interface/interface.c \
@@ -113,6 +114,7 @@ LOCAL_SRC_FILES := \
     src/misc/picture.c \
     src/misc/picture_fifo.c \
     src/misc/picture_pool.c \
+    src/misc/planes.c \
     src/misc/probe.c \
     src/misc/rand.c \
     src/misc/sql.c \
@@ -144,6 +146,7 @@ LOCAL_SRC_FILES := \
     src/playlist/fetcher.c \
     src/playlist/item.c \
     src/playlist/loadsave.c \
+    src/playlist/metacache.c \
     src/playlist/preparser.c \
     src/playlist/search.c \
     src/playlist/services_discovery.c \
@@ -199,6 +199,9 @@
 /* Define to 1 if you have the <faad.h> header file. */
 /* #undef HAVE_FAAD_H */
 
+/* Define to 1 if you have the `fallocate' function. */
+/* #undef HAVE_FALLOCATE */
+
 /* Define to 1 if you have the `fcntl' function. */
 #define HAVE_FCNTL 1
 
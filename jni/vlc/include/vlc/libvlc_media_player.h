@@ -214,6 +214,31 @@ LIBVLC_API void libvlc_media_player_pause ( libvlc_media_player_t *p_mi );
  */
 LIBVLC_API void libvlc_media_player_stop ( libvlc_media_player_t *p_mi );
 
+/**
+ * Open a media ahead of time, so that it starts without delay once it is set
+ * and played after the current one. Its video and audio outputs are the ones
+ * of the current media.
+ *
+ * The preloaded media is dropped if another one is set, or on stop.
+ *
+ * \param p_mi the Media Player
+ * \param p_md the media to play next
+ * \return 0 if the media is being preloaded, or -1 on error.
+ */
+LIBVLC_API int libvlc_media_player_preload ( libvlc_media_player_t *p_mi,
+                                             libvlc_media_t *p_md );
+
+/**
+ * Get the time between the end of the previous media and the first buffered
+ * frames of the current one, when it was preloaded with
+ * libvlc_media_player_preload().
+ *
+ * \param p_mi the Media Player
+ * \return the gap in ms, or -1 if there was no transition
+ */
+LIBVLC_API libvlc_time_t libvlc_media_player_get_transition_gap (
+                                             libvlc_media_player_t *p_mi );
+
 /**
  * Callback prototype to allocate and lock a picture buffer.
  *
@@ -82,6 +82,9 @@ typedef struct block_sys_t block_sys_t;
 #define BLOCK_FLAG_TOP_FIELD_FIRST 0x2000
 /** This block contains an interlaced picture with bottom field first */
 #define BLOCK_FLAG_BOTTOM_FIELD_FIRST 0x4000
+/** The payload of this block is followed by the input padding of libavcodec,
+ * it does not need to be reallocated to be decoded by it */
+#define BLOCK_FLAG_AVCODEC_PADDED 0x8000
 
 /** This block contains an interlaced picture */
 #define BLOCK_FLAG_INTERLACED_MASK \
@@ -88,5 +88,37 @@ typedef void *(*vlc_memcpy_t) (void *tgt, const void *src, size_t n);
 
 VLC_API void vlc_fastmem_register(vlc_memcpy_t cpy);
 
+/**
+ * Line kernels of the plane copy helpers, for the fast memory modules.
+ * Each processes one line of count pairs of bytes; count is a multiple of 16.
+ */
+typedef struct
+{
+    /** Splits interleaved pairs into two lines (NV12 chroma to U and V) */
+    void (*split) (uint8_t *a, uint8_t *b, const uint8_t *src, unsigned count);
+    /** Interleaves two lines into pairs (U and V to NV12 chroma) */
+    void (*interleave) (uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                        unsigned count);
+    /** Swaps the bytes of each pair (NV12 to NV21 chroma), may be in place */
+    void (*swap) (uint8_t *dst, const uint8_t *src, unsigned count);
+} vlc_fastplane_t;
+
+VLC_API void vlc_fastplane_register(const vlc_fastplane_t *);
+
+VLC_API void vlc_CopyPlane(uint8_t *dst, size_t dst_pitch,
+                           const uint8_t *src, size_t src_pitch,
+                           unsigned width, unsigned height);
+VLC_API void vlc_SplitPlane(uint8_t *dst_a, size_t a_pitch,
+                            uint8_t *dst_b, size_t b_pitch,
+                            const uint8_t *src, size_t src_pitch,
+                            unsigned width, unsigned height);
+VLC_API void vlc_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
+                                  const uint8_t *src_a, size_t a_pitch,
+                                  const uint8_t *src_b, size_t b_pitch,
+                                  unsigned width, unsigned height);
+VLC_API void vlc_SwapPlaneUV(uint8_t *dst, size_t dst_pitch,
+                             const uint8_t *src, size_t src_pitch,
+                             unsigned width, unsigned height);
+
 #endif /* !VLC_CPU_H */
 
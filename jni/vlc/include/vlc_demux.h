@@ -207,6 +207,21 @@ VLC_API void demux_PacketizerDestroy( decoder_t *p_packetizer );
  */
 VLC_API input_thread_t * demux_GetParentInput( demux_t *p_demux ) VLC_USED;
 
+/**
+ * This function will create a demux reading the given stream of the URL,
+ * for the demuxers that chain other demuxers. The elementary streams are
+ * sent to the given es_out.
+ *
+ * Use an empty psz_demux to probe the demuxers.
+ */
+VLC_API demux_t * demux_NewChained( demux_t *p_demux, const char *psz_demux, const char *psz_url, stream_t *s, es_out_t *out ) VLC_USED;
+
+/**
+ * This function will destroy a demux created by demux_NewChained.
+ * The stream is not deleted.
+ */
+VLC_API void demux_DeleteChained( demux_t *p_chained );
+
 /* */
 #define DEMUX_INIT_COMMON() do {            \
     p_demux->pf_control = Control;          \
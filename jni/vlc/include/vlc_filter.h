@@ -140,6 +140,10 @@ struct filter_t
      * XXX use filter_GetInputAttachments */
     int (*pf_get_attachments)( filter_t *, input_attachment_t ***, int * );
 
+    /* Input
+     * XXX use filter_GetInput */
+    input_thread_t *(*pf_get_input)( filter_t * );
+
     /* Private structure for the owner of the decoder */
     filter_owner_sys_t *p_owner;
 };
@@ -244,6 +248,18 @@ static inline int filter_GetInputAttachments( filter_t *p_filter,
                                          ppp_attachment, pi_attachment );
 }
 
+/**
+ * This function returns the input the filter works for, if any.
+ *
+ * You MUST release the returned value with vlc_object_release
+ */
+static inline input_thread_t *filter_GetInput( filter_t *p_filter )
+{
+    if( !p_filter->pf_get_input )
+        return NULL;
+    return p_filter->pf_get_input( p_filter );
+}
+
 /**
  * It creates a blend filter.
  *
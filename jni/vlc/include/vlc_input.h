@@ -532,8 +532,13 @@ VLC_API input_thread_t * input_Create( vlc_object_t *p_parent, input_item_t *, c
 VLC_API input_thread_t * input_CreateAndStart( vlc_object_t *p_parent, input_item_t *, const char *psz_log ) VLC_USED;
 #define input_CreateAndStart(a,b,c) input_CreateAndStart(VLC_OBJECT(a),b,c)
 
+VLC_API input_thread_t * input_CreatePreload( vlc_object_t *p_parent, input_item_t *, const char *psz_log, input_resource_t * ) VLC_USED;
+#define input_CreatePreload(a,b,c,d) input_CreatePreload(VLC_OBJECT(a),b,c,d)
+
 VLC_API int input_Start( input_thread_t * );
 
+VLC_API int input_Activate( input_thread_t * );
+
 VLC_API void input_Stop( input_thread_t *, bool b_abort );
 
 VLC_API int input_Read( vlc_object_t *, input_item_t * );
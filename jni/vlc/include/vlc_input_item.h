@@ -288,6 +288,7 @@ struct input_stats_t
     float f_average_demux_bitrate;
     int64_t i_demux_corrupted;
     int64_t i_demux_discontinuity;
+    int64_t i_demux_probe_time; /* to find the demuxer, in microseconds */
 
     /* Decoders */
     int64_t i_decoded_audio;
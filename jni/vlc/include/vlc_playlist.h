@@ -291,6 +291,15 @@ VLC_API void playlist_Clear( playlist_t *, bool );
 /** Enqueue an input item for preparsing */
 VLC_API int playlist_PreparseEnqueue(playlist_t *, input_item_t * );
 
+/** Enqueue an input item for preparsing ahead of the others, or move it ahead
+ * if it is already queued (for instance once it is shown) */
+VLC_API int playlist_PreparsePrioritize(playlist_t *, input_item_t * );
+
+/** Remove an input item from the preparsing queue, if it is not being
+ * preparsed yet. It is not marked as preparsed, so nobody must be waiting
+ * for it. */
+VLC_API void playlist_PreparseCancel(playlist_t *, input_item_t * );
+
 /** Request the art for an input item to be fetched */
 VLC_API int playlist_AskForArtEnqueue(playlist_t *, input_item_t * );
 
@@ -87,6 +87,18 @@ struct subpicture_region_t
  */
 VLC_API subpicture_region_t * subpicture_region_New( const video_format_t *p_fmt );
 
+/**
+ * This function will create a new subpicture region showing the given
+ * picture instead of allocating a new one.
+ *
+ * The picture is held by the region. The offsets and visible size of the
+ * format select the part of the picture to be displayed, which allows a
+ * single picture to be shared by several regions.
+ *
+ * You must use subpicture_region_Delete to destroy it.
+ */
+VLC_API subpicture_region_t * subpicture_region_NewFromPicture( const video_format_t *p_fmt, picture_t *p_picture );
+
 /**
  * This function will destroy a subpicture region allocated by
  * subpicture_region_New.
@@ -119,6 +131,9 @@ typedef struct
                          mtime_t );
     void (*pf_destroy) ( subpicture_t * );
     subpicture_updater_sys_t *p_sys;
+    /* The update only depends on the subpicture, it may be done ahead of
+     * time by another thread than the video output one */
+    bool b_stateless;
 } subpicture_updater_t;
 
 typedef struct subpicture_private_t subpicture_private_t;
@@ -0,0 +1,77 @@
+/*****************************************************************************
+ * vlc_thumbnailer.h : fast keyframe thumbnail extraction
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THUMBNAILER_H
+#define VLC_THUMBNAILER_H 1
+
+/**
+ * \file
+ * This file defines the thumbnailer, which decodes a single keyframe of a
+ * media without any input thread, audio or video output
+ */
+
+#include <vlc_picture.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/**
+ * Extracts the first keyframe at or after i_time (in microseconds, or a
+ * negative value for a third of the duration) of psz_mrl, scaled to fit in
+ * p_fmt->i_width x p_fmt->i_height while keeping the aspect ratio, in the
+ * chroma of p_fmt (VLC_CODEC_RGB16 for RGB565, or VLC_CODEC_RGBA).
+ *
+ * \return a picture to release with picture_Release, or NULL
+ */
+VLC_API picture_t * vlc_thumbnail_Extract( vlc_object_t *, const char *psz_mrl, mtime_t i_time, const video_format_t *p_fmt ) VLC_USED;
+#define vlc_thumbnail_Extract( a, b, c, d ) vlc_thumbnail_Extract( VLC_OBJECT(a), b, c, d )
+
+/**
+ * Called from a worker thread of the thumbnailer once a request is done.
+ * p_pic is NULL on failure, or else belongs to the callback.
+ */
+typedef void (*vlc_thumbnailer_cb)( void *p_data, const char *psz_mrl,
+                                    picture_t *p_pic );
+
+typedef struct vlc_thumbnailer_t vlc_thumbnailer_t;
+
+/**
+ * Creates a pool of i_workers threads running vlc_thumbnail_Extract.
+ */
+VLC_API vlc_thumbnailer_t * vlc_thumbnailer_Create( vlc_object_t *, unsigned i_workers ) VLC_USED;
+#define vlc_thumbnailer_Create( a, b ) vlc_thumbnailer_Create( VLC_OBJECT(a), b )
+
+/**
+ * Queues a request. The callback is invoked exactly once if this succeeds.
+ */
+VLC_API int vlc_thumbnailer_Request( vlc_thumbnailer_t *, const char *psz_mrl, mtime_t i_time, const video_format_t *p_fmt, vlc_thumbnailer_cb pf_done, void *p_data );
+
+/**
+ * Cancels the queued requests (their callback gets a NULL picture), waits
+ * for the running ones and destroys the pool.
+ */
+VLC_API void vlc_thumbnailer_Delete( vlc_thumbnailer_t * );
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif /* VLC_THUMBNAILER_H */
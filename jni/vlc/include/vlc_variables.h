@@ -191,6 +191,26 @@ VLC_API int var_TriggerCallback( vlc_object_t *, const char * );
 #define var_DelCallback(a,b,c,d) var_DelCallback( VLC_OBJECT(a), b, c, d )
 #define var_TriggerCallback(a,b) var_TriggerCallback( VLC_OBJECT(a), b )
 
+/*****************************************************************************
+ * Variable handles
+ *****************************************************************************
+ * They avoid looking the variable up by name, for variables which are read
+ * or written very often.
+ *****************************************************************************/
+typedef struct variable_t var_handle_t;
+
+VLC_API var_handle_t * var_Acquire( vlc_object_t *, const char * ) VLC_USED;
+VLC_API void var_Release( vlc_object_t *, var_handle_t * );
+VLC_API int var_GetHandle( vlc_object_t *, var_handle_t *, int, vlc_value_t * );
+VLC_API int var_SetHandle( vlc_object_t *, var_handle_t *, int, vlc_value_t );
+VLC_API void var_StoreHandle( vlc_object_t *, var_handle_t *, vlc_value_t );
+
+#define var_Acquire(a,b) var_Acquire( VLC_OBJECT(a), b )
+#define var_Release(a,b) var_Release( VLC_OBJECT(a), b )
+#define var_GetHandle(a,b,c,d) var_GetHandle( VLC_OBJECT(a), b, c, d )
+#define var_SetHandle(a,b,c,d) var_SetHandle( VLC_OBJECT(a), b, c, d )
+#define var_StoreHandle(a,b,c) var_StoreHandle( VLC_OBJECT(a), b, c )
+
 /*****************************************************************************
  * helpers functions
  *****************************************************************************/
@@ -445,6 +465,64 @@ static inline int64_t var_DecInteger( vlc_object_t *p_obj, const char *psz_name
 }
 #define var_DecInteger(a,b) var_DecInteger( VLC_OBJECT(a), b )
 
+/**
+ * Get an integer value from a variable handle
+ */
+VLC_USED
+static inline int64_t var_GetIntegerHandle( vlc_object_t *p_obj,
+                                            var_handle_t *p_var )
+{
+    vlc_value_t val;
+    if( !var_GetHandle( p_obj, p_var, VLC_VAR_INTEGER, &val ) )
+        return val.i_int;
+    else
+        return 0;
+}
+
+/**
+ * Get a time value from a variable handle
+ */
+VLC_USED
+static inline int64_t var_GetTimeHandle( vlc_object_t *p_obj,
+                                         var_handle_t *p_var )
+{
+    vlc_value_t val;
+    if( !var_GetHandle( p_obj, p_var, VLC_VAR_TIME, &val ) )
+        return val.i_time;
+    else
+        return 0;
+}
+
+/**
+ * Get a float value from a variable handle
+ */
+VLC_USED
+static inline float var_GetFloatHandle( vlc_object_t *p_obj,
+                                        var_handle_t *p_var )
+{
+    vlc_value_t val;
+    if( !var_GetHandle( p_obj, p_var, VLC_VAR_FLOAT, &val ) )
+        return val.f_float;
+    else
+        return 0.0;
+}
+
+/**
+ * Set an integer value through a variable handle
+ */
+static inline int var_SetIntegerHandle( vlc_object_t *p_obj,
+                                        var_handle_t *p_var, int64_t i )
+{
+    vlc_value_t val;
+    val.i_int = i;
+    return var_SetHandle( p_obj, p_var, VLC_VAR_INTEGER, val );
+}
+
+#define var_GetIntegerHandle(a,b)   var_GetIntegerHandle( VLC_OBJECT(a),b)
+#define var_GetTimeHandle(a,b)      var_GetTimeHandle( VLC_OBJECT(a),b)
+#define var_GetFloatHandle(a,b)     var_GetFloatHandle( VLC_OBJECT(a),b)
+#define var_SetIntegerHandle(a,b,c) var_SetIntegerHandle( VLC_OBJECT(a),b,c)
+
 static inline uint64_t var_OrInteger( vlc_object_t *obj, const char *name,
                                       unsigned v )
 {
@@ -101,7 +101,8 @@ LOCAL_C_INCLUDES += \
     $(VLCROOT)/src
 
 LOCAL_SRC_FILES := \
-    http.c
+    http.c \
+    http_cache.c
 
 include $(BUILD_STATIC_LIBRARY)
 
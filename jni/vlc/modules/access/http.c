@@ -54,6 +54,8 @@
 
 #include <assert.h>
 
+#include "http_cache.h"
+
 #ifdef HAVE_LIBPROXY
 #    include <proxy.h>
 #endif
@@ -103,6 +105,26 @@ static void Close( vlc_object_t * );
 #define UA_TEXT N_("User Agent")
 #define UA_LONGTEXT N_("You can use a custom User agent or use a known one")
 
+#define CACHE_TEXT N_("Disk cache")
+#define CACHE_LONGTEXT N_( \
+    "Keep the downloaded parts of the files on the disk, to seek back " \
+    "and to play them again without the network." )
+
+#define CACHE_DIR_TEXT N_("Disk cache directory")
+#define CACHE_DIR_LONGTEXT N_( \
+    "Directory of the disk cache, in the cache directory of the user " \
+    "if empty." )
+
+#define CACHE_SIZE_TEXT N_("Disk cache size (MiB)")
+#define CACHE_SIZE_LONGTEXT N_( \
+    "The least recently played files are removed from the disk cache " \
+    "beyond this size." )
+
+#define CACHE_RATE_TEXT N_("Background download rate (KiB/s)")
+#define CACHE_RATE_LONGTEXT N_( \
+    "The missing parts of the file being played are downloaded to the " \
+    "disk cache in the background at this rate (0 to disable)." )
+
 vlc_module_begin ()
     set_description( N_("HTTP input") )
     set_capability( "access", 0 )
@@ -129,6 +151,15 @@ vlc_module_begin ()
         change_safe()
     add_bool( "http-forward-cookies", true, FORWARD_COOKIES_TEXT,
               FORWARD_COOKIES_LONGTEXT, true )
+    add_bool( "http-cache", false, CACHE_TEXT, CACHE_LONGTEXT, true )
+    add_directory( "http-cache-dir", NULL, CACHE_DIR_TEXT,
+                   CACHE_DIR_LONGTEXT, true )
+    add_integer( "http-cache-size", 500, CACHE_SIZE_TEXT,
+                 CACHE_SIZE_LONGTEXT, true )
+        change_integer_range( 1, INT_MAX )
+    add_integer( "http-cache-rate", 256, CACHE_RATE_TEXT,
+                 CACHE_RATE_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
     /* 'itpc' = iTunes Podcast */
     add_shortcut( "http", "https", "unsv", "itpc", "icyx" )
     set_callbacks( Open, Close )
@@ -196,11 +227,26 @@ struct access_sys_t
     bool b_has_size;
 
     vlc_array_t * cookies;
+
+    /* Disk cache */
+    http_cache_t *p_cache;
+    bool          b_cache_write;
+
+    /* Background download of the missing parts */
+    vlc_object_t *p_filler;
+    vlc_thread_t  filler;
+    vlc_mutex_t   filler_lock;
+    vlc_cond_t    filler_wait;
+    bool          b_filler_stop;
+    uint64_t      i_filler_reader;  /* position of the reader */
+    mtime_t       i_filler_read;    /* date of the last read */
+    unsigned      i_filler_rate;
 };
 
 /* */
 static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
-                            unsigned i_redirect, vlc_array_t *cookies );
+                            unsigned i_redirect, vlc_array_t *cookies,
+                            http_cache_t *p_cache );
 
 /* */
 static ssize_t Read( access_t *, uint8_t *, size_t );
@@ -213,6 +259,12 @@ static int Connect( access_t *, uint64_t );
 static int Request( access_t *p_access, uint64_t i_tell );
 static void Disconnect( access_t * );
 
+/* */
+static http_cache_t *CacheOpen( access_t * );
+static void CacheCheck( access_t *, uint64_t i_tell );
+static void FillerStart( access_t * );
+static void FillerStop( access_t * );
+
 /* Small Cookie utilities. Cookies support is partial. */
 static char * cookie_get_content( const char * cookie );
 static char * cookie_get_domain( const char * cookie );
@@ -231,7 +283,16 @@ static int AuthCheckReply( access_t *p_access, const char *psz_header,
 static int Open( vlc_object_t *p_this )
 {
     access_t *p_access = (access_t*)p_this;
-    return OpenWithCookies( p_this, p_access->psz_access, 5, NULL );
+
+    /* The cache entry is named after the URL before any redirection */
+    http_cache_t *p_cache = NULL;
+    if( var_InheritBool( p_access, "http-cache" ) &&
+        !var_InheritBool( p_access, "http-continuous" ) &&
+        ( !strcmp( p_access->psz_access, "http" ) ||
+          !strcmp( p_access->psz_access, "https" ) ) )
+        p_cache = CacheOpen( p_access );
+
+    return OpenWithCookies( p_this, p_access->psz_access, 5, NULL, p_cache );
 }
 
 /**
@@ -241,10 +302,12 @@ static int Open( vlc_object_t *p_this )
  *              instead of p_access->psz_access)
  * @i_redirect: number of redirections remaining
  * @cookies: the available cookies
+ * @p_cache: the disk cache, or NULL
  * @return vlc error codes
  */
 static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
-                            unsigned i_redirect, vlc_array_t *cookies )
+                            unsigned i_redirect, vlc_array_t *cookies,
+                            http_cache_t *p_cache )
 {
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *p_sys;
@@ -298,6 +361,9 @@ static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
     p_access->info.b_eof  = false;
 
     p_sys->cookies = saved_cookies;
+    p_sys->p_cache = p_cache;
+    p_sys->b_cache_write = false;
+    p_sys->p_filler = NULL;
 
     http_auth_Init( &p_sys->auth );
     http_auth_Init( &p_sys->proxy_auth );
@@ -482,6 +548,18 @@ static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
     p_sys->b_reconnect = var_InheritBool( p_access, "http-reconnect" );
     p_sys->b_continuous = var_InheritBool( p_access, "http-continuous" );
 
+    if( p_sys->p_cache != NULL && http_cache_IsComplete( p_sys->p_cache ) )
+    {
+        /* Played from the disk only */
+        msg_Dbg( p_access, "playing from the disk cache" );
+        p_sys->psz_protocol = "HTTP";
+        p_sys->i_code = 200;
+        p_sys->psz_mime = http_cache_GetContentType( p_sys->p_cache );
+        p_sys->b_has_size = true;
+        p_access->info.i_size = http_cache_GetSize( p_sys->p_cache );
+        goto cached;
+    }
+
 connect:
     /* Connect */
     switch( Connect( p_access, 0 ) )
@@ -589,7 +667,7 @@ connect:
 
         /* Do new Open() run with new data */
         return OpenWithCookies( p_this, psz_protocol, i_redirect - 1,
-                                cookies );
+                                cookies, p_cache );
     }
 
     if( p_sys->b_mms )
@@ -598,6 +676,7 @@ connect:
         goto error;
     }
 
+cached:
     if( !strcmp( p_sys->psz_protocol, "ICY" ) || p_sys->b_icecast )
     {
         if( p_sys->psz_mime && strcasecmp( p_sys->psz_mime, "application/ogg" ) )
@@ -663,6 +742,9 @@ connect:
     /* PTS delay */
     var_Create( p_access, "http-caching", VLC_VAR_INTEGER |VLC_VAR_DOINHERIT );
 
+    if( p_sys->p_cache != NULL )
+        FillerStart( p_access );
+
     return VLC_SUCCESS;
 
 error:
@@ -688,6 +770,8 @@ error:
 #ifdef HAVE_ZLIB_H
     inflateEnd( &p_sys->inflate.stream );
 #endif
+    if( p_sys->p_cache != NULL )
+        http_cache_Delete( p_sys->p_cache );
     free( p_sys );
     return VLC_EGENERIC;
 }
@@ -700,6 +784,12 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *p_sys = p_access->p_sys;
 
+    /* The filler uses the URL */
+    if( p_sys->p_filler != NULL )
+        FillerStop( p_access );
+    if( p_sys->p_cache != NULL )
+        http_cache_Delete( p_sys->p_cache );
+
     vlc_UrlClean( &p_sys->url );
     http_auth_Reset( &p_sys->auth );
     vlc_UrlClean( &p_sys->proxy );
@@ -744,6 +834,34 @@ static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
     access_sys_t *p_sys = p_access->p_sys;
     int i_read;
 
+    if( p_sys->p_cache != NULL )
+    {
+        if( p_sys->p_filler != NULL )
+        {
+            vlc_mutex_lock( &p_sys->filler_lock );
+            p_sys->i_filler_reader = p_access->info.i_pos;
+            p_sys->i_filler_read = mdate();
+            vlc_mutex_unlock( &p_sys->filler_lock );
+        }
+
+        i_read = http_cache_Read( p_sys->p_cache, p_access->info.i_pos,
+                                  p_buffer, i_len );
+        if( i_read > 0 )
+        {
+            /* The connection would lag behind */
+            if( p_sys->fd != -1 )
+                Disconnect( p_access );
+            p_access->info.i_pos += i_read;
+            return i_read;
+        }
+
+        /* Downloads the next gap */
+        if( p_sys->fd == -1 &&
+            p_access->info.i_pos < p_access->info.i_size &&
+            Connect( p_access, p_access->info.i_pos ) )
+            goto fatal;
+    }
+
     if( p_sys->fd == -1 )
         goto fatal;
 
@@ -809,6 +927,10 @@ static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
 
     if( i_read > 0 )
     {
+        if( p_sys->b_cache_write )
+            http_cache_Write( p_sys->p_cache, p_access->info.i_pos,
+                              p_buffer, i_read );
+
         if( p_sys->b_chunked )
         {
             p_sys->i_chunk -= i_read;
@@ -988,10 +1110,21 @@ static ssize_t ReadCompressed( access_t *p_access, uint8_t *p_buffer,
  *****************************************************************************/
 static int Seek( access_t *p_access, uint64_t i_pos )
 {
+    access_sys_t *p_sys = p_access->p_sys;
+
     msg_Dbg( p_access, "trying to seek to %"PRId64, i_pos );
 
     Disconnect( p_access );
 
+    if( p_sys->p_cache != NULL &&
+        http_cache_Available( p_sys->p_cache, i_pos ) > 0 )
+    {
+        /* Read() reconnects at the end of the cached range */
+        p_access->info.i_pos = i_pos;
+        p_access->info.b_eof = false;
+        return VLC_SUCCESS;
+    }
+
     if( p_access->info.i_size
      && i_pos >= p_access->info.i_size ) {
         msg_Err( p_access, "seek to far" );
@@ -1206,7 +1339,11 @@ static int Connect( access_t *p_access, uint64_t i_tell )
         p_sys->p_vs = &p_sys->p_tls->sock;
     }
 
-    return Request( p_access, i_tell ) ? -2 : 0;
+    if( Request( p_access, i_tell ) )
+        return -2;
+    if( p_sys->p_cache != NULL )
+        CacheCheck( p_access, i_tell );
+    return 0;
 }
 
 
@@ -1633,6 +1770,267 @@ static void Disconnect( access_t *p_access )
 
 }
 
+/*****************************************************************************
+ * Disk cache:
+ *****************************************************************************/
+static http_cache_t *CacheOpen( access_t *p_access )
+{
+    char *psz_dir = var_InheritString( p_access, "http-cache-dir" );
+    if( psz_dir == NULL )
+    {
+        char *psz_cache = config_GetUserDir( VLC_CACHE_DIR );
+        if( psz_cache == NULL ||
+            asprintf( &psz_dir, "%s"DIR_SEP"http", psz_cache ) == -1 )
+            psz_dir = NULL;
+        free( psz_cache );
+        if( psz_dir == NULL )
+            return NULL;
+    }
+
+    char *psz_url;
+    http_cache_t *p_cache = NULL;
+    if( asprintf( &psz_url, "%s://%s", p_access->psz_access,
+                  p_access->psz_location ) != -1 )
+    {
+        const uint64_t i_max_size =
+            (uint64_t)var_InheritInteger( p_access, "http-cache-size" ) << 20;
+        p_cache = http_cache_New( p_access, psz_dir, i_max_size, psz_url );
+        free( psz_url );
+    }
+    free( psz_dir );
+    return p_cache;
+}
+
+/* Only the identity of the whole resource is stored, at its offsets */
+static void CacheCheck( access_t *p_access, uint64_t i_tell )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->b_cache_write = p_sys->fd != -1 &&
+                           p_sys->i_code / 100 == 2 &&
+                           ( i_tell == 0 || p_sys->i_code == 206 ) &&
+                           !strcmp( p_sys->psz_protocol, "HTTP" ) &&
+                           p_sys->b_has_size && p_sys->i_icy_meta == 0;
+#ifdef HAVE_ZLIB_H
+    if( p_sys->b_compressed )
+        p_sys->b_cache_write = false;
+#endif
+    if( p_sys->b_cache_write )
+        http_cache_SetInfo( p_sys->p_cache, p_access->info.i_size,
+                            p_sys->psz_mime );
+}
+
+/* Size of the requests of the filler, and of its reads */
+#define FILLER_CHUNK    (1 << 20)
+#define FILLER_READ     (16 << 10)
+#define FILLER_RETRIES  3
+/* The gap of the reader is left to it, unless it stopped reading */
+#define FILLER_IDLE     (2 * CLOCK_FREQ)
+
+/* Waits until the given date, returns false if the filler must stop */
+static bool FillerWait( access_sys_t *p_sys, mtime_t i_date )
+{
+    vlc_mutex_lock( &p_sys->filler_lock );
+    while( !p_sys->b_filler_stop &&
+           vlc_cond_timedwait( &p_sys->filler_wait, &p_sys->filler_lock,
+                               i_date ) == 0 );
+    const bool b_alive = !p_sys->b_filler_stop;
+    vlc_mutex_unlock( &p_sys->filler_lock );
+    return b_alive;
+}
+
+/* The reader downloads the gap it is in: the filler takes the next ones,
+ * then the ones behind the reader for the backward seeks. The gap of an idle
+ * reader, paused or done with the stream, is the filler's first */
+static bool FillerNextGap( access_sys_t *p_sys, uint64_t *pi_start,
+                           uint64_t *pi_end )
+{
+    vlc_mutex_lock( &p_sys->filler_lock );
+    const uint64_t i_reader = p_sys->i_filler_reader;
+    const bool b_idle = mdate() - p_sys->i_filler_read > FILLER_IDLE;
+    vlc_mutex_unlock( &p_sys->filler_lock );
+
+    if( http_cache_GetGap( p_sys->p_cache, i_reader, pi_start, pi_end ) &&
+        ( *pi_start > i_reader || b_idle ||
+          http_cache_GetGap( p_sys->p_cache, *pi_end, pi_start, pi_end ) ) )
+        return true;
+
+    if( !http_cache_GetGap( p_sys->p_cache, 0, pi_start, pi_end ) ||
+        *pi_start >= i_reader )
+        return false;
+    if( *pi_end > i_reader )
+        *pi_end = i_reader;
+    return true;
+}
+
+/* Downloads [i_start, i_end) to the cache at the configured rate */
+static int FillerFetch( access_t *p_access, uint64_t i_start, uint64_t i_end,
+                        uint8_t *p_buffer )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    vlc_object_t *p_obj = p_sys->p_filler;
+    const char *psz_path = p_sys->url.psz_path && *p_sys->url.psz_path ?
+                           p_sys->url.psz_path : "/";
+    char *psz;
+
+    int fd = net_ConnectTCP( p_obj, p_sys->url.psz_host, p_sys->url.i_port );
+    if( fd == -1 )
+        return VLC_EGENERIC;
+
+    net_Printf( p_obj, fd, NULL, "GET %s HTTP/1.0\r\nHost: %s:%d\r\n"
+                "User-Agent: %s\r\nRange: bytes=%"PRIu64"-%"PRIu64"\r\n",
+                psz_path, p_sys->url.psz_host, p_sys->url.i_port,
+                p_sys->psz_user_agent, i_start, i_end - 1 );
+    if( p_sys->psz_referrer )
+        net_Printf( p_obj, fd, NULL, "Referer: %s\r\n",
+                    p_sys->psz_referrer );
+    if( net_Printf( p_obj, fd, NULL, "\r\n" ) < 0 ||
+        ( psz = net_Gets( p_obj, fd, NULL ) ) == NULL )
+        goto error;
+
+    unsigned i_code = 0;
+    sscanf( psz, "HTTP/%*u.%*u %3u", &i_code );
+    free( psz );
+    if( i_code != 206 )
+        goto error;
+
+    /* Only the start of the range matters */
+    uint64_t i_first = UINT64_MAX;
+    while( ( psz = net_Gets( p_obj, fd, NULL ) ) != NULL && *psz != '\0' )
+    {
+        if( !strncasecmp( psz, "Content-Range:", 14 ) )
+            sscanf( &psz[14], " bytes %"SCNu64, &i_first );
+        free( psz );
+    }
+    if( psz == NULL || i_first != i_start )
+    {
+        free( psz );
+        goto error;
+    }
+    free( psz );
+
+    const unsigned i_rate = p_sys->i_filler_rate;
+    mtime_t i_date = mdate();
+    while( i_start < i_end )
+    {
+        const size_t i_len = __MIN( FILLER_READ, i_end - i_start );
+        const ssize_t i_read = net_Read( p_obj, fd, NULL, p_buffer, i_len,
+                                         false );
+        if( i_read <= 0 )
+            break;
+
+        http_cache_Write( p_sys->p_cache, i_start, p_buffer, i_read );
+        i_start += i_read;
+
+        i_date += CLOCK_FREQ * i_read / i_rate;
+        if( !FillerWait( p_sys, i_date ) )
+            break;
+    }
+    net_Close( fd );
+    return i_start == i_end ? VLC_SUCCESS : VLC_EGENERIC;
+
+error:
+    net_Close( fd );
+    return VLC_EGENERIC;
+}
+
+static void *Filler( void *p_data )
+{
+    access_t *p_access = p_data;
+    access_sys_t *p_sys = p_access->p_sys;
+    unsigned i_failures = 0;
+
+    uint8_t *p_buffer = malloc( FILLER_READ );
+    if( p_buffer == NULL )
+        return NULL;
+
+    while( i_failures < FILLER_RETRIES && FillerWait( p_sys, 0 ) )
+    {
+        uint64_t i_start, i_end;
+        if( !FillerNextGap( p_sys, &i_start, &i_end ) )
+        {
+            if( http_cache_IsComplete( p_sys->p_cache ) )
+            {
+                msg_Dbg( p_sys->p_filler, "download complete" );
+                break;
+            }
+            /* Only the gap of the reader is left, until it seeks or stops */
+            FillerWait( p_sys, mdate() + CLOCK_FREQ );
+            continue;
+        }
+
+        if( i_end - i_start > FILLER_CHUNK )
+            i_end = i_start + FILLER_CHUNK;
+        if( FillerFetch( p_access, i_start, i_end, p_buffer ) )
+        {
+            msg_Dbg( p_sys->p_filler, "cannot download %"PRIu64"-%"PRIu64,
+                     i_start, i_end - 1 );
+            i_failures++;
+            FillerWait( p_sys, mdate() + CLOCK_FREQ );
+        }
+        else
+            i_failures = 0;
+    }
+    free( p_buffer );
+    return NULL;
+}
+
+/* The filler sends plain requests, for the servers that need no more */
+static void FillerStart( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    const int64_t i_rate = var_InheritInteger( p_access, "http-cache-rate" );
+    if( i_rate <= 0 || !p_sys->b_seekable || !p_sys->b_has_size ||
+        p_sys->b_proxy || p_sys->b_ssl || p_sys->url.psz_username ||
+        ( p_sys->cookies && vlc_array_count( p_sys->cookies ) > 0 ) ||
+        http_cache_IsComplete( p_sys->p_cache ) )
+        return;
+
+    p_sys->p_filler = vlc_object_create( p_access, sizeof(vlc_object_t) );
+    if( p_sys->p_filler == NULL )
+        return;
+    vlc_mutex_init( &p_sys->filler_lock );
+    vlc_cond_init( &p_sys->filler_wait );
+    p_sys->b_filler_stop = false;
+    p_sys->i_filler_reader = p_access->info.i_pos;
+    p_sys->i_filler_read = mdate();
+    p_sys->i_filler_rate = __MIN( i_rate, INT_MAX / 1024 ) * 1024;
+
+    if( vlc_clone( &p_sys->filler, Filler, p_access,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_sys->filler_wait );
+        vlc_mutex_destroy( &p_sys->filler_lock );
+        vlc_object_release( p_sys->p_filler );
+        p_sys->p_filler = NULL;
+        return;
+    }
+    msg_Dbg( p_access, "downloading the missing parts at %"PRId64" KiB/s",
+             i_rate );
+}
+
+static void FillerStop( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock( &p_sys->filler_lock );
+    p_sys->b_filler_stop = true;
+    vlc_cond_signal( &p_sys->filler_wait );
+    vlc_mutex_unlock( &p_sys->filler_lock );
+
+    /* Aborts the blocking network calls. Deprecated like the
+     * vlc_object_alive() checks of the reader, but the net_*() functions
+     * have no other way to be woken up */
+    vlc_object_kill( p_sys->p_filler );
+    vlc_join( p_sys->filler, NULL );
+
+    vlc_cond_destroy( &p_sys->filler_wait );
+    vlc_mutex_destroy( &p_sys->filler_lock );
+    vlc_object_release( p_sys->p_filler );
+    p_sys->p_filler = NULL;
+}
+
 /*****************************************************************************
  * Cookies (FIXME: we may want to rewrite that using a nice structure to hold
  * them) (FIXME: only support the "domain=" param)
@@ -0,0 +1,584 @@
+/*****************************************************************************
+ * http_cache.c: persistent disk cache of the HTTP resources
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef WIN32
+# include <sys/file.h>
+#endif
+
+#include "http_cache.h"
+
+/* The map is saved after that many new bytes, so that little is lost if
+ * the process dies */
+#define SAVE_INTERVAL   (4 << 20)
+
+typedef struct
+{
+    uint64_t i_start;
+    uint64_t i_end;
+} http_range_t;
+
+struct http_cache_t
+{
+    vlc_object_t *p_obj;
+    vlc_mutex_t   lock;
+
+    char         *psz_dir;
+    char         *psz_name; /* of the entry, MD5 of the URL */
+    uint64_t      i_max_size;
+    int           fd;       /* of the data */
+
+    uint64_t      i_size;   /* of the resource, 0 if unknown */
+    char         *psz_mime;
+
+    /* Sorted, neither overlapping nor contiguous */
+    http_range_t *p_ranges;
+    size_t        i_ranges;
+    uint64_t      i_unsaved;
+};
+
+static char *Path( const http_cache_t *c, const char *psz_name,
+                   const char *psz_ext )
+{
+    char *psz_path;
+    if( asprintf( &psz_path, "%s"DIR_SEP"%s%s", c->psz_dir, psz_name,
+                  psz_ext ) == -1 )
+        return NULL;
+    return psz_path;
+}
+
+static void RangeAdd( http_cache_t *c, uint64_t i_start, uint64_t i_end )
+{
+    size_t i_first = 0;
+    while( i_first < c->i_ranges && c->p_ranges[i_first].i_end < i_start )
+        i_first++;
+
+    /* Merges the ranges touching the new one */
+    size_t i_last = i_first;
+    while( i_last < c->i_ranges && c->p_ranges[i_last].i_start <= i_end )
+    {
+        i_start = __MIN( i_start, c->p_ranges[i_last].i_start );
+        i_end = __MAX( i_end, c->p_ranges[i_last].i_end );
+        i_last++;
+    }
+
+    if( i_last == i_first )
+    {
+        http_range_t *p_ranges = realloc( c->p_ranges,
+                                  ( c->i_ranges + 1 ) * sizeof(*p_ranges) );
+        if( p_ranges == NULL )
+            return;
+        c->p_ranges = p_ranges;
+        memmove( &p_ranges[i_first + 1], &p_ranges[i_first],
+                 ( c->i_ranges - i_first ) * sizeof(*p_ranges) );
+        c->i_ranges++;
+    }
+    else
+    {
+        memmove( &c->p_ranges[i_first + 1], &c->p_ranges[i_last],
+                 ( c->i_ranges - i_last ) * sizeof(*c->p_ranges) );
+        c->i_ranges -= i_last - i_first - 1;
+    }
+    c->p_ranges[i_first].i_start = i_start;
+    c->p_ranges[i_first].i_end = i_end;
+}
+
+static void RangeClear( http_cache_t *c )
+{
+    free( c->p_ranges );
+    c->p_ranges = NULL;
+    c->i_ranges = 0;
+}
+
+static void Load( http_cache_t *c )
+{
+    char *psz_path = Path( c, c->psz_name, ".map" );
+    FILE *p_file = psz_path ? vlc_fopen( psz_path, "rt" ) : NULL;
+    free( psz_path );
+    if( p_file == NULL )
+        return;
+
+    /* "<size> <type>" then one "<start> <end>" line per range */
+    char psz_line[1024];
+    if( fgets( psz_line, sizeof(psz_line), p_file ) != NULL )
+    {
+        char *psz_mime;
+        psz_line[strcspn( psz_line, "\r\n" )] = '\0';
+        c->i_size = strtoull( psz_line, &psz_mime, 10 );
+        while( *psz_mime == ' ' )
+            psz_mime++;
+        if( *psz_mime != '\0' && strcmp( psz_mime, "-" ) )
+            c->psz_mime = strdup( psz_mime );
+
+        uint64_t i_start, i_end;
+        while( fscanf( p_file, "%"SCNu64" %"SCNu64, &i_start, &i_end ) == 2 )
+            if( i_start < i_end && i_end <= c->i_size )
+                RangeAdd( c, i_start, i_end );
+    }
+    fclose( p_file );
+
+    /* The data may have been removed behind our back */
+    struct stat st;
+    if( c->i_ranges > 0 &&
+        ( fstat( c->fd, &st ) ||
+          (uint64_t)st.st_size < c->p_ranges[c->i_ranges - 1].i_end ) )
+    {
+        msg_Warn( c->p_obj, "cache entry %s is truncated", c->psz_name );
+        RangeClear( c );
+    }
+}
+
+/* Adds the ranges saved by the other accesses to the same resource */
+static void Merge( http_cache_t *c )
+{
+    char *psz_path = Path( c, c->psz_name, ".map" );
+    FILE *p_file = psz_path ? vlc_fopen( psz_path, "rt" ) : NULL;
+    free( psz_path );
+    if( p_file == NULL )
+        return;
+
+    /* Like Load(), only the ranges of the data that is on the disk */
+    struct stat st;
+    uint64_t i_size, i_start, i_end;
+    if( !fstat( c->fd, &st ) &&
+        fscanf( p_file, "%"SCNu64"%*[^\n]", &i_size ) == 1 &&
+        i_size > 0 && i_size == c->i_size )
+        while( fscanf( p_file, "%"SCNu64" %"SCNu64, &i_start, &i_end ) == 2 )
+            if( i_start < i_end && i_end <= (uint64_t)st.st_size )
+                RangeAdd( c, i_start, i_end );
+    fclose( p_file );
+}
+
+/* Also marks the entry as the most recently used */
+static void Save( http_cache_t *c )
+{
+    Merge( c );
+
+    /* The temporary file is our own, the rename replaces the map at once */
+    char *psz_path = Path( c, c->psz_name, ".map" );
+    char *psz_tmp = Path( c, c->psz_name, ".map.XXXXXX" );
+    int fd = psz_tmp ? vlc_mkstemp( psz_tmp ) : -1;
+    FILE *p_file = fd != -1 ? fdopen( fd, "wt" ) : NULL;
+
+    if( p_file == NULL && fd != -1 )
+    {
+        close( fd );
+        vlc_unlink( psz_tmp );
+    }
+    if( p_file != NULL )
+    {
+        fprintf( p_file, "%"PRIu64" %s\n", c->i_size,
+                 c->psz_mime ? c->psz_mime : "-" );
+        for( size_t i = 0; i < c->i_ranges; i++ )
+            fprintf( p_file, "%"PRIu64" %"PRIu64"\n",
+                     c->p_ranges[i].i_start, c->p_ranges[i].i_end );
+
+        if( fclose( p_file ) || psz_path == NULL ||
+            vlc_rename( psz_tmp, psz_path ) )
+        {
+            msg_Warn( c->p_obj, "cannot save cache entry %s", c->psz_name );
+            vlc_unlink( psz_tmp );
+        }
+    }
+    c->i_unsaved = 0;
+    free( psz_tmp );
+    free( psz_path );
+}
+
+static void Remove( http_cache_t *c, const char *psz_name )
+{
+    static const char *const ppsz_ext[] = { ".map", ".data" };
+
+    for( unsigned i = 0; i < sizeof(ppsz_ext) / sizeof(*ppsz_ext); i++ )
+    {
+        char *psz_path = Path( c, psz_name, ppsz_ext[i] );
+        if( psz_path != NULL )
+            vlc_unlink( psz_path );
+        free( psz_path );
+    }
+}
+
+/* Removes the entry unless another access has it open: each access holds a
+ * shared lock on the data. flock() rather than fcntl(), whose locks are of
+ * the process and released as soon as any descriptor of the file is closed */
+static bool RemoveUnused( http_cache_t *c, const char *psz_name )
+{
+#ifndef WIN32
+    char *psz_path = Path( c, psz_name, ".data" );
+    int fd = psz_path ? vlc_open( psz_path, O_RDONLY ) : -1;
+    free( psz_path );
+
+    if( fd != -1 && flock( fd, LOCK_EX | LOCK_NB ) )
+    {
+        close( fd );
+        return false;
+    }
+    Remove( c, psz_name );
+    if( fd != -1 )
+        close( fd );
+#else
+    Remove( c, psz_name );
+#endif
+    return true;
+}
+
+typedef struct
+{
+    char    *psz_name;
+    time_t   i_date;    /* of the last use */
+    uint64_t i_size;    /* on the disk */
+} http_cache_entry_t;
+
+static int EntryCompare( const void *a, const void *b )
+{
+    const http_cache_entry_t *p_a = a, *p_b = b;
+    return ( p_a->i_date > p_b->i_date ) - ( p_a->i_date < p_b->i_date );
+}
+
+/* Removes the least recently used entries beyond the size limit, except the
+ * open ones */
+static void Trim( http_cache_t *c )
+{
+    DIR *p_dir = vlc_opendir( c->psz_dir );
+    if( p_dir == NULL )
+        return;
+
+    http_cache_entry_t *p_entries = NULL;
+    size_t i_entries = 0;
+    uint64_t i_total = 0;
+    char *psz_file;
+
+    while( ( psz_file = vlc_readdir( p_dir ) ) != NULL )
+    {
+        const size_t i_len = strlen( psz_file );
+        http_cache_entry_t *p_new;
+
+        if( i_len <= 4 || strcmp( &psz_file[i_len - 4], ".map" ) ||
+            ( p_new = realloc( p_entries, ( i_entries + 1 ) *
+                                          sizeof(*p_entries) ) ) == NULL )
+        {
+            free( psz_file );
+            continue;
+        }
+        p_entries = p_new;
+        psz_file[i_len - 4] = '\0';
+
+        http_cache_entry_t *p_entry = &p_entries[i_entries++];
+        p_entry->psz_name = psz_file;
+        p_entry->i_date = 0;
+        p_entry->i_size = 0;
+
+        struct stat st;
+        char *psz_path = Path( c, psz_file, ".map" );
+        if( psz_path != NULL && !vlc_stat( psz_path, &st ) )
+        {
+            p_entry->i_date = st.st_mtime;
+            p_entry->i_size += st.st_size;
+        }
+        free( psz_path );
+
+        /* The holes of the sparse files do not count */
+        psz_path = Path( c, psz_file, ".data" );
+        if( psz_path != NULL && !vlc_stat( psz_path, &st ) )
+#ifndef WIN32
+            p_entry->i_size += (uint64_t)st.st_blocks * 512;
+#else
+            p_entry->i_size += st.st_size;
+#endif
+        free( psz_path );
+
+        i_total += p_entry->i_size;
+    }
+    closedir( p_dir );
+
+    qsort( p_entries, i_entries, sizeof(*p_entries), EntryCompare );
+    for( size_t i = 0; i < i_entries && i_total > c->i_max_size; i++ )
+    {
+        if( !strcmp( p_entries[i].psz_name, c->psz_name ) ||
+            !RemoveUnused( c, p_entries[i].psz_name ) )
+            continue;
+
+        msg_Dbg( c->p_obj, "removed cache entry %s (%"PRIu64" bytes)",
+                 p_entries[i].psz_name, p_entries[i].i_size );
+        i_total -= p_entries[i].i_size;
+    }
+
+    for( size_t i = 0; i < i_entries; i++ )
+        free( p_entries[i].psz_name );
+    free( p_entries );
+}
+
+#undef http_cache_New
+http_cache_t *http_cache_New( vlc_object_t *p_obj, const char *psz_dir,
+                              uint64_t i_max_size, const char *psz_url )
+{
+    if( vlc_mkdir( psz_dir, 0700 ) && errno != EEXIST )
+    {
+        msg_Err( p_obj, "cannot create cache directory %s: %m", psz_dir );
+        return NULL;
+    }
+
+    http_cache_t *c = malloc( sizeof(*c) );
+    if( c == NULL )
+        return NULL;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_url, strlen( psz_url ) );
+    EndMD5( &md5 );
+
+    c->p_obj = p_obj;
+    c->psz_dir = strdup( psz_dir );
+    c->psz_name = psz_md5_hash( &md5 );
+    c->i_max_size = i_max_size;
+    c->i_size = 0;
+    c->psz_mime = NULL;
+    c->p_ranges = NULL;
+    c->i_ranges = 0;
+    c->i_unsaved = 0;
+
+    char *psz_path = NULL;
+    if( c->psz_dir == NULL || c->psz_name == NULL ||
+        ( psz_path = Path( c, c->psz_name, ".data" ) ) == NULL ||
+        ( c->fd = vlc_open( psz_path, O_RDWR | O_CREAT, 0600 ) ) == -1 )
+    {
+        msg_Err( p_obj, "cannot open cache entry for %s", psz_url );
+        free( psz_path );
+        free( c->psz_name );
+        free( c->psz_dir );
+        free( c );
+        return NULL;
+    }
+    free( psz_path );
+#ifndef WIN32
+    if( flock( c->fd, LOCK_SH ) )
+        msg_Warn( p_obj, "cannot lock cache entry %s: %m", c->psz_name );
+#endif
+    vlc_mutex_init( &c->lock );
+
+    Load( c );
+    Save( c );
+    Trim( c );
+
+    msg_Dbg( p_obj, "cache entry %s: %zu ranges of %"PRIu64" bytes",
+             c->psz_name, c->i_ranges, c->i_size );
+    return c;
+}
+
+void http_cache_Delete( http_cache_t *c )
+{
+    /* Nothing worth keeping without the size */
+    const bool b_keep = c->i_size > 0 && c->i_ranges > 0;
+    if( b_keep )
+        Save( c );
+    close( c->fd );
+    if( !b_keep )
+        RemoveUnused( c, c->psz_name );
+
+    /* The entry has grown */
+    Trim( c );
+
+    vlc_mutex_destroy( &c->lock );
+    RangeClear( c );
+    free( c->psz_mime );
+    free( c->psz_name );
+    free( c->psz_dir );
+    free( c );
+}
+
+void http_cache_SetInfo( http_cache_t *c, uint64_t i_size,
+                         const char *psz_mime )
+{
+    vlc_mutex_lock( &c->lock );
+    if( i_size != c->i_size )
+    {
+        if( c->i_ranges > 0 )
+            msg_Dbg( c->p_obj, "resource size changed, dropping the cache" );
+        RangeClear( c );
+        if( ftruncate( c->fd, 0 ) )
+            msg_Warn( c->p_obj, "cannot truncate cache entry: %m" );
+        c->i_size = i_size;
+    }
+    if( psz_mime != NULL &&
+        ( c->psz_mime == NULL || strcmp( c->psz_mime, psz_mime ) ) )
+    {
+        free( c->psz_mime );
+        c->psz_mime = strdup( psz_mime );
+    }
+    Save( c );
+    vlc_mutex_unlock( &c->lock );
+}
+
+uint64_t http_cache_GetSize( http_cache_t *c )
+{
+    vlc_mutex_lock( &c->lock );
+    const uint64_t i_size = c->i_size;
+    vlc_mutex_unlock( &c->lock );
+    return i_size;
+}
+
+char *http_cache_GetContentType( http_cache_t *c )
+{
+    vlc_mutex_lock( &c->lock );
+    char *psz_mime = c->psz_mime ? strdup( c->psz_mime ) : NULL;
+    vlc_mutex_unlock( &c->lock );
+    return psz_mime;
+}
+
+static bool IsComplete( const http_cache_t *c )
+{
+    return c->i_size > 0 && c->i_ranges == 1 &&
+           c->p_ranges[0].i_start == 0 && c->p_ranges[0].i_end == c->i_size;
+}
+
+bool http_cache_IsComplete( http_cache_t *c )
+{
+    vlc_mutex_lock( &c->lock );
+    const bool b_complete = IsComplete( c );
+    vlc_mutex_unlock( &c->lock );
+    return b_complete;
+}
+
+static uint64_t Available( http_cache_t *c, uint64_t i_pos )
+{
+    for( size_t i = 0; i < c->i_ranges; i++ )
+    {
+        if( c->p_ranges[i].i_start > i_pos )
+            break;
+        if( c->p_ranges[i].i_end > i_pos )
+            return c->p_ranges[i].i_end - i_pos;
+    }
+    return 0;
+}
+
+uint64_t http_cache_Available( http_cache_t *c, uint64_t i_pos )
+{
+    vlc_mutex_lock( &c->lock );
+    const uint64_t i_available = Available( c, i_pos );
+    vlc_mutex_unlock( &c->lock );
+    return i_available;
+}
+
+ssize_t http_cache_Read( http_cache_t *c, uint64_t i_pos, void *p_buf,
+                         size_t i_len )
+{
+    ssize_t i_read = 0;
+
+    vlc_mutex_lock( &c->lock );
+    const uint64_t i_available = Available( c, i_pos );
+    if( i_available > 0 )
+    {
+        if( i_len > i_available )
+            i_len = i_available;
+
+        if( lseek( c->fd, i_pos, SEEK_SET ) == (off_t)i_pos )
+            i_read = read( c->fd, p_buf, i_len );
+        if( i_read <= 0 )
+        {
+            /* Serves the network rather than a broken entry */
+            msg_Err( c->p_obj, "cannot read cache entry: %m" );
+            RangeClear( c );
+            i_read = 0;
+        }
+    }
+    vlc_mutex_unlock( &c->lock );
+    return i_read;
+}
+
+void http_cache_Write( http_cache_t *c, uint64_t i_pos, const void *p_buf,
+                       size_t i_len )
+{
+    const uint8_t *p = p_buf;
+
+    vlc_mutex_lock( &c->lock );
+    if( i_pos >= c->i_size )
+        goto out;
+    if( i_len > c->i_size - i_pos )
+        i_len = c->i_size - i_pos;
+
+    if( lseek( c->fd, i_pos, SEEK_SET ) != (off_t)i_pos )
+        goto error;
+    for( size_t i_done = 0; i_done < i_len; )
+    {
+        ssize_t i_ret = write( c->fd, &p[i_done], i_len - i_done );
+        if( i_ret < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            goto error;
+        }
+        i_done += i_ret;
+    }
+
+    const bool b_complete = IsComplete( c );
+    RangeAdd( c, i_pos, i_pos + i_len );
+    c->i_unsaved += i_len;
+    /* The other accesses see the complete entry at once */
+    if( c->i_unsaved >= SAVE_INTERVAL || ( !b_complete && IsComplete( c ) ) )
+        Save( c );
+out:
+    vlc_mutex_unlock( &c->lock );
+    return;
+
+error:
+    msg_Err( c->p_obj, "cannot write cache entry: %m" );
+    vlc_mutex_unlock( &c->lock );
+}
+
+bool http_cache_GetGap( http_cache_t *c, uint64_t i_pos,
+                        uint64_t *pi_start, uint64_t *pi_end )
+{
+    bool b_found = false;
+
+    vlc_mutex_lock( &c->lock );
+    for( size_t i = 0; i < c->i_ranges && !b_found; i++ )
+    {
+        if( c->p_ranges[i].i_end <= i_pos )
+            continue;
+        if( c->p_ranges[i].i_start > i_pos )
+        {
+            *pi_start = i_pos;
+            *pi_end = c->p_ranges[i].i_start;
+            b_found = true;
+        }
+        else
+            i_pos = c->p_ranges[i].i_end;
+    }
+    if( !b_found && i_pos < c->i_size )
+    {
+        *pi_start = i_pos;
+        *pi_end = c->i_size;
+        b_found = true;
+    }
+    vlc_mutex_unlock( &c->lock );
+    return b_found;
+}
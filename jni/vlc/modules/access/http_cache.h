@@ -0,0 +1,45 @@
+/*****************************************************************************
+ * http_cache.h: persistent disk cache of the HTTP resources
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The downloaded bytes of a resource are stored at their offset in a sparse
+ * file, next to the map of the ranges they cover. The entries of the
+ * directory are removed, least recently used first, beyond the size limit. */
+typedef struct http_cache_t http_cache_t;
+
+http_cache_t *http_cache_New( vlc_object_t *, const char *psz_dir,
+                              uint64_t i_max_size, const char *psz_url );
+#define http_cache_New(a,b,c,d) http_cache_New(VLC_OBJECT(a),b,c,d)
+void http_cache_Delete( http_cache_t * );
+
+/* Sets the size and type of the resource, the cached ranges are dropped if
+ * it has changed */
+void http_cache_SetInfo( http_cache_t *, uint64_t i_size, const char *psz_mime );
+uint64_t http_cache_GetSize( http_cache_t * );
+char *http_cache_GetContentType( http_cache_t * );
+bool http_cache_IsComplete( http_cache_t * );
+
+/* Returns the number of bytes cached from i_pos on */
+uint64_t http_cache_Available( http_cache_t *, uint64_t i_pos );
+ssize_t http_cache_Read( http_cache_t *, uint64_t i_pos, void *, size_t );
+void http_cache_Write( http_cache_t *, uint64_t i_pos, const void *, size_t );
+
+/* Finds the first missing range at or after i_pos */
+bool http_cache_GetGap( http_cache_t *, uint64_t i_pos,
+                        uint64_t *pi_start, uint64_t *pi_end );
@@ -0,0 +1,300 @@
+/*****************************************************************************
+ * biquad.h: banks of second order IIR sections for the audio filters
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * A bank is a set of second order sections fed with the same input, whose
+ * outputs are weighted and summed together with the input:
+ *
+ *   y_k[n] = b0_k x[n] + b1_k x[n-1] + b2_k x[n-2] - a1_k y_k[n-1] - a2_k y_k[n-2]
+ *   out[n] = dry x[n] + sum_k gain_k y_k[n]
+ *
+ * The sections are computed 4 at a time (NEON, SSE or plain C), a whole block
+ * of one channel at once, so a 10 bands equalizer costs 3 vector steps per
+ * sample. Unused sections have all their coefficients set to zero.
+ *
+ * The filters process float samples; the helpers at the end give a float
+ * view of FI32 blocks, so that they also work in the fixed point chains.
+ *
+ * The NEON kernel (biquad_neon.S) depends on the layout of the structures.
+ */
+
+#ifndef VLC_AUDIO_FILTER_BIQUAD_H
+#define VLC_AUDIO_FILTER_BIQUAD_H
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_cpu.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#define BIQUAD_MAX_SECTIONS 32
+
+typedef struct
+{
+    float    f_dry;
+    unsigned i_vectors;     /* number of groups of 4 sections */
+    unsigned i_sections;
+    float    f_reserved;
+    /* b0, b1, b2, a1, a2 and gain of 4 sections */
+    float    pf_coefs[BIQUAD_MAX_SECTIONS / 4][6][4];
+} biquad_bank_t;
+
+typedef struct
+{
+    float pf_x[4];  /* unused, x[n-1], x[n-2], unused */
+    float pf_y[BIQUAD_MAX_SECTIONS / 4][2][4]; /* y[n-1], y[n-2] */
+} biquad_state_t;
+
+enum
+{
+    BIQUAD_B0 = 0, BIQUAD_B1, BIQUAD_B2, BIQUAD_A1, BIQUAD_A2, BIQUAD_GAIN,
+};
+
+#ifdef HAVE_NEON
+void biquad_bank_neon( float *, const float *, unsigned, unsigned,
+                       const biquad_bank_t *, biquad_state_t * );
+#endif
+
+/*****************************************************************************
+ * Setup
+ *****************************************************************************/
+static inline void biquad_bank_Init( biquad_bank_t *p_bank, unsigned i_sections )
+{
+    assert( i_sections <= BIQUAD_MAX_SECTIONS );
+
+    memset( p_bank, 0, sizeof(*p_bank) );
+    p_bank->f_dry = 1.f;
+    p_bank->i_sections = i_sections;
+    p_bank->i_vectors = ( i_sections + 3 ) / 4;
+}
+
+static inline void biquad_bank_SetSection( biquad_bank_t *p_bank, unsigned i,
+                                           float b0, float b1, float b2,
+                                           float a1, float a2 )
+{
+    float (*pf)[4] = p_bank->pf_coefs[i / 4];
+
+    pf[BIQUAD_B0][i % 4] = b0;
+    pf[BIQUAD_B1][i % 4] = b1;
+    pf[BIQUAD_B2][i % 4] = b2;
+    pf[BIQUAD_A1][i % 4] = a1;
+    pf[BIQUAD_A2][i % 4] = a2;
+}
+
+static inline void biquad_bank_SetGain( biquad_bank_t *p_bank, unsigned i,
+                                        float f_gain )
+{
+    p_bank->pf_coefs[i / 4][BIQUAD_GAIN][i % 4] = f_gain;
+}
+
+/* Band pass of unity gain at the center frequency (Audio EQ Cookbook), with
+ * a bandwidth in octaves */
+static inline void biquad_bank_SetBandPass( biquad_bank_t *p_bank, unsigned i,
+                                            float f_frequency, float f_octaves,
+                                            unsigned i_rate )
+{
+    const double w0 = 2. * M_PI * f_frequency / i_rate;
+    const double alpha = sin( w0 ) * sinh( M_LN2 / 2. * f_octaves * w0 / sin( w0 ) );
+    const double a0 = 1. + alpha;
+
+    biquad_bank_SetSection( p_bank, i, alpha / a0, 0.f, -alpha / a0,
+                            -2. * cos( w0 ) / a0, ( 1. - alpha ) / a0 );
+}
+
+static inline void biquad_state_Reset( biquad_state_t *p_state )
+{
+    memset( p_state, 0, sizeof(*p_state) );
+}
+
+/*****************************************************************************
+ * Processing
+ *****************************************************************************/
+static inline void biquad_bank_ProcessC( float *p_out, const float *p_in,
+                                         unsigned i_count, unsigned i_stride,
+                                         const biquad_bank_t *p_bank,
+                                         biquad_state_t *p_state )
+{
+    float x1 = p_state->pf_x[1], x2 = p_state->pf_x[2];
+
+    for( unsigned n = 0; n < i_count; n++ )
+    {
+        const float x = p_in[n * i_stride];
+        float o = p_bank->f_dry * x;
+
+        for( unsigned v = 0; v < p_bank->i_vectors; v++ )
+        {
+            const float (*pf)[4] = p_bank->pf_coefs[v];
+            float *y1 = p_state->pf_y[v][0], *y2 = p_state->pf_y[v][1];
+
+            for( unsigned k = 0; k < 4; k++ )
+            {
+                const float y = pf[BIQUAD_B0][k] * x + pf[BIQUAD_B1][k] * x1
+                              + pf[BIQUAD_B2][k] * x2 - pf[BIQUAD_A1][k] * y1[k]
+                              - pf[BIQUAD_A2][k] * y2[k];
+                y2[k] = y1[k];
+                y1[k] = y;
+                o += pf[BIQUAD_GAIN][k] * y;
+            }
+        }
+        x2 = x1;
+        x1 = x;
+        p_out[n * i_stride] = o;
+    }
+    p_state->pf_x[1] = x1;
+    p_state->pf_x[2] = x2;
+}
+
+#if defined(__SSE2__)
+static inline void biquad_bank_ProcessSSE( float *p_out, const float *p_in,
+                                           unsigned i_count, unsigned i_stride,
+                                           const biquad_bank_t *p_bank,
+                                           biquad_state_t *p_state )
+{
+    float x1 = p_state->pf_x[1], x2 = p_state->pf_x[2];
+
+    for( unsigned n = 0; n < i_count; n++ )
+    {
+        const float x = p_in[n * i_stride];
+        const __m128 vx = _mm_set1_ps( x );
+        const __m128 vx1 = _mm_set1_ps( x1 );
+        const __m128 vx2 = _mm_set1_ps( x2 );
+        __m128 vo = _mm_setzero_ps();
+
+        for( unsigned v = 0; v < p_bank->i_vectors; v++ )
+        {
+            const float (*pf)[4] = p_bank->pf_coefs[v];
+            const __m128 y1 = _mm_loadu_ps( p_state->pf_y[v][0] );
+            const __m128 y2 = _mm_loadu_ps( p_state->pf_y[v][1] );
+            __m128 y;
+
+            y = _mm_mul_ps( _mm_loadu_ps( pf[BIQUAD_B0] ), vx );
+            y = _mm_add_ps( y, _mm_mul_ps( _mm_loadu_ps( pf[BIQUAD_B1] ), vx1 ) );
+            y = _mm_add_ps( y, _mm_mul_ps( _mm_loadu_ps( pf[BIQUAD_B2] ), vx2 ) );
+            y = _mm_sub_ps( y, _mm_mul_ps( _mm_loadu_ps( pf[BIQUAD_A1] ), y1 ) );
+            y = _mm_sub_ps( y, _mm_mul_ps( _mm_loadu_ps( pf[BIQUAD_A2] ), y2 ) );
+            _mm_storeu_ps( p_state->pf_y[v][1], y1 );
+            _mm_storeu_ps( p_state->pf_y[v][0], y );
+            vo = _mm_add_ps( vo, _mm_mul_ps( _mm_loadu_ps( pf[BIQUAD_GAIN] ), y ) );
+        }
+
+        /* horizontal sum */
+        vo = _mm_add_ps( vo, _mm_movehl_ps( vo, vo ) );
+        vo = _mm_add_ss( vo, _mm_shuffle_ps( vo, vo, 1 ) );
+        p_out[n * i_stride] = _mm_cvtss_f32( vo ) + p_bank->f_dry * x;
+
+        x2 = x1;
+        x1 = x;
+    }
+    p_state->pf_x[1] = x1;
+    p_state->pf_x[2] = x2;
+}
+#endif
+
+/* Filters i_count samples spaced by i_stride floats, can work in place */
+static inline void biquad_bank_Process( float *p_out, const float *p_in,
+                                        unsigned i_count, unsigned i_stride,
+                                        const biquad_bank_t *p_bank,
+                                        biquad_state_t *p_state )
+{
+    if( i_count == 0 )
+        return;
+#if defined(HAVE_NEON)
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+    {
+        biquad_bank_neon( p_out, p_in, i_count, i_stride * sizeof(float),
+                          p_bank, p_state );
+        return;
+    }
+#elif defined(__SSE2__)
+    biquad_bank_ProcessSSE( p_out, p_in, i_count, i_stride, p_bank, p_state );
+    return;
+#endif
+    biquad_bank_ProcessC( p_out, p_in, i_count, i_stride, p_bank, p_state );
+}
+
+/*****************************************************************************
+ * Float view of the audio blocks
+ *****************************************************************************/
+typedef struct
+{
+    float  *p_buffer;
+    size_t  i_size;     /* in samples */
+} biquad_scratch_t;
+
+static inline void biquad_scratch_Clean( biquad_scratch_t *p_scratch )
+{
+    free( p_scratch->p_buffer );
+    p_scratch->p_buffer = NULL;
+    p_scratch->i_size = 0;
+}
+
+/* Returns the samples of a FL32 or FI32 block as floats, NULL on error */
+static inline float *biquad_BlockGet( biquad_scratch_t *p_scratch,
+                                      vlc_fourcc_t i_format,
+                                      block_t *p_block, unsigned i_samples )
+{
+    if( i_format == VLC_CODEC_FL32 )
+        return (float *)p_block->p_buffer;
+
+    if( p_scratch->i_size < i_samples )
+    {
+        float *p = realloc( p_scratch->p_buffer, i_samples * sizeof(float) );
+        if( !p )
+            return NULL;
+        p_scratch->p_buffer = p;
+        p_scratch->i_size = i_samples;
+    }
+
+    const int32_t *p_in = (const int32_t *)p_block->p_buffer;
+    float *p_out = p_scratch->p_buffer;
+    for( unsigned i = 0; i < i_samples; i++ )
+        p_out[i] = p_in[i] * ( 1.f / FIXED32_ONE );
+    return p_out;
+}
+
+/* Writes back the floats returned by biquad_BlockGet() */
+static inline void biquad_BlockPut( const float *p_samples,
+                                    vlc_fourcc_t i_format,
+                                    block_t *p_block, unsigned i_samples )
+{
+    if( i_format == VLC_CODEC_FL32 )
+        return;
+
+    int32_t *p_out = (int32_t *)p_block->p_buffer;
+    for( unsigned i = 0; i < i_samples; i++ )
+    {
+        /* FI32 has 3 bits of head room */
+        const float f = p_samples[i] * FIXED32_ONE;
+        p_out[i] = f >= 2147483520.f ? INT32_MAX :
+                   f <= -2147483648.f ? INT32_MIN : (int32_t)f;
+    }
+}
+
+static inline bool biquad_IsFormatSupported( const audio_format_t *p_in,
+                                             const audio_format_t *p_out )
+{
+    return ( p_in->i_format == VLC_CODEC_FL32 || p_in->i_format == VLC_CODEC_FI32 )
+        && p_in->i_format == p_out->i_format;
+}
+
+#endif
@@ -39,6 +39,8 @@
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
+#include "biquad.h"
+
 /*****************************************************************************
 * Local prototypes.
 *****************************************************************************/
@@ -99,6 +101,9 @@ struct filter_sys_t
 
     vlc_mutex_t lock;
 
+    vlc_fourcc_t i_format;
+    biquad_scratch_t scratch;
+
     float f_rms_peak;
     float f_attack;
     float f_release;
@@ -212,8 +217,8 @@ static int Open( vlc_object_t *p_this )
     filter_sys_t *p_sys;
     float f_num;
 
-    if( p_filter->fmt_in.audio.i_format != VLC_CODEC_FL32 ||
-        p_filter->fmt_out.audio.i_format != VLC_CODEC_FL32 )
+    if( !biquad_IsFormatSupported( &p_filter->fmt_in.audio,
+                                   &p_filter->fmt_out.audio ) )
     {
         p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
         p_filter->fmt_out.audio.i_format = VLC_CODEC_FL32;
@@ -234,6 +239,7 @@ static int Open( vlc_object_t *p_this )
     {
         return VLC_ENOMEM;
     }
+    p_sys->i_format = p_filter->fmt_in.audio.i_format;
 
     /* Initialize the attack lookup table */
     p_sys->pf_as[0] = 1.0f;
@@ -302,6 +308,8 @@ static void Close( vlc_object_t *p_this )
     /* Destroy the mutex */
     vlc_mutex_destroy( &p_sys->lock );
 
+    biquad_scratch_Clean( &p_sys->scratch );
+
     /* Destroy the filter parameter structure */
     free( p_sys );
 }
@@ -314,11 +322,16 @@ static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
     int i_samples = p_in_buf->i_nb_samples;
     int i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
-    float *pf_buf = (float*)p_in_buf->p_buffer;
 
     /* Current parameters */
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    float *pf_samples = biquad_BlockGet( &p_sys->scratch, p_sys->i_format,
+                                         p_in_buf, i_samples * i_channels );
+    if( !pf_samples )
+        return p_in_buf;
+    float *pf_buf = pf_samples;
+
     /* Fetch the configurable parameters */
     vlc_mutex_lock( &p_sys->lock );
 
@@ -455,6 +468,8 @@ static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
     p_sys->f_env_rms  = f_env_rms;
     p_sys->f_env_peak = f_env_peak;
 
+    biquad_BlockPut( pf_samples, p_sys->i_format, p_in_buf,
+                     i_samples * i_channels );
     return p_in_buf;
 }
 
@@ -200,7 +200,8 @@ static block_t *Do_S16ToF32( filter_t * p_filter, block_t * p_in_buf )
 
     while( i-- )
     {
-        *p_out = (vlc_fixed_t)( (int32_t)(*p_in) * (FIXED32_ONE >> 16) );
+        /* INT16_MIN is -1.0, as for the conversion back to S16 */
+        *p_out = (vlc_fixed_t)( (int32_t)(*p_in) * (FIXED32_ONE >> 15) );
         p_in++; p_out++;
     }
 
@@ -0,0 +1,426 @@
+/*****************************************************************************
+ * fused.c : single pass fixed-point audio conversion and remixing
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble:
+ *
+ * Without this filter, a decoder to output conversion is split by the audio
+ * output core into a chain of filters, for example S16N -> FI32, FI32 channel
+ * mixing, then FI32 -> S16N, each one allocating a buffer and going over all
+ * the samples. This filter does the sample format conversion, the channel
+ * remixing and the dithering at once, in place whenever the output frames are
+ * not bigger than the input ones.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_cpu.h>
+
+#include <assert.h>
+
+/* S16N is FI32 without the 13 lowest bits: INT16_MIN and -FIXED32_ONE are
+ * both -1.0, like in the fixed and format converters */
+#define FUSED_S16_SHIFT     (FIXED32_FRACBITS - 15)
+/* Precision of the remixing coefficients */
+#define FUSED_MIX_SHIFT     14
+#define FUSED_MIX_ONE       (1 << FUSED_MIX_SHIFT)
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+vlc_module_begin ()
+    set_description( N_("Fused fixed-point audio conversions") )
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_MISC )
+    set_capability( "audio filter", 30 )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local structures
+ *****************************************************************************/
+struct filter_sys_t
+{
+    unsigned i_in_channels;
+    unsigned i_out_channels;
+    bool     b_in_s16;
+    bool     b_out_s16;
+    bool     b_remix;
+
+    /* Output channel, input channel, in FUSED_MIX_SHIFT fixed point */
+    int32_t  pi_matrix[AOUT_CHAN_MAX][AOUT_CHAN_MAX];
+
+    /* One dithering generator for each of 4 consecutive samples */
+    uint32_t pi_dither[4];
+
+    void (*pf_s16_fi32)( int32_t *, const int16_t *, unsigned );
+    void (*pf_fi32_s16)( int16_t *, const int32_t *, unsigned, uint32_t * );
+};
+
+static block_t *Convert( filter_t *, block_t * );
+
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************/
+#ifdef HAVE_NEON
+void fused_s16_fi32_neon( int32_t *, const int16_t *, unsigned );
+void fused_fi32_s16_neon( int16_t *, const int32_t *, unsigned, uint32_t * );
+#endif
+
+/* Triangular dither of +/- 1 S16N LSB, from the two halves of a linear
+ * congruential generator */
+static inline int32_t Dither( uint32_t *pi_state )
+{
+    *pi_state = *pi_state * 1664525 + 1013904223;
+    return ( (int32_t)(int16_t)*pi_state + ((int32_t)*pi_state >> 16) ) >> 3;
+}
+
+static inline int16_t ToS16( int32_t i_sample, uint32_t *pi_state )
+{
+    int64_t i = (int64_t)i_sample + Dither( pi_state );
+
+    i = ( i + (1 << (FUSED_S16_SHIFT - 1)) ) >> FUSED_S16_SHIFT;
+    return __MAX( INT16_MIN, __MIN( INT16_MAX, i ) );
+}
+
+static void S16ToFI32( int32_t *p_out, const int16_t *p_in, unsigned i_count )
+{
+    for( unsigned i = 0; i < i_count; i++ )
+        p_out[i] = (int32_t)p_in[i] << FUSED_S16_SHIFT;
+}
+
+/* Can work in place */
+static void FI32ToS16( int16_t *p_out, const int32_t *p_in, unsigned i_count,
+                       uint32_t *pi_dither )
+{
+    for( unsigned i = 0; i < i_count; i++ )
+        p_out[i] = ToS16( p_in[i], &pi_dither[i & 3] );
+}
+
+/* Can work in place if the output frames are not bigger than the input ones,
+ * as a whole input frame is read before its output frame is written */
+static void Remix( filter_sys_t *p_sys, uint8_t *p_out, const uint8_t *p_in,
+                   unsigned i_frames )
+{
+    const unsigned i_in_channels = p_sys->i_in_channels;
+    const unsigned i_out_channels = p_sys->i_out_channels;
+    unsigned i_dither = 0;
+
+    for( unsigned i = 0; i < i_frames; i++ )
+    {
+        int32_t pi_in[AOUT_CHAN_MAX];
+
+        if( p_sys->b_in_s16 )
+        {
+            const int16_t *p_src = (const int16_t *)p_in + i * i_in_channels;
+            for( unsigned c = 0; c < i_in_channels; c++ )
+                pi_in[c] = (int32_t)p_src[c] << FUSED_S16_SHIFT;
+        }
+        else
+        {
+            const int32_t *p_src = (const int32_t *)p_in + i * i_in_channels;
+            for( unsigned c = 0; c < i_in_channels; c++ )
+                pi_in[c] = p_src[c];
+        }
+
+        for( unsigned o = 0; o < i_out_channels; o++ )
+        {
+            const int32_t *pi_row = p_sys->pi_matrix[o];
+            int64_t i_acc = 0;
+
+            for( unsigned c = 0; c < i_in_channels; c++ )
+                i_acc += (int64_t)pi_row[c] * pi_in[c];
+            i_acc >>= FUSED_MIX_SHIFT;
+            i_acc = __MAX( INT32_MIN, __MIN( INT32_MAX, i_acc ) );
+
+            if( p_sys->b_out_s16 )
+                ((int16_t *)p_out)[i * i_out_channels + o] =
+                    ToS16( i_acc, &p_sys->pi_dither[i_dither++ & 3] );
+            else
+                ((int32_t *)p_out)[i * i_out_channels + o] = i_acc;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Remixing matrix
+ *****************************************************************************/
+static int ChannelIndex( uint32_t i_physical, uint32_t i_channel )
+{
+    int i_index = 0;
+
+    if( !(i_physical & i_channel) )
+        return -1;
+    for( unsigned i = 0; pi_vlc_chan_order_wg4[i] != i_channel; i++ )
+        if( i_physical & pi_vlc_chan_order_wg4[i] )
+            i_index++;
+    return i_index;
+}
+
+/* Adds a part of an input channel to the output channel that replaces it */
+static void Fold( filter_sys_t *p_sys, uint32_t i_out_physical, int i_in,
+                  uint32_t i_channel, int32_t i_weight )
+{
+    const int i_out = ChannelIndex( i_out_physical, i_channel );
+    const int32_t i_half = i_weight * 46341 / 65536; /* -3 dB */
+
+    if( i_out >= 0 )
+    {
+        p_sys->pi_matrix[i_out][i_in] += i_weight;
+        return;
+    }
+
+    switch( i_channel )
+    {
+        case AOUT_CHAN_CENTER:
+            Fold( p_sys, i_out_physical, i_in, AOUT_CHAN_LEFT, i_half );
+            Fold( p_sys, i_out_physical, i_in, AOUT_CHAN_RIGHT, i_half );
+            break;
+        case AOUT_CHAN_LEFT:
+        case AOUT_CHAN_RIGHT:
+            /* Only mono is left */
+            if( i_out_physical & AOUT_CHAN_CENTER )
+                Fold( p_sys, i_out_physical, i_in, AOUT_CHAN_CENTER, i_half );
+            break;
+        case AOUT_CHAN_MIDDLELEFT:
+            Fold( p_sys, i_out_physical, i_in,
+                  (i_out_physical & AOUT_CHAN_REARLEFT) ? AOUT_CHAN_REARLEFT
+                                                        : AOUT_CHAN_LEFT,
+                  i_half );
+            break;
+        case AOUT_CHAN_MIDDLERIGHT:
+            Fold( p_sys, i_out_physical, i_in,
+                  (i_out_physical & AOUT_CHAN_REARRIGHT) ? AOUT_CHAN_REARRIGHT
+                                                         : AOUT_CHAN_RIGHT,
+                  i_half );
+            break;
+        case AOUT_CHAN_REARLEFT:
+            Fold( p_sys, i_out_physical, i_in,
+                  (i_out_physical & AOUT_CHAN_MIDDLELEFT) ? AOUT_CHAN_MIDDLELEFT
+                                                          : AOUT_CHAN_LEFT,
+                  i_half );
+            break;
+        case AOUT_CHAN_REARRIGHT:
+            Fold( p_sys, i_out_physical, i_in,
+                  (i_out_physical & AOUT_CHAN_MIDDLERIGHT) ? AOUT_CHAN_MIDDLERIGHT
+                                                           : AOUT_CHAN_RIGHT,
+                  i_half );
+            break;
+        case AOUT_CHAN_REARCENTER:
+            Fold( p_sys, i_out_physical, i_in, AOUT_CHAN_REARLEFT, i_half );
+            Fold( p_sys, i_out_physical, i_in, AOUT_CHAN_REARRIGHT, i_half );
+            break;
+        case AOUT_CHAN_LFE:
+        default:
+            /* Dropped */
+            break;
+    }
+}
+
+static void BuildMatrix( filter_sys_t *p_sys, uint32_t i_in_physical,
+                         uint32_t i_out_physical )
+{
+    memset( p_sys->pi_matrix, 0, sizeof(p_sys->pi_matrix) );
+
+    for( unsigned i = 0; pi_vlc_chan_order_wg4[i]; i++ )
+    {
+        const uint32_t i_channel = pi_vlc_chan_order_wg4[i];
+        const int i_in = ChannelIndex( i_in_physical, i_channel );
+
+        if( i_in >= 0 )
+            Fold( p_sys, i_out_physical, i_in, i_channel, FUSED_MIX_ONE );
+    }
+
+    /* Downmixing must not clip more than the input would */
+    for( unsigned o = 0; o < p_sys->i_out_channels; o++ )
+    {
+        int32_t i_sum = 0;
+
+        for( unsigned c = 0; c < p_sys->i_in_channels; c++ )
+            i_sum += p_sys->pi_matrix[o][c];
+        if( i_sum > FUSED_MIX_ONE )
+            for( unsigned c = 0; c < p_sys->i_in_channels; c++ )
+                p_sys->pi_matrix[o][c] =
+                    (int64_t)p_sys->pi_matrix[o][c] * FUSED_MIX_ONE / i_sum;
+    }
+}
+
+/*****************************************************************************
+ * Open:
+ *****************************************************************************/
+static bool IsFixed( vlc_fourcc_t i_format )
+{
+    return i_format == VLC_CODEC_S16N || i_format == VLC_CODEC_FI32;
+}
+
+static int Open( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    const audio_format_t *p_in = &p_filter->fmt_in.audio;
+    const audio_format_t *p_out = &p_filter->fmt_out.audio;
+    filter_sys_t *p_sys;
+
+    if( !IsFixed( p_in->i_format ) || !IsFixed( p_out->i_format )
+     || p_in->i_rate != p_out->i_rate
+     || AOUT_FMTS_IDENTICAL( p_in, p_out ) )
+        return VLC_EGENERIC;
+
+    /* The dual mono and reversed stereo modes are left to the trivial mixer */
+    if( (p_in->i_original_channels | p_out->i_original_channels)
+        & (AOUT_CHAN_DUALMONO | AOUT_CHAN_REVERSESTEREO) )
+        return VLC_EGENERIC;
+
+    const uint32_t i_in_physical = p_in->i_physical_channels;
+    const uint32_t i_out_physical = p_out->i_physical_channels;
+    const bool b_remix = i_in_physical != i_out_physical;
+
+    /* Nothing to do on the samples, the formats differ by other fields */
+    if( p_in->i_format == p_out->i_format && !b_remix )
+        return VLC_EGENERIC;
+
+    /* Only down-mixing, or mono to anything */
+    if( b_remix && i_in_physical != AOUT_CHAN_CENTER &&
+        aout_FormatNbChannels( p_in ) < aout_FormatNbChannels( p_out ) )
+        return VLC_EGENERIC;
+
+    p_filter->p_sys = p_sys = malloc( sizeof(*p_sys) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    p_sys->i_in_channels = aout_FormatNbChannels( p_in );
+    p_sys->i_out_channels = aout_FormatNbChannels( p_out );
+    p_sys->b_in_s16 = p_in->i_format == VLC_CODEC_S16N;
+    p_sys->b_out_s16 = p_out->i_format == VLC_CODEC_S16N;
+    p_sys->b_remix = b_remix;
+    for( unsigned i = 0; i < 4; i++ )
+        p_sys->pi_dither[i] = 0x9e3779b9 * (i + 1);
+
+    if( b_remix )
+    {
+        if( i_in_physical == AOUT_CHAN_CENTER )
+        {
+            /* Up-mixing mono: the same signal everywhere */
+            memset( p_sys->pi_matrix, 0, sizeof(p_sys->pi_matrix) );
+            for( unsigned o = 0; o < p_sys->i_out_channels; o++ )
+                p_sys->pi_matrix[o][0] = FUSED_MIX_ONE;
+        }
+        else
+            BuildMatrix( p_sys, i_in_physical, i_out_physical );
+    }
+
+    p_sys->pf_s16_fi32 = S16ToFI32;
+    p_sys->pf_fi32_s16 = FI32ToS16;
+#ifdef HAVE_NEON
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+    {
+        p_sys->pf_s16_fi32 = fused_s16_fi32_neon;
+        p_sys->pf_fi32_s16 = fused_fi32_s16_neon;
+    }
+#endif
+
+    p_filter->pf_audio_filter = Convert;
+
+    msg_Dbg( p_filter, "%4.4s/%u -> %4.4s/%u in one pass",
+             (const char *)&p_in->i_format, p_sys->i_in_channels,
+             (const char *)&p_out->i_format, p_sys->i_out_channels );
+    return VLC_SUCCESS;
+}
+
+static void Close( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
+/*****************************************************************************
+ * Convert:
+ *****************************************************************************/
+static block_t *Convert( filter_t *p_filter, block_t *p_block )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_frames = p_block->i_nb_samples;
+    const unsigned i_in_frame = p_sys->i_in_channels * (p_sys->b_in_s16 ? 2 : 4);
+    const unsigned i_out_frame = p_sys->i_out_channels * (p_sys->b_out_s16 ? 2 : 4);
+
+    /* The samples are never widened in place */
+    block_t *p_out = p_block;
+    if( i_out_frame > i_in_frame || ( p_sys->b_in_s16 && !p_sys->b_out_s16 ) )
+    {
+        p_out = filter_NewAudioBuffer( p_filter, i_frames * i_out_frame );
+        if( !p_out )
+        {
+            block_Release( p_block );
+            return NULL;
+        }
+        p_out->i_nb_samples = i_frames;
+        p_out->i_dts        = p_block->i_dts;
+        p_out->i_pts        = p_block->i_pts;
+        p_out->i_length     = p_block->i_length;
+        p_out->i_flags      = p_block->i_flags;
+    }
+
+    if( p_sys->b_remix )
+    {
+        Remix( p_sys, p_out->p_buffer, p_block->p_buffer, i_frames );
+    }
+    else
+    {
+        const unsigned i_count = i_frames * p_sys->i_in_channels;
+        /* The NEON kernels work on groups of 4 samples */
+        const unsigned i_fast = i_count & ~3;
+
+        assert( p_sys->b_in_s16 != p_sys->b_out_s16 );
+        if( p_sys->b_in_s16 )
+        {
+            if( i_fast > 0 )
+                p_sys->pf_s16_fi32( (int32_t *)p_out->p_buffer,
+                                    (const int16_t *)p_block->p_buffer, i_fast );
+            S16ToFI32( (int32_t *)p_out->p_buffer + i_fast,
+                       (const int16_t *)p_block->p_buffer + i_fast,
+                       i_count - i_fast );
+        }
+        else
+        {
+            if( i_fast > 0 )
+                p_sys->pf_fi32_s16( (int16_t *)p_out->p_buffer,
+                                    (const int32_t *)p_block->p_buffer, i_fast,
+                                    p_sys->pi_dither );
+            FI32ToS16( (int16_t *)p_out->p_buffer + i_fast,
+                       (const int32_t *)p_block->p_buffer + i_fast,
+                       i_count - i_fast, p_sys->pi_dither );
+        }
+    }
+    p_out->i_buffer = i_frames * i_out_frame;
+
+    if( p_out != p_block )
+        block_Release( p_block );
+    return p_out;
+}
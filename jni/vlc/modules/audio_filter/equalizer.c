@@ -39,11 +39,9 @@
 #include <vlc_filter.h>
 
 #include "equalizer_presets.h"
+#include "biquad.h"
 /* TODO:
- *  - add tables for other rates ( 22500, 11250, ...)
- *  - optimize a bit (you can hardly do slower ;)
- *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
- *  computation (not too hard once the Q is found).
+ *  - add tables for more bands (15 and 32 would be cool)
  *  - support for external preset
  *  - callback to handle preset changes on the fly
  *  - ...
@@ -98,9 +96,8 @@ struct filter_sys_t
 {
     /* Filter static config */
     int i_band;
-    float *f_alpha;
-    float *f_beta;
-    float *f_gamma;
+    vlc_fourcc_t i_format;
+    biquad_bank_t bank;
 
     float f_newpreamp;
     char *psz_newbands;
@@ -111,13 +108,9 @@ struct filter_sys_t
     float f_gamp;   /* Global preamp */
     bool b_2eqz;
 
-    /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
-
-    /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    /* Filter state, for each pass and channel */
+    biquad_state_t state[2][AOUT_CHAN_MAX];
+    biquad_scratch_t scratch;
 
     vlc_mutex_t lock;
 };
@@ -126,7 +119,7 @@ static block_t *DoWork( filter_t *, block_t * );
 
 #define EQZ_IN_FACTOR (0.25)
 static int  EqzInit( filter_t *, int );
-static void EqzFilter( filter_t *, float *, float *, int, int );
+static void EqzFilter( filter_t *, float *, int, int );
 static void EqzClean( filter_t * );
 
 static int PresetCallback ( vlc_object_t *, char const *, vlc_value_t,
@@ -148,8 +141,8 @@ static int Open( vlc_object_t *p_this )
     filter_t     *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys;
 
-    if( p_filter->fmt_in.audio.i_format != VLC_CODEC_FL32 ||
-        p_filter->fmt_out.audio.i_format != VLC_CODEC_FL32 )
+    if( !biquad_IsFormatSupported( &p_filter->fmt_in.audio,
+                                   &p_filter->fmt_out.audio ) )
     {
         p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
         p_filter->fmt_out.audio.i_format = VLC_CODEC_FL32;
@@ -171,6 +164,9 @@ static int Open( vlc_object_t *p_this )
     if( !p_sys )
         return VLC_ENOMEM;
 
+    p_sys->i_format = p_filter->fmt_in.audio.i_format;
+    p_sys->scratch.p_buffer = NULL;
+    p_sys->scratch.i_size = 0;
     vlc_mutex_init( &p_sys->lock );
     if( EqzInit( p_filter, p_filter->fmt_in.audio.i_rate ) != VLC_SUCCESS )
     {
@@ -191,6 +187,7 @@ static void Close( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     EqzClean( p_filter );
+    biquad_scratch_Clean( &p_sys->scratch );
     vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
@@ -202,9 +199,17 @@ static void Close( vlc_object_t *p_this )
  *****************************************************************************/
 static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
-    EqzFilter( p_filter, (float*)p_in_buf->p_buffer,
-               (float*)p_in_buf->p_buffer, p_in_buf->i_nb_samples,
-               aout_FormatNbChannels( &p_filter->fmt_in.audio ) );
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    const unsigned i_samples = p_in_buf->i_nb_samples * i_channels;
+
+    float *p_buf = biquad_BlockGet( &p_sys->scratch, p_sys->i_format,
+                                    p_in_buf, i_samples );
+    if( !p_buf )
+        return p_in_buf;
+
+    EqzFilter( p_filter, p_buf, p_in_buf->i_nb_samples, i_channels );
+    biquad_BlockPut( p_buf, p_sys->i_format, p_in_buf, i_samples );
     return p_in_buf;
 }
 
@@ -281,9 +286,9 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     filter_sys_t *p_sys = p_filter->p_sys;
     const eqz_config_t *p_cfg;
     int i, ch;
+    bool b_table = true;
     vlc_value_t val1, val2, val3;
     vlc_object_t *p_aout = p_filter->p_parent;
-    int i_ret = VLC_ENOMEM;
 
     /* Select the config */
     if( i_rate == 48000 )
@@ -296,24 +301,28 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     }
     else
     {
-        /* TODO compute the coeffs on the fly */
-        msg_Err( p_filter, "rate not supported" );
-        return VLC_EGENERIC;
+        /* One octave wide bands, at the same frequencies, and as many as
+         * the Nyquist frequency allows */
+        p_cfg = &eqz_config_48000_10b;
+        b_table = false;
     }
 
     /* Create the static filter config */
     p_sys->i_band = p_cfg->i_band;
-    p_sys->f_alpha = malloc( p_sys->i_band * sizeof(float) );
-    p_sys->f_beta  = malloc( p_sys->i_band * sizeof(float) );
-    p_sys->f_gamma = malloc( p_sys->i_band * sizeof(float) );
-    if( !p_sys->f_alpha || !p_sys->f_beta || !p_sys->f_gamma )
-        goto error;
+    biquad_bank_Init( &p_sys->bank, p_sys->i_band );
 
     for( i = 0; i < p_sys->i_band; i++ )
     {
-        p_sys->f_alpha[i] = p_cfg->band[i].f_alpha;
-        p_sys->f_beta[i]  = p_cfg->band[i].f_beta;
-        p_sys->f_gamma[i] = p_cfg->band[i].f_gamma;
+        /* y = alpha * ( x - x[n-2] ) + gamma * y[n-1] - beta * y[n-2] */
+        if( b_table )
+            biquad_bank_SetSection( &p_sys->bank, i,
+                                    p_cfg->band[i].f_alpha, 0.f,
+                                    -p_cfg->band[i].f_alpha,
+                                    -p_cfg->band[i].f_gamma,
+                                    p_cfg->band[i].f_beta );
+        else if( p_cfg->band[i].f_frequency < 0.45f * i_rate )
+            biquad_bank_SetBandPass( &p_sys->bank, i,
+                                     p_cfg->band[i].f_frequency, 1.f, i_rate );
     }
 
     /* Filter dyn config */
@@ -321,7 +330,7 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     p_sys->f_gamp = 1.0;
     p_sys->f_amp  = malloc( p_sys->i_band * sizeof(float) );
     if( !p_sys->f_amp )
-        goto error;
+        return VLC_ENOMEM;
 
     for( i = 0; i < p_sys->i_band; i++ )
     {
@@ -329,20 +338,10 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     }
 
     /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
+    for( ch = 0; ch < AOUT_CHAN_MAX; ch++ )
     {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0;
-
-        for( i = 0; i < p_sys->i_band; i++ )
-        {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0;
-        }
+        biquad_state_Reset( &p_sys->state[0][ch] );
+        biquad_state_Reset( &p_sys->state[1][ch] );
     }
 
     var_Create( p_aout, "equalizer-bands", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
@@ -373,8 +372,7 @@ static int EqzInit( filter_t *p_filter, int i_rate )
         msg_Err(p_filter, "No preset selected");
         free( val2.psz_string );
         free( p_sys->f_amp );
-        i_ret = VLC_EGENERIC;
-        goto error;
+        return VLC_EGENERIC;
     }
     if( ( *(val2.psz_string) &&
         strstr( p_sys->psz_newbands, val2.psz_string ) ) || !*val2.psz_string )
@@ -391,83 +389,49 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     var_AddCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_AddCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
-    msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass",
-                        i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1 );
+    msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass%s",
+                        i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1,
+                        b_table ? "" : " (computed coefficients)" );
     for( i = 0; i < p_sys->i_band; i++ )
     {
-        msg_Dbg( p_filter, "   %d Hz -> factor:%f alpha:%f beta:%f gamma:%f",
+        const float (*pf)[4] = p_sys->bank.pf_coefs[i / 4];
+        msg_Dbg( p_filter, "   %d Hz -> factor:%f b0:%f a1:%f a2:%f",
                  (int)p_cfg->band[i].f_frequency, p_sys->f_amp[i],
-                 p_sys->f_alpha[i], p_sys->f_beta[i], p_sys->f_gamma[i]);
+                 pf[BIQUAD_B0][i % 4], pf[BIQUAD_A1][i % 4],
+                 pf[BIQUAD_A2][i % 4] );
     }
     return VLC_SUCCESS;
+}
 
-error:
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
-    return i_ret;
+/* Sets the gains of the bands, and the global one for the last pass */
+static void EqzSetGains( filter_sys_t *p_sys, float f_gain )
+{
+    p_sys->bank.f_dry = f_gain * EQZ_IN_FACTOR;
+    for( int i = 0; i < p_sys->i_band; i++ )
+        biquad_bank_SetGain( &p_sys->bank, i, f_gain * p_sys->f_amp[i] );
 }
 
-static void EqzFilter( filter_t *p_filter, float *out, float *in,
+static void EqzFilter( filter_t *p_filter, float *p_buf,
                        int i_samples, int i_channels )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
+    int ch;
 
     vlc_mutex_lock( &p_sys->lock );
-    for( i = 0; i < i_samples; i++ )
+    /* With two passes, the first one is done without the global gain,
+     * each pass adds the source PCM and the filtered PCM */
+    if( p_sys->b_2eqz )
     {
+        EqzSetGains( p_sys, 1.f );
         for( ch = 0; ch < i_channels; ch++ )
-        {
-            const float x = in[ch];
-            float o = 0.0;
-
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
-
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
-
-                o += y * p_sys->f_amp[j];
-            }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
-
-            /* Second filter */
-            if( p_sys->b_2eqz )
-            {
-                const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
-
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
-            }
-            else
-            {
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
-            }
-        }
-
-        in  += i_channels;
-        out += i_channels;
+            biquad_bank_Process( p_buf + ch, p_buf + ch, i_samples, i_channels,
+                                 &p_sys->bank, &p_sys->state[1][ch] );
     }
+
+    EqzSetGains( p_sys, p_sys->f_gamp );
+    for( ch = 0; ch < i_channels; ch++ )
+        biquad_bank_Process( p_buf + ch, p_buf + ch, i_samples, i_channels,
+                             &p_sys->bank, &p_sys->state[0][ch] );
     vlc_mutex_unlock( &p_sys->lock );
 }
 
@@ -481,10 +445,6 @@ static void EqzClean( filter_t *p_filter )
     var_DelCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
-
     free( p_sys->f_amp );
     free( p_sys->psz_newbands );
 }
@@ -44,6 +44,8 @@
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
+#include "biquad.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -57,6 +59,11 @@ struct filter_sys_t
     int i_nb;
     float *p_last;
     float f_max;
+
+    vlc_fourcc_t i_format;
+    biquad_scratch_t scratch;
+    float pf_sum[AOUT_CHAN_MAX];
+    float pf_gain[AOUT_CHAN_MAX];
 };
 
 /*****************************************************************************
@@ -97,8 +104,8 @@ static int Open( vlc_object_t *p_this )
     unsigned i_channels;
     filter_sys_t *p_sys;
 
-    if( p_filter->fmt_in.audio.i_format != VLC_CODEC_FL32 ||
-        p_filter->fmt_out.audio.i_format != VLC_CODEC_FL32 )
+    if( !biquad_IsFormatSupported( &p_filter->fmt_in.audio,
+                                   &p_filter->fmt_out.audio ) )
     {
         p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
         p_filter->fmt_out.audio.i_format = VLC_CODEC_FL32;
@@ -121,6 +128,9 @@ static int Open( vlc_object_t *p_this )
     p_sys = p_filter->p_sys = malloc( sizeof( *p_sys ) );
     if( !p_sys )
         return VLC_ENOMEM;
+    p_sys->i_format = p_filter->fmt_in.audio.i_format;
+    p_sys->scratch.p_buffer = NULL;
+    p_sys->scratch.i_size = 0;
     p_sys->i_nb = var_CreateGetInteger( p_filter->p_parent, "norm-buff-size" );
     p_sys->f_max = var_CreateGetFloat( p_filter->p_parent, "norm-max-level" );
 
@@ -142,42 +152,36 @@ static int Open( vlc_object_t *p_this )
  *****************************************************************************/
 static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
 {
-    float *pf_sum;
-    float *pf_gain;
     float f_average = 0;
     int i, i_chan;
 
     int i_samples = p_in_buf->i_nb_samples;
     int i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
-    float *p_out = (float*)p_in_buf->p_buffer;
-    float *p_in =  (float*)p_in_buf->p_buffer;
 
     struct filter_sys_t *p_sys = p_filter->p_sys;
+    float *pf_sum = p_sys->pf_sum;
+    float *pf_gain = p_sys->pf_gain;
 
-    pf_sum = calloc( i_channels, sizeof(float) );
-    if( !pf_sum )
-        goto out;
-
-    pf_gain = malloc( sizeof(float) * i_channels );
-    if( !pf_gain )
-    {
-        free( pf_sum );
-        goto out;
-    }
+    float *p_buf = biquad_BlockGet( &p_sys->scratch, p_sys->i_format,
+                                    p_in_buf, i_samples * i_channels );
+    if( !p_buf )
+        return p_in_buf;
 
     /* Calculate the average power level on this buffer */
+    for( i_chan = 0; i_chan < i_channels; i_chan++ )
+        pf_sum[i_chan] = 0;
     for( i = 0 ; i < i_samples; i++ )
     {
+        const float *p_in = &p_buf[i * i_channels];
         for( i_chan = 0; i_chan < i_channels; i_chan++ )
-        {
-            float f_sample = p_in[i_chan];
-            float f_square = pow( f_sample, 2 );
-            pf_sum[i_chan] += f_square;
-        }
-        p_in += i_channels;
+            pf_sum[i_chan] += p_in[i_chan] * p_in[i_chan];
     }
 
+    /* Seuil arbitraire */
+    p_sys->f_max = var_GetFloat( p_filter->p_parent, "norm-max-level" );
+
     /* sum now contains for each channel the sigma(value²) */
+    bool b_unity = true;
     for( i_chan = 0; i_chan < i_channels; i_chan++ )
     {
         /* Shift our lastbuff */
@@ -187,9 +191,7 @@ static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
 
         /* Insert the new average : sqrt(sigma(value²)) */
         p_sys->p_last[ i_chan * p_sys->i_nb + p_sys->i_nb - 1] =
-                sqrt( pf_sum[i_chan] );
-
-        pf_sum[i_chan] = 0;
+                sqrtf( pf_sum[i_chan] );
 
         /* Get the average power on the lastbuff */
         f_average = 0;
@@ -199,37 +201,31 @@ static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
         }
         f_average = f_average / p_sys->i_nb;
 
-        /* Seuil arbitraire */
-        p_sys->f_max = var_GetFloat( p_filter->p_parent, "norm-max-level" );
-
-        //fprintf(stderr,"Average %f, max %f\n", f_average, p_sys->f_max );
         if( f_average > p_sys->f_max )
         {
-             pf_gain[i_chan] = f_average / p_sys->f_max;
+            pf_gain[i_chan] = p_sys->f_max / f_average;
+            b_unity = false;
         }
         else
         {
-           pf_gain[i_chan] = 1;
+            pf_gain[i_chan] = 1;
         }
     }
 
     /* Apply gain */
-    for( i = 0; i < i_samples; i++)
+    if( !b_unity )
     {
-        for( i_chan = 0; i_chan < i_channels; i_chan++ )
+        for( i = 0; i < i_samples; i++)
         {
-            p_out[i_chan] /= pf_gain[i_chan];
+            float *p_out = &p_buf[i * i_channels];
+            for( i_chan = 0; i_chan < i_channels; i_chan++ )
+                p_out[i_chan] *= pf_gain[i_chan];
         }
-        p_out += i_channels;
+        biquad_BlockPut( p_buf, p_sys->i_format, p_in_buf,
+                         i_samples * i_channels );
     }
 
-    free( pf_sum );
-    free( pf_gain );
-
     return p_in_buf;
-out:
-    block_Release( p_in_buf );
-    return NULL;
 }
 
 /**********************************************************************
@@ -241,5 +237,6 @@ static void Close( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     free( p_sys->p_last );
+    biquad_scratch_Clean( &p_sys->scratch );
     free( p_sys );
 }
@@ -0,0 +1,604 @@
+/*****************************************************************************
+ * polyphase.c : fixed-point polyphase FIR resampler
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble:
+ *
+ * The low-pass filter is a Kaiser-windowed sinc, tabulated for POLYPHASE_PHASES
+ * positions between two input samples. An output sample is filtered with the
+ * two phases surrounding its position, and the two results are linearly
+ * interpolated. Any ratio can so be used, and it can change at every buffer
+ * without computing the table again, as long as the cut-off frequency does not
+ * move. This makes the small steps of the A/V drift correction cheap.
+ *
+ * It works on S16N and FI32 samples, for the devices without a fast FPU.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_cpu.h>
+
+#include <math.h>
+#include <assert.h>
+
+/* Phases in the table, between two input samples */
+#define POLYPHASE_BITS      6
+#define POLYPHASE_PHASES    (1 << POLYPHASE_BITS)
+
+/* Coefficients precision, for S16N and FI32 samples */
+#define POLYPHASE_S16_SHIFT 15
+#define POLYPHASE_S32_SHIFT 23
+
+/* The table is computed again only if the cut-off frequency moves more */
+#define POLYPHASE_CUTOFF_TOLERANCE 0.01
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int  OpenFilter ( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
+static block_t *Resample( filter_t *, block_t * );
+
+#define QUALITY_TEXT N_("Resampling quality")
+#define QUALITY_LONGTEXT N_( \
+    "Length of the resampling filter. A longer filter removes more aliasing " \
+    "but uses more CPU.")
+
+static const int pi_quality_values[] = { 0, 1, 2 };
+static const char *const ppsz_quality_descriptions[] = {
+    N_("Fast"), N_("Medium"), N_("Best") };
+
+/* Taps (multiple of 8), cut-off relative to the Nyquist frequency, and Kaiser
+ * window shape of each quality */
+static const struct
+{
+    unsigned i_taps;
+    double   f_cutoff;
+    double   f_beta;
+} p_qualities[] = {
+    {  8, 0.80, 5.0 },
+    { 16, 0.90, 7.0 },
+    { 32, 0.95, 9.0 },
+};
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_MISC )
+    set_description( N_("Audio filter for fixed-point polyphase resampling") )
+    set_shortname( N_("Polyphase resampler") )
+    set_capability( "audio filter", 25 )
+    add_integer_with_range( "polyphase-quality", 1, 0, 2,
+                            QUALITY_TEXT, QUALITY_LONGTEXT, true )
+        change_integer_list( pi_quality_values, ppsz_quality_descriptions )
+    set_callbacks( OpenFilter, CloseFilter )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local structures
+ *****************************************************************************/
+typedef void (*fir_s16_t)( const int16_t *, const int16_t *, unsigned,
+                           int32_t * );
+typedef void (*fir_s32_t)( const int32_t *, const int32_t *, unsigned,
+                           int64_t * );
+
+struct filter_sys_t
+{
+    bool     b_s16;
+    unsigned i_channels;
+
+    /* Filter */
+    unsigned i_taps;
+    double   f_cutoff;
+    double   f_beta;
+    double   f_table_cutoff;
+    void     *p_table;             /* POLYPHASE_PHASES + 1 rows of i_taps */
+
+    fir_s16_t pf_fir_s16;
+    fir_s32_t pf_fir_s32;
+
+    /* Input history, one plane per channel */
+    uint8_t  *p_buf;
+    unsigned i_buf_size;           /* samples per plane */
+    unsigned i_buf;
+    uint32_t i_frac;               /* position of the next output sample */
+
+    bool     b_first;
+    date_t   end_date;
+};
+
+/*****************************************************************************
+ * FIR kernels: filter with two adjacent phases at once
+ *****************************************************************************/
+#ifdef HAVE_NEON
+void polyphase_fir_s16_neon( const int16_t *, const int16_t *, unsigned,
+                             int32_t * );
+void polyphase_fir_s32_neon( const int32_t *, const int32_t *, unsigned,
+                             int64_t * );
+#endif
+
+static void FirS16( const int16_t *p_in, const int16_t *p_h, unsigned i_taps,
+                    int32_t pi_acc[2] )
+{
+    const int16_t *p_h1 = p_h + i_taps;
+    int32_t i_acc0 = 0, i_acc1 = 0;
+
+    for( unsigned i = 0; i < i_taps; i++ )
+    {
+        i_acc0 += p_in[i] * p_h[i];
+        i_acc1 += p_in[i] * p_h1[i];
+    }
+    pi_acc[0] = i_acc0;
+    pi_acc[1] = i_acc1;
+}
+
+static void FirS32( const int32_t *p_in, const int32_t *p_h, unsigned i_taps,
+                    int64_t pi_acc[2] )
+{
+    const int32_t *p_h1 = p_h + i_taps;
+    int64_t i_acc0 = 0, i_acc1 = 0;
+
+    for( unsigned i = 0; i < i_taps; i++ )
+    {
+        i_acc0 += (int64_t)p_in[i] * p_h[i];
+        i_acc1 += (int64_t)p_in[i] * p_h1[i];
+    }
+    pi_acc[0] = i_acc0;
+    pi_acc[1] = i_acc1;
+}
+
+/*****************************************************************************
+ * Table
+ *****************************************************************************/
+static double BesselI0( double x )
+{
+    double f_sum = 1., f_term = 1.;
+
+    for( int k = 1; k < 64; k++ )
+    {
+        const double f = x / (2 * k);
+        f_term *= f * f;
+        f_sum += f_term;
+        if( f_term < f_sum * 1e-12 )
+            break;
+    }
+    return f_sum;
+}
+
+static double CutOff( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_in_rate = p_filter->fmt_in.audio.i_rate;
+    const unsigned i_out_rate = p_filter->fmt_out.audio.i_rate;
+
+    /* The band is limited by the output when down-sampling */
+    if( i_out_rate < i_in_rate )
+        return p_sys->f_cutoff * i_out_rate / i_in_rate;
+    return p_sys->f_cutoff;
+}
+
+static void ComputeTable( filter_sys_t *p_sys, double f_cutoff )
+{
+    const unsigned i_taps = p_sys->i_taps;
+    const double f_half = i_taps / 2.;
+    const double f_norm = BesselI0( p_sys->f_beta );
+    double pf_row[i_taps];
+
+    for( unsigned p = 0; p <= POLYPHASE_PHASES; p++ )
+    {
+        double f_sum = 0.;
+
+        /* The output is centered between the taps i_taps/2 - 1 and i_taps/2 */
+        for( unsigned k = 0; k < i_taps; k++ )
+        {
+            const double t = (double)k - (f_half - 1.) -
+                             (double)p / POLYPHASE_PHASES;
+            const double w = t / f_half;
+            double f_window = 0., f_sinc = 1.;
+
+            if( fabs( w ) < 1. )
+                f_window = BesselI0( p_sys->f_beta * sqrt( 1. - w * w ) ) / f_norm;
+            if( t != 0. )
+                f_sinc = sin( M_PI * f_cutoff * t ) / ( M_PI * f_cutoff * t );
+
+            pf_row[k] = f_cutoff * f_sinc * f_window;
+            f_sum += pf_row[k];
+        }
+
+        /* Unity gain for every phase */
+        for( unsigned k = 0; k < i_taps; k++ )
+        {
+            const double f = pf_row[k] / f_sum;
+
+            if( p_sys->b_s16 )
+            {
+                long i = lround( f * (1 << POLYPHASE_S16_SHIFT) );
+                ((int16_t *)p_sys->p_table)[p * i_taps + k] =
+                    __MAX( INT16_MIN, __MIN( INT16_MAX, i ) );
+            }
+            else
+                ((int32_t *)p_sys->p_table)[p * i_taps + k] =
+                    lround( f * (1 << POLYPHASE_S32_SHIFT) );
+        }
+    }
+    p_sys->f_table_cutoff = f_cutoff;
+}
+
+/*****************************************************************************
+ * Filtering of one channel
+ *****************************************************************************/
+static void FilterS16( filter_sys_t *p_sys, int16_t *p_out,
+                       const int16_t *p_in, unsigned i_count,
+                       uint64_t i_pos, uint64_t i_step )
+{
+    const int16_t *p_table = p_sys->p_table;
+    const unsigned i_taps = p_sys->i_taps;
+
+    for( unsigned i = 0; i < i_count; i++, i_pos += i_step )
+    {
+        const uint32_t i_frac = i_pos;
+        const unsigned i_phase = i_frac >> (32 - POLYPHASE_BITS);
+        const int64_t i_alpha = (i_frac >> (16 - POLYPHASE_BITS)) & 0xffff;
+        int32_t pi_acc[2];
+
+        p_sys->pf_fir_s16( &p_in[i_pos >> 32], &p_table[i_phase * i_taps],
+                           i_taps, pi_acc );
+
+        int64_t i_out = pi_acc[0] +
+                        ((((int64_t)pi_acc[1] - pi_acc[0]) * i_alpha) >> 16);
+        i_out = (i_out + (1 << (POLYPHASE_S16_SHIFT - 1))) >> POLYPHASE_S16_SHIFT;
+        *p_out = __MAX( INT16_MIN, __MIN( INT16_MAX, i_out ) );
+        p_out += p_sys->i_channels;
+    }
+}
+
+static void FilterS32( filter_sys_t *p_sys, int32_t *p_out,
+                       const int32_t *p_in, unsigned i_count,
+                       uint64_t i_pos, uint64_t i_step )
+{
+    const int32_t *p_table = p_sys->p_table;
+    const unsigned i_taps = p_sys->i_taps;
+
+    for( unsigned i = 0; i < i_count; i++, i_pos += i_step )
+    {
+        const uint32_t i_frac = i_pos;
+        const unsigned i_phase = i_frac >> (32 - POLYPHASE_BITS);
+        const int64_t i_alpha = (i_frac >> (16 - POLYPHASE_BITS)) & 0xffff;
+        int64_t pi_acc[2];
+
+        p_sys->pf_fir_s32( &p_in[i_pos >> 32], &p_table[i_phase * i_taps],
+                           i_taps, pi_acc );
+
+        /* The difference is shifted first not to overflow */
+        int64_t i_out = pi_acc[0] + ((pi_acc[1] - pi_acc[0]) >> 16) * i_alpha;
+        i_out = (i_out + (1 << (POLYPHASE_S32_SHIFT - 1))) >> POLYPHASE_S32_SHIFT;
+        *p_out = __MAX( INT32_MIN, __MIN( INT32_MAX, i_out ) );
+        p_out += p_sys->i_channels;
+    }
+}
+
+/*****************************************************************************
+ * History buffer
+ *****************************************************************************/
+static uint8_t *Plane( filter_sys_t *p_sys, unsigned i_channel )
+{
+    const unsigned i_bytes = p_sys->b_s16 ? 2 : 4;
+
+    return &p_sys->p_buf[i_channel * p_sys->i_buf_size * i_bytes];
+}
+
+static int GrowBuffer( filter_sys_t *p_sys, unsigned i_size )
+{
+    const unsigned i_bytes = p_sys->b_s16 ? 2 : 4;
+
+    if( i_size <= p_sys->i_buf_size )
+        return VLC_SUCCESS;
+
+    uint8_t *p_buf = malloc( i_size * i_bytes * p_sys->i_channels );
+    if( !p_buf )
+        return VLC_ENOMEM;
+    for( unsigned c = 0; c < p_sys->i_channels; c++ )
+        memcpy( &p_buf[c * i_size * i_bytes], Plane( p_sys, c ),
+                p_sys->i_buf * i_bytes );
+    free( p_sys->p_buf );
+    p_sys->p_buf = p_buf;
+    p_sys->i_buf_size = i_size;
+    return VLC_SUCCESS;
+}
+
+/* Copies interleaved samples at the end of the planes */
+static void Deinterleave( filter_sys_t *p_sys, const uint8_t *p_in,
+                          unsigned i_count )
+{
+    for( unsigned c = 0; c < p_sys->i_channels; c++ )
+    {
+        if( p_sys->b_s16 )
+        {
+            const int16_t *p_src = (const int16_t *)p_in + c;
+            int16_t *p_dst = (int16_t *)Plane( p_sys, c ) + p_sys->i_buf;
+
+            for( unsigned i = 0; i < i_count; i++ )
+                p_dst[i] = p_src[i * p_sys->i_channels];
+        }
+        else
+        {
+            const int32_t *p_src = (const int32_t *)p_in + c;
+            int32_t *p_dst = (int32_t *)Plane( p_sys, c ) + p_sys->i_buf;
+
+            for( unsigned i = 0; i < i_count; i++ )
+                p_dst[i] = p_src[i * p_sys->i_channels];
+        }
+    }
+    p_sys->i_buf += i_count;
+}
+
+static void Interleave( filter_sys_t *p_sys, uint8_t *p_out,
+                        unsigned i_start, unsigned i_count )
+{
+    for( unsigned c = 0; c < p_sys->i_channels; c++ )
+    {
+        if( p_sys->b_s16 )
+        {
+            const int16_t *p_src = (const int16_t *)Plane( p_sys, c ) + i_start;
+            int16_t *p_dst = (int16_t *)p_out + c;
+
+            for( unsigned i = 0; i < i_count; i++ )
+                p_dst[i * p_sys->i_channels] = p_src[i];
+        }
+        else
+        {
+            const int32_t *p_src = (const int32_t *)Plane( p_sys, c ) + i_start;
+            int32_t *p_dst = (int32_t *)p_out + c;
+
+            for( unsigned i = 0; i < i_count; i++ )
+                p_dst[i * p_sys->i_channels] = p_src[i];
+        }
+    }
+}
+
+/* Drops the samples that will not be used anymore */
+static void Consume( filter_sys_t *p_sys, unsigned i_count )
+{
+    const unsigned i_bytes = p_sys->b_s16 ? 2 : 4;
+
+    assert( i_count <= p_sys->i_buf );
+    p_sys->i_buf -= i_count;
+    for( unsigned c = 0; c < p_sys->i_channels; c++ )
+    {
+        uint8_t *p_plane = Plane( p_sys, c );
+        memmove( p_plane, &p_plane[i_count * i_bytes], p_sys->i_buf * i_bytes );
+    }
+}
+
+/*****************************************************************************
+ * Resample: convert a buffer
+ *****************************************************************************/
+static block_t *Resample( filter_t *p_filter, block_t *p_in_buf )
+{
+    if( !p_in_buf || !p_in_buf->i_nb_samples )
+    {
+        if( p_in_buf )
+            block_Release( p_in_buf );
+        return NULL;
+    }
+
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_in_rate = p_filter->fmt_in.audio.i_rate;
+    const unsigned i_out_rate = p_filter->fmt_out.audio.i_rate;
+    const unsigned i_delay = p_sys->i_taps / 2 - 1;
+    const unsigned i_bytes_per_frame = (p_sys->b_s16 ? 2 : 4) *
+                                       p_sys->i_channels;
+    const bool b_discontinuity =
+        (p_in_buf->i_flags & BLOCK_FLAG_DISCONTINUITY) != 0;
+
+    /* Check if we really need to run the resampler */
+    if( i_in_rate == i_out_rate )
+    {
+        if( !b_discontinuity && !p_sys->b_first && p_sys->i_buf > i_delay )
+        {
+            /* Output the samples still in the history first */
+            const unsigned i_old = p_sys->i_buf - i_delay;
+
+            p_in_buf = block_Realloc( p_in_buf, i_old * i_bytes_per_frame,
+                                      p_in_buf->i_buffer );
+            if( !p_in_buf )
+                return NULL;
+            Interleave( p_sys, p_in_buf->p_buffer, i_delay, i_old );
+
+            p_in_buf->i_nb_samples += i_old;
+            p_in_buf->i_pts = date_Get( &p_sys->end_date );
+            p_in_buf->i_length =
+                date_Increment( &p_sys->end_date,
+                                p_in_buf->i_nb_samples ) - p_in_buf->i_pts;
+        }
+        p_sys->b_first = true;
+        return p_in_buf;
+    }
+
+    if( b_discontinuity || p_sys->b_first )
+    {
+        /* Continuity in sound samples has been broken, start again with
+         * silence centered on the first sample */
+        p_sys->i_buf = 0;
+        if( GrowBuffer( p_sys, i_delay + p_in_buf->i_nb_samples ) )
+        {
+            block_Release( p_in_buf );
+            return NULL;
+        }
+        for( unsigned c = 0; c < p_sys->i_channels; c++ )
+            memset( Plane( p_sys, c ), 0, i_delay * i_bytes_per_frame /
+                                          p_sys->i_channels );
+        p_sys->i_buf = i_delay;
+        p_sys->i_frac = 0;
+        date_Init( &p_sys->end_date, i_out_rate, 1 );
+        date_Set( &p_sys->end_date, p_in_buf->i_pts );
+        p_sys->b_first = false;
+    }
+
+    /* Small rate changes only move the step */
+    const double f_cutoff = CutOff( p_filter );
+    if( fabs( f_cutoff - p_sys->f_table_cutoff ) >
+        p_sys->f_table_cutoff * POLYPHASE_CUTOFF_TOLERANCE )
+        ComputeTable( p_sys, f_cutoff );
+
+    if( GrowBuffer( p_sys, p_sys->i_buf + p_in_buf->i_nb_samples ) )
+    {
+        block_Release( p_in_buf );
+        return NULL;
+    }
+    Deinterleave( p_sys, p_in_buf->p_buffer, p_in_buf->i_nb_samples );
+
+    /* Output samples for which all the taps are available */
+    const uint64_t i_step = ((uint64_t)i_in_rate << 32) / i_out_rate;
+    unsigned i_count = 0;
+    if( p_sys->i_buf >= p_sys->i_taps )
+    {
+        const uint64_t i_end = (uint64_t)(p_sys->i_buf - p_sys->i_taps + 1) << 32;
+        i_count = (i_end - p_sys->i_frac + i_step - 1) / i_step;
+    }
+
+    block_t *p_out_buf = NULL;
+    if( i_count > 0 )
+        p_out_buf = filter_NewAudioBuffer( p_filter,
+                                           i_count * i_bytes_per_frame );
+    if( p_out_buf )
+    {
+        for( unsigned c = 0; c < p_sys->i_channels; c++ )
+        {
+            if( p_sys->b_s16 )
+                FilterS16( p_sys, (int16_t *)p_out_buf->p_buffer + c,
+                           (const int16_t *)Plane( p_sys, c ), i_count,
+                           p_sys->i_frac, i_step );
+            else
+                FilterS32( p_sys, (int32_t *)p_out_buf->p_buffer + c,
+                           (const int32_t *)Plane( p_sys, c ), i_count,
+                           p_sys->i_frac, i_step );
+        }
+
+        p_out_buf->i_nb_samples = i_count;
+        p_out_buf->i_buffer = i_count * i_bytes_per_frame;
+        p_out_buf->i_flags = p_in_buf->i_flags & BLOCK_FLAG_DISCONTINUITY;
+        p_out_buf->i_dts =
+        p_out_buf->i_pts = date_Get( &p_sys->end_date );
+        p_out_buf->i_length = date_Increment( &p_sys->end_date,
+                                      i_count ) - p_out_buf->i_pts;
+
+        const uint64_t i_pos = p_sys->i_frac + i_count * i_step;
+        Consume( p_sys, i_pos >> 32 );
+        p_sys->i_frac = i_pos;
+    }
+
+    block_Release( p_in_buf );
+    return p_out_buf;
+}
+
+/*****************************************************************************
+ * OpenFilter:
+ *****************************************************************************/
+static int OpenFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+    unsigned int i_out_rate = p_filter->fmt_out.audio.i_rate;
+
+    if ( p_filter->fmt_in.audio.i_rate == p_filter->fmt_out.audio.i_rate
+      || p_filter->fmt_in.audio.i_format != p_filter->fmt_out.audio.i_format
+      || p_filter->fmt_in.audio.i_physical_channels
+              != p_filter->fmt_out.audio.i_physical_channels
+      || p_filter->fmt_in.audio.i_original_channels
+              != p_filter->fmt_out.audio.i_original_channels
+      || ( p_filter->fmt_in.audio.i_format != VLC_CODEC_S16N
+        && p_filter->fmt_in.audio.i_format != VLC_CODEC_FI32 ) )
+    {
+        return VLC_EGENERIC;
+    }
+
+    const unsigned i_quality =
+        __MIN( var_InheritInteger( p_this, "polyphase-quality" ), 2 );
+
+    p_filter->p_sys = p_sys = malloc( sizeof(*p_sys) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys->b_s16 = p_filter->fmt_in.audio.i_format == VLC_CODEC_S16N;
+    p_sys->i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    p_sys->i_taps = p_qualities[i_quality].i_taps;
+    p_sys->f_cutoff = p_qualities[i_quality].f_cutoff;
+    p_sys->f_beta = p_qualities[i_quality].f_beta;
+    p_sys->p_table = malloc( (POLYPHASE_PHASES + 1) * p_sys->i_taps *
+                             (p_sys->b_s16 ? 2 : 4) );
+    if( !p_sys->p_table )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    ComputeTable( p_sys, CutOff( p_filter ) );
+
+    p_sys->pf_fir_s16 = FirS16;
+    p_sys->pf_fir_s32 = FirS32;
+#ifdef HAVE_NEON
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+    {
+        p_sys->pf_fir_s16 = polyphase_fir_s16_neon;
+        p_sys->pf_fir_s32 = polyphase_fir_s32_neon;
+    }
+#endif
+
+    p_sys->p_buf = NULL;
+    p_sys->i_buf_size = 0;
+    p_sys->i_buf = 0;
+    p_sys->i_frac = 0;
+    p_sys->b_first = true;
+    p_filter->pf_audio_filter = Resample;
+
+    msg_Dbg( p_this, "%4.4s/%iKHz/%i->%4.4s/%iKHz/%i, %u taps",
+             (char *)&p_filter->fmt_in.i_codec,
+             p_filter->fmt_in.audio.i_rate,
+             p_filter->fmt_in.audio.i_channels,
+             (char *)&p_filter->fmt_out.i_codec,
+             p_filter->fmt_out.audio.i_rate,
+             p_filter->fmt_out.audio.i_channels, p_sys->i_taps );
+
+    p_filter->fmt_out = p_filter->fmt_in;
+    p_filter->fmt_out.audio.i_rate = i_out_rate;
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * CloseFilter : deallocate data structures
+ *****************************************************************************/
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys->p_buf );
+    free( p_filter->p_sys->p_table );
+    free( p_filter->p_sys );
+}
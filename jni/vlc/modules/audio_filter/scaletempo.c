@@ -32,6 +32,7 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
@@ -71,6 +72,10 @@ vlc_module_end ()
  * for the best overlap position.  Scaletempo uses a statistical cross correlation
  * (roughly a dot-product).  Scaletempo consumes most of its CPU cycles here.
  *
+ * With fixed point samples (S16N and FI32), the search is done on a 16-bits
+ * mono down-mix of the overlap and of the search window, so that it does not
+ * need a FPU and costs the same whatever the number of channels.
+ *
  * NOTE:
  * sample: a single audio sample for one channel
  * frame: a single set of samples, one for each channel
@@ -89,6 +94,7 @@ struct filter_sys_t
     unsigned  bytes_per_sample;
     unsigned  bytes_per_frame;
     unsigned  sample_rate;
+    vlc_fourcc_t format;
     /* stride */
     double    frames_stride_scaled;
     double    frames_stride_error;
@@ -111,8 +117,16 @@ struct filter_sys_t
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    /* best overlap, fixed point */
+    unsigned  samples_corr;     /* mono pre-correlation length, padded */
+    int16_t  *buf_search;       /* mono down-mix of the search window */
+    int64_t (*correlate)( const int16_t *, const int16_t *, unsigned );
 };
 
+#ifdef HAVE_NEON
+int64_t scaletempo_correlate_neon( const int16_t *, const int16_t *, unsigned );
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
@@ -150,6 +164,75 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     return best_off * p->bytes_per_frame;
 }
 
+/*****************************************************************************
+ * best_overlap_offset_fixed: same as above, on a 16-bits mono down-mix
+ *****************************************************************************/
+/* n must be a multiple of 8 */
+static int64_t correlate_s16( const int16_t *a, const int16_t *b, unsigned n )
+{
+    int64_t corr = 0;
+    for( unsigned i = 0; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+static inline int16_t mono_s16( filter_sys_t *p, const void *frame )
+{
+    int32_t sum = 0;
+    unsigned j;
+
+    if( p->format == VLC_CODEC_S16N )
+    {
+        const int16_t *ps = frame;
+        for( j = 0; j < p->samples_per_frame; j++ )
+            sum += ps[j];
+    }
+    else
+    {
+        const int32_t *ps = frame;
+        for( j = 0; j < p->samples_per_frame; j++ )
+            sum += ps[j] >> 13;
+    }
+    sum /= (int32_t)p->samples_per_frame;
+    return __MAX( INT16_MIN, __MIN( INT16_MAX, sum ) );
+}
+
+static unsigned best_overlap_offset_fixed( filter_t *p_filter )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    const int32_t *pw = p->table_window;
+    int16_t *ppc = p->buf_pre_corr;
+    unsigned frames_overlap = p->samples_overlap / p->samples_per_frame;
+    int64_t best_corr = INT64_MIN;
+    unsigned best_off = 0;
+    unsigned i, off;
+
+    for( i = 1; i < frames_overlap; i++ )
+    {
+        const uint8_t *po = (uint8_t *)p->buf_overlap + i * p->bytes_per_frame;
+        *ppc++ = ( *pw++ * mono_s16( p, po ) ) >> 15;
+    }
+
+    /* the padding of the pre-correlation is zero, so the end of the search
+     * window does not matter */
+    const unsigned frames_window = p->frames_search + frames_overlap - 1;
+    for( i = 0; i < frames_window; i++ )
+        p->buf_search[i] = mono_s16( p, p->buf_queue + ( i + 1 ) * p->bytes_per_frame );
+
+    for( off = 0; off < p->frames_search; off++ )
+    {
+        int64_t corr = p->correlate( p->buf_pre_corr, p->buf_search + off,
+                                     p->samples_corr );
+        if( corr > best_corr )
+        {
+            best_corr = corr;
+            best_off  = off;
+        }
+    }
+
+    return best_off * p->bytes_per_frame;
+}
+
 /*****************************************************************************
  * output_overlap: blend end of previous stride with beginning of current stride
  *****************************************************************************/
@@ -168,6 +251,37 @@ static void output_overlap_float( filter_t        *p_filter,
     }
 }
 
+/* the blending table is in 16 bits fixed point */
+static void output_overlap_s16( filter_t        *p_filter,
+                                void            *buf_out,
+                                unsigned         bytes_off )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    int16_t *pout = buf_out;
+    int32_t *pb   = p->table_blend;
+    int16_t *po   = p->buf_overlap;
+    int16_t *pin  = (int16_t *)( p->buf_queue + bytes_off );
+    unsigned i;
+    for( i = 0; i < p->samples_overlap; i++ ) {
+        *pout++ = *po + ( ( (int64_t)*pb++ * ( *pin++ - *po ) ) >> 16 ); po++;
+    }
+}
+
+static void output_overlap_fi32( filter_t        *p_filter,
+                                 void            *buf_out,
+                                 unsigned         bytes_off )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    int32_t *pout = buf_out;
+    int32_t *pb   = p->table_blend;
+    int32_t *po   = p->buf_overlap;
+    int32_t *pin  = (int32_t *)( p->buf_queue + bytes_off );
+    unsigned i;
+    for( i = 0; i < p->samples_overlap; i++ ) {
+        *pout++ = *po + ( ( (int64_t)*pb++ * ( (int64_t)*pin++ - *po ) ) >> 16 ); po++;
+    }
+}
+
 /*****************************************************************************
  * fill_queue: fill p_sys->buf_queue as much possible, skipping samples as needed
  *****************************************************************************/
@@ -306,15 +420,30 @@ static int reinit_buffers( filter_t *p_filter )
         if( p->bytes_overlap > prev_overlap )
             memset( (uint8_t *)p->buf_overlap + prev_overlap, 0, p->bytes_overlap - prev_overlap );
 
-        float *pb = p->table_blend;
-        float t = (float)frames_overlap;
-        for( i = 0; i<frames_overlap; i++ )
+        if( p->format == VLC_CODEC_FL32 )
         {
-            float v = i / t;
-            for( j = 0; j < p->samples_per_frame; j++ )
-                *pb++ = v;
+            float *pb = p->table_blend;
+            float t = (float)frames_overlap;
+            for( i = 0; i<frames_overlap; i++ )
+            {
+                float v = i / t;
+                for( j = 0; j < p->samples_per_frame; j++ )
+                    *pb++ = v;
+            }
+            p->output_overlap = output_overlap_float;
+        }
+        else
+        {
+            int32_t *pb = p->table_blend;
+            for( i = 0; i<frames_overlap; i++ )
+            {
+                int32_t v = ( i << 16 ) / frames_overlap;
+                for( j = 0; j < p->samples_per_frame; j++ )
+                    *pb++ = v;
+            }
+            p->output_overlap = p->format == VLC_CODEC_S16N ? output_overlap_s16
+                                                            : output_overlap_fi32;
         }
-        p->output_overlap = output_overlap_float;
     }
 
     /* best overlap */
@@ -323,7 +452,7 @@ static int reinit_buffers( filter_t *p_filter )
     { /* if no search */
         p->best_overlap_offset = NULL;
     }
-    else
+    else if( p->format == VLC_CODEC_FL32 )
     {
         unsigned bytes_pre_corr = ( p->samples_overlap - p->samples_per_frame ) * 4; /* sizeof (int32|float) */
         p->buf_pre_corr = malloc( bytes_pre_corr );
@@ -339,6 +468,27 @@ static int reinit_buffers( filter_t *p_filter )
         }
         p->best_overlap_offset = best_overlap_offset_float;
     }
+    else
+    {
+        /* mono, padded to the 8 samples of the correlation kernels */
+        p->samples_corr = ( frames_overlap - 1 + 7 ) & ~7;
+        p->buf_pre_corr = calloc( p->samples_corr, sizeof(int16_t) );
+        p->table_window = malloc( ( frames_overlap - 1 ) * sizeof(int32_t) );
+        p->buf_search   = calloc( p->frames_search + p->samples_corr, sizeof(int16_t) );
+        if( ! p->buf_pre_corr || ! p->table_window || ! p->buf_search )
+            return VLC_ENOMEM;
+        /* same window as above, scaled to 15 bits */
+        int64_t max = (int64_t)( frames_overlap / 2 ) * ( frames_overlap - frames_overlap / 2 );
+        int32_t *pw = p->table_window;
+        for( i = 1; i<frames_overlap; i++ )
+            *pw++ = (int64_t)i * ( frames_overlap - i ) * 32767 / max;
+        p->correlate = correlate_s16;
+#ifdef HAVE_NEON
+        if( vlc_CPU() & CPU_CAPABILITY_NEON )
+            p->correlate = scaletempo_correlate_neon;
+#endif
+        p->best_overlap_offset = best_overlap_offset_fixed;
+    }
 
     unsigned new_size = ( p->frames_search + frames_stride + frames_overlap ) * p->bytes_per_frame;
     if( p->bytes_queued > new_size )
@@ -375,7 +525,7 @@ static int reinit_buffers( filter_t *p_filter )
              (int)( p->bytes_overlap / p->bytes_per_frame ),
              p->frames_search,
              (int)( p->bytes_queue_max / p->bytes_per_frame ),
-             "fl32");
+             (const char *)&p->format );
 
     return VLC_SUCCESS;
 }
@@ -389,8 +539,11 @@ static int Open( vlc_object_t *p_this )
     filter_sys_t *p_sys;
     bool b_fit = true;
 
-    if( p_filter->fmt_in.audio.i_format != VLC_CODEC_FL32 ||
-        p_filter->fmt_out.audio.i_format != VLC_CODEC_FL32 )
+    vlc_fourcc_t format = p_filter->fmt_in.audio.i_format;
+
+    if( ( format != VLC_CODEC_FL32 && format != VLC_CODEC_FI32
+       && format != VLC_CODEC_S16N ) ||
+        p_filter->fmt_out.audio.i_format != format )
     {
         b_fit = false;
         p_filter->fmt_in.audio.i_format = p_filter->fmt_out.audio.i_format = VLC_CODEC_FL32;
@@ -415,15 +568,16 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->scale             = 1.0;
     p_sys->sample_rate       = p_filter->fmt_in.audio.i_rate;
+    p_sys->format            = format;
     p_sys->samples_per_frame = aout_FormatNbChannels( &p_filter->fmt_in.audio );
-    p_sys->bytes_per_sample  = 4;
+    p_sys->bytes_per_sample  = format == VLC_CODEC_S16N ? 2 : 4;
     p_sys->bytes_per_frame   = p_sys->samples_per_frame * p_sys->bytes_per_sample;
 
-    msg_Dbg( p_this, "format: %5i rate, %i nch, %i bps, %s",
+    msg_Dbg( p_this, "format: %5i rate, %i nch, %i bps, %4.4s",
              p_sys->sample_rate,
              p_sys->samples_per_frame,
              p_sys->bytes_per_sample,
-             "fl32" );
+             (const char *)&p_sys->format );
 
     p_sys->ms_stride       = var_InheritInteger( p_this, "scaletempo-stride" );
     p_sys->percent_overlap = var_InheritFloat( p_this, "scaletempo-overlap" );
@@ -437,6 +591,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->table_blend    = NULL;
     p_sys->buf_pre_corr   = NULL;
     p_sys->table_window   = NULL;
+    p_sys->buf_search     = NULL;
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
@@ -459,6 +614,7 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->table_blend );
     free( p_sys->buf_pre_corr );
     free( p_sys->table_window );
+    free( p_sys->buf_search );
     free( p_sys );
 }
 
@@ -76,7 +76,6 @@ struct decoder_sys_t
     int64_t i_previous_layout;
 };
 
-#define BLOCK_FLAG_PRIVATE_REALLOCATED (1 << BLOCK_FLAG_PRIVATE_SHIFT)
 
 static void SetupOutputFormat( decoder_t *p_dec, bool b_trust );
 
@@ -145,7 +144,7 @@ int InitAudioDec( decoder_t *p_dec, AVCodecContext *p_context,
     decoder_sys_t *p_sys;
 
     /* Allocate the memory needed to store the decoder's structure */
-    if( ( p_dec->p_sys = p_sys = malloc(sizeof(*p_sys)) ) == NULL )
+    if( ( p_dec->p_sys = p_sys = calloc( 1, sizeof(*p_sys) ) ) == NULL )
     {
         return VLC_ENOMEM;
     }
@@ -310,16 +309,9 @@ aout_buffer_t * DecodeAudio ( decoder_t *p_dec, block_t **pp_block )
         return NULL;
     }
 
-    if( (p_block->i_flags & BLOCK_FLAG_PRIVATE_REALLOCATED) == 0 )
-    {
-        *pp_block = p_block = block_Realloc( p_block, 0, p_block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE );
-        if( !p_block )
-            return NULL;
-        p_block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
-        memset( &p_block->p_buffer[p_block->i_buffer], 0, FF_INPUT_BUFFER_PADDING_SIZE );
-
-        p_block->i_flags |= BLOCK_FLAG_PRIVATE_REALLOCATED;
-    }
+    *pp_block = p_block = ffmpeg_PadBlock( p_dec, p_block );
+    if( !p_block )
+        return NULL;
 
     do
     {
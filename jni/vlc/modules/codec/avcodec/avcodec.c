@@ -70,6 +70,12 @@ static const int  nloopf_list[] = { 0, 1, 2, 3, 4 };
 static const char *const nloopf_list_text[] =
   { N_("None"), N_("Non-ref"), N_("Bidir"), N_("Non-key"), N_("All") };
 
+#if defined(FF_THREAD_FRAME)
+static const int  nthreads_type_list[] = { 0, FF_THREAD_FRAME, FF_THREAD_SLICE };
+static const char *const nthreads_type_list_text[] =
+  { N_("Automatic"), N_("Frame"), N_("Slice") };
+#endif
+
 #ifdef ENABLE_SOUT
 static const char *const enc_hq_list[] = { "rd", "bits", "simple" };
 static const char *const enc_hq_list_text[] = {
@@ -132,6 +138,9 @@ vlc_module_begin ()
 #endif
 #if defined(FF_THREAD_FRAME)
     add_integer( "ffmpeg-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true );
+    add_integer( "ffmpeg-threads-type", 0, THREADS_TYPE_TEXT,
+                 THREADS_TYPE_LONGTEXT, true )
+        change_integer_list( nthreads_type_list, nthreads_type_list_text )
 #endif
 
 
@@ -358,6 +367,9 @@ static void CloseDecoder( vlc_object_t *p_this )
             vlc_avcodec_unlock();
         }
         msg_Dbg( p_dec, "ffmpeg codec (%s) stopped", p_sys->psz_namecodec );
+        msg_Dbg( p_dec, "%"PRIu64" bytes decoded in place, %"PRIu64
+                 " reallocated for the padding", p_sys->i_in_place,
+                 p_sys->i_reallocated );
         av_free( p_sys->p_context );
     }
 
@@ -464,3 +476,36 @@ int ffmpeg_OpenCodec( decoder_t *p_dec )
 
     return VLC_SUCCESS;
 }
+
+/*****************************************************************************
+ * ffmpeg_PadBlock:
+ *****************************************************************************
+ * The packets of libavformat already have the padding, the other blocks are
+ * reallocated, which copies them when they do not own their buffer.
+ *****************************************************************************/
+block_t *ffmpeg_PadBlock( decoder_t *p_dec, block_t *p_block )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    /* The rest of a block is decoded by the next calls */
+    if( p_block->i_flags & BLOCK_FLAG_PRIVATE_PADDED )
+        return p_block;
+
+    if( p_block->i_flags & BLOCK_FLAG_AVCODEC_PADDED )
+    {
+        p_sys->i_in_place += p_block->i_buffer;
+    }
+    else
+    {
+        p_sys->i_reallocated += p_block->i_buffer;
+        p_block = block_Realloc( p_block, 0,
+                            p_block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE );
+        if( !p_block )
+            return NULL;
+        p_block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
+    }
+    memset( &p_block->p_buffer[p_block->i_buffer], 0,
+            FF_INPUT_BUFFER_PADDING_SIZE );
+    p_block->i_flags |= BLOCK_FLAG_PRIVATE_PADDED;
+    return p_block;
+}
@@ -65,6 +65,10 @@ void EndSubtitleDec( decoder_t *p_dec );
 /* Initialize decoder */
 int ffmpeg_OpenCodec( decoder_t *p_dec );
 
+/* Adds the zeroed padding libavcodec reads past the data of the block */
+#define BLOCK_FLAG_PRIVATE_PADDED (1 << BLOCK_FLAG_PRIVATE_SHIFT)
+block_t *ffmpeg_PadBlock( decoder_t *p_dec, block_t *p_block );
+
 /*****************************************************************************
  * Module descriptor help strings
  *****************************************************************************/
@@ -140,6 +144,13 @@ int ffmpeg_OpenCodec( decoder_t *p_dec );
 #define THREADS_TEXT N_( "Threads" )
 #define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning auto" )
 
+#define THREADS_TYPE_TEXT N_( "Threading mode" )
+#define THREADS_TYPE_LONGTEXT N_( "Frame threading decodes several " \
+    "pictures at once, at the cost of one picture of delay per thread. " \
+    "Slice threading splits each picture, when the stream has several " \
+    "slices. By default, the mode is chosen from the codec, the resolution " \
+    "and the source." )
+
 /*
  * Encoder options
  */
@@ -262,7 +273,9 @@ int ffmpeg_OpenCodec( decoder_t *p_dec );
     const char *psz_namecodec;  \
     AVCodecContext *p_context;  \
     AVCodec        *p_codec;    \
-    bool b_delayed_open;
+    bool b_delayed_open;        \
+    uint64_t i_in_place;        \
+    uint64_t i_reallocated;
 
 #ifndef AV_VERSION_INT
 #   define AV_VERSION_INT(a, b, c) ((a)<<16 | (b)<<8 | (c))
@@ -57,6 +57,12 @@
 #   define ASM_SSE2(cpu, op)
 #endif
 
+#ifdef CAN_COMPILE_SSE2
+#   define HasSSE2(cpu) ((cpu & CPU_CAPABILITY_SSE2) != 0)
+#else
+#   define HasSSE2(cpu) false
+#endif
+
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
  * as used by some video surface.
  * XXX It is really efficient only when SSE4.1 is available.
@@ -313,6 +319,16 @@ void CopyFromNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
 {
     const unsigned cpu = vlc_CPU();
 
+    /* Without SSE2, there is nothing to gain from the cache */
+    if (!HasSSE2(cpu)) {
+        vlc_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                      src[0], src_pitch[0], width, height);
+        vlc_SplitPlane(dst->p[2].p_pixels, dst->p[2].i_pitch,
+                       dst->p[1].p_pixels, dst->p[1].i_pitch,
+                       src[1], src_pitch[1], width/2, height/2);
+        return;
+    }
+
     /* */
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0],
@@ -335,6 +351,11 @@ void CopyFromYv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
     /* */
     for (unsigned n = 0; n < 3; n++) {
         const unsigned d = n > 0 ? 2 : 1;
+        if (!HasSSE2(cpu)) {
+            vlc_CopyPlane(dst->p[n].p_pixels, dst->p[n].i_pitch,
+                          src[n], src_pitch[n], width/d, height/d);
+            continue;
+        }
         CopyPlane(dst->p[n].p_pixels, dst->p[n].i_pitch,
                   src[n], src_pitch[n],
                   cache->buffer, cache->size,
@@ -343,6 +364,7 @@ void CopyFromYv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
     ASM_SSE2(cpu, "emms");
 }
 
+#undef HasSSE2
 #undef ASM_SSE2
 #undef COPY64
 
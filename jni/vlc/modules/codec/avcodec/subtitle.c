@@ -72,7 +72,7 @@ int InitSubtitleDec(decoder_t *dec, AVCodecContext *context,
     }
 
     /* */
-    dec->p_sys = sys = malloc(sizeof(*sys));
+    dec->p_sys = sys = calloc(1, sizeof(*sys));
     if (!sys)
         return VLC_ENOMEM;
 
@@ -131,13 +131,9 @@ subpicture_t *DecodeSubtitle(decoder_t *dec, block_t **block_ptr)
     }
 
     *block_ptr =
-    block      = block_Realloc(block,
-                               0,
-                               block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE);
+    block      = ffmpeg_PadBlock(dec, block);
     if (!block)
         return NULL;
-    block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
-    memset(&block->p_buffer[block->i_buffer], 0, FF_INPUT_BUFFER_PADDING_SIZE);
 
     /* */
     AVSubtitle subtitle;
@@ -200,6 +200,136 @@ static inline picture_t *ffmpeg_NewPictBuf( decoder_t *p_dec,
     return decoder_NewPicture( p_dec );
 }
 
+#ifdef HAVE_AVCODEC_MT
+/* Up to CIF, a single core keeps up and the threads only add overhead */
+#define THREADS_MIN_PIXELS  (352 * 288)
+/* Each frame thread delays the pictures, live sources have little slack */
+#define THREADS_LIVE_FRAME  2
+#define THREADS_MAX         16
+
+#define H264_PROFILE_BASELINE 66
+
+/* Returns the H.264 profile from the avcC or Annex B extra data, or -1 */
+static int GetH264Profile( const es_format_t *p_fmt )
+{
+    const uint8_t *p = p_fmt->p_extra;
+    const int i_extra = p_fmt->i_extra;
+
+    if( p_fmt->i_profile > 0 )
+        return p_fmt->i_profile;
+    if( i_extra >= 2 && p[0] == 1 )
+        return p[1];
+    for( int i = 0; i + 4 < i_extra; i++ )
+    {
+        if( p[i] == 0 && p[i+1] == 0 && p[i+2] == 1 && (p[i+3] & 0x1f) == 7 )
+            return p[i+4];
+    }
+    return -1;
+}
+
+/* Returns the value of a variable of the input playing the stream */
+static bool GetInputBool( decoder_t *p_dec, const char *psz_name,
+                          bool b_default )
+{
+    vlc_object_t *p_input = p_dec->p_parent;
+
+    if( p_input == NULL || !var_Type( p_input, psz_name ) )
+        return b_default;
+    return var_GetBool( p_input, psz_name );
+}
+
+/*****************************************************************************
+ * ffmpeg_InitThreads: chooses between frame and slice threading
+ *****************************************************************************
+ * Frame threading scales with any stream but delays the pictures by one per
+ * thread and duplicates the decoding context, slice threading only helps
+ * with the streams made of several slices.
+ *****************************************************************************/
+static void ffmpeg_InitThreads( decoder_t *p_dec, AVCodecContext *p_context,
+                                AVCodec *p_codec, int i_codec_id )
+{
+    const bool b_frame = p_codec->capabilities & CODEC_CAP_FRAME_THREADS;
+    const bool b_slice = p_codec->capabilities & CODEC_CAP_SLICE_THREADS;
+    const unsigned i_pixels = p_dec->fmt_in.video.i_width *
+                              p_dec->fmt_in.video.i_height;
+    const bool b_low_delay = GetInputBool( p_dec, "low-delay", false );
+    const bool b_live = !GetInputBool( p_dec, "can-seek", true );
+    const char *psz_reason;
+
+    int i_type = var_InheritInteger( p_dec, "ffmpeg-threads-type" );
+    int i_count = var_InheritInteger( p_dec, "ffmpeg-threads" );
+    const bool b_forced_count = i_count > 0;
+    if( !b_forced_count )
+        i_count = vlc_GetCPUCount();
+
+    if( i_type == FF_THREAD_FRAME || i_type == FF_THREAD_SLICE )
+    {
+        psz_reason = "forced";
+        if( i_type == FF_THREAD_FRAME && !b_frame && b_slice )
+        {
+            psz_reason = "no frame threading in the codec";
+            i_type = FF_THREAD_SLICE;
+        }
+    }
+    else if( b_low_delay )
+    {
+        psz_reason = "low latency source";
+        i_type = FF_THREAD_SLICE;
+    }
+    else if( !b_frame )
+    {
+        psz_reason = "no frame threading in the codec";
+        i_type = FF_THREAD_SLICE;
+    }
+    else if( i_codec_id == CODEC_ID_H264 &&
+             GetH264Profile( &p_dec->fmt_in ) == H264_PROFILE_BASELINE )
+    {
+        /* Conferencing and camera streams, without reordering and often
+         * split in slices */
+        psz_reason = "baseline profile";
+        i_type = FF_THREAD_SLICE;
+    }
+    else if( i_pixels > 0 && i_pixels <= THREADS_MIN_PIXELS )
+    {
+        psz_reason = "small pictures";
+        i_type = FF_THREAD_FRAME;
+        if( !b_forced_count )
+            i_count = 1;
+    }
+    else if( b_live )
+    {
+        psz_reason = "live source";
+        i_type = FF_THREAD_FRAME;
+        if( !b_forced_count )
+            i_count = __MIN( i_count, THREADS_LIVE_FRAME );
+    }
+    else
+    {
+        psz_reason = i_pixels > 0 ? "resolution" : "unknown resolution";
+        i_type = FF_THREAD_FRAME;
+    }
+
+    i_count = __MIN( i_count, THREADS_MAX );
+    if( i_count <= 1 || ( i_type == FF_THREAD_SLICE && !b_slice ) )
+    {
+        i_count = 1;
+        i_type = 0;
+    }
+
+    if( i_type != 0 )
+        msg_Dbg( p_dec, "allowing %d %s thread(s) for decoding %ux%u (%s)",
+                 i_count, i_type == FF_THREAD_FRAME ? "frame" : "slice",
+                 p_dec->fmt_in.video.i_width, p_dec->fmt_in.video.i_height,
+                 psz_reason );
+    else
+        msg_Dbg( p_dec, "decoding %ux%u in a single thread (%s)",
+                 p_dec->fmt_in.video.i_width, p_dec->fmt_in.video.i_height,
+                 psz_reason );
+    p_context->thread_count = i_count;
+    p_context->thread_type = i_type;
+}
+#endif
+
 /*****************************************************************************
  * InitVideo: initialize the video decoder
  *****************************************************************************
@@ -343,11 +473,7 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     p_sys->p_context->opaque = p_dec;
 
 #ifdef HAVE_AVCODEC_MT
-    int i_thread_count = var_InheritInteger( p_dec, "ffmpeg-threads" );
-    if( i_thread_count <= 0 )
-        i_thread_count = vlc_GetCPUCount();
-    msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
-    p_sys->p_context->thread_count = i_thread_count;
+    ffmpeg_InitThreads( p_dec, p_context, p_codec, i_codec_id );
 #endif
 
 #ifdef HAVE_AVCODEC_VA
@@ -563,7 +689,10 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
     bool b_no_skip_pred = (p_sys->i_decode_last_time < p_sys->i_decode_average_time);
     bool b_no_skip_late = (i_time_now + p_sys->i_decode_average_time - p_sys->i_late_frames_start < 200000);
     bool b_skip = ( (!p_dec->b_pace_control) &&  ((b_skip_pred && !b_no_skip_pred) || (b_skip_late && !b_no_skip_late)) );
-    p_context->skip_frame = b_skip ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+    /* Never below the configured ffmpeg-skip-frame (keyframes only for the
+     * thumbnailer) */
+    p_context->skip_frame = __MAX( b_skip ? AVDISCARD_NONREF : AVDISCARD_DEFAULT,
+                                   p_sys->i_skip_frame );
     if( !(p_block->i_flags & BLOCK_FLAG_PREROLL) )
         b_drawpicture = 1;
     else
@@ -581,14 +710,10 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
     {
         p_sys->b_flush = ( p_block->i_flags & BLOCK_FLAG_END_OF_SEQUENCE ) != 0;
 
-        p_block = block_Realloc( p_block, 0,
-                            p_block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE );
+        p_block = ffmpeg_PadBlock( p_dec, p_block );
+        *pp_block = p_block;
         if( !p_block )
             return NULL;
-        p_block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
-        *pp_block = p_block;
-        memset( p_block->p_buffer + p_block->i_buffer, 0,
-                FF_INPUT_BUFFER_PADDING_SIZE );
     }
 
     while( p_block->i_buffer > 0 || p_sys->b_flush )
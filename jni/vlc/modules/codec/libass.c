@@ -66,6 +66,17 @@ vlc_module_end ()
  *****************************************************************************/
 static subpicture_t *DecodeBlock( decoder_t *, block_t ** );
 
+typedef struct
+{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} rectangle_t;
+
+/* Maximum number of regions of a subpicture */
+#define LIBASS_MAX_REGION 4
+
 /* */
 struct decoder_sys_t
 {
@@ -82,6 +93,19 @@ struct decoder_sys_t
 
     /* */
     ASS_Track      *p_track;
+
+    /* Regions drawn by the last update, reused as long as the images they
+     * are made of do not change (karaoke effects usually animate only one
+     * line at a time, scrolling ones only move their images) */
+    struct
+    {
+        rectangle_t rect;
+        uint64_t    i_key;
+        picture_t   *p_picture;
+    } cache[LIBASS_MAX_REGION];
+    int            i_cache;
+    unsigned       i_drawn;
+    unsigned       i_reused;
 };
 static void DecSysRelease( decoder_sys_t *p_sys );
 static void DecSysHold( decoder_sys_t *p_sys );
@@ -105,18 +129,13 @@ struct subpicture_updater_sys_t
     mtime_t       i_pts;
 
     ASS_Image     *p_img;
+    int           i_changed;
 };
 
-typedef struct
-{
-    int x0;
-    int y0;
-    int x1;
-    int y1;
-} rectangle_t;
-
 static int BuildRegions( rectangle_t *p_region, int i_max_region, ASS_Image *p_img_list, int i_width, int i_height );
+static uint64_t RegionKey( const rectangle_t *p_rect, ASS_Image *p_img );
 static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img );
+static void CacheFlush( decoder_sys_t *p_sys );
 
 //#define DEBUG_REGION
 
@@ -145,6 +164,9 @@ static int Create( vlc_object_t *p_this )
     p_sys->p_library  = NULL;
     p_sys->p_renderer = NULL;
     p_sys->p_track    = NULL;
+    p_sys->i_cache    = 0;
+    p_sys->i_drawn    = 0;
+    p_sys->i_reused   = 0;
 
     /* Create libass library */
     ASS_Library *p_library = p_sys->p_library = ass_library_init();
@@ -250,8 +272,13 @@ static int Create( vlc_object_t *p_this )
 static void Destroy( vlc_object_t *p_this )
 {
     decoder_t *p_dec = (decoder_t *)p_this;
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    msg_Dbg( p_dec, "%u regions drawn, %u reused", p_sys->i_drawn, p_sys->i_reused );
+    vlc_mutex_unlock( &p_sys->lock );
 
-    DecSysRelease( p_dec->p_sys );
+    DecSysRelease( p_sys );
 }
 
 static void DecSysHold( decoder_sys_t *p_sys )
@@ -273,6 +300,8 @@ static void DecSysRelease( decoder_sys_t *p_sys )
     vlc_mutex_unlock( &p_sys->lock );
     vlc_mutex_destroy( &p_sys->lock );
 
+    CacheFlush( p_sys );
+
     if( p_sys->p_track )
         ass_free_track( p_sys->p_track );
     if( p_sys->p_renderer )
@@ -395,6 +424,7 @@ static int SubpictureValidate( subpicture_t *p_subpic,
         const double dst_ratio = (double)p_fmt_dst->i_width / p_fmt_dst->i_height;
         ass_set_aspect_ratio( p_sys->p_renderer, dst_ratio / src_ratio, 1 );
         p_sys->fmt = fmt;
+        CacheFlush( p_sys );
     }
 
     /* */
@@ -410,6 +440,7 @@ static int SubpictureValidate( subpicture_t *p_subpic,
         return VLC_SUCCESS;
     }
     p_subpic->updater.p_sys->p_img = p_img;
+    p_subpic->updater.p_sys->i_changed = i_changed;
 
     /* The lock is released by SubpictureUpdate */
     return VLC_EGENERIC;
@@ -426,6 +457,7 @@ static void SubpictureUpdate( subpicture_t *p_subpic,
 
     video_format_t fmt = p_sys->fmt;
     ASS_Image *p_img = p_subpic->updater.p_sys->p_img;
+    const bool b_unchanged = p_subpic->updater.p_sys->i_changed == 0;
 
     /* */
     p_subpic->i_original_picture_height = fmt.i_height;
@@ -437,18 +469,19 @@ static void SubpictureUpdate( subpicture_t *p_subpic,
      * reinstanciate a lot the scaler, and as we do not support subpel blending
      * it looks ugly (text unaligned).
      */
-    const int i_max_region = 4;
-    rectangle_t region[i_max_region];
-    const int i_region = BuildRegions( region, i_max_region, p_img, fmt.i_width, fmt.i_height );
+    rectangle_t region[LIBASS_MAX_REGION];
+    const int i_region = BuildRegions( region, LIBASS_MAX_REGION, p_img, fmt.i_width, fmt.i_height );
 
-    if( i_region <= 0 )
-    {
-        vlc_mutex_unlock( &p_sys->lock );
-        return;
-    }
-
-    /* Allocate the regions and draw them */
+    /* Allocate the regions and draw the ones that have changed since the
+     * last update, the others reuse the previously drawn picture */
     subpicture_region_t **pp_region_last = &p_subpic->p_region;
+    int i_cache = 0;
+    struct
+    {
+        rectangle_t rect;
+        uint64_t    i_key;
+        picture_t   *p_picture;
+    } cache[LIBASS_MAX_REGION];
 
     for( int i = 0; i < i_region; i++ )
     {
@@ -462,7 +495,30 @@ static void SubpictureUpdate( subpicture_t *p_subpic,
         fmt_region.i_height =
         fmt_region.i_visible_height = region[i].y1 - region[i].y0;
 
-        r = subpicture_region_New( &fmt_region );
+        /* When libass reports no change, the regions are the same as the
+         * last time. Otherwise a region drawn from the same images at the
+         * same place in it is reused, even if it moved. */
+        const uint64_t i_key = RegionKey( &region[i], p_img );
+        picture_t *p_cached = NULL;
+        for( int j = 0; j < p_sys->i_cache; j++ )
+        {
+            const rectangle_t *p_rect = &p_sys->cache[j].rect;
+
+            if( b_unchanged ?
+                !memcmp( p_rect, &region[i], sizeof(region[i]) ) :
+                p_sys->cache[j].i_key == i_key &&
+                p_rect->x1 - p_rect->x0 == region[i].x1 - region[i].x0 &&
+                p_rect->y1 - p_rect->y0 == region[i].y1 - region[i].y0 )
+            {
+                p_cached = p_sys->cache[j].p_picture;
+                break;
+            }
+        }
+
+        if( p_cached )
+            r = subpicture_region_NewFromPicture( &fmt_region, p_cached );
+        else
+            r = subpicture_region_New( &fmt_region );
         if( !r )
             break;
         r->i_x = region[i].x0;
@@ -470,14 +526,33 @@ static void SubpictureUpdate( subpicture_t *p_subpic,
         r->i_align = SUBPICTURE_ALIGN_TOP | SUBPICTURE_ALIGN_LEFT;
 
         /* */
-        RegionDraw( r, p_img );
+        if( p_cached )
+        {
+            p_sys->i_reused++;
+        }
+        else
+        {
+            RegionDraw( r, p_img );
+            p_sys->i_drawn++;
+        }
+
+        /* */
+        cache[i_cache].rect = region[i];
+        cache[i_cache].i_key = i_key;
+        cache[i_cache].p_picture = r->p_picture;
+        picture_Hold( r->p_picture );
+        i_cache++;
 
         /* */
         *pp_region_last = r;
         pp_region_last = &r->p_next;
     }
-    vlc_mutex_unlock( &p_sys->lock );
 
+    CacheFlush( p_sys );
+    memcpy( p_sys->cache, cache, i_cache * sizeof(*cache) );
+    p_sys->i_cache = i_cache;
+
+    vlc_mutex_unlock( &p_sys->lock );
 }
 static void SubpictureDestroy( subpicture_t *p_subpic )
 {
@@ -639,6 +714,44 @@ static int BuildRegions( rectangle_t *p_region, int i_max_region, ASS_Image *p_i
     return i_region;
 }
 
+static void CacheFlush( decoder_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_cache; i++ )
+        picture_Release( p_sys->cache[i].p_picture );
+    p_sys->i_cache = 0;
+}
+
+/* Identifies the images drawn by RegionDraw() into a region. libass frees
+ * and reuses the bitmaps of its cache, so the content of the bitmaps is
+ * hashed rather than their address; it is still much cheaper than the
+ * blending of RegionDraw(). */
+static uint64_t RegionKey( const rectangle_t *p_rect, ASS_Image *p_img )
+{
+    uint64_t i_key = UINT64_C(14695981039346656037);
+
+#define KEY(v) do { i_key ^= (uint64_t)(v); i_key *= UINT64_C(1099511628211); } while(0)
+    for( ; p_img != NULL; p_img = p_img->next )
+    {
+        if( p_img->dst_x < p_rect->x0 || p_img->dst_x + p_img->w > p_rect->x1 ||
+            p_img->dst_y < p_rect->y0 || p_img->dst_y + p_img->h > p_rect->y1 )
+            continue;
+
+        KEY( p_img->dst_x - p_rect->x0 );
+        KEY( p_img->dst_y - p_rect->y0 );
+        KEY( p_img->w );
+        KEY( p_img->h );
+        KEY( p_img->color );
+        for( int y = 0; y < p_img->h; y++ )
+        {
+            const unsigned char *p_row = &p_img->bitmap[y * p_img->stride];
+            for( int x = 0; x < p_img->w; x++ )
+                KEY( p_row[x] );
+        }
+    }
+#undef KEY
+    return i_key;
+}
+
 static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img )
 {
     const plane_t *p = &p_region->p_picture->p[0];
@@ -127,7 +127,7 @@ void CopyOmxPicture( decoder_t *p_dec, picture_t *p_pic,
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
     int i_src_stride, i_dst_stride;
-    int i_plane, i_width, i_line;
+    int i_plane, i_width;
     uint8_t *p_dst, *p_src;
 
     i_src_stride  = p_sys->out.i_frame_stride;
@@ -140,12 +140,9 @@ void CopyOmxPicture( decoder_t *p_dec, picture_t *p_pic,
         i_dst_stride = p_pic->p[i_plane].i_pitch;
         i_width = p_pic->p[i_plane].i_visible_pitch;
 
-        for( i_line = 0; i_line < p_pic->p[i_plane].i_visible_lines; i_line++ )
-        {
-            vlc_memcpy( p_dst, p_src, i_width );
-            p_src += i_src_stride;
-            p_dst += i_dst_stride;
-        }
+        vlc_CopyPlane( p_dst, i_dst_stride, p_src, i_src_stride, i_width,
+                       p_pic->p[i_plane].i_visible_lines );
+        p_src += i_src_stride * p_pic->p[i_plane].i_visible_lines;
     }
 }
 
@@ -154,7 +151,7 @@ void CopyVlcPicture( decoder_t *p_dec, OMX_BUFFERHEADERTYPE *p_header,
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
     int i_src_stride, i_dst_stride;
-    int i_plane, i_width, i_line;
+    int i_plane, i_width;
     uint8_t *p_dst, *p_src;
 
     i_dst_stride  = p_sys->out.i_frame_stride;
@@ -167,12 +164,9 @@ void CopyVlcPicture( decoder_t *p_dec, OMX_BUFFERHEADERTYPE *p_header,
         i_src_stride = p_pic->p[i_plane].i_pitch;
         i_width = p_pic->p[i_plane].i_visible_pitch;
 
-        for( i_line = 0; i_line < p_pic->p[i_plane].i_visible_lines; i_line++ )
-        {
-            vlc_memcpy( p_dst, p_src, i_width );
-            p_src += i_src_stride;
-            p_dst += i_dst_stride;
-        }
+        vlc_CopyPlane( p_dst, i_dst_stride, p_src, i_src_stride, i_width,
+                       p_pic->p[i_plane].i_visible_lines );
+        p_dst += i_dst_stride * p_pic->p[i_plane].i_visible_lines;
     }
 }
 
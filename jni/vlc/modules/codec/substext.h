@@ -98,6 +98,7 @@ static inline subpicture_t *decoder_NewSubpictureText(decoder_t *decoder)
         .pf_update   = SubpictureTextUpdate,
         .pf_destroy  = SubpictureTextDestroy,
         .p_sys       = sys,
+        .b_stateless = true,
     };
     subpicture_t *subpic = decoder_NewSubpicture(decoder, &updater);
     if (!subpic)
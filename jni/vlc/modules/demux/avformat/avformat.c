@@ -41,6 +41,9 @@ vlc_module_begin ()
     set_shortname( N_("Avformat") )
     set_capability( "demux", 2 )
     set_callbacks( OpenDemux, CloseDemux )
+    /* The packets sent without copy are released by this plugin, possibly
+     * after the demuxer was closed */
+    cannot_unload_broken_library()
 
 #ifdef ENABLE_SOUT
     /* mux submodule */
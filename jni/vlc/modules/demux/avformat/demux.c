@@ -78,6 +78,11 @@ struct demux_sys_t
 
     unsigned    i_ssa_order;
 
+    /* Bytes sent in the packets of libavformat, and bytes duplicated out of
+     * its internal buffers */
+    uint64_t    i_wrapped;
+    uint64_t    i_copied;
+
     int                i_attachments;
     input_attachment_t **attachments;
 
@@ -95,6 +100,7 @@ static int IORead( void *opaque, uint8_t *buf, int buf_size );
 static int64_t IOSeek( void *opaque, int64_t offset, int whence );
 
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order );
+static block_t *BuildFrame( demux_sys_t *p_sys, AVPacket *p_pkt );
 static void UpdateSeekPoint( demux_t *p_demux, int64_t i_time );
 
 /*****************************************************************************
@@ -194,6 +200,8 @@ int OpenDemux( vlc_object_t *p_this )
     p_sys->i_pcr_tk = -1;
     p_sys->i_pcr = -1;
     p_sys->i_ssa_order = 0;
+    p_sys->i_wrapped = 0;
+    p_sys->i_copied = 0;
     TAB_INIT( p_sys->i_attachments, p_sys->attachments);
     p_sys->p_title = NULL;
 
@@ -507,6 +515,10 @@ void CloseDemux( vlc_object_t *p_this )
 
     FREENULL( p_sys->tk );
 
+    msg_Dbg( p_demux, "%"PRIu64" bytes sent in the packets of libavformat, "
+             "%"PRIu64" of them duplicated", p_sys->i_wrapped + p_sys->i_copied,
+             p_sys->i_copied );
+
     if( p_sys->ic ) av_close_input_stream( p_sys->ic );
 
     for( int i = 0; i < p_sys->i_attachments; i++ )
@@ -558,12 +570,11 @@ static int Demux( demux_t *p_demux )
     }
     else
     {
-        if( ( p_frame = block_New( p_demux, pkt.size ) ) == NULL )
+        if( ( p_frame = BuildFrame( p_sys, &pkt ) ) == NULL )
         {
             av_free_packet( &pkt );
             return 0;
         }
-        memcpy( p_frame->p_buffer, pkt.data, pkt.size );
     }
 
     if( pkt.flags & AV_PKT_FLAG_KEY )
@@ -635,6 +646,58 @@ static void UpdateSeekPoint( demux_t *p_demux, int64_t i_time )
     }
 }
 
+/* A block holding the data of a packet of libavformat */
+typedef struct
+{
+    block_t  self;
+    AVPacket packet;
+} block_packet_t;
+
+static void BlockPacketRelease( block_t *p_block )
+{
+    block_packet_t *p_packet = (block_packet_t *)p_block;
+
+    av_free_packet( &p_packet->packet );
+    free( p_packet );
+}
+
+/* Takes the data of the packet, which is left empty */
+static block_t *BuildFrame( demux_sys_t *p_sys, AVPacket *p_pkt )
+{
+    block_packet_t *p_packet = malloc( sizeof(*p_packet) );
+    if( p_packet == NULL )
+        return NULL;
+
+    /* The packets pointing to the internal buffers of the demuxer are only
+     * valid until the next read, those are copied */
+    const uint8_t *p_data = p_pkt->data;
+    if( av_dup_packet( p_pkt ) )
+    {
+        free( p_packet );
+        return NULL;
+    }
+    if( p_pkt->data != p_data )
+        p_sys->i_copied += p_pkt->size;
+    else
+        p_sys->i_wrapped += p_pkt->size;
+
+    /* The timestamps and the flags of the packet are still read by the
+     * caller, only its data is taken */
+    p_packet->packet = *p_pkt;
+    p_pkt->data = NULL;
+    p_pkt->size = 0;
+    p_pkt->destruct = NULL;
+    p_pkt->side_data = NULL;
+    p_pkt->side_data_elems = 0;
+
+    /* The packets are allocated with the padding of libavcodec, so that the
+     * decoders do not reallocate them */
+    block_Init( &p_packet->self, p_packet->packet.data, p_packet->packet.size );
+    p_packet->self.pf_release = BlockPacketRelease;
+    p_packet->self.i_flags |= BLOCK_FLAG_AVCODEC_PADDED;
+    return &p_packet->self;
+}
+
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order )
 {
     if( p_pkt->size <= 0 )
@@ -0,0 +1,744 @@
+/*****************************************************************************
+ * concat.c: demuxer playing the parts of a split video as one stream
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_demux.h>
+#include <vlc_charset.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+vlc_module_begin ()
+    set_shortname( "Concat" )
+    set_description( N_("Split video demuxer") )
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_DEMUX )
+    set_capability( "demux", 10 )
+    set_callbacks( Open, Close )
+    add_shortcut( "concat" )
+vlc_module_end ()
+
+/*****************************************************************************
+ * The video sites serve an episode as several FLV or MP4 files. Those are
+ * listed in the format of the concat demuxer of FFmpeg:
+ *
+ *   ffconcat version 1.0
+ *   file http://example.com/part1.flv
+ *   duration 362.4
+ *   file http://example.com/part2.flv
+ *   duration 360.0
+ *
+ * Each part is read by its own demuxer, and its dates are moved after the
+ * previous parts, so that the decoders go on across the parts. The
+ * durations are optional, but without them the parts cannot be sought to
+ * before they were played.
+ *****************************************************************************/
+#define CONCAT_HEADER "ffconcat version "
+
+/* The next part is opened that long before the end of the current one */
+#define PREFETCH_TIME   INT64_C(15000000)
+/* and its headers are read */
+#define PREFETCH_SIZE   (256 * 1024)
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int Demux  ( demux_t * );
+static int Control( demux_t *, int i_query, va_list args );
+
+static es_out_id_t *EsOutAdd( es_out_t *, const es_format_t * );
+static int          EsOutSend( es_out_t *, es_out_id_t *, block_t * );
+static void         EsOutDel( es_out_t *, es_out_id_t * );
+static int          EsOutControl( es_out_t *, int i_query, va_list );
+
+/* An elementary stream of the input, kept across the parts */
+struct es_out_id_t
+{
+    es_out_id_t *p_es;
+    es_format_t fmt;
+    bool        b_used;     /* by the current part */
+};
+
+typedef struct
+{
+    char    *psz_url;
+    mtime_t i_length;       /* 0 if unknown */
+} concat_part_t;
+
+struct demux_sys_t
+{
+    int           i_parts;
+    concat_part_t *p_parts;
+
+    /* Current part */
+    int           i_current;
+    mtime_t       i_start;  /* of the part in the whole stream */
+    mtime_t       i_end;    /* of the data sent so far, from the part start */
+    stream_t      *s;
+    demux_t       *p_part;
+
+    /* Moves the dates of the parts */
+    es_out_t      out;
+    int           i_es;
+    es_out_id_t   **es;
+
+    /* Next part, opened ahead */
+    struct
+    {
+        vlc_thread_t thread;
+        bool         b_active;
+        int          i_part;
+        stream_t     *s;
+    } prefetch;
+};
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+static int PartvaControl( demux_t *p_part, int i_query, va_list args )
+{
+    if( p_part == NULL )
+        return VLC_EGENERIC;
+    return p_part->pf_control( p_part, i_query, args );
+}
+
+static int PartControl( demux_t *p_part, int i_query, ... )
+{
+    va_list args;
+    int     i_result;
+
+    va_start( args, i_query );
+    i_result = PartvaControl( p_part, i_query, args );
+    va_end( args );
+    return i_result;
+}
+
+/* Returns the date of the part in the whole stream, or -1 if unknown */
+static mtime_t PartStart( demux_sys_t *p_sys, int i_part )
+{
+    mtime_t i_start = 0;
+
+    for( int i = 0; i < i_part; i++ )
+    {
+        if( p_sys->p_parts[i].i_length <= 0 )
+            return -1;
+        i_start += p_sys->p_parts[i].i_length;
+    }
+    return i_start;
+}
+
+/* Returns the value of the line if it is for the key */
+static char *GetValue( char *psz_line, const char *psz_key )
+{
+    const size_t i_key = strlen( psz_key );
+
+    psz_line += strspn( psz_line, " \t" );
+    if( strncmp( psz_line, psz_key, i_key ) ||
+        ( psz_line[i_key] != ' ' && psz_line[i_key] != '\t' ) )
+        return NULL;
+
+    char *psz_value = psz_line + i_key;
+    psz_value += strspn( psz_value, " \t" );
+
+    size_t i_value = strlen( psz_value );
+    while( i_value > 0 && strchr( " \t\r", psz_value[i_value - 1] ) )
+        psz_value[--i_value] = '\0';
+
+    if( i_value >= 2 && psz_value[0] == '\'' &&
+        psz_value[i_value - 1] == '\'' )
+    {
+        psz_value[i_value - 1] = '\0';
+        psz_value++;
+    }
+    return psz_value;
+}
+
+/* The parts may be given relative to the list */
+static char *ResolveUrl( demux_t *p_demux, const char *psz_url )
+{
+    const char *psz_dir = p_demux->psz_location;
+    const char *psz_slash = strrchr( psz_dir, '/' );
+    char *psz_resolved;
+
+    if( strstr( psz_url, "://" ) || psz_url[0] == '/' || psz_slash == NULL )
+        return strdup( psz_url );
+
+    if( asprintf( &psz_resolved, "%s://%.*s/%s", p_demux->psz_access,
+                  (int)(psz_slash - psz_dir), psz_dir, psz_url ) < 0 )
+        return NULL;
+    return psz_resolved;
+}
+
+static int ParseList( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    char *psz_line;
+
+    while( ( psz_line = stream_ReadLine( p_demux->s ) ) != NULL )
+    {
+        const char *psz_value;
+
+        if( ( psz_value = GetValue( psz_line, "file" ) ) != NULL )
+        {
+            concat_part_t *p_parts = realloc( p_sys->p_parts,
+                                ( p_sys->i_parts + 1 ) * sizeof(*p_parts) );
+            char *psz_url = ResolveUrl( p_demux, psz_value );
+
+            if( p_parts == NULL || psz_url == NULL )
+            {
+                if( p_parts != NULL )
+                    p_sys->p_parts = p_parts;
+                free( psz_url );
+                free( psz_line );
+                return VLC_ENOMEM;
+            }
+            p_sys->p_parts = p_parts;
+            p_parts[p_sys->i_parts].psz_url = psz_url;
+            p_parts[p_sys->i_parts].i_length = 0;
+            p_sys->i_parts++;
+        }
+        else if( ( psz_value = GetValue( psz_line, "duration" ) ) != NULL &&
+                 p_sys->i_parts > 0 )
+        {
+            const double f_duration = us_strtod( psz_value, NULL );
+            if( f_duration > 0. )
+                p_sys->p_parts[p_sys->i_parts - 1].i_length =
+                    f_duration * CLOCK_FREQ;
+        }
+        free( psz_line );
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Prefetch: opens the next part and reads its headers
+ *****************************************************************************/
+static void *Prefetch( void *p_data )
+{
+    demux_t *p_demux = p_data;
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const char *psz_url = p_sys->p_parts[p_sys->prefetch.i_part].psz_url;
+
+    stream_t *s = stream_UrlNew( p_demux, psz_url );
+    if( s != NULL )
+    {
+        const uint8_t *p_peek;
+        stream_Peek( s, &p_peek, PREFETCH_SIZE );
+    }
+    p_sys->prefetch.s = s;
+    return NULL;
+}
+
+static void PrefetchStart( demux_t *p_demux, int i_part )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    p_sys->prefetch.i_part = i_part;
+    p_sys->prefetch.s = NULL;
+    if( vlc_clone( &p_sys->prefetch.thread, Prefetch, p_demux,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+        return;
+    p_sys->prefetch.b_active = true;
+    msg_Dbg( p_demux, "prefetching part %d", i_part + 1 );
+}
+
+/* Returns the stream of the part if it was prefetched */
+static stream_t *PrefetchTake( demux_t *p_demux, int i_part )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->prefetch.b_active )
+        return NULL;
+
+    vlc_join( p_sys->prefetch.thread, NULL );
+    p_sys->prefetch.b_active = false;
+
+    stream_t *s = p_sys->prefetch.s;
+    if( p_sys->prefetch.i_part != i_part )
+    {
+        if( s != NULL )
+            stream_Delete( s );
+        s = NULL;
+    }
+    /* So that the part is prefetched again if it is reached again */
+    p_sys->prefetch.i_part = -1;
+    return s;
+}
+
+/* Tells whether the end of the current part is near */
+static bool PartEnding( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const mtime_t i_length = p_sys->p_parts[p_sys->i_current].i_length;
+    int64_t i_time;
+    double f_position;
+
+    if( i_length > 0 &&
+        !PartControl( p_sys->p_part, DEMUX_GET_TIME, &i_time ) )
+        return i_length - i_time < PREFETCH_TIME;
+    if( !PartControl( p_sys->p_part, DEMUX_GET_POSITION, &f_position ) )
+        return f_position > .9;
+    return false;
+}
+
+/*****************************************************************************
+ * Parts
+ *****************************************************************************/
+static void ClosePart( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->p_part == NULL )
+        return;
+
+    demux_DeleteChained( p_sys->p_part );
+    stream_Delete( p_sys->s );
+    p_sys->p_part = NULL;
+    p_sys->s = NULL;
+
+    /* The next part takes the elementary streams over */
+    for( int i = 0; i < p_sys->i_es; i++ )
+        p_sys->es[i]->b_used = false;
+}
+
+static int OpenPart( demux_t *p_demux, int i_part, mtime_t i_start )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    concat_part_t *p_part = &p_sys->p_parts[i_part];
+
+    stream_t *s = PrefetchTake( p_demux, i_part );
+    if( s == NULL )
+        s = stream_UrlNew( p_demux, p_part->psz_url );
+    if( s == NULL )
+    {
+        msg_Err( p_demux, "cannot open part %d: %s", i_part + 1,
+                 p_part->psz_url );
+        return VLC_EGENERIC;
+    }
+
+    ClosePart( p_demux );
+    p_sys->i_current = i_part;
+    p_sys->i_start = i_start;
+    p_sys->i_end = 0;
+
+    p_sys->p_part = demux_NewChained( p_demux, "", p_part->psz_url, s,
+                                      &p_sys->out );
+    if( p_sys->p_part == NULL )
+    {
+        msg_Err( p_demux, "cannot demux part %d: %s", i_part + 1,
+                 p_part->psz_url );
+        stream_Delete( s );
+        return VLC_EGENERIC;
+    }
+    p_sys->s = s;
+
+    int64_t i_length;
+    if( p_part->i_length <= 0 &&
+        !PartControl( p_sys->p_part, DEMUX_GET_LENGTH, &i_length ) &&
+        i_length > 0 )
+        p_part->i_length = i_length;
+
+    msg_Dbg( p_demux, "part %d of %d at %"PRId64" ms: %s", i_part + 1,
+             p_sys->i_parts, i_start / 1000, p_part->psz_url );
+    return VLC_SUCCESS;
+}
+
+/* Opens the next part that can be played */
+static int OpenNextPart( demux_t *p_demux, int i_part, mtime_t i_start )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( ; i_part < p_sys->i_parts; i_part++ )
+    {
+        if( !OpenPart( p_demux, i_part, i_start ) )
+            return VLC_SUCCESS;
+        i_start += p_sys->p_parts[i_part].i_length;
+    }
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Open: check file and initializes structures
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    demux_t     *p_demux = (demux_t*)p_this;
+    demux_sys_t *p_sys;
+    const uint8_t *p_peek;
+    const int i_header = strlen( CONCAT_HEADER );
+
+    if( !demux_IsForced( p_demux, "concat" ) &&
+        ( stream_Peek( p_demux->s, &p_peek, i_header ) < i_header ||
+          memcmp( p_peek, CONCAT_HEADER, i_header ) ) )
+        return VLC_EGENERIC;
+
+    p_demux->p_sys = p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys->i_current = -1;
+    p_sys->out.pf_add = EsOutAdd;
+    p_sys->out.pf_send = EsOutSend;
+    p_sys->out.pf_del = EsOutDel;
+    p_sys->out.pf_control = EsOutControl;
+    p_sys->out.pf_destroy = NULL;
+    p_sys->out.p_sys = (es_out_sys_t *)p_demux;
+    TAB_INIT( p_sys->i_es, p_sys->es );
+    p_sys->prefetch.b_active = false;
+    p_sys->prefetch.i_part = -1;
+
+    if( ParseList( p_demux ) || p_sys->i_parts == 0 )
+    {
+        msg_Err( p_demux, "no part to play" );
+        Close( p_this );
+        return VLC_EGENERIC;
+    }
+    msg_Dbg( p_demux, "%d parts", p_sys->i_parts );
+
+    if( OpenNextPart( p_demux, 0, 0 ) )
+    {
+        Close( p_this );
+        return VLC_EGENERIC;
+    }
+
+    p_demux->pf_demux = Demux;
+    p_demux->pf_control = Control;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Close: frees unused data
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    demux_t     *p_demux = (demux_t*)p_this;
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    PrefetchTake( p_demux, -1 );
+    ClosePart( p_demux );
+
+    for( int i = 0; i < p_sys->i_es; i++ )
+    {
+        es_out_Del( p_demux->out, p_sys->es[i]->p_es );
+        es_format_Clean( &p_sys->es[i]->fmt );
+        free( p_sys->es[i] );
+    }
+    TAB_CLEAN( p_sys->i_es, p_sys->es );
+
+    for( int i = 0; i < p_sys->i_parts; i++ )
+        free( p_sys->p_parts[i].psz_url );
+    free( p_sys->p_parts );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Demux:
+ *****************************************************************************/
+static int Demux( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->p_part == NULL )
+        return 0;
+
+    const int i_next = p_sys->i_current + 1;
+    if( i_next < p_sys->i_parts && !p_sys->prefetch.b_active &&
+        p_sys->prefetch.i_part != i_next && PartEnding( p_demux ) )
+        PrefetchStart( p_demux, i_next );
+
+    if( p_sys->p_part->pf_demux == NULL ||
+        p_sys->p_part->pf_demux( p_sys->p_part ) > 0 )
+        return 1;
+
+    /* The part ended: the next one starts after its last data */
+    concat_part_t *p_part = &p_sys->p_parts[p_sys->i_current];
+    if( p_part->i_length < p_sys->i_end )
+        p_part->i_length = p_sys->i_end;
+
+    if( OpenNextPart( p_demux, i_next, p_sys->i_start + p_part->i_length ) )
+        return 0;
+    return 1;
+}
+
+/*****************************************************************************
+ * Control:
+ *****************************************************************************/
+static int Seek( demux_t *p_demux, int64_t i_time, bool b_precise )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mtime_t i_start = 0;
+    int i_part;
+
+    /* The parts after one of unknown length are out of reach */
+    for( i_part = 0; i_part < p_sys->i_parts - 1; i_part++ )
+    {
+        const mtime_t i_length = p_sys->p_parts[i_part].i_length;
+
+        if( i_length <= 0 )
+        {
+            if( i_part != p_sys->i_current )
+                return VLC_EGENERIC;
+            break;
+        }
+        if( i_time < i_start + i_length )
+            break;
+        i_start += i_length;
+    }
+
+    if( i_part != p_sys->i_current &&
+        OpenPart( p_demux, i_part, i_start ) )
+        return VLC_EGENERIC;
+
+    return PartControl( p_sys->p_part, DEMUX_SET_TIME, i_time - i_start,
+                        b_precise );
+}
+
+static int Control( demux_t *p_demux, int i_query, va_list args )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    switch( i_query )
+    {
+        case DEMUX_GET_LENGTH:
+        {
+            int64_t *pi_length = (int64_t*)va_arg( args, int64_t * );
+            const mtime_t i_length = PartStart( p_sys, p_sys->i_parts );
+
+            if( i_length <= 0 )
+                return VLC_EGENERIC;
+            *pi_length = i_length;
+            return VLC_SUCCESS;
+        }
+
+        case DEMUX_GET_TIME:
+        {
+            int64_t *pi_time = (int64_t*)va_arg( args, int64_t * );
+
+            if( PartControl( p_sys->p_part, DEMUX_GET_TIME, pi_time ) )
+                return VLC_EGENERIC;
+            *pi_time += p_sys->i_start;
+            return VLC_SUCCESS;
+        }
+
+        case DEMUX_SET_TIME:
+        {
+            int64_t i_time = (int64_t)va_arg( args, int64_t );
+            bool b_precise = (bool)va_arg( args, int );
+
+            return Seek( p_demux, i_time, b_precise );
+        }
+
+        case DEMUX_GET_POSITION:
+        {
+            double *pf_position = (double*)va_arg( args, double * );
+            const mtime_t i_length = PartStart( p_sys, p_sys->i_parts );
+            int64_t i_time;
+            double f_position;
+
+            if( i_length > 0 &&
+                !PartControl( p_sys->p_part, DEMUX_GET_TIME, &i_time ) )
+                *pf_position = (double)( p_sys->i_start + i_time ) / i_length;
+            else if( !PartControl( p_sys->p_part, DEMUX_GET_POSITION,
+                                   &f_position ) )
+                *pf_position = ( p_sys->i_current + f_position ) /
+                               p_sys->i_parts;
+            else
+                return VLC_EGENERIC;
+            return VLC_SUCCESS;
+        }
+
+        case DEMUX_SET_POSITION:
+        {
+            double f_position = (double)va_arg( args, double );
+            bool b_precise = (bool)va_arg( args, int );
+            const mtime_t i_length = PartStart( p_sys, p_sys->i_parts );
+
+            if( i_length <= 0 )
+                return VLC_EGENERIC;
+            return Seek( p_demux, f_position * i_length, b_precise );
+        }
+
+        /* The titles of a part are not those of the whole stream */
+        case DEMUX_GET_TITLE_INFO:
+        case DEMUX_SET_TITLE:
+        case DEMUX_SET_SEEKPOINT:
+            return VLC_EGENERIC;
+
+        default:
+            return PartvaControl( p_sys->p_part, i_query, args );
+    }
+}
+
+/*****************************************************************************
+ * es_out: moves the dates of the current part after the previous parts
+ *****************************************************************************/
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *p_fmt )
+{
+    demux_t *p_demux = (demux_t *)out->p_sys;
+    demux_sys_t *p_sys = p_demux->p_sys;
+    es_out_id_t *es;
+
+    /* Keep the decoder of the previous part, unless the codec changed */
+    for( int i = 0; i < p_sys->i_es; i++ )
+    {
+        es = p_sys->es[i];
+        if( es->b_used || es->fmt.i_cat != p_fmt->i_cat ||
+            es->fmt.i_codec != p_fmt->i_codec )
+            continue;
+
+        if( p_fmt->i_extra > 0 &&
+            ( p_fmt->i_extra != es->fmt.i_extra ||
+              memcmp( p_fmt->p_extra, es->fmt.p_extra, p_fmt->i_extra ) ) )
+            es_out_Control( p_demux->out, ES_OUT_SET_ES_FMT, es->p_es,
+                            p_fmt );
+
+        es_format_Clean( &es->fmt );
+        es_format_Copy( &es->fmt, p_fmt );
+        es->b_used = true;
+        return es;
+    }
+
+    /* Otherwise replace the one of the previous part, so that the decoders
+     * do not pile up along the parts */
+    for( int i = 0; i < p_sys->i_es; i++ )
+    {
+        es = p_sys->es[i];
+        if( es->b_used || es->fmt.i_cat != p_fmt->i_cat )
+            continue;
+
+        es_out_Del( p_demux->out, es->p_es );
+        es_format_Clean( &es->fmt );
+        TAB_REMOVE( p_sys->i_es, p_sys->es, es );
+        free( es );
+        break;
+    }
+
+    es = malloc( sizeof( *es ) );
+    if( es == NULL )
+        return NULL;
+
+    es->p_es = es_out_Add( p_demux->out, p_fmt );
+    if( es->p_es == NULL )
+    {
+        free( es );
+        return NULL;
+    }
+    es_format_Copy( &es->fmt, p_fmt );
+    es->b_used = true;
+    TAB_APPEND( p_sys->i_es, p_sys->es, es );
+    return es;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
+{
+    demux_t *p_demux = (demux_t *)out->p_sys;
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    const mtime_t i_date = __MAX( p_block->i_dts, p_block->i_pts );
+    if( i_date > VLC_TS_INVALID &&
+        i_date - VLC_TS_0 + p_block->i_length > p_sys->i_end )
+        p_sys->i_end = i_date - VLC_TS_0 + p_block->i_length;
+
+    if( p_block->i_dts > VLC_TS_INVALID )
+        p_block->i_dts += p_sys->i_start;
+    if( p_block->i_pts > VLC_TS_INVALID )
+        p_block->i_pts += p_sys->i_start;
+
+    return es_out_Send( p_demux->out, es->p_es, p_block );
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *es )
+{
+    VLC_UNUSED( out );
+
+    /* The elementary stream is deleted with the demuxer */
+    es->b_used = false;
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    demux_t *p_demux = (demux_t *)out->p_sys;
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    switch( i_query )
+    {
+        case ES_OUT_SET_ES:
+        case ES_OUT_RESTART_ES:
+        case ES_OUT_SET_ES_DEFAULT:
+        {
+            es_out_id_t *es = va_arg( args, es_out_id_t * );
+            return es_out_Control( p_demux->out, i_query,
+                                   es != NULL ? es->p_es : NULL );
+        }
+
+        case ES_OUT_SET_ES_STATE:
+        case ES_OUT_SET_ES_SCRAMBLED_STATE:
+        {
+            es_out_id_t *es = va_arg( args, es_out_id_t * );
+            bool b_state = (bool)va_arg( args, int );
+            return es_out_Control( p_demux->out, i_query, es->p_es, b_state );
+        }
+
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *es = va_arg( args, es_out_id_t * );
+            bool *pb_state = va_arg( args, bool * );
+            return es_out_Control( p_demux->out, i_query, es->p_es, pb_state );
+        }
+
+        case ES_OUT_SET_ES_FMT:
+        {
+            es_out_id_t *es = va_arg( args, es_out_id_t * );
+            es_format_t *p_fmt = va_arg( args, es_format_t * );
+            return es_out_Control( p_demux->out, i_query, es->p_es, p_fmt );
+        }
+
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+        {
+            int64_t i_date = (int64_t)va_arg( args, int64_t );
+            return es_out_Control( p_demux->out, i_query,
+                                   i_date + p_sys->i_start );
+        }
+
+        case ES_OUT_SET_GROUP_PCR:
+        {
+            int i_group = (int)va_arg( args, int );
+            int64_t i_pcr = (int64_t)va_arg( args, int64_t );
+            return es_out_Control( p_demux->out, i_query, i_group,
+                                   i_pcr + p_sys->i_start );
+        }
+
+        default:
+            return es_out_vaControl( p_demux->out, i_query, args );
+    }
+}
@@ -78,6 +78,13 @@ static void Close( vlc_object_t * );
     "Allows you to modify the default caching value for RTSP streams. This " \
     "value should be set in millisecond units." )
 
+#define LOW_LATENCY_TEXT N_("Low latency live mode")
+#define LOW_LATENCY_LONGTEXT N_( \
+    "Plays live RTP streams with as little delay as possible. The packets " \
+    "are held in a playout buffer sized from the jitter measured on their " \
+    "RTP timestamps instead of the RTSP caching. Meant for cameras on a " \
+    "local network." )
+
 #define KASENNA_TEXT N_( "Kasenna RTSP dialect")
 #define KASENNA_LONGTEXT N_( "Kasenna servers use an old and nonstandard " \
     "dialect of RTSP. With this parameter VLC will try this dialect, but "\
@@ -131,6 +138,9 @@ vlc_module_begin ()
         add_integer("rtsp-caching", 4 * DEFAULT_PTS_DELAY / 1000,
                     CACHING_TEXT, CACHING_LONGTEXT, true )
             change_safe()
+        add_bool(   "rtsp-low-latency", false, LOW_LATENCY_TEXT,
+                    LOW_LATENCY_LONGTEXT, true )
+            change_safe()
         add_bool(   "rtsp-kasenna", false, KASENNA_TEXT,
                     KASENNA_LONGTEXT, true )
             change_safe()
@@ -150,6 +160,17 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 
+/* Low latency mode: the caching left to the input for the decoders (the
+ * network jitter is absorbed by the playout buffer of the demux), the bounds
+ * of the RTP reordering delay and of the playout delay, and the period of
+ * their update */
+#define LOW_LATENCY_CACHING      INT64_C(50000)
+#define LOW_LATENCY_REORDER_MIN  10000
+#define LOW_LATENCY_REORDER_MAX  100000
+#define LOW_LATENCY_PLAYOUT_MAX  150000
+#define LOW_LATENCY_PLAYOUT_STEP 10000
+#define LOW_LATENCY_PERIOD       INT64_C(1000000)
+
 typedef struct
 {
     demux_t         *p_demux;
@@ -173,6 +194,15 @@ typedef struct
     int64_t         i_pts;
     float           i_npt;
 
+    /* playout buffer of the low latency mode */
+    block_t         *p_playout;     /* blocks waiting for their date */
+    block_t         **pp_playout_last;
+    int64_t         i_playout_pts;  /* last timestamp taken from the buffer */
+    int64_t         i_transit;      /* smallest arrival - pts */
+    int64_t         i_transit_next; /* the same over the current period */
+    int64_t         i_last_transit;
+    int64_t         i_jitter;       /* RFC 3550 interarrival jitter in us */
+
 } live_track_t;
 
 struct timeout_thread_t
@@ -221,6 +251,12 @@ struct demux_sys_t
     bool             b_no_data;     /* if we never received any data */
     int              i_no_data_ti;  /* consecutive number of TaskInterrupt */
 
+    /* low latency mode */
+    bool             b_low_latency;
+    unsigned         i_reorder;     /* RTP reordering delay in us */
+    mtime_t          i_playout;     /* playout delay in us */
+    mtime_t          i_jitter_date; /* next update of the delays */
+
     char             event_rtsp;
     char             event_data;
 
@@ -255,11 +291,16 @@ static int SessionsSetup( demux_t * );
 static int Play         ( demux_t *);
 static int ParseASF     ( demux_t * );
 static int RollOverTcp  ( demux_t * );
+static void UpdateJitter( demux_t * );
+
+static void    PlayoutReset  ( demux_t *, live_track_t *, bool );
+static mtime_t PlayoutRelease( demux_t *, live_track_t *, mtime_t );
 
 static void StreamRead  ( void *, unsigned int, unsigned int,
                           struct timeval, unsigned int );
 static void StreamClose ( void * );
 static void TaskInterruptData( void * );
+static void TaskInterruptPlayout( void * );
 static void TaskInterruptRTSP( void * );
 
 static void* TimeoutPrevention( void * );
@@ -327,6 +368,25 @@ static int  Open ( vlc_object_t *p_this )
     p_sys->f_seek_request = -1;
     p_sys->b_error = false;
     p_sys->i_live555_ret = 0;
+    p_sys->b_low_latency = var_InheritBool( p_demux, "rtsp-low-latency" );
+    p_sys->i_reorder = p_sys->b_low_latency ? LOW_LATENCY_REORDER_MAX : 200000;
+    p_sys->i_playout = LOW_LATENCY_REORDER_MAX;
+    p_sys->i_jitter_date = 0;
+
+    if( p_sys->b_low_latency )
+    {
+        /* The decoders should not hold the pictures back either */
+        input_thread_t *p_input = demux_GetParentInput( p_demux );
+        if( p_input )
+        {
+            var_Create( p_input, "low-delay", VLC_VAR_BOOL );
+            var_SetBool( p_input, "low-delay", true );
+            /* The reordering delay in use, for the interfaces */
+            var_Create( p_input, "rtsp-reorder", VLC_VAR_INTEGER );
+            var_SetInteger( p_input, "rtsp-reorder", p_sys->i_reorder );
+            vlc_object_release( p_input );
+        }
+    }
 
     /* parse URL for rtsp://[user:[passwd]@]serverip:port/options */
     vlc_UrlParse( &p_sys->url, p_sys->psz_path, 0 );
@@ -458,6 +518,7 @@ static void Close( vlc_object_t *p_this )
         live_track_t *tk = p_sys->track[i];
 
         if( tk->b_muxed ) stream_Delete( tk->p_out_muxed );
+        PlayoutReset( p_demux, tk, false );
         es_format_Clean( &tk->fmt );
         free( tk->p_buffer );
         free( tk );
@@ -692,7 +753,6 @@ static int SessionsSetup( demux_t *p_demux )
     int            i_client_port;
     int            i_return = VLC_SUCCESS;
     unsigned int   i_buffer = 0;
-    unsigned const thresh = 200000; /* RTP reorder threshold .2 second (default .1) */
 
     b_rtsp_tcp    = var_CreateGetBool( p_demux, "rtsp-tcp" ) ||
                     var_InheritBool( p_demux, "rtsp-http" );
@@ -762,8 +822,9 @@ static int SessionsSetup( demux_t *p_demux )
                 if( i_buffer > 0 )
                     increaseReceiveBufferTo( *p_sys->env, fd, i_buffer );
 
-                /* Increase the RTP reorder timebuffer just a bit */
-                sub->rtpSource()->setPacketReorderingThresholdTime(thresh);
+                /* Increase the RTP reorder timebuffer just a bit, unless
+                 * the low latency mode sizes it from the jitter */
+                sub->rtpSource()->setPacketReorderingThresholdTime( p_sys->i_reorder );
             }
             msg_Dbg( p_demux, "RTP subsession '%s/%s'", sub->mediumName(),
                      sub->codecName() );
@@ -819,6 +880,13 @@ static int SessionsSetup( demux_t *p_demux )
             tk->b_rtcp_sync = false;
             tk->i_pts       = VLC_TS_INVALID;
             tk->i_npt       = 0.;
+            tk->p_playout   = NULL;
+            tk->pp_playout_last = &tk->p_playout;
+            tk->i_playout_pts = 0;
+            tk->i_transit   = INT64_MAX;
+            tk->i_transit_next = INT64_MAX;
+            tk->i_last_transit = INT64_MAX;
+            tk->i_jitter    = 0;
             tk->i_buffer    = 65536;
             tk->p_buffer    = (uint8_t *)malloc( 65536 );
             if( !tk->p_buffer )
@@ -1176,6 +1244,8 @@ static int Demux( demux_t *p_demux )
 {
     demux_sys_t    *p_sys = p_demux->p_sys;
     TaskToken      task;
+    TaskToken      playout = NULL;
+    mtime_t        i_playout = 0;
 
     bool            b_send_pcr = true;
     int64_t         i_pcr = 0;
@@ -1224,15 +1294,44 @@ static int Demux( demux_t *p_demux )
             tk->sub->readSource()->getNextFrame( tk->p_buffer, tk->i_buffer,
                                           StreamRead, tk, StreamClose, tk );
         }
+
+        /* Find the next block to take from the playout buffers */
+        if( tk->p_playout != NULL )
+        {
+            const mtime_t i_date = PlayoutRelease( p_demux, tk, 0 );
+            if( i_playout == 0 || i_date < i_playout )
+                i_playout = i_date;
+        }
     }
     /* Create a task that will be called if we wait more than 300ms */
     task = p_sys->scheduler->scheduleDelayedTask( 300000, TaskInterruptData, p_demux );
+    /* and another one to wake up when a block of the playout buffers is due */
+    if( i_playout > 0 )
+        playout = p_sys->scheduler->scheduleDelayedTask(
+                        __MAX( i_playout - mdate(), 0 ), TaskInterruptPlayout,
+                        p_demux );
 
     /* Do the read */
     p_sys->scheduler->doEventLoop( &p_sys->event_data );
 
     /* remove the task */
     p_sys->scheduler->unscheduleDelayedTask( task );
+    if( playout != NULL )
+        p_sys->scheduler->unscheduleDelayedTask( playout );
+
+    if( p_sys->b_low_latency )
+    {
+        if( mdate() >= p_sys->i_jitter_date )
+        {
+            UpdateJitter( p_demux );
+            p_sys->i_jitter_date = mdate() + LOW_LATENCY_PERIOD;
+        }
+
+        /* Send the blocks that are due */
+        const mtime_t i_now = mdate();
+        for( i = 0; i < p_sys->i_track; i++ )
+            PlayoutRelease( p_demux, p_sys->track[i], i_now );
+    }
 
     /* Check for gap in pts value */
     for( i = 0; i < p_sys->i_track; i++ )
@@ -1244,6 +1343,9 @@ static int Demux( demux_t *p_demux )
         {
             msg_Dbg( p_demux, "tk->rtpSource->hasBeenSynchronizedUsingRTCP()" );
 
+            /* The timestamps of the buffered blocks are from the old base */
+            for( int j = 0; j < p_sys->i_track; j++ )
+                PlayoutReset( p_demux, p_sys->track[j], true );
             es_out_Control( p_demux->out, ES_OUT_RESET_PCR );
             tk->b_rtcp_sync = true;
             /* reset PCR */
@@ -1382,6 +1484,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 {
                     p_sys->track[i]->b_rtcp_sync = false;
                     p_sys->track[i]->i_pts = VLC_TS_INVALID;
+                    PlayoutReset( p_demux, p_sys->track[i], false );
                 }
 
                 /* Retrieve the starttime if possible */
@@ -1479,6 +1582,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             p_sys->i_npt_start = 0;
             p_sys->i_pcr = 0;
             p_sys->i_npt = 0.0;
+            for( int i = 0; i < p_sys->i_track; i++ )
+                PlayoutReset( p_demux, p_sys->track[i], false );
 
             *pi_int = (int)( INPUT_RATE_DEFAULT / p_sys->ms->scale() );
             msg_Dbg( p_demux, "PLAY with new Scale %0.2f (%d)", p_sys->ms->scale(), (*pi_int) );
@@ -1527,6 +1632,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                     live_track_t *tk = p_sys->track[i];
                     tk->b_rtcp_sync = false;
                     tk->i_pts = VLC_TS_INVALID;
+                    PlayoutReset( p_demux, tk, false );
                     p_sys->i_pcr = 0;
                     es_out_Control( p_demux->out, ES_OUT_RESET_PCR );
                 }
@@ -1552,7 +1658,10 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_GET_PTS_DELAY:
             pi64 = (int64_t*)va_arg( args, int64_t * );
-            *pi64 = var_GetInteger( p_demux, "rtsp-caching" ) * 1000;
+            if( p_sys->b_low_latency )
+                *pi64 = LOW_LATENCY_CACHING;
+            else
+                *pi64 = var_GetInteger( p_demux, "rtsp-caching" ) * 1000;
             return VLC_SUCCESS;
 
         default:
@@ -1582,6 +1691,7 @@ static int RollOverTcp( demux_t *p_demux )
         live_track_t *tk = p_sys->track[i];
 
         if( tk->b_muxed ) stream_Delete( tk->p_out_muxed );
+        PlayoutReset( p_demux, tk, false );
         if( tk->p_es ) es_out_Del( p_demux->out, tk->p_es );
         if( tk->p_asf_block ) block_Release( tk->p_asf_block );
         es_format_Clean( &tk->fmt );
@@ -1880,7 +1990,28 @@ static void StreamRead( void *p_private, unsigned int i_size,
         memcpy( p_block->p_buffer, tk->p_buffer, i_size );
     }
 
-    if( p_sys->i_pcr < i_pts )
+    /* In low latency mode, the blocks wait in the playout buffer and the
+     * clock follows the blocks taken from it */
+    const bool b_playout = p_sys->b_low_latency && !tk->b_muxed && !tk->b_asf;
+
+    if( b_playout && i_pts > 0 )
+    {
+        /* RFC 3550 interarrival jitter, from the timestamps that live555
+         * derives from the RTP ones */
+        const int64_t i_transit = mdate() - i_pts;
+
+        if( tk->i_last_transit != INT64_MAX )
+        {
+            const int64_t i_diff = i_transit > tk->i_last_transit ?
+                                   i_transit - tk->i_last_transit :
+                                   tk->i_last_transit - i_transit;
+            tk->i_jitter += ( i_diff - tk->i_jitter ) / 16;
+        }
+        tk->i_last_transit = i_transit;
+        tk->i_transit = __MIN( tk->i_transit, i_transit );
+        tk->i_transit_next = __MIN( tk->i_transit_next, i_transit );
+    }
+    else if( p_sys->i_pcr < i_pts )
     {
         p_sys->i_pcr = i_pts;
     }
@@ -1904,6 +2035,8 @@ static void StreamRead( void *p_private, unsigned int i_size,
             stream_DemuxSend( tk->p_out_muxed, p_block );
         else if( tk->b_asf )
             stream_DemuxSend( p_sys->p_out_asf, p_block );
+        else if( b_playout )
+            block_ChainLastAppend( &tk->pp_playout_last, p_block );
         else
             es_out_Send( p_demux->out, tk->p_es, p_block );
     }
@@ -1922,6 +2055,152 @@ static void StreamRead( void *p_private, unsigned int i_size,
     }
 }
 
+/*****************************************************************************
+ * UpdateJitter: sizes the RTP reordering and playout delays from the jitter
+ *****************************************************************************
+ * The jitter is the RFC 3550 estimate from the RTP timestamps of the blocks.
+ * A packet that is missing for about four times the jitter is most likely
+ * lost, so waiting longer only adds latency. The playout buffer covers the
+ * reordering delay of the packets that follow a loss, and twice the jitter
+ * of their arrival on top of it.
+ *****************************************************************************/
+static void UpdateJitter( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mtime_t i_jitter = 0;
+    unsigned i_received = 0;
+    unsigned i_expected = 0;
+    bool b_measured = false;
+
+    for( int i = 0; i < p_sys->i_track; i++ )
+    {
+        live_track_t *tk = p_sys->track[i];
+        RTPSource *rtpSource = tk->sub->rtpSource();
+
+        /* Follow the drift of the clocks: the smallest transit of the
+         * period that ends is the base of the next one */
+        if( tk->i_transit_next != INT64_MAX )
+        {
+            tk->i_transit = tk->i_transit_next;
+            tk->i_transit_next = INT64_MAX;
+            i_jitter = __MAX( i_jitter, tk->i_jitter );
+            b_measured = true;
+        }
+
+        if( rtpSource == NULL )
+            continue;
+
+        RTPReceptionStatsDB::Iterator iter( rtpSource->receptionStatsDB() );
+        RTPReceptionStats *stats;
+        while( ( stats = iter.next( True ) ) != NULL )
+        {
+            i_received += stats->totNumPacketsReceived();
+            i_expected += stats->totNumPacketsExpected();
+        }
+    }
+    if( !b_measured )
+        return;
+
+    const unsigned i_reorder = __MIN( __MAX( 4 * i_jitter,
+                                             LOW_LATENCY_REORDER_MIN ),
+                                      LOW_LATENCY_REORDER_MAX );
+    mtime_t i_playout = __MIN( i_reorder + 2 * i_jitter,
+                               LOW_LATENCY_PLAYOUT_MAX );
+
+    /* The playout delay grows at once, but shrinks by steps so that the
+     * blocks it frees do not reach the decoders in a burst */
+    if( i_playout < p_sys->i_playout - LOW_LATENCY_PLAYOUT_STEP )
+        i_playout = p_sys->i_playout - LOW_LATENCY_PLAYOUT_STEP;
+
+    /* Do not flip the delays for a few milliseconds of difference */
+    if( i_reorder + 5000 < p_sys->i_reorder ||
+        i_reorder > p_sys->i_reorder + 5000 ||
+        i_playout + 5000 < p_sys->i_playout ||
+        i_playout > p_sys->i_playout + 5000 )
+    {
+        msg_Dbg( p_demux, "jitter %d ms, %u of %u packets lost, "
+                 "reordering delay %u ms, playout delay %d ms",
+                 (int)(i_jitter / 1000),
+                 i_expected > i_received ? i_expected - i_received : 0,
+                 i_expected, i_reorder / 1000, (int)(i_playout / 1000) );
+
+        p_sys->i_playout = i_playout;
+        p_sys->i_reorder = i_reorder;
+        for( int i = 0; i < p_sys->i_track; i++ )
+        {
+            RTPSource *rtpSource = p_sys->track[i]->sub->rtpSource();
+            if( rtpSource != NULL )
+                rtpSource->setPacketReorderingThresholdTime( i_reorder );
+        }
+
+        input_thread_t *p_input = demux_GetParentInput( p_demux );
+        if( p_input )
+        {
+            var_SetInteger( p_input, "rtsp-reorder", i_reorder );
+            vlc_object_release( p_input );
+        }
+    }
+}
+
+/*****************************************************************************
+ * PlayoutRelease: sends the blocks of the playout buffer that are due
+ *****************************************************************************
+ * A block is due at its timestamp, shifted by the smallest transit time seen
+ * on the track and by the playout delay. The decoders thus get the blocks at
+ * the pace of their RTP timestamps whatever the jitter of the network.
+ * Returns the date of the first block left in the buffer, 0 if it is empty.
+ *****************************************************************************/
+static mtime_t PlayoutRelease( demux_t *p_demux, live_track_t *tk,
+                               mtime_t i_now )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    while( tk->p_playout != NULL )
+    {
+        block_t *p_block = tk->p_playout;
+
+        /* The blocks of a frame after the first one have no timestamp */
+        int64_t i_pts = tk->i_playout_pts;
+        if( p_block->i_dts > VLC_TS_INVALID )
+            i_pts = p_block->i_dts - VLC_TS_0;
+        else if( p_block->i_pts > VLC_TS_INVALID )
+            i_pts = p_block->i_pts - VLC_TS_0;
+
+        /* Without a transit time yet, the block is due at once */
+        const mtime_t i_date = tk->i_transit == INT64_MAX ? 0 :
+                               i_pts + tk->i_transit + p_sys->i_playout;
+        if( i_date > i_now )
+            return i_date;
+
+        tk->p_playout = p_block->p_next;
+        if( tk->p_playout == NULL )
+            tk->pp_playout_last = &tk->p_playout;
+        p_block->p_next = NULL;
+
+        tk->i_playout_pts = i_pts;
+        if( p_sys->i_pcr < i_pts )
+            p_sys->i_pcr = i_pts;
+        es_out_Send( p_demux->out, tk->p_es, p_block );
+    }
+    return 0;
+}
+
+/*****************************************************************************
+ * PlayoutReset: empties the playout buffer when the timestamps change
+ *****************************************************************************/
+static void PlayoutReset( demux_t *p_demux, live_track_t *tk, bool b_send )
+{
+    if( b_send )
+        PlayoutRelease( p_demux, tk, INT64_MAX );
+    block_ChainRelease( tk->p_playout );
+    tk->p_playout = NULL;
+    tk->pp_playout_last = &tk->p_playout;
+
+    tk->i_transit = INT64_MAX;
+    tk->i_transit_next = INT64_MAX;
+    tk->i_last_transit = INT64_MAX;
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -1960,6 +2239,14 @@ static void TaskInterruptData( void *p_private )
     p_demux->p_sys->event_data = 0xff;
 }
 
+static void TaskInterruptPlayout( void *p_private )
+{
+    demux_t *p_demux = (demux_t*)p_private;
+
+    /* Avoid lock */
+    p_demux->p_sys->event_data = 0xff;
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -119,15 +119,29 @@ enum
                          and Gnome subtitles SubViewer 1.0 */
 };
 
+/* Subtitle files bigger than this are not loaded in memory but indexed, the
+ * subtitles being parsed again from the stream when they are needed */
+#define SUB_INDEX_MIN_SIZE (1024 * 1024)
+
 typedef struct
 {
     int     i_line_count;
     int     i_line;
     char    **line;
+
+    /* When indexing, the lines are read from the stream one at a time */
+    stream_t *s;
+    char     *psz_line;
+    uint64_t i_line_offset;
+    bool     b_previous;
 } text_t;
 
 static int  TextLoad( text_t *, stream_t *s );
 static void TextUnload( text_t * );
+static void TextOpenStream( text_t *, stream_t *s );
+static void TextCloseStream( text_t * );
+static uint64_t TextTell( text_t * );
+static int  TextSeek( text_t *, uint64_t );
 
 typedef struct
 {
@@ -135,6 +149,10 @@ typedef struct
     int64_t i_stop;
 
     char    *psz_text;
+
+    /* Order in the file, and offset of the text in indexed mode */
+    int      i_idx;
+    uint64_t i_offset;
 } subtitle_t;
 
 
@@ -154,6 +172,11 @@ struct demux_sys_t
 
     int64_t     i_length;
 
+    /* Indexed mode: subtitle_t.psz_text is NULL and parsed when sent */
+    bool        b_indexed;
+    int         (*pf_read)( demux_t *, subtitle_t*, int );
+    int64_t     i_max_duration;
+
     /* */
     struct
     {
@@ -227,6 +250,9 @@ static int Demux( demux_t * );
 static int Control( demux_t *, int, va_list );
 
 static void Fix( demux_t * );
+static bool CanIndex( demux_t * );
+static int  SubtitleFind( demux_sys_t *, int64_t );
+static char *SubtitleGetText( demux_t *, const subtitle_t * );
 
 /*****************************************************************************
  * Module initializer
@@ -258,6 +284,9 @@ static int Open ( vlc_object_t *p_this )
     p_sys->i_subtitles        = 0;
     p_sys->subtitle           = NULL;
     p_sys->i_microsecperframe = 40000;
+    p_sys->b_indexed          = false;
+    p_sys->i_max_duration     = 0;
+    p_sys->es                 = NULL;
 
     p_sys->jss.b_inited       = false;
     p_sys->mpsub.b_inited     = false;
@@ -471,10 +500,20 @@ static int Open ( vlc_object_t *p_this )
         }
     }
 
-    msg_Dbg( p_demux, "loading all subtitles..." );
+    p_sys->pf_read = pf_read;
+    p_sys->b_indexed = CanIndex( p_demux );
 
-    /* Load the whole file */
-    TextLoad( &p_sys->txt, p_demux->s );
+    /* Load the whole file, or only index it */
+    if( p_sys->b_indexed )
+    {
+        msg_Dbg( p_demux, "indexing all subtitles..." );
+        TextOpenStream( &p_sys->txt, p_demux->s );
+    }
+    else
+    {
+        msg_Dbg( p_demux, "loading all subtitles..." );
+        TextLoad( &p_sys->txt, p_demux->s );
+    }
 
     /* Parse it */
     for( i_max = 0;; )
@@ -485,22 +524,40 @@ static int Open ( vlc_object_t *p_this )
             if( !( p_sys->subtitle = realloc_or_free( p_sys->subtitle,
                                               sizeof(subtitle_t) * i_max ) ) )
             {
-                TextUnload( &p_sys->txt );
+                if( p_sys->b_indexed )
+                    TextCloseStream( &p_sys->txt );
+                else
+                    TextUnload( &p_sys->txt );
                 free( p_sys );
                 return VLC_ENOMEM;
             }
         }
 
-        if( pf_read( p_demux, &p_sys->subtitle[p_sys->i_subtitles],
-                     p_sys->i_subtitles ) )
+        subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitles];
+        p_subtitle->i_offset = p_sys->b_indexed ? TextTell( &p_sys->txt ) : 0;
+        p_subtitle->i_idx = p_sys->i_subtitles;
+        if( pf_read( p_demux, p_subtitle, p_sys->i_subtitles ) )
             break;
 
+        /* Only the timestamps and the offset are kept */
+        if( p_sys->b_indexed )
+            FREENULL( p_subtitle->psz_text );
+
         p_sys->i_subtitles++;
     }
-    /* Unload */
-    TextUnload( &p_sys->txt );
 
-    msg_Dbg(p_demux, "loaded %d subtitles", p_sys->i_subtitles );
+    if( p_sys->b_indexed )
+    {
+        msg_Dbg( p_demux, "indexed %d subtitles (%zu KiB)", p_sys->i_subtitles,
+                 p_sys->i_subtitles * sizeof(subtitle_t) / 1024 );
+    }
+    else
+    {
+        /* Unload */
+        TextUnload( &p_sys->txt );
+
+        msg_Dbg( p_demux, "loaded %d subtitles", p_sys->i_subtitles );
+    }
 
     /* Fix subtitle (order and time) *** */
     p_sys->i_subtitle = 0;
@@ -521,6 +578,12 @@ static int Open ( vlc_object_t *p_this )
         Fix( p_demux );
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SSA );
     }
+    else if( p_sys->b_indexed )
+    {
+        /* Seeking in the index needs the subtitles to be in order */
+        Fix( p_demux );
+        es_format_Init( &fmt, SPU_ES, VLC_CODEC_SUBT );
+    }
     else
     {
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SUBT );
@@ -554,6 +617,9 @@ static void Close( vlc_object_t *p_this )
         free( p_sys->subtitle[i].psz_text );
     free( p_sys->subtitle );
 
+    if( p_sys->b_indexed )
+        TextCloseStream( &p_sys->txt );
+    free( p_sys->psz_header );
     free( p_sys );
 }
 
@@ -584,17 +650,37 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles )
+            if( p_sys->b_indexed )
             {
-                const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
+                /* Only the subtitles started less than the longest duration
+                 * ago can still be displayed */
+                const int i_end = SubtitleFind( p_sys, i64 + 1 );
 
-                if( p_subtitle->i_start > i64 )
-                    break;
-                if( p_subtitle->i_stop > p_subtitle->i_start && p_subtitle->i_stop > i64 )
-                    break;
+                p_sys->i_subtitle = SubtitleFind( p_sys, i64 - p_sys->i_max_duration );
+                while( p_sys->i_subtitle < i_end )
+                {
+                    const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
 
-                p_sys->i_subtitle++;
+                    if( p_subtitle->i_stop > p_subtitle->i_start && p_subtitle->i_stop > i64 )
+                        break;
+
+                    p_sys->i_subtitle++;
+                }
+            }
+            else
+            {
+                p_sys->i_subtitle = 0;
+                while( p_sys->i_subtitle < p_sys->i_subtitles )
+                {
+                    const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
+
+                    if( p_subtitle->i_start > i64 )
+                        break;
+                    if( p_subtitle->i_stop > p_subtitle->i_start && p_subtitle->i_stop > i64 )
+                        break;
+
+                    p_sys->i_subtitle++;
+                }
             }
 
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
@@ -622,11 +708,18 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             f = (double)va_arg( args, double );
             i64 = f * p_sys->i_length;
 
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles &&
-                   p_sys->subtitle[p_sys->i_subtitle].i_start < i64 )
+            if( p_sys->b_indexed )
+            {
+                p_sys->i_subtitle = SubtitleFind( p_sys, i64 );
+            }
+            else
             {
-                p_sys->i_subtitle++;
+                p_sys->i_subtitle = 0;
+                while( p_sys->i_subtitle < p_sys->i_subtitles &&
+                       p_sys->subtitle[p_sys->i_subtitle].i_start < i64 )
+                {
+                    p_sys->i_subtitle++;
+                }
             }
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
                 return VLC_EGENERIC;
@@ -673,18 +766,26 @@ static int Demux( demux_t *p_demux )
            p_sys->subtitle[p_sys->i_subtitle].i_start < i_maxdate )
     {
         const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
+        const char *psz_text = p_subtitle->psz_text;
+        char *psz_parsed = NULL;
+
+        /* In indexed mode, the text is parsed again only when it is sent */
+        if( psz_text == NULL && p_subtitle->i_start >= 0 )
+            psz_text = psz_parsed = SubtitleGetText( p_demux, p_subtitle );
 
         block_t *p_block;
-        int i_len = strlen( p_subtitle->psz_text ) + 1;
+        int i_len = psz_text ? strlen( psz_text ) + 1 : 0;
 
         if( i_len <= 1 || p_subtitle->i_start < 0 )
         {
+            free( psz_parsed );
             p_sys->i_subtitle++;
             continue;
         }
 
         if( ( p_block = block_New( p_demux, i_len ) ) == NULL )
         {
+            free( psz_parsed );
             p_sys->i_subtitle++;
             continue;
         }
@@ -694,7 +795,8 @@ static int Demux( demux_t *p_demux )
         if( p_subtitle->i_stop >= 0 && p_subtitle->i_stop >= p_subtitle->i_start )
             p_block->i_length = p_subtitle->i_stop - p_subtitle->i_start;
 
-        memcpy( p_block->p_buffer, p_subtitle->psz_text, i_len );
+        memcpy( p_block->p_buffer, psz_text, i_len );
+        free( psz_parsed );
 
         es_out_Send( p_demux->out, p_sys->es, p_block );
 
@@ -710,37 +812,98 @@ static int Demux( demux_t *p_demux )
 /*****************************************************************************
  * Fix: fix time stamp and order of subtitle
  *****************************************************************************/
+static int SubtitleCompare( const void *a, const void *b )
+{
+    const subtitle_t *p_a = a;
+    const subtitle_t *p_b = b;
+
+    /* Subtitles starting at the same time are kept in the file order */
+    if( p_a->i_start != p_b->i_start )
+        return p_a->i_start < p_b->i_start ? -1 : 1;
+    return p_a->i_idx - p_b->i_idx;
+}
+
 static void Fix( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    bool b_done;
 
     /* *** fix order (to be sure...) *** */
-    /* We suppose that there are near in order and this durty bubble sort
-     * wont take too much time
-     */
-    do
+    qsort( p_sys->subtitle, p_sys->i_subtitles, sizeof(*p_sys->subtitle),
+           SubtitleCompare );
+
+    /* The longest duration bounds the search of the displayed subtitles */
+    p_sys->i_max_duration = 0;
+    for( int i = 0; i < p_sys->i_subtitles; i++ )
     {
-        b_done = true;
-        for( int i_index = 1; i_index < p_sys->i_subtitles; i_index++ )
-        {
-            if( p_sys->subtitle[i_index].i_start <
-                p_sys->subtitle[i_index - 1].i_start )
-            {
-                subtitle_t sub_xch;
-                memcpy( &sub_xch,
-                        p_sys->subtitle + i_index - 1,
-                        sizeof( subtitle_t ) );
-                memcpy( p_sys->subtitle + i_index - 1,
-                        p_sys->subtitle + i_index,
-                        sizeof( subtitle_t ) );
-                memcpy( p_sys->subtitle + i_index,
-                        &sub_xch,
-                        sizeof( subtitle_t ) );
-                b_done = false;
-            }
-        }
-    } while( !b_done );
+        const subtitle_t *p_subtitle = &p_sys->subtitle[i];
+
+        if( p_subtitle->i_stop - p_subtitle->i_start > p_sys->i_max_duration )
+            p_sys->i_max_duration = p_subtitle->i_stop - p_subtitle->i_start;
+    }
+}
+
+/*****************************************************************************
+ * Index: subtitles not kept in memory
+ *****************************************************************************/
+static bool CanIndex( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_can_seek;
+
+    /* Only the formats without any state between the subtitles */
+    switch( p_sys->i_type )
+    {
+        case SUB_TYPE_MICRODVD:
+        case SUB_TYPE_SUBRIP:
+        case SUB_TYPE_SUBRIP_DOT:
+        case SUB_TYPE_SUBVIEWER:
+        case SUB_TYPE_SSA1:
+        case SUB_TYPE_SSA2_4:
+        case SUB_TYPE_ASS:
+        case SUB_TYPE_MPL2:
+            break;
+        default:
+            return false;
+    }
+
+    if( stream_Control( p_demux->s, STREAM_CAN_SEEK, &b_can_seek ) ||
+        !b_can_seek )
+        return false;
+    return stream_Size( p_demux->s ) >= SUB_INDEX_MIN_SIZE;
+}
+
+/* Returns the first subtitle starting at or after i_time */
+static int SubtitleFind( demux_sys_t *p_sys, int64_t i_time )
+{
+    int i_low = 0;
+    int i_high = p_sys->i_subtitles;
+
+    while( i_low < i_high )
+    {
+        const int i_middle = i_low + (i_high - i_low) / 2;
+
+        if( p_sys->subtitle[i_middle].i_start < i_time )
+            i_low = i_middle + 1;
+        else
+            i_high = i_middle;
+    }
+    return i_low;
+}
+
+static char *SubtitleGetText( demux_t *p_demux, const subtitle_t *p_subtitle )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    subtitle_t subtitle;
+
+    if( TextSeek( &p_sys->txt, p_subtitle->i_offset ) )
+    {
+        msg_Err( p_demux, "cannot seek to subtitle at %"PRIu64,
+                 p_subtitle->i_offset );
+        return NULL;
+    }
+    if( p_sys->pf_read( p_demux, &subtitle, p_subtitle->i_idx ) )
+        return NULL;
+    return subtitle.psz_text;
 }
 
 static int TextLoad( text_t *txt, stream_t *s )
@@ -751,6 +914,7 @@ static int TextLoad( text_t *txt, stream_t *s )
     i_line_max          = 500;
     txt->i_line_count   = 0;
     txt->i_line         = 0;
+    txt->s              = NULL;
     txt->line           = calloc( i_line_max, sizeof( char * ) );
     if( !txt->line )
         return VLC_ENOMEM;
@@ -794,8 +958,50 @@ static void TextUnload( text_t *txt )
     txt->i_line_count = 0;
 }
 
+static void TextOpenStream( text_t *txt, stream_t *s )
+{
+    txt->i_line_count  = 0;
+    txt->i_line        = 0;
+    txt->line          = NULL;
+    txt->s             = s;
+    txt->psz_line      = NULL;
+    txt->i_line_offset = 0;
+    txt->b_previous    = false;
+}
+static void TextCloseStream( text_t *txt )
+{
+    FREENULL( txt->psz_line );
+    txt->s = NULL;
+}
+static uint64_t TextTell( text_t *txt )
+{
+    if( txt->b_previous )
+        return txt->i_line_offset;
+    return stream_Tell( txt->s );
+}
+static int TextSeek( text_t *txt, uint64_t i_offset )
+{
+    FREENULL( txt->psz_line );
+    txt->b_previous = false;
+    return stream_Seek( txt->s, i_offset );
+}
+
 static char *TextGetLine( text_t *txt )
 {
+    if( txt->s )
+    {
+        /* The line stays valid until the next one is read */
+        if( txt->b_previous )
+        {
+            txt->b_previous = false;
+            return txt->psz_line;
+        }
+        free( txt->psz_line );
+        txt->i_line_offset = stream_Tell( txt->s );
+        txt->psz_line = stream_ReadLine( txt->s );
+        return txt->psz_line;
+    }
+
     if( txt->i_line >= txt->i_line_count )
         return( NULL );
 
@@ -803,6 +1009,13 @@ static char *TextGetLine( text_t *txt )
 }
 static void TextPreviousLine( text_t *txt )
 {
+    if( txt->s )
+    {
+        if( txt->psz_line )
+            txt->b_previous = true;
+        return;
+    }
+
     if( txt->i_line > 0 )
         txt->i_line--;
 }
@@ -1064,6 +1277,10 @@ static int  ParseSSA( demux_t *p_demux, subtitle_t *p_subtitle,
         }
         free( psz_text );
 
+        /* Already sent with the ES when parsed again in indexed mode */
+        if( p_sys->es != NULL )
+            continue;
+
         /* All the other stuff we add to the header field */
         char *psz_header;
         if( asprintf( &psz_header, "%s%s\n",
@@ -135,6 +135,12 @@ static void Destroy( vlc_object_t * );
 #define SHADOW_ANGLE_TEXT N_("Shadow angle")
 #define SHADOW_DISTANCE_TEXT N_("Shadow distance")
 
+#define CACHE_SIZE_TEXT N_("Glyph cache size")
+#define CACHE_SIZE_LONGTEXT N_("Maximum amount of memory in KiB used to " \
+    "keep the rendered glyphs and text lines around, so that text rendered " \
+    "again (karaoke, repeated lines, ...) does not need to be rasterized " \
+    "again. 0 disables the cache." )
+
 
 static const int pi_sizes[] = { 20, 18, 16, 12, 6 };
 static const char *const ppsz_sizes_text[] = {
@@ -231,6 +237,9 @@ vlc_module_begin ()
 
     add_obsolete_integer( "freetype-effect" );
 
+    add_integer( "freetype-cache-size", 2048, CACHE_SIZE_TEXT,
+                 CACHE_SIZE_LONGTEXT, true )
+
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
     set_capability( "text renderer", 100 )
@@ -264,6 +273,89 @@ struct line_desc_t
     line_character_t *p_character;
 };
 
+/* Rendered glyph, keyed by face, size, glyph index, synthetic style
+ * and the fractional (26.6) part of the pen position. The bitmaps are
+ * rendered at the fractional pen position only, the integer part is
+ * applied when the glyph is used. */
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+struct glyph_cache_entry_t
+{
+    glyph_cache_entry_t *p_hash_next;
+    glyph_cache_entry_t *p_lru_prev;
+    glyph_cache_entry_t *p_lru_next;
+
+    FT_Face   p_face;
+    int       i_font_size;
+    int       i_glyph_index;
+    int       i_style_flags;
+    FT_Pos    i_pen_x;
+    FT_Pos    i_pen_y;
+
+    FT_Glyph  p_glyph;
+    FT_BBox   glyph_bbox;
+    FT_Glyph  p_outline;
+    FT_BBox   outline_bbox;
+    FT_Glyph  p_shadow;
+    FT_BBox   shadow_bbox;
+    FT_Vector advance;
+
+    size_t    i_size;
+};
+
+#define GLYPH_CACHE_HASH_SIZE (1024)
+typedef struct
+{
+    glyph_cache_entry_t *pp_hash[GLYPH_CACHE_HASH_SIZE];
+    glyph_cache_entry_t *p_lru_first;   /* Most recently used */
+    glyph_cache_entry_t *p_lru_last;    /* Least recently used */
+
+    size_t   i_size;
+    size_t   i_size_max;
+
+    uint64_t i_hit;
+    uint64_t i_miss;
+} glyph_cache_t;
+
+/* Laid out lines, keyed by the text and the styles */
+typedef struct line_cache_entry_t line_cache_entry_t;
+struct line_cache_entry_t
+{
+    line_cache_entry_t *p_next;
+
+    uint32_t      *psz_text;
+    text_style_t  **pp_styles;
+    int           i_len;
+    unsigned      i_visible_width;
+    unsigned      i_visible_height;
+
+    line_desc_t   *p_lines;
+    FT_BBox       bbox;
+    int           i_max_face_height;
+
+    size_t        i_size;
+};
+
+typedef struct
+{
+    line_cache_entry_t *p_first;        /* Most recently used */
+
+    size_t   i_size;
+    size_t   i_size_max;
+
+    uint64_t i_hit;
+    uint64_t i_miss;
+} line_cache_t;
+
+/* Faces loaded for a given font name and style */
+typedef struct
+{
+    char    *psz_fontname;
+    int     i_style_flags;
+    FT_Face p_face;     /* NULL if the default face is used */
+} face_cache_entry_t;
+
+#define FACE_CACHE_MAX (16)
+
 typedef struct font_stack_t font_stack_t;
 struct font_stack_t
 {
@@ -315,6 +407,12 @@ struct filter_sys_t
 
     input_attachment_t **pp_font_attachments;
     int                  i_font_attachments;
+
+    face_cache_entry_t   faces[FACE_CACHE_MAX];
+    int                  i_faces;
+
+    glyph_cache_t        glyph_cache;
+    line_cache_t         line_cache;
 };
 
 /* */
@@ -1730,7 +1828,8 @@ static int GetGlyph( filter_t *p_filter,
                      int i_glyph_index,
                      int i_style_flags,
                      FT_Vector *p_pen,
-                     FT_Vector *p_pen_shadow )
+                     FT_Vector *p_pen_shadow,
+                     FT_Vector *p_advance )
 {
     if( FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT ) &&
         FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
@@ -1790,22 +1889,24 @@ static int GetGlyph( filter_t *p_filter,
     }
     *pp_outline = outline;
 
+    *p_advance = p_face->glyph->advance;
+
     return VLC_SUCCESS;
 }
 
-static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, FT_Face face, const FT_Vector *p_pen )
+static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, const FT_Vector *p_advance, const FT_Vector *p_pen )
 {
     FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)glyph;
     if( p_bbox->xMin >= p_bbox->xMax )
     {
         p_bbox->xMin = FT_CEIL(p_pen->x);
-        p_bbox->xMax = FT_CEIL(p_pen->x + face->glyph->advance.x);
+        p_bbox->xMax = FT_CEIL(p_pen->x + p_advance->x);
         glyph_bmp->left = p_bbox->xMin;
     }
     if( p_bbox->yMin >= p_bbox->yMax )
     {
         p_bbox->yMax = FT_CEIL(p_pen->y);
-        p_bbox->yMin = FT_CEIL(p_pen->y + face->glyph->advance.y);
+        p_bbox->yMin = FT_CEIL(p_pen->y + p_advance->y);
         glyph_bmp->top  = p_bbox->yMax;
     }
 }
@@ -1818,6 +1919,517 @@ static void BBoxEnlarge( FT_BBox *p_max, const FT_BBox *p )
     p_max->yMax = __MAX(p_max->yMax, p->yMax);
 }
 
+/*****************************************************************************
+ * Glyph cache
+ *****************************************************************************/
+static size_t GlyphSize( FT_Glyph glyph )
+{
+    if( !glyph )
+        return 0;
+    const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)glyph)->bitmap;
+    return sizeof(FT_BitmapGlyphRec) + p_bitmap->rows * abs(p_bitmap->pitch);
+}
+
+static FT_Glyph GlyphMove( FT_Glyph glyph, int i_dx, int i_dy )
+{
+    if( glyph )
+    {
+        ((FT_BitmapGlyph)glyph)->left += i_dx;
+        ((FT_BitmapGlyph)glyph)->top  += i_dy;
+    }
+    return glyph;
+}
+
+static void BBoxMove( FT_BBox *p_dst, const FT_BBox *p_src, int i_dx, int i_dy )
+{
+    p_dst->xMin = p_src->xMin + i_dx;
+    p_dst->xMax = p_src->xMax + i_dx;
+    p_dst->yMin = p_src->yMin + i_dy;
+    p_dst->yMax = p_src->yMax + i_dy;
+}
+
+static unsigned GlyphCacheHash( FT_Face p_face, int i_font_size, int i_glyph_index )
+{
+    uintptr_t i_hash = (uintptr_t)p_face >> 4;
+    i_hash = i_hash * 31 + i_font_size;
+    i_hash = i_hash * 31 + i_glyph_index;
+    return i_hash % GLYPH_CACHE_HASH_SIZE;
+}
+
+static void GlyphCacheInit( glyph_cache_t *p_cache, size_t i_size_max )
+{
+    for( int i = 0; i < GLYPH_CACHE_HASH_SIZE; i++ )
+        p_cache->pp_hash[i] = NULL;
+    p_cache->p_lru_first = NULL;
+    p_cache->p_lru_last = NULL;
+    p_cache->i_size = 0;
+    p_cache->i_size_max = i_size_max;
+    p_cache->i_hit = 0;
+    p_cache->i_miss = 0;
+}
+
+static void GlyphCacheEntryDelete( glyph_cache_entry_t *p_entry )
+{
+    FT_Done_Glyph( p_entry->p_glyph );
+    if( p_entry->p_outline )
+        FT_Done_Glyph( p_entry->p_outline );
+    if( p_entry->p_shadow )
+        FT_Done_Glyph( p_entry->p_shadow );
+    free( p_entry );
+}
+
+static void GlyphCacheUnlink( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->p_lru_prev )
+        p_entry->p_lru_prev->p_lru_next = p_entry->p_lru_next;
+    else
+        p_cache->p_lru_first = p_entry->p_lru_next;
+    if( p_entry->p_lru_next )
+        p_entry->p_lru_next->p_lru_prev = p_entry->p_lru_prev;
+    else
+        p_cache->p_lru_last = p_entry->p_lru_prev;
+}
+
+static void GlyphCacheLinkFirst( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    p_entry->p_lru_prev = NULL;
+    p_entry->p_lru_next = p_cache->p_lru_first;
+    if( p_cache->p_lru_first )
+        p_cache->p_lru_first->p_lru_prev = p_entry;
+    else
+        p_cache->p_lru_last = p_entry;
+    p_cache->p_lru_first = p_entry;
+}
+
+static void GlyphCacheRemove( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp_entry =
+        &p_cache->pp_hash[GlyphCacheHash( p_entry->p_face, p_entry->i_font_size,
+                                          p_entry->i_glyph_index )];
+    while( *pp_entry != p_entry )
+        pp_entry = &(*pp_entry)->p_hash_next;
+    *pp_entry = p_entry->p_hash_next;
+
+    GlyphCacheUnlink( p_cache, p_entry );
+
+    p_cache->i_size -= p_entry->i_size;
+    GlyphCacheEntryDelete( p_entry );
+}
+
+static void GlyphCacheClean( glyph_cache_t *p_cache )
+{
+    while( p_cache->p_lru_last )
+        GlyphCacheRemove( p_cache, p_cache->p_lru_last );
+    assert( p_cache->i_size == 0 );
+}
+
+static glyph_cache_entry_t *GlyphCacheFind( glyph_cache_t *p_cache,
+                                            FT_Face p_face, int i_font_size,
+                                            int i_glyph_index, int i_style_flags,
+                                            FT_Pos i_pen_x, FT_Pos i_pen_y )
+{
+    glyph_cache_entry_t *p_entry =
+        p_cache->pp_hash[GlyphCacheHash( p_face, i_font_size, i_glyph_index )];
+
+    for( ; p_entry != NULL; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->p_face == p_face &&
+            p_entry->i_font_size == i_font_size &&
+            p_entry->i_glyph_index == i_glyph_index &&
+            p_entry->i_style_flags == i_style_flags &&
+            p_entry->i_pen_x == i_pen_x &&
+            p_entry->i_pen_y == i_pen_y )
+        {
+            GlyphCacheUnlink( p_cache, p_entry );
+            GlyphCacheLinkFirst( p_cache, p_entry );
+            return p_entry;
+        }
+    }
+    return NULL;
+}
+
+static bool GlyphCacheInsert( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->i_size > p_cache->i_size_max )
+        return false;
+
+    while( p_cache->i_size + p_entry->i_size > p_cache->i_size_max )
+        GlyphCacheRemove( p_cache, p_cache->p_lru_last );
+
+    glyph_cache_entry_t **pp_bucket =
+        &p_cache->pp_hash[GlyphCacheHash( p_entry->p_face, p_entry->i_font_size,
+                                          p_entry->i_glyph_index )];
+    p_entry->p_hash_next = *pp_bucket;
+    *pp_bucket = p_entry;
+
+    GlyphCacheLinkFirst( p_cache, p_entry );
+    p_cache->i_size += p_entry->i_size;
+    return true;
+}
+
+static int GlyphCacheEntryCopy( const glyph_cache_entry_t *p_entry, int i_dx, int i_dy,
+                                FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
+                                FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
+                                FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+                                FT_Vector *p_advance )
+{
+    FT_Glyph glyph, outline = NULL, shadow = NULL;
+
+    if( FT_Glyph_Copy( p_entry->p_glyph, &glyph ) )
+        return VLC_EGENERIC;
+    if( ( p_entry->p_outline && FT_Glyph_Copy( p_entry->p_outline, &outline ) ) ||
+        ( p_entry->p_shadow  && FT_Glyph_Copy( p_entry->p_shadow,  &shadow  ) ) )
+    {
+        FT_Done_Glyph( glyph );
+        if( outline )
+            FT_Done_Glyph( outline );
+        return VLC_EGENERIC;
+    }
+    *pp_glyph   = GlyphMove( glyph,   i_dx, i_dy );
+    *pp_outline = GlyphMove( outline, i_dx, i_dy );
+    *pp_shadow  = GlyphMove( shadow,  i_dx, i_dy );
+    BBoxMove( p_glyph_bbox,   &p_entry->glyph_bbox,   i_dx, i_dy );
+    BBoxMove( p_outline_bbox, &p_entry->outline_bbox, i_dx, i_dy );
+    BBoxMove( p_shadow_bbox,  &p_entry->shadow_bbox,  i_dx, i_dy );
+    *p_advance = p_entry->advance;
+    return VLC_SUCCESS;
+}
+
+/* Same as GetGlyph() but the glyphs returned may come from the cache.
+ * The caller owns the returned glyphs. */
+static int GetCachedGlyph( filter_t *p_filter,
+                           FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
+                           FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
+                           FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+                           FT_Vector *p_advance,
+
+                           FT_Face  p_face,
+                           int i_font_size,
+                           int i_glyph_index,
+                           int i_style_flags,
+                           const FT_Vector *p_pen,
+                           const FT_Vector *p_pen_shadow )
+{
+    glyph_cache_t *p_cache = &p_filter->p_sys->glyph_cache;
+
+    /* Only the synthetic styles change the glyph rendering */
+    i_style_flags &= STYLE_BOLD | STYLE_ITALIC;
+
+    /* Split the pen position into its fractional and integer (pixels) parts */
+    const FT_Pos i_pen_x = p_pen->x & 63;
+    const FT_Pos i_pen_y = p_pen->y & 63;
+    const int    i_dx = ( p_pen->x - i_pen_x ) / 64;
+    const int    i_dy = ( p_pen->y - i_pen_y ) / 64;
+
+    glyph_cache_entry_t *p_entry = NULL;
+    if( p_cache->i_size_max > 0 )
+        p_entry = GlyphCacheFind( p_cache, p_face, i_font_size, i_glyph_index,
+                                  i_style_flags, i_pen_x, i_pen_y );
+    if( p_entry )
+    {
+        p_cache->i_hit++;
+        return GlyphCacheEntryCopy( p_entry, i_dx, i_dy,
+                                    pp_glyph, p_glyph_bbox,
+                                    pp_outline, p_outline_bbox,
+                                    pp_shadow, p_shadow_bbox,
+                                    p_advance );
+    }
+    p_cache->i_miss++;
+
+    /* Render the glyph at the fractional pen position */
+    p_entry = calloc( 1, sizeof(*p_entry) );
+    if( !p_entry )
+        return VLC_ENOMEM;
+
+    FT_Vector pen = {
+        .x = i_pen_x,
+        .y = i_pen_y,
+    };
+    FT_Vector pen_shadow = {
+        .x = i_pen_x + p_pen_shadow->x - p_pen->x,
+        .y = i_pen_y + p_pen_shadow->y - p_pen->y,
+    };
+    if( GetGlyph( p_filter,
+                  &p_entry->p_glyph,   &p_entry->glyph_bbox,
+                  &p_entry->p_outline, &p_entry->outline_bbox,
+                  &p_entry->p_shadow,  &p_entry->shadow_bbox,
+                  p_face, i_glyph_index, i_style_flags,
+                  &pen, &pen_shadow, &p_entry->advance ) )
+    {
+        free( p_entry );
+        return VLC_EGENERIC;
+    }
+    p_entry->p_face        = p_face;
+    p_entry->i_font_size   = i_font_size;
+    p_entry->i_glyph_index = i_glyph_index;
+    p_entry->i_style_flags = i_style_flags;
+    p_entry->i_pen_x       = i_pen_x;
+    p_entry->i_pen_y       = i_pen_y;
+    p_entry->i_size        = sizeof(*p_entry) +
+                             GlyphSize( p_entry->p_glyph ) +
+                             GlyphSize( p_entry->p_outline ) +
+                             GlyphSize( p_entry->p_shadow );
+
+    /* Use a copy, the cache keeps the original */
+    if( GlyphCacheInsert( p_cache, p_entry ) )
+        return GlyphCacheEntryCopy( p_entry, i_dx, i_dy,
+                                    pp_glyph, p_glyph_bbox,
+                                    pp_outline, p_outline_bbox,
+                                    pp_shadow, p_shadow_bbox,
+                                    p_advance );
+
+    /* Not cachable, give our rendering away */
+    *pp_glyph   = GlyphMove( p_entry->p_glyph,   i_dx, i_dy );
+    *pp_outline = GlyphMove( p_entry->p_outline, i_dx, i_dy );
+    *pp_shadow  = GlyphMove( p_entry->p_shadow,  i_dx, i_dy );
+    BBoxMove( p_glyph_bbox,   &p_entry->glyph_bbox,   i_dx, i_dy );
+    BBoxMove( p_outline_bbox, &p_entry->outline_bbox, i_dx, i_dy );
+    BBoxMove( p_shadow_bbox,  &p_entry->shadow_bbox,  i_dx, i_dy );
+    *p_advance = p_entry->advance;
+    free( p_entry );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Line cache
+ *****************************************************************************/
+static bool LineStyleEquals( const text_style_t *p_style1,
+                             const text_style_t *p_style2 )
+{
+    if( p_style1 == p_style2 )
+        return true;
+
+    return FaceStyleEquals( p_style1, p_style2 ) &&
+           p_style1->i_font_size == p_style2->i_font_size &&
+           p_style1->i_font_color == p_style2->i_font_color &&
+           p_style1->i_font_alpha == p_style2->i_font_alpha &&
+           p_style1->i_style_flags == p_style2->i_style_flags &&
+           p_style1->i_karaoke_background_color == p_style2->i_karaoke_background_color &&
+           p_style1->i_karaoke_background_alpha == p_style2->i_karaoke_background_alpha;
+}
+
+static size_t LinesSize( const line_desc_t *p_lines )
+{
+    size_t i_size = 0;
+    for( const line_desc_t *p_line = p_lines; p_line != NULL; p_line = p_line->p_next )
+    {
+        i_size += sizeof(*p_line);
+        for( int i = 0; i < p_line->i_character_count; i++ )
+        {
+            const line_character_t *ch = &p_line->p_character[i];
+            i_size += sizeof(*ch) +
+                      GlyphSize( (FT_Glyph)ch->p_glyph ) +
+                      GlyphSize( (FT_Glyph)ch->p_outline ) +
+                      GlyphSize( (FT_Glyph)ch->p_shadow );
+        }
+    }
+    return i_size;
+}
+
+static void DeleteStyles( text_style_t **pp_styles, int i_len )
+{
+    for( int i = 0; i < i_len; i++ )
+    {
+        if( pp_styles[i] && ( i + 1 == i_len || pp_styles[i] != pp_styles[i + 1] ) )
+            text_style_Delete( pp_styles[i] );
+    }
+    free( pp_styles );
+}
+
+static void LineCacheEntryDelete( line_cache_entry_t *p_entry )
+{
+    FreeLines( p_entry->p_lines );
+    DeleteStyles( p_entry->pp_styles, p_entry->i_len );
+    free( p_entry->psz_text );
+    free( p_entry );
+}
+
+static void LineCacheInit( line_cache_t *p_cache, size_t i_size_max )
+{
+    p_cache->p_first = NULL;
+    p_cache->i_size = 0;
+    p_cache->i_size_max = i_size_max;
+    p_cache->i_hit = 0;
+    p_cache->i_miss = 0;
+}
+
+static void LineCacheClean( line_cache_t *p_cache )
+{
+    while( p_cache->p_first )
+    {
+        line_cache_entry_t *p_next = p_cache->p_first->p_next;
+        LineCacheEntryDelete( p_cache->p_first );
+        p_cache->p_first = p_next;
+    }
+    p_cache->i_size = 0;
+}
+
+/* The returned entry stays valid until the next LineCacheInsert() */
+static line_cache_entry_t *LineCacheFind( line_cache_t *p_cache,
+                                          const uint32_t *psz_text,
+                                          text_style_t **pp_styles,
+                                          int i_len,
+                                          unsigned i_visible_width,
+                                          unsigned i_visible_height )
+{
+    if( p_cache->i_size_max <= 0 )
+        return NULL;
+
+    for( line_cache_entry_t **pp_entry = &p_cache->p_first;
+         *pp_entry != NULL; pp_entry = &(*pp_entry)->p_next )
+    {
+        line_cache_entry_t *p_entry = *pp_entry;
+
+        if( p_entry->i_len != i_len ||
+            p_entry->i_visible_width != i_visible_width ||
+            p_entry->i_visible_height != i_visible_height ||
+            memcmp( p_entry->psz_text, psz_text, i_len * sizeof(*psz_text) ) )
+            continue;
+
+        int i;
+        for( i = 0; i < i_len; i++ )
+        {
+            if( !LineStyleEquals( p_entry->pp_styles[i], pp_styles[i] ) )
+                break;
+        }
+        if( i < i_len )
+            continue;
+
+        /* Move it first */
+        *pp_entry = p_entry->p_next;
+        p_entry->p_next = p_cache->p_first;
+        p_cache->p_first = p_entry;
+
+        p_cache->i_hit++;
+        return p_entry;
+    }
+    p_cache->i_miss++;
+    return NULL;
+}
+
+/* On success, the cache takes the ownership of p_lines */
+static int LineCacheInsert( line_cache_t *p_cache,
+                            const uint32_t *psz_text,
+                            text_style_t **pp_styles,
+                            int i_len,
+                            unsigned i_visible_width,
+                            unsigned i_visible_height,
+                            line_desc_t *p_lines,
+                            const FT_BBox *p_bbox,
+                            int i_max_face_height )
+{
+    const size_t i_size = sizeof(line_cache_entry_t) + LinesSize( p_lines ) +
+                          i_len * ( sizeof(*psz_text) + sizeof(*pp_styles) );
+    if( i_size > p_cache->i_size_max )
+        return VLC_EGENERIC;
+
+    line_cache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    if( !p_entry )
+        return VLC_ENOMEM;
+    p_entry->psz_text = malloc( i_len * sizeof(*psz_text) );
+    p_entry->pp_styles = calloc( i_len, sizeof(*pp_styles) );
+    if( !p_entry->psz_text || !p_entry->pp_styles )
+    {
+        free( p_entry->psz_text );
+        free( p_entry->pp_styles );
+        free( p_entry );
+        return VLC_ENOMEM;
+    }
+    memcpy( p_entry->psz_text, psz_text, i_len * sizeof(*psz_text) );
+    for( int i = 0; i < i_len; i++ )
+    {
+        if( i > 0 && pp_styles[i] == pp_styles[i - 1] )
+            p_entry->pp_styles[i] = p_entry->pp_styles[i - 1];
+        else
+            p_entry->pp_styles[i] = text_style_Duplicate( pp_styles[i] );
+
+        if( !p_entry->pp_styles[i] )
+        {
+            p_entry->p_lines = NULL;
+            p_entry->i_len = i;
+            LineCacheEntryDelete( p_entry );
+            return VLC_ENOMEM;
+        }
+    }
+    p_entry->i_len = i_len;
+    p_entry->i_visible_width = i_visible_width;
+    p_entry->i_visible_height = i_visible_height;
+    p_entry->p_lines = p_lines;
+    p_entry->bbox = *p_bbox;
+    p_entry->i_max_face_height = i_max_face_height;
+    p_entry->i_size = i_size;
+
+    /* Evict the least recently used entries */
+    while( p_cache->p_first && p_cache->i_size + i_size > p_cache->i_size_max )
+    {
+        line_cache_entry_t **pp_last = &p_cache->p_first;
+        while( (*pp_last)->p_next )
+            pp_last = &(*pp_last)->p_next;
+
+        p_cache->i_size -= (*pp_last)->i_size;
+        LineCacheEntryDelete( *pp_last );
+        *pp_last = NULL;
+    }
+
+    p_entry->p_next = p_cache->p_first;
+    p_cache->p_first = p_entry;
+    p_cache->i_size += i_size;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Face cache
+ *****************************************************************************/
+static void FaceCacheClean( filter_sys_t *p_sys )
+{
+    /* Glyphs are keyed by face */
+    GlyphCacheClean( &p_sys->glyph_cache );
+
+    for( int i = 0; i < p_sys->i_faces; i++ )
+    {
+        face_cache_entry_t *p_entry = &p_sys->faces[i];
+        if( p_entry->p_face )
+            FT_Done_Face( p_entry->p_face );
+        free( p_entry->psz_fontname );
+    }
+    p_sys->i_faces = 0;
+}
+
+/* Returns the face to use for the given style, NULL for the default one.
+ * The face is owned by the cache. */
+static FT_Face GetFace( filter_t *p_filter, const text_style_t *p_style )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_style_flags = p_style->i_style_flags & (STYLE_BOLD | STYLE_ITALIC);
+
+    for( int i = 0; i < p_sys->i_faces; i++ )
+    {
+        const face_cache_entry_t *p_entry = &p_sys->faces[i];
+        if( p_entry->i_style_flags == i_style_flags &&
+            !strcmp( p_entry->psz_fontname, p_style->psz_fontname ) )
+            return p_entry->p_face;
+    }
+
+    if( p_sys->i_faces >= FACE_CACHE_MAX )
+        FaceCacheClean( p_sys );
+
+    FT_Face p_face = LoadFace( p_filter, p_style );
+
+    char *psz_fontname = strdup( p_style->psz_fontname );
+    if( !psz_fontname )
+    {
+        if( p_face )
+            FT_Done_Face( p_face );
+        return NULL;
+    }
+    p_sys->faces[p_sys->i_faces++] = (face_cache_entry_t){
+        .psz_fontname = psz_fontname,
+        .i_style_flags = i_style_flags,
+        .p_face = p_face,
+    };
+    return p_face;
+}
+
 static int ProcessLines( filter_t *p_filter,
                          line_desc_t **pp_lines,
                          FT_BBox     *p_bbox,
@@ -1994,11 +2606,9 @@ static int ProcessLines( filter_t *p_filter,
             /* (Re)load/reconfigure the face if needed */
             if( !FaceStyleEquals( p_current_style, p_previous_style ) )
             {
-                if( p_face )
-                    FT_Done_Face( p_face );
                 p_previous_style = NULL;
 
-                p_face = LoadFace( p_filter, p_current_style );
+                p_face = GetFace( p_filter, p_current_style );
             }
             FT_Face p_current_face = p_face ? p_face : p_sys->p_face;
             if( !p_previous_style || p_previous_style->i_font_size != p_current_style->i_font_size )
@@ -2048,20 +2658,23 @@ static int ProcessLines( filter_t *p_filter,
                 FT_BBox  outline_bbox;
                 FT_Glyph shadow;
                 FT_BBox  shadow_bbox;
-
-                if( GetGlyph( p_filter,
-                              &glyph, &glyph_bbox,
-                              &outline, &outline_bbox,
-                              &shadow, &shadow_bbox,
-                              p_current_face, i_glyph_index, p_glyph_style->i_style_flags,
-                              &pen_new, &pen_shadow_new ) )
+                FT_Vector advance;
+
+                if( GetCachedGlyph( p_filter,
+                                    &glyph, &glyph_bbox,
+                                    &outline, &outline_bbox,
+                                    &shadow, &shadow_bbox,
+                                    &advance,
+                                    p_current_face, p_current_style->i_font_size,
+                                    i_glyph_index, p_glyph_style->i_style_flags,
+                                    &pen_new, &pen_shadow_new ) )
                     goto next;
 
-                FixGlyph( glyph, &glyph_bbox, p_current_face, &pen_new );
+                FixGlyph( glyph, &glyph_bbox, &advance, &pen_new );
                 if( outline )
-                    FixGlyph( outline, &outline_bbox, p_current_face, &pen_new );
+                    FixGlyph( outline, &outline_bbox, &advance, &pen_new );
                 if( shadow )
-                    FixGlyph( shadow, &shadow_bbox, p_current_face, &pen_shadow_new );
+                    FixGlyph( shadow, &shadow_bbox, &advance, &pen_shadow_new );
 
                 /* FIXME and what about outline */
 
@@ -2160,8 +2773,8 @@ static int ProcessLines( filter_t *p_filter,
                     .i_line_thickness = i_line_thickness,
                 };
 
-                pen.x = pen_new.x + p_current_face->glyph->advance.x;
-                pen.y = pen_new.y + p_current_face->glyph->advance.y;
+                pen.x = pen_new.x + advance.x;
+                pen.y = pen_new.y + advance.y;
                 line_bbox = line_bbox_new;
             next:
                 i_glyph_last = i_glyph_index;
@@ -2224,9 +2837,6 @@ static int ProcessLines( filter_t *p_filter,
             break;
         }
     }
-    if( p_face )
-        FT_Done_Face( p_face );
-
     free( pp_fribidi_styles );
     free( p_fribidi_string );
     free( pi_karaoke_bar );
@@ -2275,6 +2885,7 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
     FT_BBox bbox;
     int i_max_face_height;
     line_desc_t *p_lines = NULL;
+    bool b_lines_cached = false;
 
     uint32_t *pi_k_durations   = NULL;
 
@@ -2367,9 +2978,34 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
 
     if( !rv && i_text_length > 0 )
     {
-        rv = ProcessLines( p_filter,
-                           &p_lines, &bbox, &i_max_face_height,
-                           psz_text, pp_styles, pi_k_durations, i_text_length );
+        /* The karaoke progress changes with time, do not cache it */
+        const unsigned i_visible_width  = p_filter->fmt_out.video.i_visible_width;
+        const unsigned i_visible_height = p_filter->fmt_out.video.i_visible_height;
+        line_cache_entry_t *p_cached = NULL;
+
+        if( !pi_k_durations )
+            p_cached = LineCacheFind( &p_sys->line_cache,
+                                      psz_text, pp_styles, i_text_length,
+                                      i_visible_width, i_visible_height );
+        if( p_cached )
+        {
+            p_lines = p_cached->p_lines;
+            bbox = p_cached->bbox;
+            i_max_face_height = p_cached->i_max_face_height;
+            b_lines_cached = true;
+        }
+        else
+        {
+            rv = ProcessLines( p_filter,
+                               &p_lines, &bbox, &i_max_face_height,
+                               psz_text, pp_styles, pi_k_durations, i_text_length );
+
+            if( !rv && !pi_k_durations )
+                b_lines_cached = !LineCacheInsert( &p_sys->line_cache,
+                                                   psz_text, pp_styles, i_text_length,
+                                                   i_visible_width, i_visible_height,
+                                                   p_lines, &bbox, i_max_face_height );
+        }
     }
 
     p_region_out->i_x = p_region_in->i_x;
@@ -2416,15 +3052,11 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
             var_SetBool( p_filter, "text-rerender", true );
     }
 
-    FreeLines( p_lines );
+    if( !b_lines_cached )
+        FreeLines( p_lines );
 
     free( psz_text );
-    for( int i = 0; i < i_text_length; i++ )
-    {
-        if( pp_styles[i] && ( i + 1 == i_text_length || pp_styles[i] != pp_styles[i + 1] ) )
-            text_style_Delete( pp_styles[i] );
-    }
-    free( pp_styles );
+    DeleteStyles( pp_styles, i_text_length );
     free( pi_k_durations );
 
     return rv;
@@ -2608,6 +3240,12 @@ static int Create( vlc_object_t *p_this )
     p_sys->pp_font_attachments = NULL;
     p_sys->i_font_attachments = 0;
 
+    /* Share the cache memory between the glyphs and the laid out lines */
+    const int64_t i_cache_size = __MAX( var_InheritInteger( p_filter, "freetype-cache-size" ), 0 ) * 1024;
+    GlyphCacheInit( &p_sys->glyph_cache, i_cache_size * 3 / 4 );
+    LineCacheInit( &p_sys->line_cache, i_cache_size / 4 );
+    p_sys->i_faces = 0;
+
     p_filter->pf_render_text = RenderText;
 #ifdef HAVE_STYLES
     p_filter->pf_render_html = RenderHtml;
@@ -2640,6 +3278,21 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    const glyph_cache_t *p_glyph_cache = &p_sys->glyph_cache;
+    const line_cache_t  *p_line_cache  = &p_sys->line_cache;
+    if( p_glyph_cache->i_hit + p_glyph_cache->i_miss > 0 )
+        msg_Dbg( p_filter, "glyph cache: %"PRIu64" hits, %"PRIu64" misses (%d%%), %zu KiB",
+                 p_glyph_cache->i_hit, p_glyph_cache->i_miss,
+                 (int)(100 * p_glyph_cache->i_hit / (p_glyph_cache->i_hit + p_glyph_cache->i_miss)),
+                 p_glyph_cache->i_size / 1024 );
+    if( p_line_cache->i_hit + p_line_cache->i_miss > 0 )
+        msg_Dbg( p_filter, "line cache: %"PRIu64" hits, %"PRIu64" misses (%d%%), %zu KiB",
+                 p_line_cache->i_hit, p_line_cache->i_miss,
+                 (int)(100 * p_line_cache->i_hit / (p_line_cache->i_hit + p_line_cache->i_miss)),
+                 p_line_cache->i_size / 1024 );
+    LineCacheClean( &p_sys->line_cache );
+    FaceCacheClean( p_sys );
+
     if( p_sys->pp_font_attachments )
     {
         for( int k = 0; k < p_sys->i_font_attachments; k++ )
@@ -32,8 +32,12 @@
 #include <vlc_plugin.h>
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <vlc_stream.h>
 #include <vlc_input.h>
+#include <vlc_block.h>
 #include <vlc_fs.h>
 
 
@@ -43,21 +47,56 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define QUEUE_TEXT N_("Record buffer size (KiB)")
+#define QUEUE_LONGTEXT N_( \
+    "Data waiting to be written to the record file. Beyond that, the data " \
+    "is dropped rather than stalling the playback." )
+
+#define SYNC_TEXT N_("Record synchronization interval (KiB)")
+#define SYNC_LONGTEXT N_( \
+    "The record file is flushed to the storage each time this much data " \
+    "has been written (0 to flush only at the end)." )
+
 vlc_module_begin()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
     set_description( N_("Internal stream record") )
     set_capability( "stream_filter", 0 )
+    add_integer( "record-buffer", 8192, QUEUE_TEXT, QUEUE_LONGTEXT, true )
+        change_integer_range( 1024, 262144 )
+    add_integer( "record-sync", 32768, SYNC_TEXT, SYNC_LONGTEXT, true )
+        change_integer_range( 0, 1048576 )
     set_callbacks( Open, Close )
 vlc_module_end()
 
 /*****************************************************************************
  *
  *****************************************************************************/
+
+/* The data is written by chunks of this size, the file grows by steps of
+ * RECORD_PREALLOC to stay contiguous on the storage */
+#define RECORD_CHUNK    (256 << 10)
+#define RECORD_PREALLOC (16 << 20)
+
 struct stream_sys_t
 {
-    FILE *f;        /* TODO it could be replaced by access_output_t one day */
-    bool b_error;
+    /* Demux thread */
+    bool          b_recording;
+    block_t      *p_chunk;      /* being filled */
+    block_fifo_t *p_fifo;
+    size_t        i_max_chunks; /* in the fifo */
+    uint64_t      i_dropped;
+    bool          b_dropping;
+    vlc_thread_t  thread;
+    block_t       end;          /* tells the writer to finish the file */
+
+    /* Writer thread */
+    int           fd;
+    uint64_t      i_written;
+    uint64_t      i_allocated;
+    uint64_t      i_sync;       /* interval, 0 for only at the end */
+    uint64_t      i_unsynced;
+    bool          b_error;
 };
 
 
@@ -71,6 +110,9 @@ static int  Control( stream_t *, int i_query, va_list );
 static int  Start  ( stream_t *, const char *psz_extension );
 static int  Stop   ( stream_t * );
 static void Write  ( stream_t *, const uint8_t *p_buffer, size_t i_buffer );
+static block_t *Chunk( stream_t * );
+static void Flush  ( stream_t * );
+static void *Writer( void * );
 
 /****************************************************************************
  * Open
@@ -85,7 +127,7 @@ static int Open ( vlc_object_t *p_this )
     if( !p_sys )
         return VLC_ENOMEM;
 
-    p_sys->f = NULL;
+    p_sys->b_recording = false;
 
     /* */
     s->pf_read = Read;
@@ -103,7 +145,7 @@ static void Close( vlc_object_t *p_this )
     stream_t *s = (stream_t*)p_this;
     stream_sys_t *p_sys = s->p_sys;
 
-    if( p_sys->f )
+    if( p_sys->b_recording )
         Stop( s );
 
     free( p_sys );
@@ -115,25 +157,43 @@ static void Close( vlc_object_t *p_this )
 static int Read( stream_t *s, void *p_read, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
-    void *p_record = p_read;
 
-    /* Allocate a temporary buffer for record when no p_read */
-    if( p_sys->f && !p_record )
-        p_record = malloc( i_read );
+    if( !p_sys->b_recording || p_read )
+    {
+        const int i_record = stream_Read( s->p_source, p_read, i_read );
 
-    /* */
-    const int i_record = stream_Read( s->p_source, p_record, i_read );
+        /* Dump read data */
+        if( p_sys->b_recording && i_record > 0 )
+            Write( s, p_read, i_record );
+        return i_record;
+    }
 
-    /* Dump read data */
-    if( p_sys->f )
+    /* The skipped data is read straight into the chunks */
+    int i_total = 0;
+    while( i_read > 0 )
     {
-        if( p_record && i_record > 0 )
-            Write( s, p_record, i_record );
-        if( !p_read )
-            free( p_record );
+        block_t *p_chunk = Chunk( s );
+        if( !p_chunk )
+            return i_total + stream_Read( s->p_source, NULL, i_read );
+
+        const unsigned i_len = __MIN( i_read,
+                                      RECORD_CHUNK - p_chunk->i_buffer );
+        const int i_ret = stream_Read( s->p_source,
+                                       &p_chunk->p_buffer[p_chunk->i_buffer],
+                                       i_len );
+        if( i_ret <= 0 )
+            break;
+
+        p_chunk->i_buffer += i_ret;
+        if( p_chunk->i_buffer >= RECORD_CHUNK )
+            Flush( s );
+
+        i_total += i_ret;
+        i_read -= i_ret;
+        if( (unsigned)i_ret < i_len )
+            break;
     }
-
-    return i_record;
+    return i_total;
 }
 
 static int Peek( stream_t *s, const uint8_t **pp_peek, unsigned int i_peek )
@@ -151,7 +211,7 @@ static int Control( stream_t *s, int i_query, va_list args )
     if( b_active )
         psz_extension = (const char*)va_arg( args, const char* );
 
-    if( !s->p_sys->f == !b_active )
+    if( s->p_sys->b_recording == b_active )
         return VLC_SUCCESS;
 
     if( b_active )
@@ -168,7 +228,7 @@ static int Start( stream_t *s, const char *psz_extension )
     stream_sys_t *p_sys = s->p_sys;
 
     char *psz_file;
-    FILE *f;
+    int fd;
 
     /* */
     if( !psz_extension )
@@ -191,9 +251,41 @@ static int Start( stream_t *s, const char *psz_extension )
     if( !psz_file )
         return VLC_ENOMEM;
 
-    f = vlc_fopen( psz_file, "wb" );
-    if( !f )
+    fd = vlc_open( psz_file, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+    if( fd == -1 )
+    {
+        free( psz_file );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->p_fifo = block_FifoNew();
+    if( !p_sys->p_fifo )
+    {
+        close( fd );
+        vlc_unlink( psz_file );
+        free( psz_file );
+        return VLC_ENOMEM;
+    }
+
+    /* */
+    p_sys->p_chunk = NULL;
+    p_sys->i_max_chunks = var_InheritInteger( s, "record-buffer" ) * 1024 /
+                          RECORD_CHUNK;
+    p_sys->i_dropped = 0;
+    p_sys->b_dropping = false;
+
+    p_sys->fd = fd;
+    p_sys->i_written = 0;
+    p_sys->i_allocated = 0;
+    p_sys->i_sync = var_InheritInteger( s, "record-sync" ) * UINT64_C(1024);
+    p_sys->i_unsynced = 0;
+    p_sys->b_error = false;
+
+    if( vlc_clone( &p_sys->thread, Writer, s, VLC_THREAD_PRIORITY_LOW ) )
     {
+        block_FifoRelease( p_sys->p_fifo );
+        close( fd );
+        vlc_unlink( psz_file );
         free( psz_file );
         return VLC_EGENERIC;
     }
@@ -204,40 +296,170 @@ static int Start( stream_t *s, const char *psz_extension )
     msg_Dbg( s, "Recording into %s", psz_file );
     free( psz_file );
 
-    /* */
-    p_sys->f = f;
-    p_sys->b_error = false;
+    p_sys->b_recording = true;
     return VLC_SUCCESS;
 }
 static int Stop( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    assert( p_sys->f );
+    assert( p_sys->b_recording );
+
+    Flush( s );
+    block_Init( &p_sys->end, NULL, 0 );
+    block_FifoPut( p_sys->p_fifo, &p_sys->end );
+    vlc_join( p_sys->thread, NULL );
+    block_FifoRelease( p_sys->p_fifo );
 
-    msg_Dbg( s, "Recording completed" );
-    fclose( p_sys->f );
-    p_sys->f = NULL;
+    if( p_sys->i_dropped > 0 )
+        msg_Err( s, "Recording completed, %"PRIu64" bytes dropped",
+                 p_sys->i_dropped );
+    else
+        msg_Dbg( s, "Recording completed" );
+    p_sys->b_recording = false;
     return VLC_SUCCESS;
 }
 
+/* Returns the chunk being filled */
+static block_t *Chunk( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( !p_sys->p_chunk )
+    {
+        p_sys->p_chunk = block_Alloc( RECORD_CHUNK );
+        if( p_sys->p_chunk )
+            p_sys->p_chunk->i_buffer = 0;
+    }
+    return p_sys->p_chunk;
+}
+
+/* Hands the chunk being filled over to the writer */
+static void Flush( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    block_t *p_chunk = p_sys->p_chunk;
+
+    p_sys->p_chunk = NULL;
+    if( !p_chunk || p_chunk->i_buffer == 0 )
+    {
+        if( p_chunk )
+            block_Release( p_chunk );
+        return;
+    }
+
+    /* The demux must not wait for a slow storage */
+    if( block_FifoCount( p_sys->p_fifo ) >= p_sys->i_max_chunks )
+    {
+        if( !p_sys->b_dropping )
+            msg_Err( s, "Failed to record data in time (begin)" );
+        p_sys->b_dropping = true;
+        p_sys->i_dropped += p_chunk->i_buffer;
+        block_Release( p_chunk );
+        return;
+    }
+    if( p_sys->b_dropping )
+    {
+        msg_Err( s, "Failed to record data in time (end), %"PRIu64" bytes "
+                 "dropped", p_sys->i_dropped );
+        p_sys->b_dropping = false;
+    }
+    block_FifoPut( p_sys->p_fifo, p_chunk );
+}
+
 static void Write( stream_t *s, const uint8_t *p_buffer, size_t i_buffer )
+{
+    assert( s->p_sys->b_recording );
+
+    while( i_buffer > 0 )
+    {
+        block_t *p_chunk = Chunk( s );
+        if( !p_chunk )
+            return;
+
+        const size_t i_copy = __MIN( i_buffer,
+                                     RECORD_CHUNK - p_chunk->i_buffer );
+        memcpy( &p_chunk->p_buffer[p_chunk->i_buffer], p_buffer, i_copy );
+        p_chunk->i_buffer += i_copy;
+        if( p_chunk->i_buffer >= RECORD_CHUNK )
+            Flush( s );
+
+        p_buffer += i_copy;
+        i_buffer -= i_copy;
+    }
+}
+
+/****************************************************************************
+ * Writer thread
+ ****************************************************************************/
+static void WriteChunk( stream_t *s, const block_t *p_chunk )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    assert( p_sys->f );
+#ifdef HAVE_FALLOCATE
+    /* Grows the file ahead, unless the file system cannot */
+    if( p_sys->i_written + p_chunk->i_buffer > p_sys->i_allocated )
+    {
+        const uint64_t i_size = p_sys->i_written + RECORD_PREALLOC;
+        if( fallocate( p_sys->fd, 0, 0, i_size ) == 0 )
+            p_sys->i_allocated = i_size;
+        else
+            p_sys->i_allocated = UINT64_MAX;
+    }
+#endif
+
+    const bool b_previous_error = p_sys->b_error;
+    size_t i_done = 0;
+    while( i_done < p_chunk->i_buffer )
+    {
+        const ssize_t i_ret = write( p_sys->fd, &p_chunk->p_buffer[i_done],
+                                     p_chunk->i_buffer - i_done );
+        if( i_ret < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            break;
+        }
+        i_done += i_ret;
+    }
+    p_sys->i_written += i_done;
+    p_sys->i_unsynced += i_done;
+
+    p_sys->b_error = i_done != p_chunk->i_buffer;
 
-    if( i_buffer > 0 )
+    /* TODO maybe a intf_UserError or something like that ? */
+    if( p_sys->b_error && !b_previous_error )
+        msg_Err( s, "Failed to record data (begin)" );
+    else if( !p_sys->b_error && b_previous_error )
+        msg_Err( s, "Failed to record data (end)" );
+
+    if( p_sys->i_sync > 0 && p_sys->i_unsynced >= p_sys->i_sync )
     {
-        const bool b_previous_error = p_sys->b_error;
-        const size_t i_written = fwrite( p_buffer, 1, i_buffer, p_sys->f );
+        fdatasync( p_sys->fd );
+        p_sys->i_unsynced = 0;
+    }
+}
+
+static void *Writer( void *p_data )
+{
+    stream_t *s = p_data;
+    stream_sys_t *p_sys = s->p_sys;
 
-        p_sys->b_error = i_written != i_buffer;
+    for( ;; )
+    {
+        block_t *p_chunk = block_FifoGet( p_sys->p_fifo );
+        if( p_chunk == &p_sys->end )
+            break;
 
-        /* TODO maybe a intf_UserError or something like that ? */
-        if( p_sys->b_error && !b_previous_error )
-            msg_Err( s, "Failed to record data (begin)" );
-        else if( !p_sys->b_error && b_previous_error )
-            msg_Err( s, "Failed to record data (end)" );
+        WriteChunk( s, p_chunk );
+        block_Release( p_chunk );
     }
+
+    /* Drops the preallocated tail */
+    if( p_sys->i_allocated > p_sys->i_written &&
+        ftruncate( p_sys->fd, p_sys->i_written ) )
+        msg_Err( s, "Failed to truncate the record file: %m" );
+    fsync( p_sys->fd );
+    close( p_sys->fd );
+    return NULL;
 }
@@ -0,0 +1,1112 @@
+/*****************************************************************************
+ * danmaku.c : scrolling comments (danmaku) overlay
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+
+#include <vlc_filter.h>
+#include <vlc_input.h>
+#include <vlc_modules.h>
+#include <vlc_fs.h>
+#include <vlc_charset.h>
+#include <vlc_strings.h>
+
+#include <assert.h>
+#include <ctype.h>
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int  CreateFilter ( vlc_object_t * );
+static void DestroyFilter( vlc_object_t * );
+static subpicture_t *Filter( filter_t *, mtime_t );
+
+#define FILE_TEXT N_("Comment file")
+#define FILE_LONGTEXT N_( \
+    "Comment timeline to display over the video, in bilibili (<d p=...>) " \
+    "or acfun (<l i=...>) XML format." )
+#define DURATION_TEXT N_("Duration")
+#define DURATION_LONGTEXT N_( \
+    "Number of milliseconds a comment remains on screen. Scrolling " \
+    "comments cross the whole video during that time." )
+#define DELAY_TEXT N_("Delay")
+#define DELAY_LONGTEXT N_( \
+    "Delay of the comments relative to the video, in milliseconds." )
+#define OPACITY_TEXT N_("Opacity")
+#define OPACITY_LONGTEXT N_("Opacity (inverse of transparency) of " \
+    "the comments. 0 = transparent, 255 = totally opaque." )
+#define SIZE_TEXT N_("Font size, pixels")
+#define SIZE_LONGTEXT N_("Font size, in pixels, of a comment of standard " \
+    "size. Default is 0 (relative to the video height)." )
+
+#define CFG_PREFIX "danmaku-"
+
+#define DANMAKU_HELP N_("Display scrolling comments above the video")
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_capability( "sub source", 0 )
+    set_shortname( N_("Danmaku") )
+    set_description( N_("Scrolling comments overlay") )
+    set_help( DANMAKU_HELP )
+    set_callbacks( CreateFilter, DestroyFilter )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_SUBPIC )
+    add_loadfile( CFG_PREFIX "file", NULL, FILE_TEXT, FILE_LONGTEXT, false )
+    add_integer( CFG_PREFIX "duration", 4000, DURATION_TEXT,
+                 DURATION_LONGTEXT, false )
+    add_integer( CFG_PREFIX "delay", 0, DELAY_TEXT, DELAY_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "opacity", 255, 0, 255,
+        OPACITY_TEXT, OPACITY_LONGTEXT, false )
+    add_integer( CFG_PREFIX "size", 0, SIZE_TEXT, SIZE_LONGTEXT, false )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "file", "duration", "delay", "opacity", "size", NULL
+};
+
+/*****************************************************************************
+ * Comments timeline
+ *****************************************************************************/
+#define DANMAKU_FILE_MAX    (64 * 1024 * 1024)
+
+/* Nominal size of a comment in the bilibili and acfun formats */
+#define DANMAKU_SIZE_DEFAULT 25
+
+/* The whole comment texts are rendered once into a shared atlas */
+#define ATLAS_WIDTH         2048
+#define ATLAS_HEIGHT        2048
+
+/* Input time jumps larger than this are seeks */
+#define SEEK_THRESHOLD      (CLOCK_FREQ)
+
+enum
+{
+    DANMAKU_SCROLL,
+    DANMAKU_REVERSE,
+    DANMAKU_TOP,
+    DANMAKU_BOTTOM,
+};
+
+typedef struct
+{
+    mtime_t  i_time;        /* stream time at which the comment appears */
+    int      i_mode;
+    int      i_size;        /* nominal size */
+    uint32_t i_color;
+    char     *psz_text;
+
+    /* Location in the atlas, valid if i_atlas matches the atlas generation */
+    unsigned i_atlas;
+    int      i_x, i_y;
+    int      i_width, i_height;
+
+    /* Lane, valid if i_layout matches the layout generation */
+    unsigned i_layout;
+    int      i_lane;
+} danmaku_comment_t;
+
+typedef struct
+{
+    int i_y;
+    int i_height;
+    int i_used;
+} atlas_shelf_t;
+
+typedef struct
+{
+    mtime_t i_free;         /* the last comment is fully on screen */
+    mtime_t i_exit;         /* the last comment has left the screen */
+} danmaku_lane_t;
+
+/**
+ * Shared state between the filter and the subpictures it emits
+ *
+ * The subpictures may outlive the filter, so it is reference counted.
+ */
+typedef struct
+{
+    vlc_mutex_t lock;
+    unsigned    i_refs;
+
+    filter_t   *p_text;     /* text renderer, NULL once the filter is gone */
+
+    danmaku_comment_t *p_comments;
+    size_t             i_comments;
+    mtime_t            i_duration;
+    int                i_font_size_cfg;
+
+    /* Atlas */
+    picture_t     *p_atlas;
+    unsigned       i_atlas;
+    atlas_shelf_t *p_shelves;
+    int            i_shelves;
+    int            i_shelves_max;
+
+    /* Layout */
+    unsigned        i_layout;
+    int             i_width;
+    int             i_height;
+    int             i_font_size;
+    int             i_lane_height;
+    int             i_lanes;
+    danmaku_lane_t *p_lanes[4];
+    size_t          i_next;
+    mtime_t         i_layout_time;
+
+    /* Statistics */
+    unsigned i_rendered;
+    unsigned i_atlas_resets;
+    unsigned i_visible_max;
+} danmaku_t;
+
+struct filter_sys_t
+{
+    danmaku_t *p_danmaku;
+
+    int     i_channel;
+    int     i_alpha;
+    mtime_t i_delay;
+
+    /* Stream clock */
+    input_thread_t *p_input;
+    mtime_t         i_input_lookup;
+    mtime_t         i_input_time;
+    mtime_t         i_time;
+    mtime_t         i_date;
+    float           f_rate;
+    mtime_t         i_origin;
+};
+
+struct subpicture_updater_sys_t
+{
+    danmaku_t *p_danmaku;
+    mtime_t    i_time;
+};
+
+/*****************************************************************************
+ * Timeline loading
+ *****************************************************************************/
+static int CommentCmp( const void *a, const void *b )
+{
+    const danmaku_comment_t *p_a = a, *p_b = b;
+
+    if( p_a->i_time != p_b->i_time )
+        return p_a->i_time < p_b->i_time ? -1 : 1;
+    /* Keep the file order (the text pointers are increasing) */
+    return p_a->psz_text < p_b->psz_text ? -1 : p_a->psz_text > p_b->psz_text;
+}
+
+static char *LoadFile( filter_t *p_filter, const char *psz_file )
+{
+    FILE *p_file = vlc_fopen( psz_file, "rb" );
+    if( !p_file )
+    {
+        msg_Err( p_filter, "cannot open %s: %m", psz_file );
+        return NULL;
+    }
+
+    char  *p_data = NULL;
+    size_t i_data = 0;
+    for( ;; )
+    {
+        char *p_realloc = realloc( p_data, i_data + 65536 + 1 );
+        if( !p_realloc )
+        {
+            free( p_data );
+            p_data = NULL;
+            break;
+        }
+        p_data = p_realloc;
+
+        size_t i_read = fread( &p_data[i_data], 1, 65536, p_file );
+        i_data += i_read;
+        p_data[i_data] = '\0';
+        if( i_read < 65536 )
+            break;
+        if( i_data > DANMAKU_FILE_MAX )
+        {
+            msg_Err( p_filter, "comment file %s is too large", psz_file );
+            free( p_data );
+            p_data = NULL;
+            break;
+        }
+    }
+    fclose( p_file );
+    return p_data;
+}
+
+/* Returns the value of the attribute psz_name in the tag [psz_tag, psz_end[ */
+static char *GetAttribute( char *psz_tag, const char *psz_end,
+                           const char *psz_name )
+{
+    const size_t i_name = strlen( psz_name );
+
+    for( char *p = psz_tag; p + i_name + 2 < psz_end; p++ )
+    {
+        if( !isspace( (unsigned char)p[0] ) ||
+            strncmp( &p[1], psz_name, i_name ) || p[1 + i_name] != '=' )
+            continue;
+
+        char *psz_value = &p[2 + i_name];
+        const char quote = *psz_value;
+        if( quote != '"' && quote != '\'' )
+            return NULL;
+        psz_value++;
+
+        char *psz_close = memchr( psz_value, quote, psz_end - psz_value );
+        if( !psz_close )
+            return NULL;
+        *psz_close = '\0';
+        return psz_value;
+    }
+    return NULL;
+}
+
+/**
+ * Parses the bilibili and acfun XML formats:
+ *  <d p="time,mode,size,color,...">text</d>
+ *  <l i="time,color,mode,size,...">text</l>
+ * The file is modified in place.
+ */
+static void ParseComments( filter_t *p_filter, danmaku_t *p_dmk, char *p_data )
+{
+    size_t i_allocated = 0;
+    char *p = p_data;
+
+    while( (p = strchr( p, '<' )) != NULL )
+    {
+        const char tag = p[1];
+        if( (tag != 'd' && tag != 'l') || !isspace( (unsigned char)p[2] ) )
+        {
+            p++;
+            continue;
+        }
+
+        char *psz_end = strchr( p, '>' );
+        if( !psz_end )
+            break;
+        char *psz_attr = GetAttribute( p + 2, psz_end,
+                                       tag == 'd' ? "p" : "i" );
+        char *psz_text = psz_end + 1;
+        if( !psz_attr )
+        {
+            p = psz_text;
+            continue;
+        }
+
+        /* Text, either raw or in a CDATA section */
+        char *psz_close;
+        if( !strncmp( psz_text, "<![CDATA[", 9 ) )
+        {
+            psz_text += 9;
+            psz_close = strstr( psz_text, "]]>" );
+            p = psz_close ? psz_close + 3 : NULL;
+        }
+        else
+        {
+            psz_close = strstr( psz_text, "</" );
+            p = psz_close ? psz_close + 1 : NULL;
+        }
+        if( !psz_close )
+            break;
+        *psz_close = '\0';
+        resolve_xml_special_chars( psz_text );
+
+        /* Attributes */
+        double f_time = us_strtod( psz_attr, &psz_attr );
+        long pi_field[3] = { 0, 0, 0 };
+        for( int i = 0; i < 3 && *psz_attr == ','; i++ )
+            pi_field[i] = strtol( psz_attr + 1, &psz_attr, 10 );
+
+        long i_mode, i_size, i_color;
+        if( tag == 'd' )
+        {
+            i_mode  = pi_field[0];
+            i_size  = pi_field[1];
+            i_color = pi_field[2];
+        }
+        else
+        {
+            i_color = pi_field[0];
+            i_mode  = pi_field[1];
+            i_size  = pi_field[2];
+        }
+
+        int i_type;
+        switch( i_mode )
+        {
+        case 1: case 2: case 3:
+            i_type = DANMAKU_SCROLL;
+            break;
+        case 4:
+            i_type = DANMAKU_BOTTOM;
+            break;
+        case 5:
+            i_type = DANMAKU_TOP;
+            break;
+        case 6:
+            i_type = DANMAKU_REVERSE;
+            break;
+        default:
+            /* Scripted and positioned comments are not supported */
+            continue;
+        }
+        if( f_time < 0. || *psz_text == '\0' )
+            continue;
+
+        if( p_dmk->i_comments >= i_allocated )
+        {
+            size_t i_new = i_allocated ? 2 * i_allocated : 1024;
+            danmaku_comment_t *p_realloc =
+                realloc( p_dmk->p_comments, i_new * sizeof(*p_realloc) );
+            if( !p_realloc )
+                break;
+            p_dmk->p_comments = p_realloc;
+            i_allocated = i_new;
+        }
+
+        danmaku_comment_t *p_cmt = &p_dmk->p_comments[p_dmk->i_comments++];
+        p_cmt->i_time   = (mtime_t)(f_time * CLOCK_FREQ);
+        p_cmt->i_mode   = i_type;
+        p_cmt->i_size   = i_size > 0 ? __MIN( i_size, 4 * DANMAKU_SIZE_DEFAULT )
+                                     : DANMAKU_SIZE_DEFAULT;
+        p_cmt->i_color  = i_color & 0xffffff;
+        p_cmt->psz_text = psz_text;
+        p_cmt->i_atlas  = 0;
+        p_cmt->i_layout = 0;
+    }
+
+    qsort( p_dmk->p_comments, p_dmk->i_comments,
+           sizeof(*p_dmk->p_comments), CommentCmp );
+
+    msg_Dbg( p_filter, "loaded %zu comments", p_dmk->i_comments );
+}
+
+/* Returns the index of the first comment appearing at or after i_time */
+static size_t CommentFind( const danmaku_t *p_dmk, mtime_t i_time )
+{
+    size_t i_low = 0, i_high = p_dmk->i_comments;
+
+    while( i_low < i_high )
+    {
+        const size_t i_mid = (i_low + i_high) / 2;
+        if( p_dmk->p_comments[i_mid].i_time < i_time )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+/*****************************************************************************
+ * Atlas
+ *****************************************************************************/
+static void AtlasReset( danmaku_t *p_dmk )
+{
+    video_format_t fmt;
+
+    /* Regions still being displayed keep a reference on the previous atlas,
+     * so it is never overwritten */
+    if( p_dmk->p_atlas )
+    {
+        picture_Release( p_dmk->p_atlas );
+        p_dmk->i_atlas_resets++;
+    }
+
+    video_format_Init( &fmt, VLC_CODEC_RGBA );
+    fmt.i_width  = fmt.i_visible_width  = ATLAS_WIDTH;
+    fmt.i_height = fmt.i_visible_height = ATLAS_HEIGHT;
+    fmt.i_sar_num = fmt.i_sar_den = 1;
+    p_dmk->p_atlas = picture_NewFromFormat( &fmt );
+
+    p_dmk->i_atlas++;
+    p_dmk->i_shelves = 0;
+}
+
+/* Finds room for a w x h rectangle using a simple shelf packing */
+static int AtlasAllocate( danmaku_t *p_dmk, int i_width, int i_height,
+                          int *pi_x, int *pi_y )
+{
+    atlas_shelf_t *p_shelf = NULL;
+
+    for( int i = 0; i < p_dmk->i_shelves; i++ )
+    {
+        atlas_shelf_t *p_cur = &p_dmk->p_shelves[i];
+        if( p_cur->i_height >= i_height &&
+            p_cur->i_height <= i_height + i_height / 4 &&
+            p_cur->i_used + i_width <= ATLAS_WIDTH )
+        {
+            p_shelf = p_cur;
+            break;
+        }
+    }
+
+    if( !p_shelf )
+    {
+        const int i_y = p_dmk->i_shelves > 0 ?
+            p_dmk->p_shelves[p_dmk->i_shelves - 1].i_y +
+            p_dmk->p_shelves[p_dmk->i_shelves - 1].i_height : 0;
+        if( i_y + i_height > ATLAS_HEIGHT )
+            return VLC_EGENERIC;
+
+        if( p_dmk->i_shelves >= p_dmk->i_shelves_max )
+        {
+            const int i_max = p_dmk->i_shelves_max ? 2 * p_dmk->i_shelves_max : 64;
+            atlas_shelf_t *p_realloc =
+                realloc( p_dmk->p_shelves, i_max * sizeof(*p_realloc) );
+            if( !p_realloc )
+                return VLC_ENOMEM;
+            p_dmk->p_shelves = p_realloc;
+            p_dmk->i_shelves_max = i_max;
+        }
+        p_shelf = &p_dmk->p_shelves[p_dmk->i_shelves++];
+        p_shelf->i_y      = i_y;
+        p_shelf->i_height = i_height;
+        p_shelf->i_used   = 0;
+    }
+
+    *pi_x = p_shelf->i_used;
+    *pi_y = p_shelf->i_y;
+    p_shelf->i_used += i_width;
+    return VLC_SUCCESS;
+}
+
+/* Renders the comment text once and copies it into the atlas */
+static int CommentRasterize( danmaku_t *p_dmk, danmaku_comment_t *p_cmt,
+                             bool *pb_reset )
+{
+    static const vlc_fourcc_t p_chroma_list[] = { VLC_CODEC_RGBA, 0 };
+    filter_t *p_text = p_dmk->p_text;
+    video_format_t fmt;
+    int i_ret = VLC_EGENERIC;
+
+    if( !p_text || !p_dmk->p_atlas )
+        return VLC_EGENERIC;
+
+    video_format_Init( &fmt, VLC_CODEC_TEXT );
+    subpicture_region_t *p_region = subpicture_region_New( &fmt );
+    if( !p_region )
+        return VLC_ENOMEM;
+
+    p_region->psz_text = strdup( p_cmt->psz_text );
+    p_region->p_style  = text_style_New();
+    if( !p_region->psz_text || !p_region->p_style )
+        goto error;
+    p_region->p_style->i_font_size  = p_dmk->i_font_size * p_cmt->i_size
+                                    / DANMAKU_SIZE_DEFAULT;
+    p_region->p_style->i_font_color = p_cmt->i_color;
+    p_region->p_style->i_font_alpha = 0xff;
+    /* Dark comments are outlined in white */
+    if( (p_cmt->i_color & 0xff) + ((p_cmt->i_color >> 8) & 0xff) +
+        ((p_cmt->i_color >> 16) & 0xff) < 0x60 )
+        p_region->p_style->i_outline_color = 0xffffff;
+
+    if( p_text->pf_render_text( p_text, p_region, p_region, p_chroma_list ) ||
+        !p_region->p_picture || p_region->fmt.i_chroma != VLC_CODEC_RGBA )
+        goto error;
+
+    const picture_t *p_pic = p_region->p_picture;
+    const int i_width  = __MIN( (int)p_region->fmt.i_visible_width, ATLAS_WIDTH );
+    const int i_height = __MIN( (int)p_region->fmt.i_visible_height, ATLAS_HEIGHT );
+    int i_x, i_y;
+
+    if( AtlasAllocate( p_dmk, i_width, i_height, &i_x, &i_y ) )
+    {
+        if( *pb_reset )
+            goto error;
+        /* The atlas is full of comments that are no more displayed,
+         * start a new one, visible comments will be rendered again */
+        *pb_reset = true;
+        AtlasReset( p_dmk );
+        if( !p_dmk->p_atlas ||
+            AtlasAllocate( p_dmk, i_width, i_height, &i_x, &i_y ) )
+            goto error;
+    }
+
+    const plane_t *p_src = &p_pic->p[0];
+    plane_t *p_dst = &p_dmk->p_atlas->p[0];
+    for( int y = 0; y < i_height; y++ )
+        memcpy( &p_dst->p_pixels[(i_y + y) * p_dst->i_pitch + 4 * i_x],
+                &p_src->p_pixels[(p_region->fmt.i_y_offset + y) * p_src->i_pitch
+                                 + 4 * p_region->fmt.i_x_offset],
+                4 * i_width );
+
+    p_cmt->i_atlas  = p_dmk->i_atlas;
+    p_cmt->i_x      = i_x;
+    p_cmt->i_y      = i_y;
+    p_cmt->i_width  = i_width;
+    p_cmt->i_height = i_height;
+    p_dmk->i_rendered++;
+    i_ret = VLC_SUCCESS;
+
+error:
+    subpicture_region_Delete( p_region );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Layout
+ *****************************************************************************/
+static void LayoutReset( danmaku_t *p_dmk, mtime_t i_time )
+{
+    p_dmk->i_layout++;
+    for( int i = 0; i < 4; i++ )
+        for( int j = 0; j < p_dmk->i_lanes; j++ )
+            p_dmk->p_lanes[i][j].i_free =
+            p_dmk->p_lanes[i][j].i_exit = INT64_MIN;
+    /* Comments still on screen are laid out again from their start */
+    p_dmk->i_next = CommentFind( p_dmk, i_time - p_dmk->i_duration );
+    p_dmk->i_layout_time = i_time;
+}
+
+static int LayoutSetup( danmaku_t *p_dmk, int i_width, int i_height )
+{
+    if( p_dmk->i_width == i_width && p_dmk->i_height == i_height )
+        return VLC_SUCCESS;
+
+    p_dmk->i_width  = i_width;
+    p_dmk->i_height = i_height;
+
+    /* The text is rendered for the output size, start a new atlas */
+    p_dmk->i_font_size = p_dmk->i_font_size_cfg > 0 ? p_dmk->i_font_size_cfg
+                                                    : __MAX( i_height / 24, 12 );
+    p_dmk->i_lane_height = p_dmk->i_font_size + p_dmk->i_font_size / 4;
+    AtlasReset( p_dmk );
+
+    p_dmk->i_lanes = __MAX( i_height / p_dmk->i_lane_height, 1 );
+    for( int i = 0; i < 4; i++ )
+    {
+        free( p_dmk->p_lanes[i] );
+        p_dmk->p_lanes[i] = malloc( p_dmk->i_lanes * sizeof(danmaku_lane_t) );
+        if( !p_dmk->p_lanes[i] )
+        {
+            p_dmk->i_lanes = 0;
+            p_dmk->i_width = p_dmk->i_height = 0;
+            return VLC_ENOMEM;
+        }
+    }
+    LayoutReset( p_dmk, p_dmk->i_layout_time );
+    return VLC_SUCCESS;
+}
+
+/* Picks the lanes for a comment, avoiding collisions when possible */
+static void CommentLayout( danmaku_t *p_dmk, danmaku_comment_t *p_cmt )
+{
+    danmaku_lane_t *p_lanes = p_dmk->p_lanes[p_cmt->i_mode];
+    const mtime_t i_start    = p_cmt->i_time;
+    const mtime_t i_duration = p_dmk->i_duration;
+    const int i_span = __MIN( (p_cmt->i_height + p_dmk->i_lane_height - 1) /
+                              p_dmk->i_lane_height, p_dmk->i_lanes );
+    const bool b_scroll = p_cmt->i_mode == DANMAKU_SCROLL ||
+                          p_cmt->i_mode == DANMAKU_REVERSE;
+
+    /* A scrolling comment moves by (W + w) pixels during i_duration */
+    mtime_t i_free, i_head;
+    if( b_scroll )
+    {
+        const int64_t i_distance = p_dmk->i_width + p_cmt->i_width;
+        /* Its tail is fully on screen */
+        i_free = i_start + i_duration * p_cmt->i_width / i_distance;
+        /* Its head reaches the other side */
+        i_head = i_start + i_duration * p_dmk->i_width / i_distance;
+    }
+    else
+    {
+        i_free = i_start + i_duration;
+        i_head = INT64_MAX;
+    }
+
+    int i_best = 0;
+    mtime_t i_best_exit = INT64_MAX;
+    for( int i = 0; i + i_span <= p_dmk->i_lanes; i++ )
+    {
+        mtime_t i_exit = INT64_MIN;
+        bool b_free = true;
+        for( int j = i; j < i + i_span; j++ )
+        {
+            const danmaku_lane_t *p_lane = &p_lanes[j];
+            if( b_scroll )
+                /* The previous comment must be fully on screen, and must
+                 * have left it before being caught up */
+                b_free &= p_lane->i_free <= i_start && p_lane->i_exit <= i_head;
+            else
+                b_free &= p_lane->i_exit <= i_start;
+            i_exit = __MAX( i_exit, p_lane->i_exit );
+        }
+        if( b_free )
+        {
+            i_best = i;
+            break;
+        }
+        if( i_exit < i_best_exit )
+        {
+            /* Overlap the comment that is about to disappear */
+            i_best = i;
+            i_best_exit = i_exit;
+        }
+    }
+
+    for( int j = i_best; j < i_best + i_span; j++ )
+    {
+        p_lanes[j].i_free = i_free;
+        p_lanes[j].i_exit = i_start + i_duration;
+    }
+    p_cmt->i_lane   = i_best;
+    p_cmt->i_layout = p_dmk->i_layout;
+}
+
+/* Lays out the comments appearing up to i_time */
+static void Layout( danmaku_t *p_dmk, mtime_t i_time )
+{
+    if( i_time < p_dmk->i_layout_time ||
+        i_time > p_dmk->i_layout_time + p_dmk->i_duration )
+        LayoutReset( p_dmk, i_time );
+
+    bool b_reset = false;
+    while( p_dmk->i_next < p_dmk->i_comments &&
+           p_dmk->p_comments[p_dmk->i_next].i_time <= i_time )
+    {
+        danmaku_comment_t *p_cmt = &p_dmk->p_comments[p_dmk->i_next++];
+
+        if( p_cmt->i_time + p_dmk->i_duration <= i_time )
+            continue;
+        if( p_cmt->i_atlas != p_dmk->i_atlas &&
+            CommentRasterize( p_dmk, p_cmt, &b_reset ) )
+            continue;
+        CommentLayout( p_dmk, p_cmt );
+    }
+    p_dmk->i_layout_time = i_time;
+}
+
+/*****************************************************************************
+ * Subpicture updater
+ *****************************************************************************/
+static danmaku_t *DanmakuHold( danmaku_t *p_dmk )
+{
+    vlc_mutex_lock( &p_dmk->lock );
+    p_dmk->i_refs++;
+    vlc_mutex_unlock( &p_dmk->lock );
+    return p_dmk;
+}
+
+static void DanmakuRelease( danmaku_t *p_dmk )
+{
+    vlc_mutex_lock( &p_dmk->lock );
+    const unsigned i_refs = --p_dmk->i_refs;
+    vlc_mutex_unlock( &p_dmk->lock );
+    if( i_refs > 0 )
+        return;
+
+    assert( p_dmk->p_text == NULL );
+    if( p_dmk->p_atlas )
+        picture_Release( p_dmk->p_atlas );
+    for( int i = 0; i < 4; i++ )
+        free( p_dmk->p_lanes[i] );
+    free( p_dmk->p_shelves );
+    /* The texts are stored after the comments */
+    free( p_dmk->p_comments );
+    vlc_mutex_destroy( &p_dmk->lock );
+    free( p_dmk );
+}
+
+static int SubpictureValidate( subpicture_t *p_subpic,
+                               bool b_fmt_src, const video_format_t *p_fmt_src,
+                               bool b_fmt_dst, const video_format_t *p_fmt_dst,
+                               mtime_t i_ts )
+{
+    VLC_UNUSED( p_subpic );
+    VLC_UNUSED( b_fmt_src ); VLC_UNUSED( p_fmt_src );
+    VLC_UNUSED( b_fmt_dst ); VLC_UNUSED( p_fmt_dst );
+    VLC_UNUSED( i_ts );
+
+    /* The regions move with the time, always update them */
+    return VLC_EGENERIC;
+}
+
+static void SubpictureUpdate( subpicture_t *p_subpic,
+                              const video_format_t *p_fmt_src,
+                              const video_format_t *p_fmt_dst,
+                              mtime_t i_ts )
+{
+    subpicture_updater_sys_t *p_upd = p_subpic->updater.p_sys;
+    danmaku_t *p_dmk = p_upd->p_danmaku;
+    const mtime_t i_time = p_upd->i_time;
+
+    VLC_UNUSED( p_fmt_src ); VLC_UNUSED( i_ts );
+
+    const int i_width  = p_fmt_dst->i_width;
+    const int i_height = p_fmt_dst->i_height;
+    if( i_width <= 0 || i_height <= 0 )
+        return;
+
+    /* The regions are laid out in the output resolution, so that the spu
+     * renders them without scaling */
+    p_subpic->i_original_picture_width  = i_width;
+    p_subpic->i_original_picture_height = i_height;
+
+    vlc_mutex_lock( &p_dmk->lock );
+    if( LayoutSetup( p_dmk, i_width, i_height ) || !p_dmk->p_atlas )
+    {
+        vlc_mutex_unlock( &p_dmk->lock );
+        return;
+    }
+    Layout( p_dmk, i_time );
+
+    video_format_t fmt;
+    video_format_Init( &fmt, VLC_CODEC_RGBA );
+    fmt.i_sar_num = p_fmt_dst->i_sar_num;
+    fmt.i_sar_den = p_fmt_dst->i_sar_den;
+
+    subpicture_region_t **pp_last = &p_subpic->p_region;
+    unsigned i_visible = 0;
+    bool b_reset = false;
+    for( size_t i = CommentFind( p_dmk, i_time - p_dmk->i_duration + 1 );
+         i < p_dmk->i_next; i++ )
+    {
+        danmaku_comment_t *p_cmt = &p_dmk->p_comments[i];
+        if( p_cmt->i_layout != p_dmk->i_layout )
+            continue;
+        if( p_cmt->i_atlas != p_dmk->i_atlas &&
+            CommentRasterize( p_dmk, p_cmt, &b_reset ) )
+            continue;
+
+        const mtime_t i_elapsed = i_time - p_cmt->i_time;
+        const int64_t i_distance = (int64_t)i_width + p_cmt->i_width;
+        int i_x, i_y;
+        switch( p_cmt->i_mode )
+        {
+        case DANMAKU_SCROLL:
+            i_x = i_width - i_distance * i_elapsed / p_dmk->i_duration;
+            i_y = p_cmt->i_lane * p_dmk->i_lane_height;
+            break;
+        case DANMAKU_REVERSE:
+            i_x = i_distance * i_elapsed / p_dmk->i_duration - p_cmt->i_width;
+            i_y = p_cmt->i_lane * p_dmk->i_lane_height;
+            break;
+        case DANMAKU_TOP:
+            i_x = (i_width - p_cmt->i_width) / 2;
+            i_y = p_cmt->i_lane * p_dmk->i_lane_height;
+            break;
+        default:
+            i_x = (i_width - p_cmt->i_width) / 2;
+            i_y = i_height - p_cmt->i_lane * p_dmk->i_lane_height
+                           - p_cmt->i_height;
+            break;
+        }
+
+        /* Clip to the output, the spu would otherwise move the regions
+         * inside */
+        int i_left   = __MAX( -i_x, 0 );
+        int i_top    = __MAX( -i_y, 0 );
+        int i_right  = __MIN( i_width  - i_x, p_cmt->i_width );
+        int i_bottom = __MIN( i_height - i_y, p_cmt->i_height );
+        if( i_left >= i_right || i_top >= i_bottom )
+            continue;
+
+        /* The region shows a part of the atlas */
+        fmt.i_x_offset = p_cmt->i_x + i_left;
+        fmt.i_y_offset = p_cmt->i_y + i_top;
+        fmt.i_width  = fmt.i_visible_width  = i_right - i_left;
+        fmt.i_height = fmt.i_visible_height = i_bottom - i_top;
+
+        subpicture_region_t *p_region =
+            subpicture_region_NewFromPicture( &fmt, p_dmk->p_atlas );
+        if( !p_region )
+            break;
+        p_region->i_align = SUBPICTURE_ALIGN_LEFT | SUBPICTURE_ALIGN_TOP;
+        p_region->i_x = i_x + i_left;
+        p_region->i_y = i_y + i_top;
+
+        *pp_last = p_region;
+        pp_last = &p_region->p_next;
+        i_visible++;
+    }
+    if( i_visible > p_dmk->i_visible_max )
+        p_dmk->i_visible_max = i_visible;
+    vlc_mutex_unlock( &p_dmk->lock );
+}
+
+static void SubpictureDestroy( subpicture_t *p_subpic )
+{
+    subpicture_updater_sys_t *p_upd = p_subpic->updater.p_sys;
+
+    DanmakuRelease( p_upd->p_danmaku );
+    free( p_upd );
+}
+
+/*****************************************************************************
+ * Stream clock
+ *****************************************************************************/
+/**
+ * Converts a display date into a stream time.
+ *
+ * The input time is only updated a few times per second, it is extrapolated
+ * in between so that the comments scroll smoothly.
+ */
+static mtime_t GetStreamTime( filter_t *p_filter, mtime_t i_date )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_input )
+    {
+        const int i_state = var_GetInteger( p_sys->p_input, "state" );
+        if( i_state == END_S || i_state == ERROR_S )
+        {
+            vlc_object_release( p_sys->p_input );
+            p_sys->p_input = NULL;
+        }
+    }
+    if( !p_sys->p_input && i_date >= p_sys->i_input_lookup )
+    {
+        p_sys->p_input = filter_GetInput( p_filter );
+        p_sys->i_input_lookup = i_date + CLOCK_FREQ;
+        p_sys->i_date = VLC_TS_INVALID;
+    }
+
+    if( !p_sys->p_input )
+    {
+        /* Offline rendering: the comments follow the display clock */
+        if( p_sys->i_origin == VLC_TS_INVALID )
+            p_sys->i_origin = i_date;
+        return i_date - p_sys->i_origin;
+    }
+
+    const mtime_t i_input_time = var_GetTime( p_sys->p_input, "time" );
+    mtime_t i_time = p_sys->i_time +
+                     (mtime_t)((i_date - p_sys->i_date) * p_sys->f_rate);
+
+    if( p_sys->i_date == VLC_TS_INVALID )
+        i_time = i_input_time;
+    else if( i_input_time != p_sys->i_input_time )
+    {
+        if( llabs( i_input_time - i_time ) > SEEK_THRESHOLD )
+            i_time = i_input_time;
+        else
+            i_time += (i_input_time - i_time) / 4;
+    }
+
+    p_sys->i_input_time = i_input_time;
+    p_sys->i_time = i_time;
+    p_sys->i_date = i_date;
+    p_sys->f_rate =
+        var_GetInteger( p_sys->p_input, "state" ) == PAUSE_S ? 0.f :
+        var_GetFloat( p_sys->p_input, "rate" );
+    return i_time;
+}
+
+/*****************************************************************************
+ * CreateFilter: allocates the danmaku filter
+ *****************************************************************************/
+static int CreateFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    char *psz_file = var_InheritString( p_filter, CFG_PREFIX "file" );
+    if( !psz_file )
+    {
+        msg_Err( p_filter, "no comment file" );
+        return VLC_EGENERIC;
+    }
+    char *p_data = LoadFile( p_filter, psz_file );
+    free( psz_file );
+    if( !p_data )
+        return VLC_EGENERIC;
+
+    danmaku_t *p_dmk = calloc( 1, sizeof(*p_dmk) );
+    p_sys = p_filter->p_sys = malloc( sizeof(*p_sys) );
+    if( !p_dmk || !p_sys )
+    {
+        free( p_dmk );
+        free( p_sys );
+        free( p_data );
+        return VLC_ENOMEM;
+    }
+
+    vlc_mutex_init( &p_dmk->lock );
+    p_dmk->i_refs = 1;
+    p_dmk->i_duration = __MAX( var_InheritInteger( p_filter, CFG_PREFIX "duration" ),
+                               100 ) * 1000;
+    p_dmk->i_font_size_cfg = var_InheritInteger( p_filter, CFG_PREFIX "size" );
+
+    ParseComments( p_filter, p_dmk, p_data );
+    if( p_dmk->i_comments == 0 )
+    {
+        msg_Err( p_filter, "no comment found" );
+        free( p_data );
+        goto error;
+    }
+    /* Move the texts after the comments, so that the file can be freed */
+    size_t i_text = 0;
+    for( size_t i = 0; i < p_dmk->i_comments; i++ )
+        i_text += strlen( p_dmk->p_comments[i].psz_text ) + 1;
+    danmaku_comment_t *p_realloc =
+        realloc( p_dmk->p_comments,
+                 p_dmk->i_comments * sizeof(*p_realloc) + i_text );
+    if( !p_realloc )
+    {
+        free( p_data );
+        goto error;
+    }
+    p_dmk->p_comments = p_realloc;
+    char *psz_text = (char *)&p_realloc[p_dmk->i_comments];
+    for( size_t i = 0; i < p_dmk->i_comments; i++ )
+    {
+        const size_t i_length = strlen( p_realloc[i].psz_text ) + 1;
+        memcpy( psz_text, p_realloc[i].psz_text, i_length );
+        p_realloc[i].psz_text = psz_text;
+        psz_text += i_length;
+    }
+    free( p_data );
+
+    /* Text renderer used to rasterize the comments */
+    filter_t *p_text = vlc_object_create( p_filter, sizeof(*p_text) );
+    if( !p_text )
+        goto error;
+    es_format_Init( &p_text->fmt_in, VIDEO_ES, 0 );
+    es_format_Init( &p_text->fmt_out, VIDEO_ES, 0 );
+    /* Comments are never wrapped */
+    p_text->fmt_out.video.i_width  =
+    p_text->fmt_out.video.i_visible_width  = ATLAS_WIDTH;
+    p_text->fmt_out.video.i_height =
+    p_text->fmt_out.video.i_visible_height = ATLAS_HEIGHT;
+    var_Create( p_text, "spu-elapsed", VLC_VAR_TIME );
+    var_Create( p_text, "text-rerender", VLC_VAR_BOOL );
+    p_text->p_module = module_need( p_text, "text renderer", "$text-renderer",
+                                    false );
+    if( !p_text->p_module )
+    {
+        msg_Err( p_filter, "no text renderer found" );
+        vlc_object_release( p_text );
+        goto error;
+    }
+    p_dmk->p_text = p_text;
+
+    p_sys->p_danmaku = p_dmk;
+    p_sys->i_channel = -1;
+    p_sys->i_alpha = var_InheritInteger( p_filter, CFG_PREFIX "opacity" );
+    p_sys->i_delay = var_InheritInteger( p_filter, CFG_PREFIX "delay" ) * 1000;
+    p_sys->p_input = NULL;
+    p_sys->i_input_lookup = VLC_TS_INVALID;
+    p_sys->i_input_time = VLC_TS_INVALID;
+    p_sys->i_time = 0;
+    p_sys->i_date = VLC_TS_INVALID;
+    p_sys->f_rate = 1.f;
+    p_sys->i_origin = VLC_TS_INVALID;
+
+    p_filter->pf_sub_source = Filter;
+
+    return VLC_SUCCESS;
+
+error:
+    DanmakuRelease( p_dmk );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * DestroyFilter: destroys the danmaku filter
+ *****************************************************************************/
+static void DestroyFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+    danmaku_t *p_dmk = p_sys->p_danmaku;
+
+    vlc_mutex_lock( &p_dmk->lock );
+    filter_t *p_text = p_dmk->p_text;
+    p_dmk->p_text = NULL;
+    msg_Dbg( p_filter, "%u comments rendered, %u atlas resets, "
+             "at most %u comments on screen", p_dmk->i_rendered,
+             p_dmk->i_atlas_resets, p_dmk->i_visible_max );
+    vlc_mutex_unlock( &p_dmk->lock );
+
+    module_unneed( p_text, p_text->p_module );
+    vlc_object_release( p_text );
+
+    if( p_sys->p_input )
+        vlc_object_release( p_sys->p_input );
+    DanmakuRelease( p_dmk );
+    free( p_sys );
+}
+
+/****************************************************************************
+ * Filter: emits the visible comments
+ ****************************************************************************
+ * A new subpicture is emitted for each rendered picture, its regions are
+ * created by the updater which knows the output size.
+ ****************************************************************************/
+static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    /* The buffer callback only gives subpictures without updater, use it
+     * once to learn our channel */
+    if( p_sys->i_channel < 0 )
+    {
+        subpicture_t *p_spu = filter_NewSubpicture( p_filter );
+        if( !p_spu )
+            return NULL;
+        p_sys->i_channel = p_spu->i_channel;
+        filter_DeleteSubpicture( p_filter, p_spu );
+    }
+
+    subpicture_updater_sys_t *p_upd = malloc( sizeof(*p_upd) );
+    if( !p_upd )
+        return NULL;
+    p_upd->i_time = GetStreamTime( p_filter, date ) - p_sys->i_delay;
+    p_upd->p_danmaku = DanmakuHold( p_sys->p_danmaku );
+
+    subpicture_updater_t updater = {
+        .pf_validate = SubpictureValidate,
+        .pf_update   = SubpictureUpdate,
+        .pf_destroy  = SubpictureDestroy,
+        .p_sys       = p_upd,
+    };
+    subpicture_t *p_spu = subpicture_New( &updater );
+    if( !p_spu )
+    {
+        DanmakuRelease( p_upd->p_danmaku );
+        free( p_upd );
+        return NULL;
+    }
+
+    p_spu->i_channel  = p_sys->i_channel;
+    p_spu->i_start    = date;
+    p_spu->i_stop     = 0;
+    p_spu->b_ephemer  = true;
+    p_spu->b_absolute = true;
+    p_spu->i_alpha    = p_sys->i_alpha;
+    return p_spu;
+}
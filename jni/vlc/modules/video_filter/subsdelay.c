@@ -686,6 +686,7 @@ static subsdelay_heap_entry_t * SubsdelayEntryCreate( subpicture_t *p_source, fi
     updater.pf_validate = SubpicValidateWrapper;
     updater.pf_update = SubpicUpdateWrapper;
     updater.pf_destroy = SubpicDestroyWrapper;
+    updater.b_stateless = false;
 
     /* create new subpic */
 
@@ -68,6 +68,9 @@ struct libvlc_media_list_player_t
     libvlc_media_list_t *       p_mlist;
     libvlc_media_player_t *     p_mi;
     libvlc_playback_mode_t      e_playback_mode;
+    /* Preloading of the next item, in ms before the end (0 disables it) */
+    libvlc_time_t               i_preload_time;
+    bool                        b_next_preloaded;
 };
 
 /* This is not yet exported by libvlccore */
@@ -334,6 +337,56 @@ media_player_reached_end(const libvlc_event_t * p_event, void * p_user_data)
     vlc_mutex_unlock(&p_mlp->mp_callback_lock);
 }
 
+/**************************************************************************
+ *       media_player_time_changed (private) (Event Callback)
+ *
+ * Preloads the next item when the current one is about to end.
+ **************************************************************************/
+static void
+media_player_time_changed(const libvlc_event_t * p_event, void * p_user_data)
+{
+    libvlc_media_list_player_t * p_mlp = p_user_data;
+    const libvlc_time_t i_time = p_event->u.media_player_time_changed.new_time;
+
+    vlc_mutex_lock(&p_mlp->mp_callback_lock);
+    if (p_mlp->are_mp_callback_cancelled || p_mlp->b_next_preloaded ||
+        !p_mlp->p_mlist)
+    {
+        vlc_mutex_unlock(&p_mlp->mp_callback_lock);
+        return;
+    }
+
+    libvlc_time_t i_length = libvlc_media_player_get_length(p_mlp->p_mi);
+    if (i_length <= 0 || i_length - i_time > p_mlp->i_preload_time)
+    {
+        vlc_mutex_unlock(&p_mlp->mp_callback_lock);
+        return;
+    }
+    p_mlp->b_next_preloaded = true;
+
+    libvlc_media_list_lock(p_mlp->p_mlist);
+    libvlc_media_list_path_t path;
+    if (p_mlp->e_playback_mode != libvlc_playback_mode_repeat)
+        path = get_next_path(p_mlp,
+                        p_mlp->e_playback_mode == libvlc_playback_mode_loop);
+    else
+        path = p_mlp->current_playing_item_path ?
+               libvlc_media_list_path_copy(p_mlp->current_playing_item_path) : NULL;
+
+    libvlc_media_t * p_md = NULL;
+    if (path)
+        p_md = libvlc_media_list_item_at_path(p_mlp->p_mlist, path);
+    libvlc_media_list_unlock(p_mlp->p_mlist);
+    free(path);
+
+    if (p_md)
+    {
+        libvlc_media_player_preload(p_mlp->p_mi, p_md);
+        libvlc_media_release(p_md);
+    }
+    vlc_mutex_unlock(&p_mlp->mp_callback_lock);
+}
+
 /**************************************************************************
  *       playlist_item_deleted (private) (Event Callback)
  **************************************************************************/
@@ -374,6 +427,8 @@ install_media_player_observer(libvlc_media_list_player_t * p_mlp)
 {
     assert_locked(p_mlp);
     libvlc_event_attach_async(mplayer_em(p_mlp), libvlc_MediaPlayerEndReached, media_player_reached_end, p_mlp);
+    if (p_mlp->i_preload_time > 0)
+        libvlc_event_attach_async(mplayer_em(p_mlp), libvlc_MediaPlayerTimeChanged, media_player_time_changed, p_mlp);
 }
 
 
@@ -393,6 +448,8 @@ uninstall_media_player_observer(libvlc_media_list_player_t * p_mlp)
     // This is safe because only callbacks are allowed, and there execution will be cancelled.
     vlc_mutex_unlock(&p_mlp->mp_callback_lock);
     libvlc_event_detach(mplayer_em(p_mlp), libvlc_MediaPlayerEndReached, media_player_reached_end, p_mlp);
+    if (p_mlp->i_preload_time > 0)
+        libvlc_event_detach(mplayer_em(p_mlp), libvlc_MediaPlayerTimeChanged, media_player_time_changed, p_mlp);
 
     // Now, lock back the callback lock. No more callback will be present from this point.
     vlc_mutex_lock(&p_mlp->mp_callback_lock);
@@ -435,6 +492,7 @@ set_current_playing_item(libvlc_media_list_player_t * p_mlp, libvlc_media_list_p
         p_mlp->p_mi = libvlc_media_player_new_from_media(p_md);
 
     libvlc_media_player_set_media(p_mlp->p_mi, p_md);
+    p_mlp->b_next_preloaded = false;
 
     install_media_player_observer(p_mlp);
     libvlc_media_release(p_md); /* for libvlc_media_list_item_at_index */
@@ -472,6 +530,8 @@ libvlc_media_list_player_new(libvlc_instance_t * p_instance)
     vlc_mutex_init(&p_mlp->mp_callback_lock);
     libvlc_event_manager_register_event_type(p_mlp->p_event_manager, libvlc_MediaListPlayerNextItemSet);
     p_mlp->e_playback_mode = libvlc_playback_mode_default;
+    p_mlp->i_preload_time = 1000 *
+        var_InheritInteger(p_instance->p_libvlc_int, "preload-time");
 
     return p_mlp;
 }
@@ -143,6 +143,24 @@ static void release_input_thread( libvlc_media_player_t *p_mi, bool b_input_abor
     input_Close( p_input_thread );
 }
 
+/*
+ * Release the preloaded input thread.
+ *
+ * Input lock is held or instance is being destroyed.
+ */
+static void release_preload( libvlc_media_player_t *p_mi )
+{
+    input_thread_t *p_preload = p_mi->input.p_preload;
+    if( !p_preload )
+        return;
+    p_mi->input.p_preload = NULL;
+
+    input_Stop( p_preload, true );
+    input_Close( p_preload );
+    libvlc_media_release( p_mi->input.p_preload_md );
+    p_mi->input.p_preload_md = NULL;
+}
+
 /*
  * Retrieve the input thread. Be sure to release the object
  * once you are done with it. (libvlc Internal)
@@ -276,6 +294,13 @@ input_event_changed( vlc_object_t * p_this, char const * psz_cmd,
                 return VLC_SUCCESS;
         }
 
+        if( libvlc_state == libvlc_Ended )
+        {
+            lock( p_mi );
+            p_mi->input.i_end_date = mdate();
+            unlock( p_mi );
+        }
+
         set_state( p_mi, libvlc_state, false );
         libvlc_event_send( p_mi->p_event_manager, &event );
     }
@@ -316,6 +341,20 @@ input_event_changed( vlc_object_t * p_this, char const * psz_cmd,
         event.type = libvlc_MediaPlayerBuffering;
         event.u.media_player_buffering.new_cache = (int)(100 *
             var_GetFloat( p_input, "cache" ));
+
+        /* Measure the transition from the previous media */
+        if( event.u.media_player_buffering.new_cache >= 100 )
+        {
+            lock( p_mi );
+            if( p_mi->input.i_end_date > 0 )
+            {
+                p_mi->input.i_gap = mdate() - p_mi->input.i_end_date;
+                p_mi->input.i_end_date = 0;
+                msg_Dbg( p_mi, "transition gap: %"PRId64" ms",
+                         p_mi->input.i_gap / 1000 );
+            }
+            unlock( p_mi );
+        }
         libvlc_event_send( p_mi->p_event_manager, &event );
     }
 
@@ -466,6 +505,10 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     mp->p_libvlc_instance = instance;
     mp->input.p_thread = NULL;
     mp->input.p_resource = NULL;
+    mp->input.p_preload = NULL;
+    mp->input.p_preload_md = NULL;
+    mp->input.i_end_date = 0;
+    mp->input.i_gap = -1;
     vlc_mutex_init (&mp->input.lock);
     mp->i_refcount = 1;
     mp->p_event_manager = libvlc_event_manager_new(mp, instance);
@@ -546,6 +589,7 @@ static void libvlc_media_player_destroy( libvlc_media_player_t *p_mi )
     /* No need for lock_input() because no other threads knows us anymore */
     if( p_mi->input.p_thread )
         release_input_thread(p_mi, true);
+    release_preload( p_mi );
     if( p_mi->input.p_resource )
     {
         input_resource_Terminate( p_mi->input.p_resource );
@@ -613,6 +657,10 @@ void libvlc_media_player_set_media(
                           !p_mi->input.p_thread->b_eof &&
                           !p_mi->input.p_thread->b_error );
 
+    /* Keep the preloaded input only if it is the new media */
+    if( p_md != p_mi->input.p_preload_md )
+        release_preload( p_mi );
+
     lock( p_mi );
     set_state( p_mi, libvlc_NothingSpecial, true );
     unlock_input( p_mi );
@@ -695,6 +743,65 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
         return -1;
     }
 
+    /* Take over the preloaded input if it is still alive */
+    if( p_mi->input.p_preload && p_mi->input.p_preload_md == p_mi->p_md )
+    {
+        p_input_thread = p_mi->input.p_preload;
+        p_mi->input.p_preload = NULL;
+        libvlc_media_release( p_mi->input.p_preload_md );
+        p_mi->input.p_preload_md = NULL;
+        unlock(p_mi);
+
+        var_AddCallback( p_input_thread, "can-seek", input_seekable_changed, p_mi );
+        var_AddCallback( p_input_thread, "can-pause", input_pausable_changed, p_mi );
+        var_AddCallback( p_input_thread, "intf-event", input_event_changed, p_mi );
+
+        if( !p_input_thread->b_error && !input_Activate( p_input_thread ) )
+        {
+            p_mi->input.p_thread = p_input_thread;
+            unlock_input(p_mi);
+
+            /* The state events were sent before the callbacks were added */
+            libvlc_event_t event;
+            set_state( p_mi, libvlc_Playing, false );
+            event.type = libvlc_MediaPlayerPlaying;
+            libvlc_event_send( p_mi->p_event_manager, &event );
+            event.type = libvlc_MediaPlayerSeekableChanged;
+            event.u.media_player_seekable_changed.new_seekable =
+                var_GetBool( p_input_thread, "can-seek" );
+            libvlc_event_send( p_mi->p_event_manager, &event );
+            event.type = libvlc_MediaPlayerPausableChanged;
+            event.u.media_player_pausable_changed.new_pausable =
+                var_GetBool( p_input_thread, "can-pause" );
+            libvlc_event_send( p_mi->p_event_manager, &event );
+            event.type = libvlc_MediaPlayerLengthChanged;
+            event.u.media_player_length_changed.new_length =
+                from_mtime(var_GetTime( p_input_thread, "length" ));
+            libvlc_event_send( p_mi->p_event_manager, &event );
+            return 0;
+        }
+
+        /* It failed or ended meanwhile, open the media again */
+        var_DelCallback( p_input_thread, "intf-event", input_event_changed, p_mi );
+        var_DelCallback( p_input_thread, "can-pause", input_pausable_changed, p_mi );
+        var_DelCallback( p_input_thread, "can-seek", input_seekable_changed, p_mi );
+        input_Stop( p_input_thread, true );
+        input_Close( p_input_thread );
+        lock(p_mi);
+        if( !p_mi->p_md )
+        {
+            unlock(p_mi);
+            unlock_input( p_mi );
+            libvlc_printerr( "No associated media descriptor" );
+            return -1;
+        }
+    }
+
+    /* Not a transition from a preloaded media: do not measure it from the
+     * end of whatever was played before */
+    p_mi->input.i_end_date = 0;
+    p_mi->input.i_gap = -1;
+
     if( !p_mi->input.p_resource )
         p_mi->input.p_resource = input_resource_New( VLC_OBJECT( p_mi ) );
     p_input_thread = input_Create( p_mi, p_mi->p_md->p_input_item, NULL,
@@ -796,11 +903,60 @@ void libvlc_media_player_stop( libvlc_media_player_t *p_mi )
         libvlc_event_send( p_mi->p_event_manager, &event );
     }
 
+    release_preload( p_mi );
     if( p_mi->input.p_resource != NULL )
         input_resource_Terminate( p_mi->input.p_resource );
     unlock_input(p_mi);
 }
 
+/**************************************************************************
+ * Open the next media ahead of time.
+ **************************************************************************/
+int libvlc_media_player_preload( libvlc_media_player_t *p_mi,
+                                 libvlc_media_t *p_md )
+{
+    lock_input( p_mi );
+    if( p_mi->input.p_preload_md == p_md )
+    {
+        unlock_input( p_mi );
+        return 0;
+    }
+    release_preload( p_mi );
+
+    if( !p_mi->input.p_resource )
+        p_mi->input.p_resource = input_resource_New( VLC_OBJECT( p_mi ) );
+    input_thread_t *p_preload = input_CreatePreload( p_mi, p_md->p_input_item,
+                                                     NULL,
+                                                     p_mi->input.p_resource );
+    if( !p_preload || input_Start( p_preload ) )
+    {
+        unlock_input( p_mi );
+        if( p_preload )
+            vlc_object_release( p_preload );
+        libvlc_printerr( "Cannot preload the media" );
+        return -1;
+    }
+
+    libvlc_media_retain( p_md );
+    p_mi->input.p_preload = p_preload;
+    p_mi->input.p_preload_md = p_md;
+    unlock_input( p_mi );
+    return 0;
+}
+
+/**************************************************************************
+ * Get the duration of the last transition between two media.
+ **************************************************************************/
+libvlc_time_t libvlc_media_player_get_transition_gap(
+                                             libvlc_media_player_t *p_mi )
+{
+    lock( p_mi );
+    const mtime_t i_gap = p_mi->input.i_gap;
+    unlock( p_mi );
+
+    return i_gap >= 0 ? from_mtime( i_gap ) : -1;
+}
+
 
 void libvlc_video_set_callbacks( libvlc_media_player_t *mp,
     void *(*lock_cb) (void *, void **),
@@ -46,6 +46,14 @@ struct libvlc_media_player_t
         input_thread_t   *p_thread;
         input_resource_t *p_resource;
         vlc_mutex_t       lock;
+
+        /* Next media opened ahead of time (see libvlc_media_player_preload) */
+        input_thread_t   *p_preload;
+        libvlc_media_t   *p_preload_md;
+
+        /* Transition between two inputs, protected by object_lock */
+        mtime_t           i_end_date;
+        mtime_t           i_gap;
     } input;
 
     struct libvlc_instance_t * p_libvlc_instance; /* Parent instance */
@@ -34,6 +34,7 @@
 #include <vlc_input.h>
 #include "clock.h"
 #include <assert.h>
+#include <math.h>
 
 /* TODO:
  * - clean up locking once clock code is stable
@@ -74,6 +75,19 @@
  * new_average = (old_average * c_average + new_sample_value) / (c_average +1)
  */
 
+/*
+ * The average lags behind a steady drift of the server clock, and a burst
+ * of late points moves it for as long as they weigh in it. Instead, the
+ * regression fits a line through the (system date, drift) points of the
+ * last CR_REGRESSION_WINDOW: its intercept is the offset and its slope the
+ * drift rate of the server clock. The line is extrapolated to the current
+ * date, so there is no lag.
+ *
+ * The network only ever delays the points, so only the least delayed point
+ * of every CR_REGRESSION_BUCKET is kept: that rejects most of the jitter
+ * and the bursts before the fit.
+ */
+
 
 /*****************************************************************************
  * Constants
@@ -99,6 +113,20 @@
 /* Due to some problems in es_out, we cannot use a large value yet */
 #define CR_BUFFERING_TARGET (100000)
 
+/* Regression: duration of the window and of the buckets in it */
+#define CR_REGRESSION_WINDOW (INT64_C(60000000))
+#define CR_REGRESSION_BUCKET (INT64_C(1000000))
+#define CR_REGRESSION_POINTS (64)
+
+/* Number of buckets below which only the offset is estimated */
+#define CR_REGRESSION_MIN_POINTS (4)
+
+/* Oscillators do not drift by more than that (in ppm) */
+#define CR_REGRESSION_MAX_DRIFT (500.)
+
+/* Period of the drift report in the logs */
+#define CR_REGRESSION_REPORT (INT64_C(10000000))
+
 /*****************************************************************************
  * Structures
  *****************************************************************************/
@@ -135,6 +163,38 @@ static inline clock_point_t clock_point_Create( mtime_t i_stream, mtime_t i_syst
     return p;
 }
 
+/**
+ * This structure holds a windowed linear regression of the drift
+ */
+typedef struct
+{
+    /* Ring of the least delayed (system date relative to the reference,
+     * drift) point of each bucket, and the spread of the drift in it */
+    clock_point_t pts[CR_REGRESSION_POINTS];
+    mtime_t  pi_spread[CR_REGRESSION_POINTS];
+    unsigned i_first;
+    unsigned i_count;
+
+    /* Bucket being filled */
+    bool          b_bucket;
+    mtime_t       i_bucket_start;
+    clock_point_t bucket;
+    mtime_t       i_bucket_max;
+
+    /* drift(x) = f_offset + f_slope * (x - i_origin) */
+    mtime_t i_origin;
+    double  f_offset;
+    double  f_slope;
+
+    /* Quality of the fit */
+    double  f_confidence;
+    mtime_t i_jitter;
+} regression_t;
+static void    RegressionReset( regression_t * );
+static void    RegressionUpdate( regression_t *, mtime_t i_x, mtime_t i_value );
+static void    RegressionFit( regression_t * );
+static mtime_t RegressionGet( const regression_t *, mtime_t i_x );
+
 /* */
 #define INPUT_CLOCK_LATE_COUNT (3)
 
@@ -158,6 +218,10 @@ struct input_clock_t
     mtime_t i_next_drift_update;
     average_t drift;
 
+    /* Clock drift estimated by regression, if not NULL */
+    regression_t *p_regression;
+    mtime_t       i_next_report;
+
     /* Late statistics */
     struct
     {
@@ -184,16 +248,30 @@ static mtime_t ClockStreamToSystem( input_clock_t *, mtime_t i_stream );
 static mtime_t ClockSystemToStream( input_clock_t *, mtime_t i_system );
 
 static mtime_t ClockGetTsOffset( input_clock_t * );
+static mtime_t ClockGetDrift( input_clock_t * );
 
 /*****************************************************************************
  * input_clock_New: create a new clock
  *****************************************************************************/
-input_clock_t *input_clock_New( int i_rate )
+input_clock_t *input_clock_New( int i_rate, bool b_regression )
 {
     input_clock_t *cl = malloc( sizeof(*cl) );
     if( !cl )
         return NULL;
 
+    cl->p_regression = NULL;
+    if( b_regression )
+    {
+        cl->p_regression = malloc( sizeof(*cl->p_regression) );
+        if( !cl->p_regression )
+        {
+            free( cl );
+            return NULL;
+        }
+        RegressionReset( cl->p_regression );
+    }
+    cl->i_next_report = VLC_TS_INVALID;
+
     vlc_mutex_init( &cl->lock );
     cl->b_has_reference = false;
     cl->ref = clock_point_Create( VLC_TS_INVALID, VLC_TS_INVALID );
@@ -226,6 +304,7 @@ input_clock_t *input_clock_New( int i_rate )
 void input_clock_Delete( input_clock_t *cl )
 {
     AvgClean( &cl->drift );
+    free( cl->p_regression );
     vlc_mutex_destroy( &cl->lock );
     free( cl );
 }
@@ -272,6 +351,8 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         cl->i_next_drift_update = VLC_TS_INVALID;
         AvgReset( &cl->drift );
+        if( cl->p_regression )
+            RegressionReset( cl->p_regression );
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -282,7 +363,25 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* Compute the drift between the stream clock and the system clock
      * when we don't control the source pace */
-    if( !b_can_pace_control && cl->i_next_drift_update < i_ck_system )
+    if( !b_can_pace_control && cl->p_regression )
+    {
+        /* Every point counts, as the least delayed ones are kept */
+        const mtime_t i_converted = ClockSystemToStream( cl, i_ck_system );
+
+        RegressionUpdate( cl->p_regression, i_ck_system - cl->ref.i_system,
+                          i_converted - i_ck_stream );
+
+        if( cl->i_next_report < i_ck_system )
+        {
+            if( cl->i_next_report > VLC_TS_INVALID )
+                msg_Dbg( p_log, "clock drift %.1f ppm, jitter %d ms, "
+                         "confidence %.2f", -1000000. * cl->p_regression->f_slope,
+                         (int)(cl->p_regression->i_jitter / 1000),
+                         cl->p_regression->f_confidence );
+            cl->i_next_report = i_ck_system + CR_REGRESSION_REPORT;
+        }
+    }
+    else if( !b_can_pace_control && cl->i_next_drift_update < i_ck_system )
     {
         const mtime_t i_converted = ClockSystemToStream( cl, i_ck_system );
 
@@ -314,7 +413,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* It does not take the decoder latency into account but it is not really
      * the goal of the clock here */
-    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + AvgGet( &cl->drift ) );
+    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + ClockGetDrift( cl ) );
     const mtime_t i_late = ( i_ck_system - cl->i_pts_delay ) - i_system_expected;
     *pb_late = i_late > 0;
     if( i_late > 0 )
@@ -394,7 +493,7 @@ mtime_t input_clock_GetWakeup( input_clock_t *cl )
 
     /* Synchronized, we can wait */
     if( cl->b_has_reference )
-        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + AvgGet( &cl->drift ) - cl->i_buffering_duration );
+        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + ClockGetDrift( cl ) - cl->i_buffering_duration );
 
     vlc_mutex_unlock( &cl->lock );
 
@@ -430,7 +529,7 @@ int input_clock_ConvertTS( input_clock_t *cl,
     /* */
     if( *pi_ts0 > VLC_TS_INVALID )
     {
-        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + AvgGet( &cl->drift ) );
+        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + ClockGetDrift( cl ) );
         if( *pi_ts0 > cl->i_ts_max )
             cl->i_ts_max = *pi_ts0;
         *pi_ts0 += i_ts_delay;
@@ -439,7 +538,7 @@ int input_clock_ConvertTS( input_clock_t *cl,
     /* XXX we do not ipdate i_ts_max on purpose */
     if( pi_ts1 && *pi_ts1 > VLC_TS_INVALID )
     {
-        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + AvgGet( &cl->drift ) ) +
+        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + ClockGetDrift( cl ) ) +
                   i_ts_delay;
     }
 
@@ -590,6 +689,26 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+int input_clock_GetDrift( input_clock_t *cl, double *pf_ppm,
+                          double *pf_confidence, mtime_t *pi_jitter )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    if( !cl->p_regression || !cl->b_has_reference )
+    {
+        vlc_mutex_unlock( &cl->lock );
+        return VLC_EGENERIC;
+    }
+
+    /* The drift grows when the stream clock is slower than the system one */
+    *pf_ppm = -1000000. * cl->p_regression->f_slope;
+    *pf_confidence = cl->p_regression->f_confidence;
+    *pi_jitter = cl->p_regression->i_jitter;
+
+    vlc_mutex_unlock( &cl->lock );
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
@@ -623,6 +742,17 @@ static mtime_t ClockGetTsOffset( input_clock_t *cl )
     return cl->i_pts_delay * ( cl->i_rate - INPUT_RATE_DEFAULT ) / INPUT_RATE_DEFAULT;
 }
 
+/**
+ * It returns the drift to add to a stream date, at the last clock point
+ */
+static mtime_t ClockGetDrift( input_clock_t *cl )
+{
+    if( cl->p_regression )
+        return RegressionGet( cl->p_regression,
+                              cl->last.i_system - cl->ref.i_system );
+    return AvgGet( &cl->drift );
+}
+
 /*****************************************************************************
  * Long term average helpers
  *****************************************************************************/
@@ -665,3 +795,117 @@ static void AvgRescale( average_t *p_avg, int i_divider )
     p_avg->i_value   = i_tmp / p_avg->i_divider;
     p_avg->i_residue = i_tmp % p_avg->i_divider;
 }
+
+/*****************************************************************************
+ * Windowed linear regression helpers
+ *****************************************************************************/
+static void RegressionReset( regression_t *p_reg )
+{
+    p_reg->i_first = 0;
+    p_reg->i_count = 0;
+    p_reg->b_bucket = false;
+    p_reg->i_origin = 0;
+    p_reg->f_offset = 0.;
+    p_reg->f_slope = 0.;
+    p_reg->f_confidence = 0.;
+    p_reg->i_jitter = 0;
+}
+static void RegressionUpdate( regression_t *p_reg, mtime_t i_x, mtime_t i_value )
+{
+    if( p_reg->b_bucket && i_x - p_reg->i_bucket_start < CR_REGRESSION_BUCKET )
+    {
+        if( i_value < p_reg->bucket.i_stream )
+            p_reg->bucket = clock_point_Create( i_value, i_x );
+        if( i_value > p_reg->i_bucket_max )
+            p_reg->i_bucket_max = i_value;
+    }
+    else
+    {
+        if( p_reg->b_bucket )
+        {
+            /* Forget the buckets out of the window */
+            while( p_reg->i_count > 0 &&
+                   ( p_reg->i_count == CR_REGRESSION_POINTS ||
+                     i_x - p_reg->pts[p_reg->i_first].i_system > CR_REGRESSION_WINDOW ) )
+            {
+                p_reg->i_first = ( p_reg->i_first + 1 ) % CR_REGRESSION_POINTS;
+                p_reg->i_count--;
+            }
+            const unsigned i_last = ( p_reg->i_first + p_reg->i_count ) % CR_REGRESSION_POINTS;
+            p_reg->pts[i_last] = p_reg->bucket;
+            p_reg->pi_spread[i_last] = p_reg->i_bucket_max - p_reg->bucket.i_stream;
+            p_reg->i_count++;
+
+            RegressionFit( p_reg );
+        }
+        p_reg->b_bucket = true;
+        p_reg->i_bucket_start = i_x;
+        p_reg->bucket = clock_point_Create( i_value, i_x );
+        p_reg->i_bucket_max = i_value;
+    }
+
+    /* Until there is a line, follow the bucket being filled */
+    if( p_reg->i_count < 2 )
+    {
+        p_reg->i_origin = p_reg->bucket.i_system;
+        p_reg->f_offset = p_reg->bucket.i_stream;
+    }
+}
+static void RegressionFit( regression_t *p_reg )
+{
+    const unsigned n = p_reg->i_count;
+    const mtime_t i_x0 = p_reg->pts[p_reg->i_first].i_system;
+
+    /* Least squares, centered on the mean date for the precision */
+    double f_sum_x = 0., f_sum_y = 0., f_sum_spread = 0.;
+    for( unsigned i = 0; i < n; i++ )
+    {
+        const unsigned j = ( p_reg->i_first + i ) % CR_REGRESSION_POINTS;
+        f_sum_x += p_reg->pts[j].i_system - i_x0;
+        f_sum_y += p_reg->pts[j].i_stream;
+        f_sum_spread += p_reg->pi_spread[j];
+    }
+    const double f_mean_x = f_sum_x / n;
+    const double f_mean_y = f_sum_y / n;
+
+    double f_sxx = 0., f_sxy = 0.;
+    for( unsigned i = 0; i < n; i++ )
+    {
+        const unsigned j = ( p_reg->i_first + i ) % CR_REGRESSION_POINTS;
+        const double f_dx = p_reg->pts[j].i_system - i_x0 - f_mean_x;
+        f_sxx += f_dx * f_dx;
+        f_sxy += f_dx * ( p_reg->pts[j].i_stream - f_mean_y );
+    }
+
+    p_reg->i_origin = i_x0 + (mtime_t)f_mean_x;
+    p_reg->f_offset = f_mean_y;
+    p_reg->f_slope = 0.;
+    p_reg->f_confidence = 0.;
+    p_reg->i_jitter = f_sum_spread / n;
+
+    if( n < CR_REGRESSION_MIN_POINTS || f_sxx <= 0. )
+        return;
+
+    const double f_max = CR_REGRESSION_MAX_DRIFT / 1000000.;
+    p_reg->f_slope = __MIN( __MAX( f_sxy / f_sxx, -f_max ), f_max );
+
+    /* The confidence falls as the standard error on the slope reaches the
+     * maximal drift, and grows as the window fills */
+    double f_ssr = 0.;
+    for( unsigned i = 0; i < n; i++ )
+    {
+        const unsigned j = ( p_reg->i_first + i ) % CR_REGRESSION_POINTS;
+        const double f_r = p_reg->pts[j].i_stream - f_mean_y -
+                           p_reg->f_slope * ( p_reg->pts[j].i_system - i_x0 - f_mean_x );
+        f_ssr += f_r * f_r;
+    }
+    const double f_error = sqrt( f_ssr / ( n - 2 ) / f_sxx );
+    const mtime_t i_span = p_reg->pts[(p_reg->i_first + n - 1) % CR_REGRESSION_POINTS].i_system - i_x0;
+
+    p_reg->f_confidence = ( 1. - __MIN( f_error / f_max, 1. ) ) *
+                          __MIN( (double)i_span / CR_REGRESSION_WINDOW, 1. );
+}
+static mtime_t RegressionGet( const regression_t *p_reg, mtime_t i_x )
+{
+    return p_reg->f_offset + p_reg->f_slope * ( i_x - p_reg->i_origin );
+}
@@ -39,8 +39,11 @@ typedef struct input_clock_t input_clock_t;
 /**
  * This function creates a new input_clock_t.
  * You must use input_clock_Delete to delete it once unused.
+ *
+ * \param b_regression tells to estimate the drift by linear regression
+ * instead of a running average.
  */
-input_clock_t *input_clock_New( int i_rate );
+input_clock_t *input_clock_New( int i_rate, bool b_regression );
 
 /**
  * This function destroys a input_clock_t created by input_clock_New.
@@ -135,4 +138,14 @@ void input_clock_SetJitter( input_clock_t *,
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function returns the drift of the stream clock against the system
+ * clock (in ppm), the confidence of this estimation (between 0 and 1) and
+ * the reception jitter left once the drift is removed.
+ * It returns VLC_EGENERIC if the clock does not use the regression or has no
+ * reference point.
+ */
+int input_clock_GetDrift( input_clock_t *, double *pf_ppm,
+                          double *pf_confidence, mtime_t *pi_jitter );
+
 #endif
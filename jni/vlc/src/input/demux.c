@@ -34,6 +34,7 @@
 
 static bool SkipID3Tag( demux_t * );
 static bool SkipAPETag( demux_t *p_demux );
+static char *DemuxSniff( demux_t *, const char *psz_ext_module );
 
 /* Decode URL (which has had its scheme stripped earlier) to a file path. */
 /* XXX: evil code duplication from access.c */
@@ -185,9 +186,24 @@ demux_t *demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input,
           ;
         SkipAPETag( p_demux );
 
-        p_demux->p_module =
-            module_need( p_demux, "demux", psz_module,
-                         !strcmp( psz_module, p_demux->psz_demux ) );
+        /* Try the demuxers matching the content first, then all the others
+         * as usual */
+        char *psz_sniffed = NULL;
+        if( *p_demux->psz_demux == '\0' )
+            psz_sniffed = DemuxSniff( p_demux, psz_module );
+
+        if( psz_sniffed != NULL )
+        {
+            if( !b_quick )
+                msg_Dbg( p_obj, "trying demux '%s' first", psz_sniffed );
+            p_demux->p_module =
+                module_need( p_demux, "demux", psz_sniffed, false );
+            free( psz_sniffed );
+        }
+        else
+            p_demux->p_module =
+                module_need( p_demux, "demux", psz_module,
+                             !strcmp( psz_module, p_demux->psz_demux ) );
     }
     else
     {
@@ -232,6 +248,43 @@ input_thread_t * demux_GetParentInput( demux_t *p_demux )
     return p_demux->p_input ? vlc_object_hold((vlc_object_t*)p_demux->p_input) : NULL;
 }
 
+/*****************************************************************************
+ * demux_NewChained:
+ *****************************************************************************/
+demux_t *demux_NewChained( demux_t *p_demux, const char *psz_demux,
+                           const char *psz_url, stream_t *s, es_out_t *out )
+{
+    /* The access only tells the demuxer where the stream comes from */
+    const char *psz_location = strstr( psz_url, "://" );
+    char *psz_access;
+
+    if( psz_location != NULL )
+    {
+        psz_access = strndup( psz_url, psz_location - psz_url );
+        psz_location += 3;
+    }
+    else
+    {
+        psz_access = strdup( "file" );
+        psz_location = psz_url;
+    }
+    if( psz_access == NULL )
+        return NULL;
+
+    demux_t *p_chained = demux_New( VLC_OBJECT(p_demux), p_demux->p_input,
+                                    psz_access,
+                                    psz_demux, psz_location, s, out, false );
+    free( psz_access );
+    return p_chained;
+}
+
+/*****************************************************************************
+ * demux_DeleteChained:
+ *****************************************************************************/
+void demux_DeleteChained( demux_t *p_chained )
+{
+    demux_Delete( p_chained );
+}
 
 /*****************************************************************************
  * demux_vaControlHelper:
@@ -435,3 +488,151 @@ static bool SkipAPETag( demux_t *p_demux )
     return true;
 }
 
+
+/*****************************************************************************
+ * DemuxSniff: guesses the demuxers from the first bytes of the stream
+ *****************************************************************************
+ * Only strong signatures are used: the matching demuxers are tried first but
+ * not forced, so that they still check the content themselves. WAV is left
+ * out as it may carry raw A52 or DTS that the ES demuxer takes.
+ *****************************************************************************/
+#define DEMUX_SNIFF_SIZE 512
+
+static const char *SniffSignature( const uint8_t *p, int i_peek )
+{
+    static const struct
+    {
+        int     i_offset;
+        uint8_t i_size;
+        char    sig[15];
+        char    demux[9];
+    } signatures[] =
+    {
+        {  0,  4, "\x1A\x45\xDF\xA3",  "mkv" },
+        {  4,  4, "ftyp",              "mp4" },
+        {  4,  4, "moov",              "mp4" },
+        {  4,  4, "mdat",              "mp4" },
+        {  0,  4, "OggS",              "ogg" },
+        {  0,  4, "fLaC",              "flac" },
+        {  0,  8, "\x30\x26\xB2\x75\x8E\x66\xCF\x11", "asf" },
+        {  8,  4, "AVI ",              "avi" },
+        {  8,  4, "AIFF",              "aiff" },
+        {  8,  4, "AIFC",              "aiff" },
+        {  0,  4, "\x00\x00\x01\xBA",  "ps" },
+        {  0,  4, "\x00\x00\x01\xB3",  "mpgv" },
+        {  0,  4, ".RMF",              "rm" },
+        {  0,  4, "NSVf",              "nsv" },
+        {  0,  4, "NSVs",              "nsv" },
+        {  0,  4, ".snd",              "au" },
+        {  0,  4, "MThd",              "smf" },
+        {  0,  4, "BBCD",              "dirac" },
+        {  0,  4, "TTA1",              "tta" },
+        {  0,  4, "MPCK",              "mpc" },
+        {  0,  3, "MP+",               "mpc" },
+        {  0,  3, "FLV",               "avformat" },
+        {  0, 15, "Creative Voice ",   "voc" },
+        {  0,  3, "\xFF\xD8\xFF",      "image" },
+        {  0,  4, "\x89PNG",            "image" },
+    };
+
+    for( unsigned i = 0; i < sizeof(signatures) / sizeof(*signatures); i++ )
+    {
+        if( signatures[i].i_offset + signatures[i].i_size <= i_peek &&
+            !memcmp( &p[signatures[i].i_offset], signatures[i].sig,
+                     signatures[i].i_size ) )
+            return signatures[i].demux;
+    }
+
+    /* MPEG-TS, with 188 or 192 (M2TS) bytes packets */
+    for( int i_start = 0; i_start <= 4; i_start += 4 )
+    {
+        const int i_size = 188 + i_start;
+        if( i_start + 2 * i_size < i_peek &&
+            p[i_start] == 0x47 && p[i_start + i_size] == 0x47 &&
+            p[i_start + 2 * i_size] == 0x47 )
+            return "ts";
+    }
+    return NULL;
+}
+
+static const char *SniffContentType( const char *psz_type )
+{
+    static const struct { char type[30]; char demux[9]; } types[] =
+    {
+        { "video/mp4",                     "mp4" },
+        { "audio/mp4",                     "mp4" },
+        { "video/quicktime",               "mp4" },
+        { "video/webm",                    "mkv" },
+        { "audio/webm",                    "mkv" },
+        { "video/x-matroska",              "mkv" },
+        { "audio/x-matroska",              "mkv" },
+        { "application/ogg",               "ogg" },
+        { "audio/ogg",                     "ogg" },
+        { "video/ogg",                     "ogg" },
+        { "video/mp2t",                    "ts" },
+        { "video/x-flv",                   "avformat" },
+        { "audio/mpeg",                    "mpga" },
+        { "audio/aac",                     "aac" },
+        { "audio/aacp",                    "aac" },
+        { "audio/flac",                    "flac" },
+        { "audio/x-flac",                  "flac" },
+        { "video/x-ms-asf",                "asf" },
+        { "video/x-ms-wmv",                "asf" },
+        { "audio/x-ms-wma",                "asf" },
+        { "application/vnd.apple.mpegurl", "m3u8" },
+        { "application/x-mpegurl",         "m3u8" },
+        { "audio/x-mpegurl",               "m3u" },
+    };
+
+    /* Ignore the parameters, such as the charset */
+    const size_t i_len = strcspn( psz_type, "; " );
+
+    for( unsigned i = 0; i < sizeof(types) / sizeof(*types); i++ )
+        if( strlen( types[i].type ) == i_len &&
+            !strncasecmp( psz_type, types[i].type, i_len ) )
+            return types[i].demux;
+    return NULL;
+}
+
+static char *DemuxSniff( demux_t *p_demux, const char *psz_ext_module )
+{
+    const char *ppsz_found[3] = { NULL, NULL, NULL };
+    unsigned i_found = 0;
+
+    /* The signature, then the MIME type, then the extension */
+    const uint8_t *p_peek;
+    const int i_peek = stream_Peek( p_demux->s, &p_peek, DEMUX_SNIFF_SIZE );
+    if( i_peek > 0 )
+        ppsz_found[i_found] = SniffSignature( p_peek, i_peek );
+    if( ppsz_found[i_found] != NULL )
+        i_found++;
+
+    char *psz_type = stream_ContentType( p_demux->s );
+    if( psz_type != NULL )
+    {
+        ppsz_found[i_found] = SniffContentType( psz_type );
+        if( ppsz_found[i_found] != NULL &&
+            ( i_found == 0 || strcmp( ppsz_found[0], ppsz_found[i_found] ) ) )
+            i_found++;
+        free( psz_type );
+    }
+
+    if( i_found == 0 )
+        return NULL; /* Nothing more than the extension */
+
+    if( *psz_ext_module != '\0' )
+    {
+        bool b_dup = false;
+        for( unsigned i = 0; i < i_found; i++ )
+            b_dup |= !strcmp( ppsz_found[i], psz_ext_module );
+        if( !b_dup )
+            ppsz_found[i_found++] = psz_ext_module;
+    }
+
+    char *psz_list;
+    if( asprintf( &psz_list, "%s%s%s%s%s", ppsz_found[0],
+                  i_found > 1 ? "," : "", i_found > 1 ? ppsz_found[1] : "",
+                  i_found > 2 ? "," : "", i_found > 2 ? ppsz_found[2] : "" ) < 0 )
+        return NULL;
+    return psz_list;
+}
@@ -70,6 +70,10 @@ typedef struct
     /* Clock for this program */
     input_clock_t *p_clock;
 
+    /* First and last PCR received while preloading */
+    mtime_t i_preload_first;
+    mtime_t i_preload_last;
+
     char    *psz_name;
     char    *psz_now_playing;
     char    *psz_publisher;
@@ -100,6 +104,10 @@ struct es_out_id_t
     /* Field for CC track from a master video */
     es_out_id_t *p_master;
 
+    /* Data demuxed while preloading, fed to the decoder once created */
+    block_t     *p_preload;
+    block_t     **pp_preload_last;
+
     /* ID for the meta data */
     int         i_meta_id;
 };
@@ -153,6 +161,7 @@ struct es_out_sys_t
     mtime_t     i_pts_jitter;
     int         i_cr_average;
     int         i_rate;
+    bool        b_clock_regression;
 
     /* */
     bool        b_paused;
@@ -169,6 +178,10 @@ struct es_out_sys_t
 
     /* Record */
     sout_instance_t *p_sout_record;
+
+    /* Preload */
+    bool        b_preload;
+    size_t      i_preload_size;
 };
 
 static es_out_id_t *EsOutAdd    ( es_out_t *, const es_format_t * );
@@ -190,6 +203,7 @@ static void EsOutDecodersChangePause( es_out_t *out, bool b_paused, mtime_t i_da
 static void EsOutProgramChangePause( es_out_t *out, bool b_paused, mtime_t i_date );
 static void EsOutProgramsChangeRate( es_out_t *out );
 static void EsOutDecodersStopBuffering( es_out_t *out, bool b_forced );
+static void EsOutPreloadFlush( es_out_t *out, es_out_id_t *es );
 
 static char *LanguageGetName( const char *psz_code );
 static char *LanguageGetCode( const char *psz_lang );
@@ -317,6 +331,7 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
     p_sys->i_pts_delay = 0;
     p_sys->i_pts_jitter = 0;
     p_sys->i_cr_average = 0;
+    p_sys->b_clock_regression = var_InheritBool( p_input, "clock-regression" );
 
     p_sys->b_buffering = true;
     p_sys->i_buffering_extra_initial = 0;
@@ -326,6 +341,9 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
 
     p_sys->p_sout_record = NULL;
 
+    p_sys->b_preload = false;
+    p_sys->i_preload_size = 0;
+
     return out;
 }
 
@@ -367,6 +385,7 @@ static void EsOutTerminate( es_out_t *out )
     {
         if( p_sys->es[i]->p_dec )
             input_DecoderDelete( p_sys->es[i]->p_dec );
+        EsOutPreloadFlush( out, p_sys->es[i] );
 
         free( p_sys->es[i]->psz_language );
         free( p_sys->es[i]->psz_language_code );
@@ -596,6 +615,17 @@ static void EsOutChangeRate( es_out_t *out, int i_rate )
     EsOutProgramsChangeRate( out );
 }
 
+static void EsOutPreloadFlush( es_out_t *out, es_out_id_t *es )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    for( block_t *p_block = es->p_preload; p_block; p_block = p_block->p_next )
+        p_sys->i_preload_size -= p_block->i_buffer;
+    block_ChainRelease( es->p_preload );
+    es->p_preload = NULL;
+    es->pp_preload_last = &es->p_preload;
+}
+
 static void EsOutChangePosition( es_out_t *out )
 {
     es_out_sys_t      *p_sys = out->p_sys;
@@ -1072,7 +1102,9 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     p_pgrm->psz_name = NULL;
     p_pgrm->psz_now_playing = NULL;
     p_pgrm->psz_publisher = NULL;
-    p_pgrm->p_clock = input_clock_New( p_sys->i_rate );
+    p_pgrm->i_preload_first = VLC_TS_INVALID;
+    p_pgrm->i_preload_last = VLC_TS_INVALID;
+    p_pgrm->p_clock = input_clock_New( p_sys->i_rate, p_sys->b_clock_regression );
     if( !p_pgrm->p_clock )
     {
         free( p_pgrm );
@@ -1532,6 +1564,8 @@ static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
     for( i = 0; i < 4; i++ )
         es->pb_cc_present[i] = false;
     es->p_master = NULL;
+    es->p_preload = NULL;
+    es->pp_preload_last = &es->p_preload;
 
     if( es->p_pgrm == p_sys->p_pgrm )
         EsOutESVarUpdate( out, es, false );
@@ -1593,14 +1627,37 @@ static void EsCreateDecoder( es_out_t *out, es_out_id_t *p_es )
     {
         if( p_sys->b_buffering )
             input_DecoderStartBuffering( p_es->p_dec );
+        /* The decoder holds its output until the es_out is resumed (input
+         * started paused, or ES selected while paused) */
+        if( p_sys->b_paused )
+            input_DecoderChangePause( p_es->p_dec, true, p_sys->i_pause_date );
 
         if( !p_es->p_master && p_sys->p_sout_record )
         {
             p_es->p_dec_record = input_DecoderNew( p_input, &p_es->fmt, p_es->p_pgrm->p_clock, p_sys->p_sout_record );
             if( p_es->p_dec_record && p_sys->b_buffering )
                 input_DecoderStartBuffering( p_es->p_dec_record );
+            if( p_es->p_dec_record && p_sys->b_paused )
+                input_DecoderChangePause( p_es->p_dec_record, true,
+                                          p_sys->i_pause_date );
+        }
+
+        /* Feed the data demuxed ahead while preloading */
+        block_t *p_block = p_es->p_preload;
+        p_es->p_preload = NULL;
+        p_es->pp_preload_last = &p_es->p_preload;
+        while( p_block )
+        {
+            block_t *p_next = p_block->p_next;
+
+            p_block->p_next = NULL;
+            p_sys->i_preload_size -= p_block->i_buffer;
+            input_DecoderDecode( p_es->p_dec, p_block,
+                                 p_input->p->b_out_pace_control );
+            p_block = p_next;
         }
     }
+    EsOutPreloadFlush( out, p_es );
 
     EsOutDecoderChangeDelay( out, p_es );
 }
@@ -1962,6 +2019,14 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
 
     p_block->i_rate = 0;
 
+    if( !es->p_dec && p_sys->b_preload )
+    {
+        /* Keep it for the decoder created on activation */
+        p_sys->i_preload_size += p_block->i_buffer;
+        block_ChainLastAppend( &es->pp_preload_last, p_block );
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_SUCCESS;
+    }
     if( !es->p_dec )
     {
         block_Release( p_block );
@@ -2068,6 +2133,8 @@ static void EsOutDel( es_out_t *out, es_out_id_t *es )
     if( es->p_pgrm == p_sys->p_pgrm )
         EsOutESVarUpdate( out, es, true );
 
+    EsOutPreloadFlush( out, es );
+
     TAB_REMOVE( p_sys->i_es, p_sys->es, es );
 
     /* Update program */
@@ -2200,6 +2267,12 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
             }
             for( int i = 0; i < p_sys->i_es; i++ )
                 EsOutSelect( out, p_sys->es[i], false );
+            /* The data preloaded for the tracks not selected is useless */
+            if( !p_sys->b_preload )
+            {
+                for( int i = 0; i < p_sys->i_es; i++ )
+                    EsOutPreloadFlush( out, p_sys->es[i] );
+            }
             if( i_mode == ES_OUT_MODE_END )
                 EsOutTerminate( out );
             return VLC_SUCCESS;
@@ -2323,6 +2396,15 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
                 return VLC_EGENERIC;
             }
 
+            /* The clock starts on activation, at the first preloaded PCR */
+            if( p_sys->b_preload )
+            {
+                if( p_pgrm->i_preload_first <= VLC_TS_INVALID )
+                    p_pgrm->i_preload_first = i_pcr;
+                p_pgrm->i_preload_last = i_pcr;
+                return VLC_SUCCESS;
+            }
+
             /* TODO do not use mdate() but proper stream acquisition date */
             bool b_late;
             input_clock_Update( p_pgrm->p_clock, VLC_OBJECT(p_sys->p_input),
@@ -2360,6 +2442,15 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
                                  (int)(i_pts_delay/1000) );
                     }
 
+                    /* Tell a drifting server clock from network jitter */
+                    double f_ppm, f_confidence;
+                    mtime_t i_jitter;
+                    if( !input_clock_GetDrift( p_pgrm->p_clock, &f_ppm,
+                                               &f_confidence, &i_jitter ) )
+                        msg_Dbg( p_sys->p_input, "clock drift %.1f ppm "
+                                 "(confidence %.2f), jitter %d ms", f_ppm,
+                                 f_confidence, (int)(i_jitter / 1000) );
+
                     /* Force a rebufferization when we are too late */
 
                     /* It is not really good, as we throw away already buffered data
@@ -2549,6 +2640,51 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
             return VLC_SUCCESS;
         }
 
+        case ES_OUT_SET_PRELOAD:
+        {
+            const bool b_preload = (bool)va_arg( args, int );
+
+            if( b_preload == p_sys->b_preload )
+                return VLC_SUCCESS;
+            p_sys->b_preload = b_preload;
+            if( b_preload )
+                return VLC_SUCCESS;
+
+            /* Start the clocks at the beginning of the data demuxed ahead */
+            EsOutChangePosition( out );
+            for( int i = 0; i < p_sys->i_pgrm; i++ )
+            {
+                es_out_pgrm_t *p_pgrm = p_sys->pgrm[i];
+                bool b_late;
+
+                if( p_pgrm->i_preload_first <= VLC_TS_INVALID )
+                    continue;
+                input_clock_Update( p_pgrm->p_clock, VLC_OBJECT(p_sys->p_input),
+                                    &b_late, true, EsOutIsExtraBufferingAllowed( out ),
+                                    p_pgrm->i_preload_first, mdate() );
+                p_pgrm->i_preload_first = VLC_TS_INVALID;
+                p_pgrm->i_preload_last = VLC_TS_INVALID;
+            }
+            return VLC_SUCCESS;
+        }
+
+        case ES_OUT_GET_PRELOAD:
+        {
+            size_t *pi_size = va_arg( args, size_t * );
+            mtime_t *pi_length = va_arg( args, mtime_t * );
+
+            *pi_size = p_sys->i_preload_size;
+            *pi_length = 0;
+            for( int i = 0; i < p_sys->i_pgrm; i++ )
+            {
+                const es_out_pgrm_t *p_pgrm = p_sys->pgrm[i];
+                if( p_pgrm->i_preload_first > VLC_TS_INVALID )
+                    *pi_length = __MAX( *pi_length, p_pgrm->i_preload_last -
+                                                    p_pgrm->i_preload_first );
+            }
+            return VLC_SUCCESS;
+        }
+
         case ES_OUT_GET_EMPTY:
         {
             bool *pb = va_arg( args, bool* );
@@ -79,6 +79,10 @@ enum es_out_query_private_e
 
     /* Get forced group */
     ES_OUT_GET_GROUP_FORCED,                        /* arg1=int * res=cannot fail */
+
+    /* Keep the data of the ES without decoder, for a preloaded input */
+    ES_OUT_SET_PRELOAD,                             /* arg1=bool                res=cannot fail */
+    ES_OUT_GET_PRELOAD,                             /* arg1=size_t * arg2=mtime_t * res=cannot fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -102,6 +106,17 @@ static inline bool es_out_GetBuffering( es_out_t *p_out )
     assert( !i_ret );
     return b;
 }
+static inline void es_out_SetPreload( es_out_t *p_out, bool b_preload )
+{
+    int i_ret = es_out_Control( p_out, ES_OUT_SET_PRELOAD, b_preload );
+    assert( !i_ret );
+}
+static inline void es_out_GetPreload( es_out_t *p_out, size_t *pi_size,
+                                      mtime_t *pi_length )
+{
+    int i_ret = es_out_Control( p_out, ES_OUT_GET_PRELOAD, pi_size, pi_length );
+    assert( !i_ret );
+}
 static inline bool es_out_GetEmpty( es_out_t *p_out )
 {
     bool b;
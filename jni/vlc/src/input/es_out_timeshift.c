@@ -84,7 +84,7 @@ typedef struct attribute_packed
 {
     es_out_id_t *p_es;
     block_t *p_block;
-    int     i_offset;  /* We do not use file > INT_MAX */
+    int     i_offset;  /* We do not use file > INT_MAX, -1 when kept in memory */
 } ts_cmd_send_t;
 
 typedef struct attribute_packed
@@ -157,6 +157,7 @@ struct ts_storage_t
     ts_storage_t *p_next;
 
     /* */
+    const char *psz_tmp_path; /* Path for the (lazily created) file */
     char    *psz_file;  /* Filename */
     size_t  i_file_max; /* Max size in bytes */
     int64_t i_file_size;/* Current size in bytes */
@@ -182,6 +183,12 @@ typedef struct
     vlc_mutex_t    lock;
     vlc_cond_t     wait;
 
+    /* */
+    int64_t        i_memory_max;
+    int64_t        i_memory_size;
+    bool           b_memory_full;
+    bool           b_file_error;
+
     /* */
     bool           b_paused;
     mtime_t        i_pause_date;
@@ -216,6 +223,7 @@ struct es_out_sys_t
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
+    int64_t        i_memory_max;      /* Maximal size of data kept in memory */
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -255,11 +263,12 @@ static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
 static void         *TsRun( void * );
 
 static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
+static int          TsStorageOpenFile( ts_storage_t * );
 static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStoragePushCmd( ts_storage_t *, ts_cmd_t *p_cmd, bool b_flush );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
 
 static void CmdClean( ts_cmd_t * );
@@ -281,6 +290,9 @@ static int  CmdExecuteSend   ( es_out_t *, ts_cmd_t * );
 static void CmdExecuteDel    ( es_out_t *, ts_cmd_t * );
 static int  CmdExecuteControl( es_out_t *, ts_cmd_t * );
 
+/* */
+static int64_t CmdGetMemorySize( const ts_cmd_t * );
+
 /* File helpers */
 static char *GetTmpPath( char *psz_path );
 static FILE *GetTmpFile( char **ppsz_file, const char *psz_path );
@@ -337,6 +349,12 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
              (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
 
+    const int64_t i_memory_max = var_CreateGetInteger( p_input, "input-timeshift-memory" );
+    p_sys->i_memory_max = __MAX( i_memory_max, 0 );
+    if( p_sys->i_memory_max > 0 )
+        msg_Dbg( p_input, "keeping up to %d KiB of timeshifted data in memory",
+                 (int)(p_sys->i_memory_max/1024) );
+
 #if 0
 #define S(t) msg_Err( p_input, "SIZEOF("#t")=%d", sizeof(t) )
     S(ts_cmd_t);
@@ -754,6 +772,10 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->i_memory_max = p_sys->i_memory_max;
+    p_ts->i_memory_size = 0;
+    p_ts->b_memory_full = false;
+    p_ts->b_file_error = false;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
 
@@ -808,6 +830,20 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
 
+    /* Keep the block in memory (without any copy) as long as we are
+     * under the memory limit, otherwise it will be spilled to the file */
+    const int64_t i_memory = CmdGetMemorySize( p_cmd );
+    if( i_memory > 0 )
+    {
+        const bool b_memory_full = p_ts->i_memory_size + i_memory > p_ts->i_memory_max;
+
+        if( b_memory_full && !p_ts->b_memory_full && p_ts->i_memory_max > 0 )
+            msg_Dbg( p_ts->p_input, "timeshift memory limit reached, using temporary files" );
+        p_ts->b_memory_full = b_memory_full;
+
+        p_cmd->u.send.i_offset = b_memory_full ? 0 : -1;
+    }
+
     if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
     {
         ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
@@ -832,9 +868,19 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
         }
     }
 
-    /* TODO return error and warn the user (but only once) */
+    const bool b_file = i_memory > 0 && p_cmd->u.send.i_offset >= 0;
     TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
 
+    /* The blocks that cannot be written stay in memory, beyond the limit */
+    if( i_memory > 0 && p_cmd->u.send.i_offset < 0 )
+        p_ts->i_memory_size += i_memory;
+    if( b_file && p_cmd->u.send.i_offset < 0 && !p_ts->b_file_error )
+    {
+        msg_Err( p_ts->p_input, "cannot write the timeshift temporary file, "
+                 "keeping the data in memory" );
+        p_ts->b_file_error = true;
+    }
+
     vlc_cond_signal( &p_ts->wait );
 
     vlc_mutex_unlock( &p_ts->lock );
@@ -848,6 +894,12 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 
     TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
 
+    if( p_cmd->i_type == C_SEND && p_cmd->u.send.i_offset < 0 )
+    {
+        p_ts->i_memory_size -= CmdGetMemorySize( p_cmd );
+        assert( p_ts->i_memory_size >= 0 );
+    }
+
     while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
     {
         ts_storage_t *p_next = p_ts->p_storage_r->p_next;
@@ -1062,12 +1114,13 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     /* */
     p_storage->p_next = NULL;
 
-    /* */
+    /* The file is only created when the first block is written into it */
+    p_storage->psz_tmp_path = psz_tmp_path;
+    p_storage->psz_file = NULL;
     p_storage->i_file_max = i_tmp_size_max;
     p_storage->i_file_size = 0;
-    p_storage->p_filew = GetTmpFile( &p_storage->psz_file, psz_tmp_path );
-    if( p_storage->psz_file )
-        p_storage->p_filer = vlc_fopen( p_storage->psz_file, "rb" );
+    p_storage->p_filew = NULL;
+    p_storage->p_filer = NULL;
 
     /* */
     p_storage->i_cmd_w = 0;
@@ -1076,13 +1129,37 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->p_cmd = malloc( p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
     //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
 
-    if( !p_storage->p_cmd || !p_storage->p_filew || !p_storage->p_filer )
+    if( !p_storage->p_cmd )
     {
         TsStorageDelete( p_storage );
         return NULL;
     }
     return p_storage;
 }
+static int TsStorageOpenFile( ts_storage_t *p_storage )
+{
+    if( p_storage->p_filew )
+        return VLC_SUCCESS;
+
+    p_storage->p_filew = GetTmpFile( &p_storage->psz_file, p_storage->psz_tmp_path );
+    if( p_storage->psz_file )
+        p_storage->p_filer = vlc_fopen( p_storage->psz_file, "rb" );
+
+    if( !p_storage->p_filew || !p_storage->p_filer )
+    {
+        /* So that the next block tries again from scratch */
+        if( p_storage->p_filew )
+        {
+            fclose( p_storage->p_filew );
+            vlc_unlink( p_storage->psz_file );
+        }
+        free( p_storage->psz_file );
+        p_storage->p_filew = NULL;
+        p_storage->psz_file = NULL;
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
 static void TsStorageDelete( ts_storage_t *p_storage )
 {
     while( p_storage->i_cmd_r < p_storage->i_cmd_w )
@@ -1122,7 +1199,8 @@ static void TsStoragePack( ts_storage_t *p_storage )
 }
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
-    if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
+    if( p_cmd && p_cmd->i_type == C_SEND && p_cmd->u.send.i_offset >= 0 &&
+        p_storage->i_cmd_w > 0 )
     {
         size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
 
@@ -1135,38 +1213,37 @@ static bool TsStorageIsEmpty( ts_storage_t *p_storage )
 {
     return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
 }
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
+/* If the block cannot be written, it is kept in memory and the offset of
+ * p_cmd is set to -1 */
+static void TsStoragePushCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
 {
     ts_cmd_t cmd = *p_cmd;
 
     assert( !TsStorageIsFull( p_storage, p_cmd ) );
 
-    if( cmd.i_type == C_SEND )
+    if( cmd.i_type == C_SEND && cmd.u.send.i_offset >= 0 )
     {
         block_t *p_block = cmd.u.send.p_block;
+        long i_offset = -1;
 
-        cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
-
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
+        if( !TsStorageOpenFile( p_storage ) &&
+            ( i_offset = ftell( p_storage->p_filew ) ) >= 0 &&
+            fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) == 1 &&
+            ( p_block->i_buffer == 0 ||
+              fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) == 1 ) )
         {
+            p_storage->i_file_size += sizeof(*p_block) + p_block->i_buffer;
             block_Release( p_block );
-            return;
+
+            cmd.u.send.p_block = NULL;
+            cmd.u.send.i_offset = i_offset;
+            if( b_flush )
+                fflush( p_storage->p_filew );
         }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
+        else
         {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
+            cmd.u.send.i_offset = p_cmd->u.send.i_offset = -1;
         }
-        p_storage->i_file_size += p_block->i_buffer;
-        block_Release( p_block );
-
-        if( b_flush )
-            fflush( p_storage->p_filew );
     }
     p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
 }
@@ -1175,7 +1252,7 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     assert( !TsStorageIsEmpty( p_storage ) );
 
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
-    if( p_cmd->i_type == C_SEND )
+    if( p_cmd->i_type == C_SEND && p_cmd->u.send.i_offset >= 0 )
     {
         block_t block;
 
@@ -1263,6 +1340,12 @@ static void CmdInitSend( ts_cmd_t *p_cmd, es_out_id_t *p_es, block_t *p_block )
     p_cmd->u.send.p_es = p_es;
     p_cmd->u.send.p_block = p_block;
 }
+static int64_t CmdGetMemorySize( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type != C_SEND || !p_cmd->u.send.p_block )
+        return 0;
+    return sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+}
 static int CmdExecuteSend( es_out_t *p_out, ts_cmd_t *p_cmd )
 {
     block_t *p_block = p_cmd->u.send.p_block;
@@ -66,11 +66,11 @@ void input_SendEventPosition( input_thread_t *p_input, double f_position, mtime_
 
     /* */
     val.f_float = f_position;
-    var_Change( p_input, "position", VLC_VAR_SETVALUE, &val, NULL );
+    var_StoreHandle( p_input, p_input->p->p_var_position, val );
 
     /* */
     val.i_time = i_time;
-    var_Change( p_input, "time", VLC_VAR_SETVALUE, &val, NULL );
+    var_StoreHandle( p_input, p_input->p->p_var_time, val );
 
     Trigger( p_input, INPUT_EVENT_POSITION );
 }
@@ -79,13 +79,13 @@ void input_SendEventLength( input_thread_t *p_input, mtime_t i_length )
     vlc_value_t val;
 
     /* FIXME ugly + what about meta change event ? */
-    if( var_GetTime( p_input, "length" ) == i_length )
+    if( var_GetTimeHandle( p_input, p_input->p->p_var_length ) == i_length )
         return;
 
     input_item_SetDuration( p_input->p->p_item, i_length );
 
     val.i_time = i_length;
-    var_Change( p_input, "length", VLC_VAR_SETVALUE, &val, NULL );
+    var_StoreHandle( p_input, p_input->p->p_var_length, val );
 
     Trigger( p_input, INPUT_EVENT_LENGTH );
 }
@@ -330,7 +330,9 @@ void input_SendEventBookmark( input_thread_t *p_input )
  *****************************************************************************/
 static void Trigger( input_thread_t *p_input, int i_type )
 {
-    var_SetInteger( p_input, "intf-event", i_type );
+    /* There is no event while preparsing */
+    if( p_input->p->p_var_intf_event )
+        var_SetIntegerHandle( p_input, p_input->p->p_var_intf_event, i_type );
 }
 static void VarListAdd( input_thread_t *p_input,
                         const char *psz_variable, int i_event,
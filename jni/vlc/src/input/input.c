@@ -47,6 +47,7 @@
 
 #include <vlc_sout.h>
 #include "../stream_output/stream_output.h"
+#include "../misc/variables.h"
 
 #include <vlc_dialog.h>
 #include <vlc_url.h>
@@ -67,9 +68,13 @@ static void Destructor( input_thread_t * p_input );
 static  void *Run            ( void * );
 
 static input_thread_t * Create  ( vlc_object_t *, input_item_t *,
-                                  const char *, bool, input_resource_t * );
+                                  const char *, bool, input_resource_t *,
+                                  bool );
 static  int             Init    ( input_thread_t *p_input );
 static void             End     ( input_thread_t *p_input );
+static  int             Preload ( input_thread_t *p_input );
+static void             InitPrograms( input_thread_t *p_input );
+static bool             OwnsResource( input_thread_t *p_input );
 static void             MainLoop( input_thread_t *p_input, bool b_interactive );
 
 static void ObjectKillChildrens( input_thread_t *, vlc_object_t * );
@@ -78,6 +83,7 @@ static inline int ControlPop( input_thread_t *, int *, vlc_value_t *, mtime_t i_
 static void       ControlRelease( int i_type, vlc_value_t val );
 static bool       ControlIsSeekRequest( int i_type );
 static bool       Control( input_thread_t *, int, vlc_value_t );
+static void       ControlPause( input_thread_t *, mtime_t );
 
 static int  UpdateTitleSeekpointFromAccess( input_thread_t * );
 static void UpdateGenericFromAccess( input_thread_t * );
@@ -134,7 +140,41 @@ input_thread_t *input_Create( vlc_object_t *p_parent,
                               input_item_t *p_item,
                               const char *psz_log, input_resource_t *p_resource )
 {
-    return Create( p_parent, p_item, psz_log, false, p_resource );
+    return Create( p_parent, p_item, psz_log, false, p_resource, false );
+}
+
+#undef input_CreatePreload
+/**
+ * Create a new input_thread_t which opens its item and demuxes its first
+ * seconds once started, but does not decode nor output anything until
+ * input_Activate() is called.
+ *
+ * It is meant to open the next item of a playlist while the current one is
+ * still playing, with the same input resource. It cannot be used with a
+ * stream output.
+ *
+ * \see input_Create
+ */
+input_thread_t *input_CreatePreload( vlc_object_t *p_parent,
+                                     input_item_t *p_item,
+                                     const char *psz_log,
+                                     input_resource_t *p_resource )
+{
+    input_thread_t *p_input = Create( p_parent, p_item, psz_log, false,
+                                      p_resource, true );
+    if( !p_input )
+        return NULL;
+
+    /* The stream output cannot be shared with the current input */
+    char *psz_sout = var_GetNonEmptyString( p_input, "sout" );
+    if( psz_sout )
+    {
+        msg_Dbg( p_input, "cannot preload with a stream output" );
+        free( psz_sout );
+        vlc_object_release( p_input );
+        return NULL;
+    }
+    return p_input;
 }
 
 #undef input_CreateAndStart
@@ -168,7 +208,7 @@ input_thread_t *input_CreateAndStart( vlc_object_t *p_parent,
  */
 int input_Read( vlc_object_t *p_parent, input_item_t *p_item )
 {
-    input_thread_t *p_input = Create( p_parent, p_item, NULL, false, NULL );
+    input_thread_t *p_input = Create( p_parent, p_item, NULL, false, NULL, false );
     if( !p_input )
         return VLC_EGENERIC;
 
@@ -195,7 +235,7 @@ int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item )
     input_thread_t *p_input;
 
     /* Allocate descriptor */
-    p_input = Create( p_parent, p_item, NULL, true, NULL );
+    p_input = Create( p_parent, p_item, NULL, true, NULL, false );
     if( !p_input )
         return VLC_EGENERIC;
 
@@ -228,6 +268,32 @@ int input_Start( input_thread_t *p_input )
     return VLC_SUCCESS;
 }
 
+/**
+ * Let an input created by input_CreatePreload decode and output its item.
+ *
+ * The input previously using the same resource should be stopped first, so
+ * that its video and audio outputs are reused.
+ *
+ * \param the preloaded input thread
+ * \return VLC_SUCCESS, or VLC_EGENERIC if the input has already ended
+ */
+int input_Activate( input_thread_t *p_input )
+{
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_input->p->lock_control );
+    if( p_input->p->i_preload == PRELOAD_WAITING )
+    {
+        input_resource_SetInput( p_input->p->p_resource, p_input );
+        p_input->p->i_preload = PRELOAD_NONE;
+        vlc_cond_signal( &p_input->p->wait_control );
+        i_ret = VLC_SUCCESS;
+    }
+    vlc_mutex_unlock( &p_input->p->lock_control );
+
+    return i_ret;
+}
+
 /**
  * Request a running input thread to stop and die
  *
@@ -313,7 +379,7 @@ static void ObjectKillChildrens( input_thread_t *p_input, vlc_object_t *p_obj )
  *****************************************************************************/
 static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
                                const char *psz_header, bool b_quick,
-                               input_resource_t *p_resource )
+                               input_resource_t *p_resource, bool b_preload )
 {
     input_thread_t *p_input = NULL;                 /* thread descriptor */
     int i;
@@ -409,7 +475,11 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
         p_input->p->p_resource_private = input_resource_New( VLC_OBJECT( p_input ) );
         p_input->p->p_resource = input_resource_Hold( p_input->p->p_resource_private );
     }
-    input_resource_SetInput( p_input->p->p_resource, p_input );
+    /* A preloaded input gets the resource only once activated */
+    p_input->p->b_preload = b_preload;
+    p_input->p->i_preload = b_preload ? PRELOAD_WAITING : PRELOAD_NONE;
+    if( !b_preload )
+        input_resource_SetInput( p_input->p->p_resource, p_input );
 
     /* Init control buffer */
     vlc_mutex_init( &p_input->p->lock_control );
@@ -423,6 +493,10 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
 
     /* Create Objects variables for public Get and Set */
     input_ControlVarInit( p_input );
+    p_input->p->p_var_position = var_Acquire( p_input, "position" );
+    p_input->p->p_var_time = var_Acquire( p_input, "time" );
+    p_input->p->p_var_length = var_Acquire( p_input, "length" );
+    p_input->p->p_var_intf_event = var_Acquire( p_input, "intf-event" );
 
     /* */
     if( !p_input->b_preparsing )
@@ -517,6 +591,15 @@ static void Destructor( input_thread_t * p_input )
     if( p_input->p->p_es_out_display )
         es_out_Delete( p_input->p->p_es_out_display );
 
+    if( p_input->p->p_var_position )
+        var_Release( p_input, p_input->p->p_var_position );
+    if( p_input->p->p_var_time )
+        var_Release( p_input, p_input->p->p_var_time );
+    if( p_input->p->p_var_length )
+        var_Release( p_input, p_input->p->p_var_length );
+    if( p_input->p->p_var_intf_event )
+        var_Release( p_input, p_input->p->p_var_intf_event );
+
     if( p_input->p->p_resource )
         input_resource_Release( p_input->p->p_resource );
     if( p_input->p->p_resource_private )
@@ -546,12 +629,23 @@ static void *Run( void *obj )
 {
     input_thread_t *p_input = (input_thread_t *)obj;
     const int canc = vlc_savecancel();
+    const mtime_t i_start = mdate();
 
     if( Init( p_input ) )
         goto exit;
 
+    if( p_input->p->b_preload && Preload( p_input ) )
+    {
+        End( p_input );
+        goto exit;
+    }
+
     MainLoop( p_input, true ); /* FIXME it can be wrong (like with VLM) */
 
+    const unsigned i_lookups = var_CountLookups( VLC_OBJECT(p_input) );
+    msg_Dbg( p_input, "%u variable lookups, %.1f per second", i_lookups,
+             i_lookups * (double)CLOCK_FREQ / ( mdate() - i_start + 1 ) );
+
     /* Clean up */
     End( p_input );
 
@@ -569,6 +663,69 @@ exit:
     return NULL;
 }
 
+/*****************************************************************************
+ * Preload: prebuffer an opened input and wait for input_Activate
+ *****************************************************************************/
+/* Amount of data demuxed ahead, in bytes and in stream time */
+#define INPUT_PRELOAD_SIZE      (4 * 1024 * 1024)
+#define INPUT_PRELOAD_LENGTH    (10 * CLOCK_FREQ)
+
+static int Preload( input_thread_t * p_input )
+{
+    es_out_t *p_es_out = p_input->p->p_es_out_display;
+    size_t i_size = 0;
+    mtime_t i_length = 0;
+
+    /* Demux ahead into the es_out, which keeps the data until the decoders
+     * are created on activation. A live source is not read ahead, as its
+     * data would be late once played. */
+    bool b_demux = p_input->p->b_can_pace_control;
+    es_out_SetPreload( p_es_out, true );
+
+    vlc_mutex_lock( &p_input->p->lock_control );
+    while( p_input->p->i_preload == PRELOAD_WAITING &&
+           vlc_object_alive( p_input ) )
+    {
+        if( !b_demux )
+        {
+            vlc_cond_wait( &p_input->p->wait_control, &p_input->p->lock_control );
+            continue;
+        }
+        vlc_mutex_unlock( &p_input->p->lock_control );
+
+        b_demux = demux_Demux( p_input->p->input.p_demux ) > 0;
+        es_out_GetPreload( p_es_out, &i_size, &i_length );
+        if( i_size >= INPUT_PRELOAD_SIZE || i_length >= INPUT_PRELOAD_LENGTH )
+            b_demux = false;
+
+        vlc_mutex_lock( &p_input->p->lock_control );
+    }
+    const bool b_activated = p_input->p->i_preload == PRELOAD_NONE;
+    vlc_mutex_unlock( &p_input->p->lock_control );
+
+    if( !b_activated )
+        return VLC_EGENERIC;
+
+    msg_Dbg( p_input, "activating the preloaded input (%zu bytes, %"PRId64
+             " ms demuxed ahead)", i_size, i_length / 1000 );
+    es_out_SetPreload( p_es_out, false );
+    InitPrograms( p_input );
+    return VLC_SUCCESS;
+}
+
+/* Tells whether the input was bound to its resource. A preloaded input that
+ * was not activated yet cannot be anymore. */
+static bool OwnsResource( input_thread_t * p_input )
+{
+    vlc_mutex_lock( &p_input->p->lock_control );
+    if( p_input->p->i_preload == PRELOAD_WAITING )
+        p_input->p->i_preload = PRELOAD_DROPPED;
+    const bool b_owned = p_input->p->i_preload == PRELOAD_NONE;
+    vlc_mutex_unlock( &p_input->p->lock_control );
+
+    return b_owned;
+}
+
 /*****************************************************************************
  * Main loop: Fill buffers from access, and demux
  *****************************************************************************/
@@ -738,6 +895,14 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
     /* Start the timer */
     stats_TimerStop( p_input, STATS_TIMER_INPUT_LAUNCHING );
 
+    /* The input keeps demuxing while the es_out is buffering, so that it
+     * waits to be resumed with its decoders holding their first frames */
+    if( b_interactive && var_InheritBool( p_input, "start-paused" ) )
+    {
+        msg_Dbg( p_input, "starting paused" );
+        ControlPause( p_input, mdate() );
+    }
+
     while( vlc_object_alive( p_input ) && !p_input->b_error )
     {
         bool b_force_update;
@@ -872,6 +1037,7 @@ static void InitStatistics( input_thread_t * p_input )
         INIT_COUNTER( demux_bitrate, FLOAT, DERIVATIVE );
         INIT_COUNTER( demux_corrupted, INTEGER, COUNTER );
         INIT_COUNTER( demux_discontinuity, INTEGER, COUNTER );
+        INIT_COUNTER( demux_probe, INTEGER, COUNTER );
         INIT_COUNTER( played_abuffers, INTEGER, COUNTER );
         INIT_COUNTER( lost_abuffers, INTEGER, COUNTER );
         INIT_COUNTER( displayed_pictures, INTEGER, COUNTER );
@@ -1279,7 +1445,9 @@ static int Init( input_thread_t * p_input )
         StartTitle( p_input );
         LoadSubtitles( p_input );
         LoadSlaves( p_input );
-        InitPrograms( p_input );
+        /* A preloaded input selects its tracks once activated */
+        if( !p_input->p->b_preload )
+            InitPrograms( p_input );
 
         double f_rate = var_InheritFloat( p_input, "rate" );
         if( f_rate != 0.0 && f_rate != 1.0 )
@@ -1337,10 +1505,13 @@ error:
     es_out_SetMode( p_input->p->p_es_out_display, ES_OUT_MODE_END );
     if( p_input->p->p_resource )
     {
-        if( p_input->p->p_sout )
-            input_resource_RequestSout( p_input->p->p_resource,
-                                         p_input->p->p_sout, NULL );
-        input_resource_SetInput( p_input->p->p_resource, NULL );
+        if( OwnsResource( p_input ) )
+        {
+            if( p_input->p->p_sout )
+                input_resource_RequestSout( p_input->p->p_resource,
+                                             p_input->p->p_sout, NULL );
+            input_resource_SetInput( p_input->p->p_resource, NULL );
+        }
         if( p_input->p->p_resource_private )
             input_resource_Terminate( p_input->p->p_resource_private );
     }
@@ -1357,6 +1528,7 @@ error:
         EXIT_COUNTER( demux_bitrate );
         EXIT_COUNTER( demux_corrupted );
         EXIT_COUNTER( demux_discontinuity );
+        EXIT_COUNTER( demux_probe );
         EXIT_COUNTER( played_abuffers );
         EXIT_COUNTER( lost_abuffers );
         EXIT_COUNTER( displayed_pictures );
@@ -1430,6 +1602,7 @@ static void End( input_thread_t * p_input )
             CL_CO( demux_bitrate );
             CL_CO( demux_corrupted );
             CL_CO( demux_discontinuity );
+            CL_CO( demux_probe );
             CL_CO( played_abuffers );
             CL_CO( lost_abuffers );
             CL_CO( displayed_pictures );
@@ -1459,9 +1632,12 @@ static void End( input_thread_t * p_input )
     vlc_mutex_unlock( &p_input->p->p_item->lock );
 
     /* */
-    input_resource_RequestSout( p_input->p->p_resource,
-                                 p_input->p->p_sout, NULL );
-    input_resource_SetInput( p_input->p->p_resource, NULL );
+    if( OwnsResource( p_input ) )
+    {
+        input_resource_RequestSout( p_input->p->p_resource,
+                                     p_input->p->p_sout, NULL );
+        input_resource_SetInput( p_input->p->p_resource, NULL );
+    }
     if( p_input->p->p_resource_private )
         input_resource_Terminate( p_input->p->p_resource_private );
 }
@@ -2574,12 +2750,25 @@ static int InputSourceInit( input_thread_t *p_input,
             psz_demux = in->p_access->psz_demux;
         }
 
+        const mtime_t i_probe_start = mdate();
         in->p_demux = demux_New( p_input, p_input, psz_access, psz_demux,
                    /* Take access/stream redirections into account: */
                    in->p_stream->psz_path ? in->p_stream->psz_path : psz_path,
                                  in->p_stream, p_input->p->p_es_out,
                                  p_input->b_preparsing );
 
+        if( in->p_demux != NULL && !p_input->b_preparsing &&
+            libvlc_stats( p_input ) )
+        {
+            const mtime_t i_probe = mdate() - i_probe_start;
+
+            msg_Dbg( p_input, "demux found in %d ms", (int)(i_probe / 1000) );
+            vlc_mutex_lock( &p_input->p->counters.counters_lock );
+            stats_UpdateInteger( p_input, p_input->p->counters.p_demux_probe,
+                                 i_probe, NULL );
+            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+        }
+
         if( in->p_demux == NULL )
         {
             if( vlc_object_alive( p_input ) )
@@ -144,6 +144,7 @@ struct input_thread_private_t
         counter_t *p_demux_bitrate;
         counter_t *p_demux_corrupted;
         counter_t *p_demux_discontinuity;
+        counter_t *p_demux_probe;
         counter_t *p_decoded_audio;
         counter_t *p_decoded_video;
         counter_t *p_decoded_sub;
@@ -166,6 +167,24 @@ struct input_thread_private_t
     bool b_abort;
     bool is_running;
     vlc_thread_t thread;
+
+    /* Variables set on every event (see event.c) */
+    var_handle_t *p_var_position;
+    var_handle_t *p_var_time;
+    var_handle_t *p_var_length;
+    var_handle_t *p_var_intf_event;
+
+    /* Preloading (see input_CreatePreload) */
+    bool b_preload;
+    int  i_preload; /* Protected by lock_control */
+};
+
+/* Preloading states */
+enum
+{
+    PRELOAD_NONE,       /* Not preloaded, or activated: owns the resource */
+    PRELOAD_WAITING,    /* Opened, waiting for input_Activate */
+    PRELOAD_DROPPED,    /* Ended without having been activated */
 };
 
 /***************************************************************************
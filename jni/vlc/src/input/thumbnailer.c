@@ -0,0 +1,592 @@
+/*****************************************************************************
+ * thumbnailer.c: keyframe thumbnail extraction without an input thread
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_codec.h>
+#include <vlc_input.h>
+#include <vlc_meta.h>
+#include <vlc_image.h>
+#include <vlc_thumbnailer.h>
+
+#include <assert.h>
+
+#include "demux.h"
+#include "../libvlc.h"
+
+/* Where to look when no time is given, as a fraction of the duration */
+#define THUMBNAIL_POSITION  (1./3.)
+
+/* Give up after that many video blocks or that much time without a
+ * keyframe, so that a broken file cannot hold a worker forever */
+#define THUMBNAIL_MAX_BLOCKS    1500
+#define THUMBNAIL_TIMEOUT       (INT64_C(5000000))
+
+/*****************************************************************************
+ * Decoding: an es_out that feeds the first video ES into a decoder
+ *****************************************************************************/
+struct es_out_id_t
+{
+    bool b_selected;
+};
+
+struct es_out_sys_t
+{
+    vlc_object_t *p_obj;
+    decoder_t    *p_packetizer;
+    decoder_t    *p_dec;
+    picture_t    *p_pic;
+    unsigned      i_blocks;
+};
+
+static picture_t *video_new_buffer( decoder_t *p_dec )
+{
+    p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
+    return picture_NewFromFormat( &p_dec->fmt_out.video );
+}
+
+static void video_del_buffer( decoder_t *p_dec, picture_t *p_pic )
+{
+    (void)p_dec;
+    picture_Release( p_pic );
+}
+
+static void video_link_picture( decoder_t *p_dec, picture_t *p_pic )
+{
+    (void)p_dec;
+    picture_Hold( p_pic );
+}
+
+static void video_unlink_picture( decoder_t *p_dec, picture_t *p_pic )
+{
+    (void)p_dec;
+    picture_Release( p_pic );
+}
+
+static void DeleteDecoder( decoder_t *p_dec )
+{
+    if( p_dec->p_module )
+        module_unneed( p_dec, p_dec->p_module );
+
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+
+    if( p_dec->p_description )
+        vlc_meta_Delete( p_dec->p_description );
+
+    vlc_object_release( p_dec );
+}
+
+static decoder_t *CreateDecoder( vlc_object_t *p_obj, const es_format_t *p_fmt,
+                                 const char *psz_capability,
+                                 const char *psz_module )
+{
+    decoder_t *p_dec = vlc_custom_create( p_obj, sizeof( *p_dec ),
+                                          "thumbnail decoder" );
+    if( p_dec == NULL )
+        return NULL;
+
+    p_dec->p_module = NULL;
+    es_format_Copy( &p_dec->fmt_in, p_fmt );
+    es_format_Init( &p_dec->fmt_out, UNKNOWN_ES, 0 );
+    p_dec->b_pace_control = true;
+
+    p_dec->pf_vout_buffer_new = video_new_buffer;
+    p_dec->pf_vout_buffer_del = video_del_buffer;
+    p_dec->pf_picture_link    = video_link_picture;
+    p_dec->pf_picture_unlink  = video_unlink_picture;
+
+    p_dec->p_module = module_need( p_dec, psz_capability, psz_module, false );
+    if( !p_dec->p_module )
+    {
+        msg_Dbg( p_obj, "no %s for fourcc `%4.4s'", psz_capability,
+                 (char *)&p_fmt->i_codec );
+        DeleteDecoder( p_dec );
+        return NULL;
+    }
+    return p_dec;
+}
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *p_fmt )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    es_out_id_t *id = malloc( sizeof( *id ) );
+    if( !id )
+        return NULL;
+    id->b_selected = false;
+
+    if( p_fmt->i_cat != VIDEO_ES || p_sys->p_dec != NULL )
+        return id;
+
+    es_format_t fmt;
+    es_format_Copy( &fmt, p_fmt );
+    if( !fmt.b_packetized )
+    {
+        p_sys->p_packetizer = CreateDecoder( p_sys->p_obj, &fmt,
+                                             "packetizer", NULL );
+        if( p_sys->p_packetizer )
+        {
+            es_format_Clean( &fmt );
+            es_format_Copy( &fmt, &p_sys->p_packetizer->fmt_out );
+        }
+    }
+    fmt.b_packetized = true;
+
+    /* Prefer avcodec, as it is the one honouring ffmpeg-skip-frame */
+    p_sys->p_dec = CreateDecoder( p_sys->p_obj, &fmt, "decoder",
+                                  "avcodec,any" );
+    es_format_Clean( &fmt );
+
+    if( !p_sys->p_dec && p_sys->p_packetizer )
+    {
+        DeleteDecoder( p_sys->p_packetizer );
+        p_sys->p_packetizer = NULL;
+    }
+    id->b_selected = p_sys->p_dec != NULL;
+    return id;
+}
+
+static void Decode( es_out_sys_t *p_sys, block_t *p_block )
+{
+    decoder_t *p_dec = p_sys->p_dec;
+    picture_t *p_pic;
+
+    while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) != NULL )
+    {
+        if( p_sys->p_pic == NULL )
+            p_sys->p_pic = p_pic;
+        else
+            picture_Release( p_pic );
+    }
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( !id->b_selected || p_sys->p_pic != NULL )
+    {
+        block_Release( p_block );
+        return VLC_SUCCESS;
+    }
+    p_sys->i_blocks++;
+
+    if( !p_sys->p_packetizer )
+    {
+        Decode( p_sys, p_block );
+        return VLC_SUCCESS;
+    }
+
+    decoder_t *p_packetizer = p_sys->p_packetizer;
+    block_t *p_packetized;
+    while( (p_packetized = p_packetizer->pf_packetize( p_packetizer,
+                                                        &p_block )) != NULL )
+    {
+        /* Same as the input decoder: the extradata may only be known once
+         * the packetizer has seen the stream */
+        decoder_t *p_dec = p_sys->p_dec;
+        if( p_packetizer->fmt_out.i_extra && !p_dec->fmt_in.i_extra )
+        {
+            es_format_Clean( &p_dec->fmt_in );
+            es_format_Copy( &p_dec->fmt_in, &p_packetizer->fmt_out );
+        }
+
+        while( p_packetized )
+        {
+            block_t *p_next = p_packetized->p_next;
+            p_packetized->p_next = NULL;
+            Decode( p_sys, p_packetized );
+            p_packetized = p_next;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    (void)out;
+    free( id );
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    (void)out;
+    switch( i_query )
+    {
+    case ES_OUT_GET_ES_STATE:
+    {
+        /* Lets the demuxers skip the tracks that are not decoded */
+        es_out_id_t *id = va_arg( args, es_out_id_t * );
+        *va_arg( args, bool * ) = id->b_selected;
+        return VLC_SUCCESS;
+    }
+    case ES_OUT_GET_EMPTY:
+        *va_arg( args, bool * ) = true;
+        return VLC_SUCCESS;
+    case ES_OUT_GET_PCR_SYSTEM:
+    case ES_OUT_MODIFY_PCR_SYSTEM:
+        return VLC_EGENERIC;
+    default:
+        /* No clock and no selection to manage */
+        return VLC_SUCCESS;
+    }
+}
+
+/*****************************************************************************
+ * Extraction
+ *****************************************************************************/
+static int SeekPosition( demux_t *p_demux, double f_position )
+{
+    return demux_Control( p_demux, DEMUX_SET_POSITION, f_position, false );
+}
+
+static void Seek( demux_t *p_demux, mtime_t i_time )
+{
+    int64_t i_length;
+
+    if( demux_Control( p_demux, DEMUX_GET_LENGTH, &i_length ) )
+        i_length = 0;
+
+    if( i_time < 0 )
+    {
+        if( i_length <= 0 )
+        {
+            SeekPosition( p_demux, THUMBNAIL_POSITION );
+            return;
+        }
+        i_time = i_length * THUMBNAIL_POSITION;
+    }
+
+    if( i_time > 0 &&
+        demux_Control( p_demux, DEMUX_SET_TIME, (int64_t)i_time, false ) &&
+        i_length > 0 && i_time < i_length )
+        SeekPosition( p_demux, (double)i_time / i_length );
+}
+
+/* Fits the visible area, with square pixels, in the requested box */
+static void FitFormat( video_format_t *p_fmt, const video_format_t *p_src,
+                       const video_format_t *p_box )
+{
+    unsigned i_sar_num = p_src->i_sar_num, i_sar_den = p_src->i_sar_den;
+    if( !i_sar_num || !i_sar_den )
+        i_sar_num = i_sar_den = 1;
+
+    const uint64_t i_width = (uint64_t)p_src->i_visible_width * i_sar_num;
+    const uint64_t i_height = (uint64_t)p_src->i_visible_height * i_sar_den;
+    unsigned i_out_width, i_out_height;
+
+    if( i_width * p_box->i_height > i_height * p_box->i_width )
+    {
+        i_out_width = p_box->i_width;
+        i_out_height = i_height * p_box->i_width / i_width;
+    }
+    else
+    {
+        i_out_height = p_box->i_height;
+        i_out_width = i_width * p_box->i_height / i_height;
+    }
+
+    memset( p_fmt, 0, sizeof( *p_fmt ) );
+    p_fmt->i_width = p_fmt->i_visible_width = __MAX( i_out_width & ~1, 2 );
+    p_fmt->i_height = p_fmt->i_visible_height = __MAX( i_out_height & ~1, 2 );
+    p_fmt->i_sar_num = p_fmt->i_sar_den = 1;
+}
+
+/* Scales in the planar YUV domain first, so that the RGB conversion is done
+ * at the final size by the (NEON) yuv2rgb converter when there is one,
+ * since it does not scale */
+static picture_t *Convert( vlc_object_t *p_obj, picture_t *p_pic,
+                           const video_format_t *p_fmt_in,
+                           const video_format_t *p_box )
+{
+    image_handler_t *p_image = image_HandlerCreate( p_obj );
+    if( !p_image )
+        return NULL;
+
+    video_format_t fmt_in = *p_fmt_in, fmt_yuv, fmt_out;
+    fmt_in.i_x_offset = fmt_in.i_y_offset = 0;
+    FitFormat( &fmt_yuv, &fmt_in, p_box );
+    fmt_yuv.i_chroma = VLC_CODEC_I420;
+    fmt_out = fmt_yuv;
+    fmt_out.i_chroma = p_box->i_chroma;
+    if( fmt_out.i_chroma == VLC_CODEC_RGB16 )
+    {
+        fmt_out.i_rmask = 0xf800;
+        fmt_out.i_gmask = 0x07e0;
+        fmt_out.i_bmask = 0x001f;
+    }
+
+    picture_t *p_yuv = image_Convert( p_image, p_pic, &fmt_in, &fmt_yuv );
+    picture_t *p_out = NULL;
+    if( p_yuv )
+    {
+        p_out = image_Convert( p_image, p_yuv, &fmt_yuv, &fmt_out );
+        picture_Release( p_yuv );
+    }
+    image_HandlerDelete( p_image );
+    return p_out;
+}
+
+static picture_t *Extract( vlc_object_t *p_obj, const char *psz_mrl,
+                           mtime_t i_time, const video_format_t *p_box )
+{
+    char *psz_dup = strdup( psz_mrl );
+    if( !psz_dup )
+        return NULL;
+
+    const char *psz_access, *psz_demux;
+    char *psz_path;
+    input_SplitMRL( &psz_access, &psz_demux, &psz_path, psz_dup );
+
+    stream_t *p_stream = stream_UrlNew( p_obj, psz_mrl );
+    if( !p_stream )
+    {
+        free( psz_dup );
+        return NULL;
+    }
+
+    es_out_sys_t sys = { .p_obj = p_obj };
+    es_out_t out = {
+        .pf_add = EsOutAdd, .pf_send = EsOutSend, .pf_del = EsOutDel,
+        .pf_control = EsOutControl, .pf_destroy = NULL, .p_sys = &sys,
+    };
+
+    picture_t *p_pic = NULL;
+    demux_t *p_demux = demux_New( p_obj, NULL, psz_access, psz_demux,
+                                  psz_path, p_stream, &out, true );
+    if( p_demux )
+    {
+        if( sys.p_dec )
+        {
+            const mtime_t i_deadline = mdate() + THUMBNAIL_TIMEOUT;
+
+            Seek( p_demux, i_time );
+            while( !sys.p_pic && sys.i_blocks < THUMBNAIL_MAX_BLOCKS &&
+                   mdate() < i_deadline && demux_Demux( p_demux ) > 0 );
+        }
+        demux_Delete( p_demux );
+    }
+    stream_Delete( p_stream );
+    free( psz_dup );
+
+    if( sys.p_pic )
+    {
+        p_pic = Convert( p_obj, sys.p_pic, &sys.p_dec->fmt_out.video, p_box );
+        picture_Release( sys.p_pic );
+    }
+    if( sys.p_dec )
+        DeleteDecoder( sys.p_dec );
+    if( sys.p_packetizer )
+        DeleteDecoder( sys.p_packetizer );
+    return p_pic;
+}
+
+#undef vlc_thumbnail_Extract
+picture_t *vlc_thumbnail_Extract( vlc_object_t *p_parent, const char *psz_mrl,
+                                  mtime_t i_time, const video_format_t *p_fmt )
+{
+    assert( p_fmt->i_chroma == VLC_CODEC_RGB16 ||
+            p_fmt->i_chroma == VLC_CODEC_RGBA );
+    if( !p_fmt->i_width || !p_fmt->i_height )
+        return NULL;
+
+    vlc_object_t *p_obj = vlc_custom_create( p_parent, sizeof( *p_obj ),
+                                             "thumbnailer" );
+    if( !p_obj )
+        return NULL;
+
+    /* Inherited by the decoder: only the keyframes, each in one thread
+     * since the thumbnails are done in parallel */
+    var_Create( p_obj, "ffmpeg-skip-frame", VLC_VAR_INTEGER );
+    var_SetInteger( p_obj, "ffmpeg-skip-frame", 2 /* AVDISCARD_NONKEY */ );
+    var_Create( p_obj, "ffmpeg-hurry-up", VLC_VAR_BOOL );
+    var_Create( p_obj, "ffmpeg-threads", VLC_VAR_INTEGER );
+    var_SetInteger( p_obj, "ffmpeg-threads", 1 );
+
+    const mtime_t i_start = mdate();
+    picture_t *p_pic = Extract( p_obj, psz_mrl, i_time, p_fmt );
+    msg_Dbg( p_obj, "%s thumbnail of `%s' in %"PRId64" ms",
+             p_pic ? "made" : "no", psz_mrl, ( mdate() - i_start ) / 1000 );
+
+    vlc_object_release( p_obj );
+    return p_pic;
+}
+
+/*****************************************************************************
+ * Worker pool
+ *****************************************************************************/
+typedef struct thumbnail_request_t thumbnail_request_t;
+struct thumbnail_request_t
+{
+    thumbnail_request_t *p_next;
+    char                *psz_mrl;
+    mtime_t              i_time;
+    video_format_t       fmt;
+    vlc_thumbnailer_cb   pf_done;
+    void                *p_data;
+};
+
+struct vlc_thumbnailer_t
+{
+    vlc_object_t        *p_parent;
+    vlc_mutex_t          lock;
+    vlc_cond_t           wait;
+    thumbnail_request_t *p_first;
+    thumbnail_request_t **pp_last;
+    bool                 b_closing;
+
+    unsigned             i_workers;
+    vlc_thread_t         p_workers[];
+};
+
+static void RequestDone( thumbnail_request_t *p_req, picture_t *p_pic )
+{
+    p_req->pf_done( p_req->p_data, p_req->psz_mrl, p_pic );
+    free( p_req->psz_mrl );
+    free( p_req );
+}
+
+static void *Worker( void *data )
+{
+    vlc_thumbnailer_t *p_thumb = data;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_thumb->lock );
+    for( ;; )
+    {
+        while( !p_thumb->p_first && !p_thumb->b_closing )
+            vlc_cond_wait( &p_thumb->wait, &p_thumb->lock );
+        if( p_thumb->b_closing )
+            break;
+
+        thumbnail_request_t *p_req = p_thumb->p_first;
+        p_thumb->p_first = p_req->p_next;
+        if( !p_thumb->p_first )
+            p_thumb->pp_last = &p_thumb->p_first;
+        vlc_mutex_unlock( &p_thumb->lock );
+
+        RequestDone( p_req, vlc_thumbnail_Extract( p_thumb->p_parent,
+                                                   p_req->psz_mrl,
+                                                   p_req->i_time,
+                                                   &p_req->fmt ) );
+
+        vlc_mutex_lock( &p_thumb->lock );
+    }
+    vlc_mutex_unlock( &p_thumb->lock );
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+#undef vlc_thumbnailer_Create
+vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t *p_parent,
+                                           unsigned i_workers )
+{
+    if( i_workers == 0 )
+        i_workers = vlc_GetCPUCount();
+    i_workers = __MIN( i_workers, 8 );
+
+    vlc_thumbnailer_t *p_thumb = malloc( sizeof( *p_thumb ) +
+                                         i_workers * sizeof( vlc_thread_t ) );
+    if( !p_thumb )
+        return NULL;
+
+    p_thumb->p_parent = p_parent;
+    vlc_mutex_init( &p_thumb->lock );
+    vlc_cond_init( &p_thumb->wait );
+    p_thumb->p_first = NULL;
+    p_thumb->pp_last = &p_thumb->p_first;
+    p_thumb->b_closing = false;
+
+    for( p_thumb->i_workers = 0; p_thumb->i_workers < i_workers;
+         p_thumb->i_workers++ )
+    {
+        if( vlc_clone( &p_thumb->p_workers[p_thumb->i_workers], Worker,
+                       p_thumb, VLC_THREAD_PRIORITY_LOW ) )
+            break;
+    }
+
+    if( p_thumb->i_workers == 0 )
+    {
+        vlc_cond_destroy( &p_thumb->wait );
+        vlc_mutex_destroy( &p_thumb->lock );
+        free( p_thumb );
+        return NULL;
+    }
+    msg_Dbg( p_parent, "thumbnailer with %u workers", p_thumb->i_workers );
+    return p_thumb;
+}
+
+int vlc_thumbnailer_Request( vlc_thumbnailer_t *p_thumb, const char *psz_mrl,
+                             mtime_t i_time, const video_format_t *p_fmt,
+                             vlc_thumbnailer_cb pf_done, void *p_data )
+{
+    thumbnail_request_t *p_req = malloc( sizeof( *p_req ) );
+    if( !p_req )
+        return VLC_ENOMEM;
+
+    p_req->psz_mrl = strdup( psz_mrl );
+    if( !p_req->psz_mrl )
+    {
+        free( p_req );
+        return VLC_ENOMEM;
+    }
+    p_req->p_next = NULL;
+    p_req->i_time = i_time;
+    p_req->fmt = *p_fmt;
+    p_req->pf_done = pf_done;
+    p_req->p_data = p_data;
+
+    vlc_mutex_lock( &p_thumb->lock );
+    *p_thumb->pp_last = p_req;
+    p_thumb->pp_last = &p_req->p_next;
+    vlc_cond_signal( &p_thumb->wait );
+    vlc_mutex_unlock( &p_thumb->lock );
+    return VLC_SUCCESS;
+}
+
+void vlc_thumbnailer_Delete( vlc_thumbnailer_t *p_thumb )
+{
+    vlc_mutex_lock( &p_thumb->lock );
+    thumbnail_request_t *p_req = p_thumb->p_first;
+    p_thumb->p_first = NULL;
+    p_thumb->pp_last = &p_thumb->p_first;
+    p_thumb->b_closing = true;
+    vlc_cond_broadcast( &p_thumb->wait );
+    vlc_mutex_unlock( &p_thumb->lock );
+
+    for( unsigned i = 0; i < p_thumb->i_workers; i++ )
+        vlc_join( p_thumb->p_workers[i], NULL );
+
+    while( p_req )
+    {
+        thumbnail_request_t *p_next = p_req->p_next;
+        RequestDone( p_req, NULL );
+        p_req = p_next;
+    }
+
+    vlc_cond_destroy( &p_thumb->wait );
+    vlc_mutex_destroy( &p_thumb->lock );
+    free( p_thumb );
+}
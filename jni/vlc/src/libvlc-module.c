@@ -642,6 +642,13 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define CLOCK_REGRESSION_TEXT N_("Clock drift regression")
+#define CLOCK_REGRESSION_LONGTEXT N_( \
+    "This estimates the drift of the clock of real-time sources with a " \
+    "linear regression over the last minute instead of a running " \
+    "average. It follows a drifting server clock without lag and is less " \
+    "sensitive to bursts of network jitter." )
+
 #define NETSYNC_TEXT N_("Network synchronisation" )
 #define NETSYNC_LONGTEXT N_( "This allows you to remotely " \
         "synchronise clocks for server and client. The detailed settings " \
@@ -741,6 +748,16 @@ static const char *const ppsz_clock_descriptions[] =
 #define RUN_TIME_LONGTEXT N_( \
     "The stream will run this duration (in seconds)." )
 
+#define START_PAUSED_TEXT N_("Start paused")
+#define START_PAUSED_LONGTEXT N_( \
+    "The stream is opened, buffered and its first frames decoded, but it " \
+    "is only played once resumed." )
+
+#define PRELOAD_TIME_TEXT N_("Preload time (s)")
+#define PRELOAD_TIME_LONGTEXT N_( \
+    "How long before the end of the current item the next one of a media " \
+    "list is opened, so that there is no gap in between. 0 disables it." )
+
 #define INPUT_FAST_SEEK_TEXT N_("Fast seek")
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
@@ -784,6 +801,12 @@ static const char *const ppsz_clock_descriptions[] =
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_MEMORY_TEXT N_("Timeshift memory size")
+#define INPUT_TIMESHIFT_MEMORY_LONGTEXT N_( \
+    "This is the maximum size in bytes of the timeshifted data kept " \
+    "in memory. Data are only written to the temporary files once this " \
+    "limit is reached (0 to always use the temporary files)." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -1233,6 +1256,16 @@ static const char *const ppsz_clock_descriptions[] =
     "Automatically preparse files added to the playlist " \
     "(to retrieve some metadata)." )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparser threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of files preparsed at once " \
+    "(0 for one per CPU, up to 4)." )
+
+#define PREPARSE_CACHE_TEXT N_( "Cache the preparsed metadata" )
+#define PREPARSE_CACHE_LONGTEXT N_( \
+    "Remember the duration and tracks of the preparsed local files, " \
+    "so that they are not opened again until they are modified." )
+
 #define ALBUM_ART_TEXT N_( "Album art policy" )
 #define ALBUM_ART_LONGTEXT N_( \
     "Choose how album art will be downloaded." )
@@ -1623,7 +1656,7 @@ vlc_module_begin ()
     add_bool( "audio-replay-gain-peak-protection", true,
               AUDIO_REPLAY_GAIN_PEAK_PROTECTION_TEXT, AUDIO_REPLAY_GAIN_PEAK_PROTECTION_LONGTEXT, true )
 
-    add_bool( "audio-time-stretch", HAVE_FPU,
+    add_bool( "audio-time-stretch", true,
               AUDIO_TIME_STRETCH_TEXT, AUDIO_TIME_STRETCH_LONGTEXT, false )
 
     set_subcategory( SUBCAT_AUDIO_AOUT )
@@ -1853,6 +1886,12 @@ vlc_module_begin ()
     add_float( "run-time", 0,
                RUN_TIME_TEXT, RUN_TIME_LONGTEXT, true )
         change_safe ()
+    add_bool( "start-paused", false,
+              START_PAUSED_TEXT, START_PAUSED_LONGTEXT, true )
+        change_safe ()
+    add_integer( "preload-time", 10,
+                 PRELOAD_TIME_TEXT, PRELOAD_TIME_LONGTEXT, true )
+        change_safe ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
@@ -1932,6 +1971,9 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_bool( "clock-regression", false, CLOCK_REGRESSION_TEXT,
+              CLOCK_REGRESSION_LONGTEXT, true )
+        change_safe()
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
@@ -1945,6 +1987,8 @@ vlc_module_begin ()
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-memory", 0, INPUT_TIMESHIFT_MEMORY_TEXT,
+                 INPUT_TIMESHIFT_MEMORY_LONGTEXT, true )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -2119,6 +2163,10 @@ vlc_module_begin ()
 
     add_bool( "auto-preparse", true, PREPARSE_TEXT,
               PREPARSE_LONGTEXT, false )
+    add_integer( "preparse-threads", 0, PREPARSE_THREADS_TEXT,
+                 PREPARSE_THREADS_LONGTEXT, true )
+    add_bool( "preparse-cache", true, PREPARSE_CACHE_TEXT,
+              PREPARSE_CACHE_LONGTEXT, true )
 
     add_integer( "album-art", ALBUM_ART_WHEN_ASKED, ALBUM_ART_TEXT,
                  ALBUM_ART_LONGTEXT, false )
@@ -213,7 +213,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->p_vlm = NULL;
 
     /* Initialize message queue */
-    priv->msg_bank = msg_Create ();
+    priv->msg_bank = msg_Create (p_libvlc);
     if (unlikely(priv->msg_bank == NULL))
         goto error;
 
@@ -75,7 +75,7 @@ uint32_t CPUCapabilities( void );
 
 typedef struct msg_bank_t msg_bank_t;
 
-msg_bank_t *msg_Create (void);
+msg_bank_t *msg_Create (libvlc_int_t *);
 void msg_Destroy (msg_bank_t *);
 
 /*
@@ -145,6 +145,7 @@ struct vlc_object_internals
     /* Object variables */
     void           *var_root;
     vlc_mutex_t     var_lock;
+    unsigned        i_var_lookups;
     vlc_cond_t      var_wait;
 
     /* Objects thread synchronization */
@@ -11,6 +11,8 @@
 #include "control/media_player_internal.h"
 #include <vlc_common.h>
 #include <vlc_input.h>
+#include <vlc_url.h>
+#include <vlc_thumbnailer.h>
 
 #ifdef ANDROID
 
@@ -220,7 +222,7 @@ static void vlc_event_callback(const libvlc_event_t *ev, void *data)
         break;
     }
     case libvlc_MediaParsedChanged: {
-        libvlc_media_player_play(vj->player);
+        /* prepared is reported once the input is buffered, see below */
         trigger = 0;
         break;
     }
@@ -233,8 +235,8 @@ static void vlc_event_callback(const libvlc_event_t *ev, void *data)
             if (vj->buffering == 1) {
                 /* send buffering update event now */
                 (*env)->CallVoidMethod(env, vj->reference, m_VlcMediaPlayer_onVlcEvent, obj_VlcEvent);
-                libvlc_media_player_set_pause(vj->player, 1);
-                /* asynchonous preparing is done */
+                /* the input started paused: the demux is opened and the
+                 * decoders hold their first frames, preparing is done */
                 vlc_mutex_lock(&vj->parse_lock);
                 vj->parse_status = 1;
                 vlc_cond_broadcast(&vj->parse_cond);
@@ -487,31 +489,27 @@ JNIEXPORT void JNICALL NAME(nativePause)(JNIEnv *env, jobject thiz)
     libvlc_media_player_set_pause(vj->player, 1);
 }
 
+/* starts the input paused, nativeStart will resume it */
+static void vlc_jni_player_prepare(vlc_jni_player_t *vj)
+{
+    libvlc_media_add_option(vj->media, ":start-paused");
+    libvlc_media_player_play(vj->player);
+}
+
 JNIEXPORT void JNICALL NAME(nativePrepare)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
-    char *mrl = libvlc_media_get_mrl(vj->media);
-    if (strncmp(mrl, "file://", 7) == 0)
-        libvlc_media_parse(vj->media);
-    else {
-        libvlc_media_player_play(vj->player);
-        vlc_mutex_lock(&vj->parse_lock);
-        while (!vj->parse_status)
-            vlc_cond_wait(&vj->parse_cond, &vj->parse_lock);
-        vlc_mutex_unlock(&vj->parse_lock);
-    }
-    free(mrl);
+    vlc_jni_player_prepare(vj);
+    vlc_mutex_lock(&vj->parse_lock);
+    while (!vj->parse_status)
+        vlc_cond_wait(&vj->parse_cond, &vj->parse_lock);
+    vlc_mutex_unlock(&vj->parse_lock);
 }
 
 JNIEXPORT void JNICALL NAME(nativePrepareAsync)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
-    char *mrl = libvlc_media_get_mrl(vj->media);
-    if (strncmp(mrl, "file://", 7) == 0)
-        libvlc_media_parse_async(vj->media);
-    else
-        libvlc_media_player_play(vj->player);
-    free(mrl);
+    vlc_jni_player_prepare(vj);
 }
 
 JNIEXPORT void JNICALL NAME(nativeSeekTo)(JNIEnv *env, jobject thiz, jint msec)
@@ -542,6 +540,9 @@ JNIEXPORT void JNICALL NAME(nativeSetDataSource)(JNIEnv *env, jobject thiz, jstr
         /* */
         vj->media = media;
         vj->buffering = 0;
+        vlc_mutex_lock(&vj->parse_lock);
+        vj->parse_status = 0;
+        vlc_mutex_unlock(&vj->parse_lock);
     }
     (*env)->ReleaseStringUTFChars(env, path, str);
     if (!media)
@@ -567,6 +568,109 @@ JNIEXPORT void JNICALL NAME(nativeStop)(JNIEnv *env, jobject thiz) {
     libvlc_media_player_stop(vj->player);
 }
 
+/* thumbnailer */
+
+#define THUMBNAILER_NAME(FUN) NAME2(org_stagex_danmaku_player_VlcThumbnailer, FUN)
+
+static jmethodID m_VlcThumbnailer_onNativeThumbnail = 0;
+
+typedef struct _vlc_jni_thumbnail
+{
+    jobject reference;
+    jobject request;
+} vlc_jni_thumbnail_t;
+
+static void vlc_jni_thumbnail_callback(void *data, const char *mrl, picture_t *pic)
+{
+    vlc_jni_thumbnail_t *jt = data;
+    JNIEnv *env;
+    jbyteArray pixels = NULL;
+    int width = 0, height = 0;
+
+    if ((*gJVM)->AttachCurrentThread(gJVM, &env, 0) < 0)
+    {
+        if (pic)
+            picture_Release(pic);
+        return;
+    }
+    if (pic)
+    {
+        /* Bitmap.copyPixelsFromBuffer wants packed lines */
+        const plane_t *p = &pic->p[0];
+        width = pic->format.i_visible_width;
+        height = pic->format.i_visible_height;
+        pixels = (*env)->NewByteArray(env, p->i_visible_pitch * height);
+        if (pixels)
+        {
+            for (int y = 0; y < height; y++)
+                (*env)->SetByteArrayRegion(env, pixels, y * p->i_visible_pitch, p->i_visible_pitch, (const jbyte *) &p->p_pixels[y * p->i_pitch]);
+        }
+        picture_Release(pic);
+    }
+    (*env)->CallVoidMethod(env, jt->reference, m_VlcThumbnailer_onNativeThumbnail, jt->request, pixels, width, height);
+    if (pixels)
+        (*env)->DeleteLocalRef(env, pixels);
+    (*env)->DeleteGlobalRef(env, jt->request);
+    (*env)->DeleteGlobalRef(env, jt->reference);
+    free(jt);
+    /* EXPLAIN: this is called in pthread wrapper routines */
+}
+
+JNIEXPORT jint JNICALL THUMBNAILER_NAME(nativeCreate)(JNIEnv *env, jobject thiz, jint workers)
+{
+    if (!m_VlcThumbnailer_onNativeThumbnail)
+    {
+        jclass clz = (*env)->GetObjectClass(env, thiz);
+        m_VlcThumbnailer_onNativeThumbnail = (*env)->GetMethodID(env, clz, "onNativeThumbnail", "(Ljava/lang/Object;[BII)V");
+        (*env)->DeleteLocalRef(env, clz);
+    }
+    vlc_thumbnailer_t *thumbnailer = vlc_thumbnailer_Create(s_vlc_instance->p_libvlc_int, __MAX(workers, 0));
+    return (jint) thumbnailer;
+}
+
+JNIEXPORT void JNICALL THUMBNAILER_NAME(nativeRelease)(JNIEnv *env, jobject thiz, jint handle)
+{
+    vlc_thumbnailer_Delete((vlc_thumbnailer_t *) handle);
+}
+
+JNIEXPORT jboolean JNICALL THUMBNAILER_NAME(nativeRequest)(JNIEnv *env, jobject thiz, jint handle, jstring path, jlong msec, jint width, jint height, jint format, jobject request)
+{
+    if (width <= 0 || height <= 0)
+        return 0;
+    const char *str = (*env)->GetStringUTFChars(env, path, 0);
+    if (!str)
+        return 0;
+    char *mrl = (*str == '/') ? make_URI(str, NULL) : strdup(str);
+    (*env)->ReleaseStringUTFChars(env, path, str);
+    if (!mrl)
+        return 0;
+
+    video_format_t fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.i_chroma = (format == 0) ? VLC_CODEC_RGB16 : VLC_CODEC_RGBA;
+    fmt.i_width = fmt.i_visible_width = width;
+    fmt.i_height = fmt.i_visible_height = height;
+
+    vlc_jni_thumbnail_t *jt = malloc(sizeof(vlc_jni_thumbnail_t));
+    if (!jt)
+    {
+        free(mrl);
+        return 0;
+    }
+    jt->reference = (*env)->NewGlobalRef(env, thiz);
+    jt->request = (*env)->NewGlobalRef(env, request);
+    int err = vlc_thumbnailer_Request((vlc_thumbnailer_t *) handle, mrl, msec < 0 ? -1 : msec * 1000, &fmt, vlc_jni_thumbnail_callback, jt);
+    free(mrl);
+    if (err)
+    {
+        (*env)->DeleteGlobalRef(env, jt->request);
+        (*env)->DeleteGlobalRef(env, jt->reference);
+        free(jt);
+        return 0;
+    }
+    return 1;
+}
+
 static void *vlc_jni_player_gc_thread(void *para)
 {
     while (true)
@@ -10,12 +10,17 @@ vlc_declare_plugin(avcodec);
 vlc_declare_plugin(avformat);
 vlc_declare_plugin(bandlimited_resampler);
 vlc_declare_plugin(blend);
+vlc_declare_plugin(compressor);
+vlc_declare_plugin(concat);
 vlc_declare_plugin(converter_fixed);
+vlc_declare_plugin(danmaku);
 vlc_declare_plugin(dummy);
+vlc_declare_plugin(equalizer);
 vlc_declare_plugin(filesystem);
 vlc_declare_plugin(fixed32_mixer);
 vlc_declare_plugin(float32_mixer);
 vlc_declare_plugin(freetype);
+vlc_declare_plugin(fused_converter);
 vlc_declare_plugin(libasf);
 vlc_declare_plugin(libass);
 vlc_declare_plugin(libavi);
@@ -24,6 +29,7 @@ vlc_declare_plugin(live555);
 vlc_declare_plugin(mkv);
 vlc_declare_plugin(mpeg_audio);
 vlc_declare_plugin(mpgv);
+vlc_declare_plugin(normvol);
 vlc_declare_plugin(packetizer_copy);
 vlc_declare_plugin(packetizer_dirac);
 vlc_declare_plugin(packetizer_flac);
@@ -33,7 +39,9 @@ vlc_declare_plugin(packetizer_mpeg4audio);
 vlc_declare_plugin(packetizer_mpeg4video);
 vlc_declare_plugin(packetizer_mpegvideo);
 vlc_declare_plugin(packetizer_vc1);
+vlc_declare_plugin(polyphase_resampler);
 vlc_declare_plugin(realrtsp);
+vlc_declare_plugin(scaletempo);
 vlc_declare_plugin(simple_channel_mixer);
 vlc_declare_plugin(stream_filter_httplive);
 vlc_declare_plugin(stream_filter_record);
@@ -58,12 +66,17 @@ const void *vlc_builtins_modules[] = {
 	vlc_plugin(avformat),
 	vlc_plugin(bandlimited_resampler),
 	vlc_plugin(blend),
+	vlc_plugin(compressor),
+	vlc_plugin(concat),
 	vlc_plugin(converter_fixed),
+	vlc_plugin(danmaku),
 	vlc_plugin(dummy),
+	vlc_plugin(equalizer),
 	vlc_plugin(filesystem),
 	vlc_plugin(fixed32_mixer),
 	vlc_plugin(float32_mixer),
 	vlc_plugin(freetype),
+	vlc_plugin(fused_converter),
 	vlc_plugin(libasf),
 	vlc_plugin(libass),
 	vlc_plugin(libavi),
@@ -72,6 +85,7 @@ const void *vlc_builtins_modules[] = {
 	vlc_plugin(mkv),
 	vlc_plugin(mpeg_audio),
 	vlc_plugin(mpgv),
+	vlc_plugin(normvol),
 	vlc_plugin(packetizer_copy),
 	vlc_plugin(packetizer_dirac),
 	vlc_plugin(packetizer_flac),
@@ -81,7 +95,9 @@ const void *vlc_builtins_modules[] = {
 	vlc_plugin(packetizer_mpeg4video),
 	vlc_plugin(packetizer_mpegvideo),
 	vlc_plugin(packetizer_vc1),
+	vlc_plugin(polyphase_resampler),
 	vlc_plugin(realrtsp),
+	vlc_plugin(scaletempo),
 	vlc_plugin(simple_channel_mixer),
 	vlc_plugin(stream_filter_httplive),
 	vlc_plugin(stream_filter_record),
@@ -53,6 +53,7 @@
 #include <assert.h>
 
 #include <vlc_charset.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #ifdef ANDROID
@@ -75,10 +76,30 @@ static inline msg_bank_t *libvlc_bank (libvlc_int_t *inst)
     return (libvlc_priv (inst))->msg_bank;
 }
 
+/* Number of messages waiting to be printed, must be a power of 2 */
+#define MSG_RING_SIZE 1024
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
-static void PrintMsg ( vlc_object_t *, const msg_item_t * );
+static void PrintMsg ( msg_bank_t *, const msg_item_t * );
+static void DispatchMsg ( msg_bank_t *, const msg_item_t * );
+static void *Drain ( void * );
+
+/**
+ * Message waiting in the ring, with copies of the strings of its emitter
+ */
+typedef struct
+{
+    msg_item_t item;
+    char       strings[];
+} msg_entry_t;
+
+typedef struct
+{
+    vlc_atomic_t seq; /**< Position of the cell once filled, or emptied */
+    msg_entry_t *entry;
+} msg_cell_t;
 
 /**
  * Store all data required by messages interfaces.
@@ -91,19 +112,35 @@ struct msg_bank_t
     /* Subscribers */
     int i_sub;
     msg_subscription_t **pp_sub;
+    int i_sub_verbosity; ///< Highest verbosity of the subscribers, or -1
 
     locale_t locale; /**< C locale for error messages */
     vlc_dictionary_t enabled_objects; ///< Enabled objects
     bool all_objects_enabled; ///< Should we print all objects?
+
+    libvlc_int_t *libvlc;
+
+    /* Messages are printed and sent to the subscribers by a drainer thread.
+     * Emitters reserve a cell of the ring with an atomic operation, so that
+     * they never wait for a lock, the terminal or the subscribers. */
+    msg_cell_t   ring[MSG_RING_SIZE];
+    vlc_atomic_t enqueue_pos;
+    uintptr_t    dequeue_pos; ///< Only used by the drainer
+    vlc_atomic_t sleeping;    ///< The drainer waits for the semaphore
+    vlc_atomic_t dying;
+    vlc_sem_t    wait;
+    vlc_thread_t thread;
 };
 
 /**
  * Initialize messages queues
  * This function initializes all message queues
  */
-msg_bank_t *msg_Create (void)
+msg_bank_t *msg_Create (libvlc_int_t *libvlc)
 {
     msg_bank_t *bank = malloc (sizeof (*bank));
+    if (unlikely(bank == NULL))
+        return NULL;
 
     vlc_rwlock_init (&bank->lock);
     vlc_dictionary_init (&bank->enabled_objects, 0);
@@ -111,12 +148,125 @@ msg_bank_t *msg_Create (void)
 
     bank->i_sub = 0;
     bank->pp_sub = NULL;
+    bank->i_sub_verbosity = -1;
+    bank->libvlc = libvlc;
 
     /* C locale to get error messages in English in the logs */
     bank->locale = newlocale (LC_MESSAGES_MASK, "C", (locale_t)0);
+
+    for (uintptr_t i = 0; i < MSG_RING_SIZE; i++)
+    {
+        vlc_atomic_set (&bank->ring[i].seq, i);
+        bank->ring[i].entry = NULL;
+    }
+    vlc_atomic_set (&bank->enqueue_pos, 0);
+    bank->dequeue_pos = 0;
+    vlc_atomic_set (&bank->sleeping, 0);
+    vlc_atomic_set (&bank->dying, 0);
+    vlc_sem_init (&bank->wait, 0);
+
+    if (vlc_clone (&bank->thread, Drain, bank, VLC_THREAD_PRIORITY_LOW))
+    {
+        vlc_sem_destroy (&bank->wait);
+        if (bank->locale != (locale_t)0)
+            freelocale (bank->locale);
+        vlc_dictionary_clear (&bank->enabled_objects, NULL, NULL);
+        vlc_rwlock_destroy (&bank->lock);
+        free (bank);
+        return NULL;
+    }
     return bank;
 }
 
+/**
+ * Queue a message for the drainer thread.
+ * This is safe from any number of threads at once and never blocks.
+ *
+ * @return false if the ring is full
+ */
+static bool RingPush (msg_bank_t *bank, msg_entry_t *entry)
+{
+    uintptr_t pos = vlc_atomic_get (&bank->enqueue_pos);
+    msg_cell_t *cell;
+
+    for (;;)
+    {
+        cell = &bank->ring[pos & (MSG_RING_SIZE - 1)];
+        intptr_t dif = (intptr_t)(vlc_atomic_get (&cell->seq) - pos);
+
+        if (dif == 0)
+        {   /* The cell is free: try to reserve it */
+            uintptr_t cur = vlc_atomic_compare_swap (&bank->enqueue_pos,
+                                                     pos, pos + 1);
+            if (cur == pos)
+                break;
+            pos = cur;
+        }
+        else if (dif < 0)
+            return false; /* The drainer has not emptied it yet */
+        else
+            pos = vlc_atomic_get (&bank->enqueue_pos);
+    }
+
+    cell->entry = entry;
+    /* Full barrier: the entry is visible before the cell is marked filled */
+    vlc_atomic_swap (&cell->seq, pos + 1);
+
+    if (vlc_atomic_swap (&bank->sleeping, 0))
+        vlc_sem_post (&bank->wait);
+    return true;
+}
+
+/**
+ * Take the oldest message of the ring, if any. Only called by the drainer.
+ */
+static msg_entry_t *RingPop (msg_bank_t *bank)
+{
+    const uintptr_t pos = bank->dequeue_pos;
+    msg_cell_t *cell = &bank->ring[pos & (MSG_RING_SIZE - 1)];
+
+    /* Full barrier: the entry is not read before the cell is filled */
+    if (vlc_atomic_compare_swap (&cell->seq, pos + 1, pos + 1) != pos + 1)
+        return NULL;
+
+    msg_entry_t *entry = cell->entry;
+    vlc_atomic_swap (&cell->seq, pos + MSG_RING_SIZE);
+    bank->dequeue_pos = pos + 1;
+    return entry;
+}
+
+static void *Drain (void *data)
+{
+    msg_bank_t *bank = data;
+
+    for (;;)
+    {
+        msg_entry_t *entry = RingPop (bank);
+        if (entry != NULL)
+        {
+            DispatchMsg (bank, &entry->item);
+            free (entry->item.psz_msg);
+            free (entry);
+            continue;
+        }
+
+        /* Only quit once everything was printed */
+        if (vlc_atomic_get (&bank->dying))
+            break;
+
+        vlc_atomic_set (&bank->sleeping, 1);
+        /* Check again, a message may have been queued meanwhile */
+        msg_cell_t *cell = &bank->ring[bank->dequeue_pos & (MSG_RING_SIZE - 1)];
+        if (vlc_atomic_get (&cell->seq) == bank->dequeue_pos + 1)
+        {
+            vlc_atomic_set (&bank->sleeping, 0);
+            continue;
+        }
+        vlc_sem_wait (&bank->wait);
+    }
+    return NULL;
+}
+
 /**
  * Object Printing selection
  */
@@ -161,6 +311,11 @@ void msg_DisableObjectPrinting (vlc_object_t *obj, const char * psz_object)
  */
 void msg_Destroy (msg_bank_t *bank)
 {
+    vlc_atomic_set (&bank->dying, 1);
+    vlc_sem_post (&bank->wait);
+    vlc_join (bank->thread, NULL);
+    vlc_sem_destroy (&bank->wait);
+
     if (unlikely(bank->i_sub != 0))
         fputs ("stale interface subscribers (LibVLC might crash)\n", stderr);
 
@@ -181,10 +336,21 @@ struct msg_subscription_t
     int             verbosity;
 };
 
+/* Bank lock must be held for writing */
+static void UpdateVerbosity (msg_bank_t *bank)
+{
+    int verbosity = -1;
+
+    for (int i = 0; i < bank->i_sub; i++)
+        if (bank->pp_sub[i]->verbosity > verbosity)
+            verbosity = bank->pp_sub[i]->verbosity;
+    bank->i_sub_verbosity = verbosity;
+}
+
 /**
  * Subscribe to the message queue.
- * Whenever a message is emitted, a callback will be called.
- * Callback invocation are serialized within a subscription.
+ * Whenever a message is emitted, a callback will be called, usually from the
+ * thread draining the messages rather than from the emitter.
  *
  * @param instance LibVLC instance to get messages from
  * @param cb callback function
@@ -206,6 +372,7 @@ msg_subscription_t *msg_Subscribe (libvlc_int_t *instance, msg_callback_t cb,
     msg_bank_t *bank = libvlc_bank (instance);
     vlc_rwlock_wrlock (&bank->lock);
     TAB_APPEND (bank->i_sub, bank->pp_sub, sub);
+    UpdateVerbosity (bank);
     vlc_rwlock_unlock (&bank->lock);
 
     return sub;
@@ -221,6 +388,7 @@ void msg_Unsubscribe (msg_subscription_t *sub)
 
     vlc_rwlock_wrlock (&bank->lock);
     TAB_REMOVE (bank->i_sub, bank->pp_sub, sub);
+    UpdateVerbosity (bank);
     vlc_rwlock_unlock (&bank->lock);
     free (sub);
 }
@@ -234,6 +402,7 @@ void msg_SubscriptionSetVerbosity( msg_subscription_t *sub, const int i_verbosit
     vlc_rwlock_wrlock (&bank->lock);
 
     sub->verbosity = i_verbosity;
+    UpdateVerbosity (bank);
 
     vlc_rwlock_unlock (&bank->lock);
 }
@@ -257,8 +426,9 @@ void msg_Generic( vlc_object_t *p_this, int i_type, const char *psz_module,
  * Add a message to a queue
  *
  * This function provides basic functionnalities to other msg_* functions.
- * It adds a message to a queue (after having printed all stored messages if it
- * is full). If the message can't be converted to string in memory, it issues
+ * Messages that nobody would print are dropped before being formatted.
+ * The others are queued for the drainer thread, or printed right away if it
+ * is late. If the message can't be converted to string in memory, it issues
  * a warning.
  */
 void msg_GenericVa (vlc_object_t *p_this, int i_type,
@@ -274,17 +444,29 @@ void msg_GenericVa (vlc_object_t *p_this, int i_type,
         (p_this->i_flags & OBJECT_FLAGS_NODBG && i_type == VLC_MSG_DBG) )
         return;
 
-    msg_bank_t *bank = libvlc_bank (p_this->p_libvlc);
+    libvlc_priv_t *priv = libvlc_priv (p_this->p_libvlc);
+    msg_bank_t *bank = priv->msg_bank;
+
+    /* Neither the terminal nor a subscriber wants this message */
+    const int i_level = (i_type == VLC_MSG_DBG) ? 2 :
+                        (i_type == VLC_MSG_WARN) ? 1 : 0;
+    if (i_level > priv->i_verbose && i_level > bank->i_sub_verbosity)
+        return;
+
     locale_t locale = uselocale (bank->locale);
 
 #ifndef __GLIBC__
     /* Expand %m to strerror(errno) - only once */
-    char buf[strlen( psz_format ) + 2001], *ptr;
-    strcpy( buf, psz_format );
-    ptr = (char*)buf;
-    psz_format = (const char*) buf;
+    const bool b_errno = strstr( psz_format, "%m" ) != NULL;
+    char buf[b_errno ? strlen( psz_format ) + 2001 : 1], *ptr;
+    if( b_errno )
+    {
+        strcpy( buf, psz_format );
+        ptr = (char*)buf;
+        psz_format = (const char*) buf;
+    }
 
-    for( ;; )
+    while( b_errno )
     {
         ptr = strchr( ptr, '%' );
         if( ptr == NULL )
@@ -384,7 +566,36 @@ void msg_GenericVa (vlc_object_t *p_this, int i_type,
             break;
         }
 
-    PrintMsg( p_this, &msg );
+    /* The emitter and its module may be gone when the message is printed */
+    const size_t i_module = strlen( psz_module ) + 1;
+    const size_t i_header = msg.psz_header ? strlen( msg.psz_header ) + 1 : 0;
+    msg_entry_t *p_entry = malloc( sizeof(*p_entry) + i_module + i_header );
+    if( p_entry != NULL )
+    {
+        p_entry->item = msg;
+        p_entry->item.psz_module = memcpy( p_entry->strings, psz_module,
+                                           i_module );
+        if( i_header )
+            p_entry->item.psz_header = memcpy( p_entry->strings + i_module,
+                                               msg.psz_header, i_header );
+        if( RingPush( bank, p_entry ) )
+            return;
+        free( p_entry );
+    }
+
+    /* The drainer is late */
+    DispatchMsg( bank, &msg );
+    free( msg.psz_msg );
+}
+
+/*****************************************************************************
+ * DispatchMsg: print a message and send it to the subscribers
+ *****************************************************************************/
+static void DispatchMsg( msg_bank_t *bank, const msg_item_t *p_item )
+{
+    msg_item_t msg = *p_item;
+
+    PrintMsg( bank, &msg );
 
     vlc_rwlock_rdlock (&bank->lock);
     for (int i = 0; i < bank->i_sub; i++)
@@ -420,7 +631,6 @@ void msg_GenericVa (vlc_object_t *p_this, int i_type,
         sub->func (sub->opaque, &msg);
     }
     vlc_rwlock_unlock (&bank->lock);
-    free (msg.psz_msg);
 }
 
 /*****************************************************************************
@@ -428,7 +638,7 @@ void msg_GenericVa (vlc_object_t *p_this, int i_type,
  *****************************************************************************
  * Print a message to stderr, with colour formatting if needed.
  *****************************************************************************/
-static void PrintMsg ( vlc_object_t *p_this, const msg_item_t *p_item )
+static void PrintMsg ( msg_bank_t *bank, const msg_item_t *p_item )
 {
 #   define COL(x,y)  "\033[" #x ";" #y "m"
 #   define RED     COL(31,1)
@@ -439,14 +649,13 @@ static void PrintMsg ( vlc_object_t *p_this, const msg_item_t *p_item )
     static const char msgtype[4][9] = { "", " error", " warning", " debug" };
     static const char msgcolor[4][8] = { WHITE, RED, YELLOW, GRAY };
 
-    libvlc_priv_t *priv = libvlc_priv (p_this->p_libvlc);
+    libvlc_priv_t *priv = libvlc_priv (bank->libvlc);
     int type = p_item->i_type;
 
     if (priv->i_verbose < 0 || priv->i_verbose < (type - VLC_MSG_ERR))
         return;
 
     const char *objtype = p_item->psz_object_type;
-    msg_bank_t *bank = priv->msg_bank;
     void * val = vlc_dictionary_value_for_key (&bank->enabled_objects,
                                                p_item->psz_module);
     if( val == kObjectPrintingDisabled )
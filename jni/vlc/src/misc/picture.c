@@ -37,6 +37,7 @@
 #include <vlc_picture.h>
 #include <vlc_image.h>
 #include <vlc_block.h>
+#include <vlc_cpu.h>
 
 /**
  * Allocate a new picture in the heap.
@@ -304,19 +305,11 @@ void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
     else
     {
         /* We need to proceed line by line */
-        uint8_t *p_in = p_src->p_pixels;
-        uint8_t *p_out = p_dst->p_pixels;
-        int i_line;
+        assert( p_src->p_pixels );
+        assert( p_dst->p_pixels );
 
-        assert( p_in );
-        assert( p_out );
-
-        for( i_line = i_height; i_line--; )
-        {
-            vlc_memcpy( p_out, p_in, i_width );
-            p_in += p_src->i_pitch;
-            p_out += p_dst->i_pitch;
-        }
+        vlc_CopyPlane( p_dst->p_pixels, p_dst->i_pitch,
+                       p_src->p_pixels, p_src->i_pitch, i_width, i_height );
     }
 }
 
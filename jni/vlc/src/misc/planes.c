@@ -0,0 +1,199 @@
+/*****************************************************************************
+ * planes.c: plane copy, interleave and deinterleave helpers
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include <assert.h>
+
+#if defined (__SSE2__)
+# include <emmintrin.h>
+#endif
+
+/*
+ * The line kernels handle count pairs of bytes, count being a multiple of 16.
+ * The remaining pairs of each line are handled by the C loops below. The
+ * fast memory modules may register better kernels (see arm_neon/memcpy.c).
+ */
+#if defined (__SSE2__)
+static void split_sse2 (uint8_t *a, uint8_t *b, const uint8_t *src,
+                        unsigned count)
+{
+    const __m128i mask = _mm_set1_epi16 (0x00ff);
+
+    for (unsigned x = 0; x < count; x += 16)
+    {
+        const __m128i lo = _mm_loadu_si128 ((const __m128i *)&src[2*x]);
+        const __m128i hi = _mm_loadu_si128 ((const __m128i *)&src[2*x+16]);
+
+        _mm_storeu_si128 ((__m128i *)&a[x],
+                          _mm_packus_epi16 (_mm_and_si128 (lo, mask),
+                                            _mm_and_si128 (hi, mask)));
+        _mm_storeu_si128 ((__m128i *)&b[x],
+                          _mm_packus_epi16 (_mm_srli_epi16 (lo, 8),
+                                            _mm_srli_epi16 (hi, 8)));
+    }
+}
+
+static void interleave_sse2 (uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                             unsigned count)
+{
+    for (unsigned x = 0; x < count; x += 16)
+    {
+        const __m128i va = _mm_loadu_si128 ((const __m128i *)&a[x]);
+        const __m128i vb = _mm_loadu_si128 ((const __m128i *)&b[x]);
+
+        _mm_storeu_si128 ((__m128i *)&dst[2*x], _mm_unpacklo_epi8 (va, vb));
+        _mm_storeu_si128 ((__m128i *)&dst[2*x+16], _mm_unpackhi_epi8 (va, vb));
+    }
+}
+
+static void swap_sse2 (uint8_t *dst, const uint8_t *src, unsigned count)
+{
+    for (unsigned x = 0; x < 2 * count; x += 16)
+    {
+        const __m128i v = _mm_loadu_si128 ((const __m128i *)&src[x]);
+
+        _mm_storeu_si128 ((__m128i *)&dst[x],
+                          _mm_or_si128 (_mm_slli_epi16 (v, 8),
+                                        _mm_srli_epi16 (v, 8)));
+    }
+}
+
+static vlc_fastplane_t fastplane = {
+    split_sse2, interleave_sse2, swap_sse2,
+};
+#else
+static vlc_fastplane_t fastplane = { NULL, NULL, NULL };
+#endif
+
+void vlc_fastplane_register (const vlc_fastplane_t *ops)
+{
+    assert (ops != NULL);
+    if (ops->split != NULL)
+        fastplane.split = ops->split;
+    if (ops->interleave != NULL)
+        fastplane.interleave = ops->interleave;
+    if (ops->swap != NULL)
+        fastplane.swap = ops->swap;
+}
+
+/**
+ * Copies a plane of width bytes per line into a plane of a different pitch.
+ */
+void vlc_CopyPlane (uint8_t *dst, size_t dst_pitch,
+                    const uint8_t *src, size_t src_pitch,
+                    unsigned width, unsigned height)
+{
+    if (dst_pitch == src_pitch && src_pitch == width)
+    {
+        vlc_memcpy (dst, src, (size_t)width * height);
+        return;
+    }
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        vlc_memcpy (dst, src, width);
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+}
+
+/**
+ * Splits a plane of width interleaved pairs of bytes into two planes
+ * (NV12 chroma into U and V planes).
+ */
+void vlc_SplitPlane (uint8_t *dst_a, size_t a_pitch,
+                     uint8_t *dst_b, size_t b_pitch,
+                     const uint8_t *src, size_t src_pitch,
+                     unsigned width, unsigned height)
+{
+    const unsigned fast = fastplane.split != NULL ? width & ~15 : 0;
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        if (fast)
+            fastplane.split (dst_a, dst_b, src, fast);
+        for (unsigned x = fast; x < width; x++)
+        {
+            dst_a[x] = src[2*x];
+            dst_b[x] = src[2*x+1];
+        }
+        src += src_pitch;
+        dst_a += a_pitch;
+        dst_b += b_pitch;
+    }
+}
+
+/**
+ * Interleaves two planes of width bytes into a plane of pairs of bytes
+ * (U and V planes into NV12 chroma).
+ */
+void vlc_InterleavePlanes (uint8_t *dst, size_t dst_pitch,
+                           const uint8_t *src_a, size_t a_pitch,
+                           const uint8_t *src_b, size_t b_pitch,
+                           unsigned width, unsigned height)
+{
+    const unsigned fast = fastplane.interleave != NULL ? width & ~15 : 0;
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        if (fast)
+            fastplane.interleave (dst, src_a, src_b, fast);
+        for (unsigned x = fast; x < width; x++)
+        {
+            dst[2*x]   = src_a[x];
+            dst[2*x+1] = src_b[x];
+        }
+        src_a += a_pitch;
+        src_b += b_pitch;
+        dst += dst_pitch;
+    }
+}
+
+/**
+ * Swaps the bytes of a plane of width pairs of bytes (NV12 and NV21 chroma).
+ * The source and the destination may be the same.
+ */
+void vlc_SwapPlaneUV (uint8_t *dst, size_t dst_pitch,
+                      const uint8_t *src, size_t src_pitch,
+                      unsigned width, unsigned height)
+{
+    const unsigned fast = fastplane.swap != NULL ? width & ~15 : 0;
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        if (fast)
+            fastplane.swap (dst, src, fast);
+        for (unsigned x = fast; x < width; x++)
+        {
+            const uint8_t u = src[2*x];
+
+            dst[2*x]   = src[2*x+1];
+            dst[2*x+1] = u;
+        }
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+}
@@ -76,6 +76,7 @@ subpicture_t *subpicture_New( const subpicture_updater_t *p_upd )
         p_subpic->updater.pf_update   = NULL;
         p_subpic->updater.pf_destroy  = NULL;
         p_subpic->updater.p_sys       = NULL;
+        p_subpic->updater.b_stateless = false;
     }
     return p_subpic;
 }
@@ -171,6 +172,18 @@ void subpicture_Update( subpicture_t *p_subpicture,
     video_format_Copy( &p_private->dst, p_fmt_dst );
 }
 
+void subpicture_Invalidate( subpicture_t *p_subpicture )
+{
+    subpicture_private_t *p_private = p_subpicture->p_private;
+
+    if( !p_private )
+        return;
+    video_format_Clean( &p_private->src );
+    video_format_Clean( &p_private->dst );
+    video_format_Init( &p_private->src, 0 );
+    video_format_Init( &p_private->dst, 0 );
+}
+
 
 subpicture_region_private_t *subpicture_region_private_New( video_format_t *p_fmt )
 {
@@ -199,7 +212,7 @@ void subpicture_region_private_Delete( subpicture_region_private_t *p_private )
     free( p_private );
 }
 
-subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+static subpicture_region_t *RegionNew( const video_format_t *p_fmt )
 {
     subpicture_region_t *p_region = calloc( 1, sizeof(*p_region ) );
     if( !p_region )
@@ -220,6 +233,15 @@ subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
     p_region->p_style = NULL;
     p_region->p_picture = NULL;
 
+    return p_region;
+}
+
+subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+{
+    subpicture_region_t *p_region = RegionNew( p_fmt );
+    if( !p_region )
+        return NULL;
+
     if( p_fmt->i_chroma == VLC_CODEC_TEXT )
         return p_region;
 
@@ -234,6 +256,19 @@ subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
     return p_region;
 }
 
+subpicture_region_t *subpicture_region_NewFromPicture( const video_format_t *p_fmt,
+                                                       picture_t *p_picture )
+{
+    assert( p_fmt->i_chroma != VLC_CODEC_TEXT );
+
+    subpicture_region_t *p_region = RegionNew( p_fmt );
+    if( !p_region )
+        return NULL;
+
+    p_region->p_picture = picture_Hold( p_picture );
+    return p_region;
+}
+
 void subpicture_region_Delete( subpicture_region_t *p_region )
 {
     if( !p_region )
@@ -29,3 +29,6 @@ struct subpicture_region_private_t {
 subpicture_region_private_t *subpicture_region_private_New(video_format_t *);
 void subpicture_region_private_Delete(subpicture_region_private_t *);
 
+/* Forces the next subpicture_Update() to update the regions */
+void subpicture_Invalidate(subpicture_t *);
+
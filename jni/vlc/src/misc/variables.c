@@ -150,10 +150,32 @@ static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
     variable_t **pp_var;
 
     vlc_assert_locked( &priv->var_lock );
+    priv->i_var_lookups++;
     pp_var = tfind( &psz_name, &priv->var_root, varcmp );
     return (pp_var != NULL) ? *pp_var : NULL;
 }
 
+unsigned var_CountLookups( vlc_object_t *obj )
+{
+    vlc_object_internals_t *priv = vlc_internals( obj );
+
+    vlc_mutex_lock( &priv->var_lock );
+    unsigned i_count = priv->i_var_lookups;
+    vlc_mutex_unlock( &priv->var_lock );
+    return i_count;
+}
+
+/* The value changes between these calls, with the variable lock held */
+static void ChangeBegin( variable_t *p_var )
+{
+    vlc_atomic_inc( &p_var->seq );
+}
+
+static void ChangeEnd( variable_t *p_var )
+{
+    vlc_atomic_inc( &p_var->seq );
+}
+
 static void Destroy( variable_t *p_var )
 {
     p_var->ops->pf_free( &p_var->val );
@@ -386,6 +408,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
         return VLC_ENOVAR;
     }
 
+    ChangeBegin( p_var );
     switch( i_action )
     {
         case VLC_VAR_SETMIN:
@@ -462,6 +485,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             if( i == p_var->choices.i_count )
             {
                 /* Not found */
+                ChangeEnd( p_var );
                 vlc_mutex_unlock( &p_priv->var_lock );
                 return VLC_EGENERIC;
             }
@@ -587,6 +611,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
         default:
             break;
     }
+    ChangeEnd( p_var );
 
     vlc_mutex_unlock( &p_priv->var_lock );
 
@@ -631,6 +656,7 @@ int var_GetAndSet( vlc_object_t *p_this, const char *psz_name, int i_action,
     /* Backup needed stuff */
     oldval = p_var->val;
 
+    ChangeBegin( p_var );
     /* depending of the action requiered */
     switch( i_action )
     {
@@ -651,12 +677,14 @@ int var_GetAndSet( vlc_object_t *p_this, const char *psz_name, int i_action,
         p_var->val.i_int &= ~p_val->i_int;
         break;
     default:
+        ChangeEnd( p_var );
         vlc_mutex_unlock( &p_priv->var_lock );
         return VLC_EGENERIC;
     }
 
     /*  Check boundaries */
     CheckValue( p_var, &p_var->val );
+    ChangeEnd( p_var );
     *p_val = p_var->val;
 
     /* Deal with callbacks.*/
@@ -695,33 +723,21 @@ int var_Type( vlc_object_t *p_this, const char *psz_name )
     return i_type;
 }
 
-#undef var_SetChecked
-int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
-                    int expected_type, vlc_value_t val )
+/* Sets the value of a variable and triggers its callbacks.
+ * Enter with the variable lock held, which is released. */
+static int SetLocked( vlc_object_t *p_this, variable_t *p_var,
+                      int expected_type, vlc_value_t val )
 {
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
     int i_ret = VLC_SUCCESS;
-    variable_t *p_var;
     vlc_value_t oldval;
 
-    assert( p_this );
-
-    vlc_object_internals_t *p_priv = vlc_internals( p_this );
-
-    vlc_mutex_lock( &p_priv->var_lock );
-
-    p_var = Lookup( p_this, psz_name );
-    if( p_var == NULL )
-    {
-        vlc_mutex_unlock( &p_priv->var_lock );
-        return VLC_ENOVAR;
-    }
-
     assert( expected_type == 0 ||
             (p_var->i_type & VLC_VAR_CLASS) == expected_type );
 #ifndef NDEBUG
         /* Alert if the type is VLC_VAR_VOID */
         if( ( p_var->i_type & VLC_VAR_TYPE ) == VLC_VAR_VOID )
-            msg_Warn( p_this, "Calling var_Set on the void variable '%s' (0x%04x)", psz_name, p_var->i_type );
+            msg_Warn( p_this, "Calling var_Set on the void variable '%s' (0x%04x)", p_var->psz_name, p_var->i_type );
 #endif
 
 
@@ -737,10 +753,12 @@ int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
     CheckValue( p_var, &val );
 
     /* Set the variable */
+    ChangeBegin( p_var );
     p_var->val = val;
+    ChangeEnd( p_var );
 
     /* Deal with callbacks */
-    i_ret = TriggerCallback( p_this, p_var, psz_name, oldval );
+    i_ret = TriggerCallback( p_this, p_var, p_var->psz_name, oldval );
 
     /* Free data if needed */
     p_var->ops->pf_free( &oldval );
@@ -750,6 +768,28 @@ int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
     return i_ret;
 }
 
+#undef var_SetChecked
+int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
+                    int expected_type, vlc_value_t val )
+{
+    variable_t *p_var;
+
+    assert( p_this );
+
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+
+    p_var = Lookup( p_this, psz_name );
+    if( p_var == NULL )
+    {
+        vlc_mutex_unlock( &p_priv->var_lock );
+        return VLC_ENOVAR;
+    }
+
+    return SetLocked( p_this, p_var, expected_type, val );
+}
+
 #undef var_Set
 /**
  * Set a variable's value
@@ -814,6 +854,128 @@ int var_Get( vlc_object_t *p_this, const char *psz_name, vlc_value_t *p_val )
     return var_GetChecked( p_this, psz_name, 0, p_val );
 }
 
+#undef var_Acquire
+/**
+ * Get a handle to a variable, to get or set it without looking it up by name
+ * every time.
+ *
+ * The variable is not destroyed until the handle is released, which must
+ * happen before the object is destroyed.
+ *
+ * \param p_this The object that holds the variable
+ * \param psz_name The name of the variable
+ * \return the handle, or NULL if the variable does not exist
+ */
+var_handle_t *var_Acquire( vlc_object_t *p_this, const char *psz_name )
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    variable_t *p_var = Lookup( p_this, psz_name );
+    if( p_var != NULL )
+        p_var->i_usage++;
+    vlc_mutex_unlock( &p_priv->var_lock );
+
+    return p_var;
+}
+
+#undef var_Release
+/**
+ * Release a variable handle, like var_Destroy()
+ */
+void var_Release( vlc_object_t *p_this, var_handle_t *p_var )
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    WaitUnused( p_this, p_var );
+    if( --p_var->i_usage == 0 )
+        tdelete( p_var, &p_priv->var_root, varcmp );
+    else
+        p_var = NULL;
+    vlc_mutex_unlock( &p_priv->var_lock );
+
+    if( p_var != NULL )
+        Destroy( p_var );
+}
+
+#undef var_GetHandle
+/**
+ * Get the value of a variable from its handle.
+ *
+ * The values which need no duplication (all but strings and lists) are read
+ * without taking the variable lock: the read is retried under the lock only
+ * if the value was changed meanwhile.
+ *
+ * \see var_GetChecked
+ */
+int var_GetHandle( vlc_object_t *p_this, var_handle_t *p_var,
+                   int expected_type, vlc_value_t *p_val )
+{
+    assert( expected_type == 0 ||
+            (p_var->i_type & VLC_VAR_CLASS) == expected_type );
+    VLC_UNUSED( expected_type );
+
+    if( p_var->ops->pf_dup == DupDummy )
+    {
+        /* Full barrier: the value is not read before the sequence */
+        const uintptr_t seq = vlc_atomic_add( &p_var->seq, 0 );
+        if( !(seq & 1) )
+        {
+            *p_val = p_var->val;
+            if( vlc_atomic_get( &p_var->seq ) == seq )
+                return VLC_SUCCESS;
+        }
+    }
+
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    *p_val = p_var->val;
+    p_var->ops->pf_dup( p_val );
+    vlc_mutex_unlock( &p_priv->var_lock );
+    return VLC_SUCCESS;
+}
+
+#undef var_SetHandle
+/**
+ * Set the value of a variable from its handle, and trigger its callbacks.
+ *
+ * \see var_SetChecked
+ */
+int var_SetHandle( vlc_object_t *p_this, var_handle_t *p_var,
+                   int expected_type, vlc_value_t val )
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    return SetLocked( p_this, p_var, expected_type, val );
+}
+
+#undef var_StoreHandle
+/**
+ * Set the value of a variable from its handle, without triggering its
+ * callbacks, like var_Change() with VLC_VAR_SETVALUE.
+ */
+void var_StoreHandle( vlc_object_t *p_this, var_handle_t *p_var,
+                      vlc_value_t val )
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+    vlc_value_t oldval;
+
+    p_var->ops->pf_dup( &val );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    oldval = p_var->val;
+    CheckValue( p_var, &val );
+    ChangeBegin( p_var );
+    p_var->val = val;
+    ChangeEnd( p_var );
+    vlc_mutex_unlock( &p_priv->var_lock );
+
+    p_var->ops->pf_free( &oldval );
+}
+
 #undef var_AddCallback
 /**
  * Register a callback in a variable
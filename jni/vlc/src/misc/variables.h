@@ -24,6 +24,8 @@
 #ifndef LIBVLC_VARIABLES_H
 # define LIBVLC_VARIABLES_H 1
 
+# include <vlc_atomic.h>
+
 typedef struct callback_entry_t callback_entry_t;
 
 typedef struct variable_ops_t
@@ -43,6 +45,8 @@ struct variable_t
 
     /** The variable's exported value */
     vlc_value_t  val;
+    /** Odd while the value is being changed (see var_GetHandle) */
+    vlc_atomic_t seq;
 
     /** The variable display name, mainly for use by the interfaces */
     char *       psz_text;
@@ -73,5 +77,7 @@ struct variable_t
 };
 
 extern void var_DestroyAll( vlc_object_t * );
+/* Number of variable lookups by name on the object so far */
+unsigned var_CountLookups( vlc_object_t * );
 
 #endif
@@ -205,10 +205,30 @@ int playlist_PreparseEnqueue( playlist_t *p_playlist, input_item_t *p_item )
 
     if( unlikely(p_sys->p_preparser == NULL) )
         return VLC_ENOMEM;
-    playlist_preparser_Push( p_sys->p_preparser, p_item );
+    playlist_preparser_Push( p_sys->p_preparser, p_item, false );
     return VLC_SUCCESS;
 }
 
+/** Enqueue an item for preparsing ahead of the others */
+int playlist_PreparsePrioritize( playlist_t *p_playlist, input_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    if( unlikely(p_sys->p_preparser == NULL) )
+        return VLC_ENOMEM;
+    playlist_preparser_Push( p_sys->p_preparser, p_item, true );
+    return VLC_SUCCESS;
+}
+
+/** Remove an item from the preparsing queue */
+void playlist_PreparseCancel( playlist_t *p_playlist, input_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    if( p_sys->p_preparser != NULL )
+        playlist_preparser_Cancel( p_sys->p_preparser, p_item );
+}
+
 int playlist_AskForArtEnqueue( playlist_t *p_playlist, input_item_t *p_item )
 {
     playlist_private_t *p_sys = pl_priv(p_playlist);
@@ -0,0 +1,625 @@
+/*****************************************************************************
+ * metacache.c: persistent cache of the preparsed meta data
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_input_item.h>
+#include <vlc_meta.h>
+#include <vlc_arrays.h>
+#include <vlc_fs.h>
+#include <vlc_url.h>
+
+#include <errno.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#   include <unistd.h>
+#endif
+
+#include "metacache.h"
+#include "../input/item.h"
+
+/*****************************************************************************
+ * Structures/definitions
+ *****************************************************************************/
+#define METACACHE_NAME "preparse.dat"
+#define METACACHE_STRING "preparse cache "PACKAGE_NAME
+
+/* Sub-version number, to be increased when the entries change */
+#define METACACHE_SUBVERSION_NUM 2
+
+/* Bounds the file to about a megabyte */
+#define METACACHE_MAX_ENTRIES 10000
+#define METACACHE_MAX_TRACKS  64
+
+/* Number of least recently used entries dropped when the cache is full */
+#define METACACHE_EVICT_COUNT (METACACHE_MAX_ENTRIES / 10)
+
+/* Longest string of the file, with its nul */
+#define METACACHE_STRING_MAX  16384
+
+typedef struct
+{
+    int32_t     i_cat;
+    uint32_t    i_codec;
+    int32_t     i_id;
+    uint32_t    i_width;    /* or the audio channels */
+    uint32_t    i_height;   /* or the audio sample rate */
+    char       *psz_language;
+} metacache_track_t;
+
+typedef struct
+{
+    int64_t     i_size;
+    int64_t     i_mtime;
+    uint64_t    i_used;     /* date of the last use, in cache accesses */
+    int64_t     i_duration;
+    char       *psz_title;
+    uint32_t    i_tracks;
+    metacache_track_t *p_tracks;
+} metacache_entry_t;
+
+struct playlist_metacache_t
+{
+    vlc_object_t    *p_obj;
+    char            *psz_dir;
+
+    vlc_mutex_t      lock;
+    vlc_dictionary_t entries; /* metacache_entry_t by path */
+    int              i_entries;
+    uint64_t         i_clock;
+    bool             b_dirty;
+};
+
+static void Load( playlist_metacache_t * );
+static void Evict( playlist_metacache_t * );
+
+static void EntryDelete( void *p_data, void *p_obj )
+{
+    metacache_entry_t *p_entry = p_data;
+    VLC_UNUSED(p_obj);
+
+    for( uint32_t i = 0; i < p_entry->i_tracks; i++ )
+        free( p_entry->p_tracks[i].psz_language );
+    free( p_entry->p_tracks );
+    free( p_entry->psz_title );
+    free( p_entry );
+}
+
+/**
+ * Returns the path of a local file item, and its status.
+ */
+static char *GetPath( input_item_t *p_item, struct stat *p_st )
+{
+    char *psz_uri = input_item_GetURI( p_item );
+    if( !psz_uri )
+        return NULL;
+
+    /* Only plain files can be recognized by their size and date */
+    char *psz_path = NULL;
+    if( !strncasecmp( psz_uri, "file://", 7 ) )
+        psz_path = make_path( psz_uri );
+    free( psz_uri );
+
+    if( psz_path && ( vlc_stat( psz_path, p_st ) || !S_ISREG(p_st->st_mode) ) )
+    {
+        free( psz_path );
+        return NULL;
+    }
+    return psz_path;
+}
+
+/*****************************************************************************
+ * Public functions
+ *****************************************************************************/
+playlist_metacache_t *playlist_metacache_New( vlc_object_t *p_obj )
+{
+    playlist_metacache_t *p_cache = malloc( sizeof(*p_cache) );
+    if( !p_cache )
+        return NULL;
+
+    p_cache->p_obj = p_obj;
+    p_cache->psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    vlc_mutex_init( &p_cache->lock );
+    vlc_dictionary_init( &p_cache->entries, 0 );
+    p_cache->i_entries = 0;
+    p_cache->i_clock = 0;
+    p_cache->b_dirty = false;
+
+    if( p_cache->psz_dir )
+        Load( p_cache );
+
+    return p_cache;
+}
+
+void playlist_metacache_Delete( playlist_metacache_t *p_cache )
+{
+    playlist_metacache_Save( p_cache );
+
+    vlc_dictionary_clear( &p_cache->entries, EntryDelete, NULL );
+    vlc_mutex_destroy( &p_cache->lock );
+    free( p_cache->psz_dir );
+    free( p_cache );
+}
+
+bool playlist_metacache_Get( playlist_metacache_t *p_cache,
+                             input_item_t *p_item )
+{
+    struct stat st;
+    char *psz_path = GetPath( p_item, &st );
+    if( !psz_path )
+        return false;
+
+    vlc_mutex_lock( &p_cache->lock );
+    metacache_entry_t *p_entry =
+        vlc_dictionary_value_for_key( &p_cache->entries, psz_path );
+    const bool b_hit = p_entry &&
+                       p_entry->i_size == (int64_t)st.st_size &&
+                       p_entry->i_mtime == (int64_t)st.st_mtime;
+    if( p_entry && !b_hit )
+    {
+        /* The file was modified since it was cached */
+        vlc_dictionary_remove_value_for_key( &p_cache->entries, psz_path,
+                                             EntryDelete, NULL );
+        p_cache->i_entries--;
+        p_cache->b_dirty = true;
+    }
+    if( b_hit )
+    {
+        p_entry->i_used = ++p_cache->i_clock;
+        if( p_entry->i_duration > 0 )
+            input_item_SetDuration( p_item, p_entry->i_duration );
+        if( p_entry->psz_title )
+            input_item_SetTitle( p_item, p_entry->psz_title );
+
+        for( uint32_t i = 0; i < p_entry->i_tracks; i++ )
+        {
+            const metacache_track_t *p_track = &p_entry->p_tracks[i];
+            es_format_t fmt;
+
+            es_format_Init( &fmt, p_track->i_cat, p_track->i_codec );
+            fmt.i_id = p_track->i_id;
+            if( fmt.i_cat == VIDEO_ES )
+            {
+                fmt.video.i_width =
+                fmt.video.i_visible_width = p_track->i_width;
+                fmt.video.i_height =
+                fmt.video.i_visible_height = p_track->i_height;
+            }
+            else if( fmt.i_cat == AUDIO_ES )
+            {
+                fmt.audio.i_channels = p_track->i_width;
+                fmt.audio.i_rate = p_track->i_height;
+            }
+            if( p_track->psz_language )
+                fmt.psz_language = strdup( p_track->psz_language );
+
+            input_item_UpdateTracksInfo( p_item, &fmt );
+            es_format_Clean( &fmt );
+        }
+    }
+    vlc_mutex_unlock( &p_cache->lock );
+
+    free( psz_path );
+    return b_hit;
+}
+
+void playlist_metacache_Put( playlist_metacache_t *p_cache,
+                             input_item_t *p_item )
+{
+    struct stat st;
+    char *psz_path = GetPath( p_item, &st );
+    if( !psz_path )
+        return;
+
+    /* The key could not be saved whole */
+    if( strlen( psz_path ) >= METACACHE_STRING_MAX )
+    {
+        free( psz_path );
+        return;
+    }
+
+    metacache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    if( !p_entry )
+    {
+        free( psz_path );
+        return;
+    }
+    p_entry->i_size = st.st_size;
+    p_entry->i_mtime = st.st_mtime;
+
+    vlc_mutex_lock( &p_item->lock );
+    p_entry->i_duration = p_item->i_duration;
+    p_entry->psz_title = NULL;
+    if( p_item->p_meta )
+    {
+        const char *psz_title = vlc_meta_Get( p_item->p_meta, vlc_meta_Title );
+        if( psz_title )
+            p_entry->psz_title = strdup( psz_title );
+    }
+
+    p_entry->i_tracks = __MIN( p_item->i_es, METACACHE_MAX_TRACKS );
+    p_entry->p_tracks = calloc( p_entry->i_tracks, sizeof(*p_entry->p_tracks) );
+    if( !p_entry->p_tracks )
+        p_entry->i_tracks = 0;
+    for( uint32_t i = 0; i < p_entry->i_tracks; i++ )
+    {
+        const es_format_t *p_fmt = p_item->es[i];
+        metacache_track_t *p_track = &p_entry->p_tracks[i];
+
+        p_track->i_cat = p_fmt->i_cat;
+        p_track->i_codec = p_fmt->i_codec;
+        p_track->i_id = p_fmt->i_id;
+        if( p_fmt->i_cat == VIDEO_ES )
+        {
+            p_track->i_width = p_fmt->video.i_visible_width ?
+                               p_fmt->video.i_visible_width :
+                               p_fmt->video.i_width;
+            p_track->i_height = p_fmt->video.i_visible_height ?
+                                p_fmt->video.i_visible_height :
+                                p_fmt->video.i_height;
+        }
+        else if( p_fmt->i_cat == AUDIO_ES )
+        {
+            p_track->i_width = p_fmt->audio.i_channels;
+            p_track->i_height = p_fmt->audio.i_rate;
+        }
+        p_track->psz_language = p_fmt->psz_language ?
+                                strdup( p_fmt->psz_language ) : NULL;
+    }
+    vlc_mutex_unlock( &p_item->lock );
+
+    /* Files without any track are kept too, so that the files which are not
+     * media are not opened again */
+    vlc_mutex_lock( &p_cache->lock );
+    if( vlc_dictionary_value_for_key( &p_cache->entries, psz_path ) )
+    {
+        vlc_dictionary_remove_value_for_key( &p_cache->entries, psz_path,
+                                             EntryDelete, NULL );
+        p_cache->i_entries--;
+    }
+    if( p_cache->i_entries >= METACACHE_MAX_ENTRIES )
+        Evict( p_cache );
+    p_entry->i_used = ++p_cache->i_clock;
+    vlc_dictionary_insert( &p_cache->entries, psz_path, p_entry );
+    p_cache->i_entries++;
+    p_cache->b_dirty = true;
+    vlc_mutex_unlock( &p_cache->lock );
+
+    free( psz_path );
+}
+
+/*****************************************************************************
+ * Privates functions
+ *****************************************************************************/
+static void Load( playlist_metacache_t *p_cache )
+{
+    char *psz_filename;
+    if( asprintf( &psz_filename, "%s"DIR_SEP METACACHE_NAME,
+                  p_cache->psz_dir ) == -1 )
+        return;
+
+    FILE *file = vlc_fopen( psz_filename, "rb" );
+    if( !file )
+    {
+        if( errno != ENOENT )
+            msg_Warn( p_cache->p_obj, "cannot read %s (%m)", psz_filename );
+        free( psz_filename );
+        return;
+    }
+    msg_Dbg( p_cache->p_obj, "loading preparse cache file %s", psz_filename );
+    free( psz_filename );
+
+    char psz_string[sizeof(METACACHE_STRING)];
+    int32_t i_marker;
+    uint32_t i_count;
+    if( fread( psz_string, 1, sizeof(METACACHE_STRING) - 1, file )
+            != sizeof(METACACHE_STRING) - 1
+     || memcmp( psz_string, METACACHE_STRING, sizeof(METACACHE_STRING) - 1 )
+     || fread( &i_marker, sizeof(i_marker), 1, file ) != 1
+     || i_marker != METACACHE_SUBVERSION_NUM
+     || fread( &i_count, sizeof(i_count), 1, file ) != 1 )
+    {
+        msg_Warn( p_cache->p_obj, "This doesn't look like a valid preparse "
+                  "cache" );
+        fclose( file );
+        return;
+    }
+
+#define LOAD_IMMEDIATE(a) \
+    if( fread( (void *)&a, sizeof(char), sizeof(a), file ) != sizeof(a) ) goto error
+#define LOAD_STRING(a) \
+{ \
+    uint16_t i_size; \
+    a = NULL; \
+    if( fread( &i_size, sizeof(i_size), 1, file ) != 1 ) \
+        goto error; \
+    if( i_size > METACACHE_STRING_MAX ) { \
+        /* Skipped with its entry, the next ones are still valid */ \
+        if( fseek( file, i_size, SEEK_CUR ) ) \
+            goto error; \
+        b_skip = true; \
+    } else if( i_size ) { \
+        char *psz = xmalloc( i_size ); \
+        if( fread( psz, i_size, 1, file ) != 1 ) { \
+            free( psz ); \
+            goto error; \
+        } \
+        if( psz[i_size-1] ) { \
+            free( psz ); \
+            goto error; \
+        } \
+        a = psz; \
+    } \
+}
+
+    for( uint32_t i = 0; i < i_count && i < METACACHE_MAX_ENTRIES; i++ )
+    {
+        char *psz_path = NULL;
+        bool b_skip = false;
+        metacache_entry_t *p_entry = xmalloc( sizeof(*p_entry) );
+        p_entry->psz_title = NULL;
+        p_entry->i_tracks = 0;
+        p_entry->p_tracks = NULL;
+
+        LOAD_STRING( psz_path );
+        LOAD_IMMEDIATE( p_entry->i_size );
+        LOAD_IMMEDIATE( p_entry->i_mtime );
+        LOAD_IMMEDIATE( p_entry->i_used );
+        LOAD_IMMEDIATE( p_entry->i_duration );
+        LOAD_STRING( p_entry->psz_title );
+
+        uint32_t i_tracks;
+        LOAD_IMMEDIATE( i_tracks );
+        if( i_tracks > METACACHE_MAX_TRACKS )
+            goto error;
+        if( i_tracks > 0 )
+            p_entry->p_tracks = xcalloc( i_tracks, sizeof(*p_entry->p_tracks) );
+        for( ; p_entry->i_tracks < i_tracks; p_entry->i_tracks++ )
+        {
+            metacache_track_t *p_track = &p_entry->p_tracks[p_entry->i_tracks];
+            LOAD_IMMEDIATE( p_track->i_cat );
+            LOAD_IMMEDIATE( p_track->i_codec );
+            LOAD_IMMEDIATE( p_track->i_id );
+            LOAD_IMMEDIATE( p_track->i_width );
+            LOAD_IMMEDIATE( p_track->i_height );
+            LOAD_STRING( p_track->psz_language );
+        }
+
+        if( b_skip )
+        {
+            msg_Dbg( p_cache->p_obj, "skipping an overlong preparse cache "
+                     "entry" );
+            free( psz_path );
+            EntryDelete( p_entry, NULL );
+            continue;
+        }
+        if( !psz_path || vlc_dictionary_value_for_key( &p_cache->entries,
+                                                       psz_path ) )
+        {
+        error:
+            msg_Warn( p_cache->p_obj, "This doesn't look like a valid "
+                      "preparse cache (corrupted entry)" );
+            free( psz_path );
+            EntryDelete( p_entry, NULL );
+            break;
+        }
+        vlc_dictionary_insert( &p_cache->entries, psz_path, p_entry );
+        p_cache->i_entries++;
+        if( p_entry->i_used > p_cache->i_clock )
+            p_cache->i_clock = p_entry->i_used;
+        free( psz_path );
+    }
+#undef LOAD_IMMEDIATE
+#undef LOAD_STRING
+
+    msg_Dbg( p_cache->p_obj, "%d preparsed items in the cache",
+             p_cache->i_entries );
+    fclose( file );
+}
+
+typedef struct
+{
+    uint64_t    i_used;
+    char       *psz_path;
+} metacache_use_t;
+
+static int UseCmp( const void *p_a, const void *p_b )
+{
+    const metacache_use_t *p_ua = p_a, *p_ub = p_b;
+
+    if( p_ua->i_used == p_ub->i_used )
+        return 0;
+    return p_ua->i_used < p_ub->i_used ? -1 : 1;
+}
+
+/* Drops the least recently used entries, the cache lock must be held */
+static void Evict( playlist_metacache_t *p_cache )
+{
+    metacache_use_t *p_uses = malloc( p_cache->i_entries * sizeof(*p_uses) );
+    if( !p_uses )
+        return;
+
+    int i_count = 0;
+    for( int i = 0; i < p_cache->entries.i_size; i++ )
+    {
+        for( const vlc_dictionary_entry_t *p_dict = p_cache->entries.p_entries[i];
+             p_dict != NULL && i_count < p_cache->i_entries;
+             p_dict = p_dict->p_next )
+        {
+            const metacache_entry_t *p_entry = p_dict->p_value;
+
+            p_uses[i_count].i_used = p_entry->i_used;
+            p_uses[i_count].psz_path = p_dict->psz_key;
+            i_count++;
+        }
+    }
+    qsort( p_uses, i_count, sizeof(*p_uses), UseCmp );
+
+    /* The keys are copied, as removing an entry frees its key */
+    const int i_evict = __MIN( i_count, METACACHE_EVICT_COUNT );
+    for( int i = 0; i < i_evict; i++ )
+        p_uses[i].psz_path = strdup( p_uses[i].psz_path );
+    for( int i = 0; i < i_evict; i++ )
+    {
+        if( !p_uses[i].psz_path )
+            continue;
+        vlc_dictionary_remove_value_for_key( &p_cache->entries,
+                                             p_uses[i].psz_path,
+                                             EntryDelete, NULL );
+        p_cache->i_entries--;
+        free( p_uses[i].psz_path );
+    }
+    free( p_uses );
+
+    msg_Dbg( p_cache->p_obj, "%d least recently used items dropped from the "
+             "preparse cache", i_evict );
+}
+
+/* The strings longer than Load() accepts are cut on a character boundary */
+static int SaveString( FILE *file, const char *psz )
+{
+    size_t i_len = psz ? strlen( psz ) : 0;
+    if( i_len >= METACACHE_STRING_MAX )
+    {
+        i_len = METACACHE_STRING_MAX - 1;
+        while( i_len > 0 && ( psz[i_len] & 0xc0 ) == 0x80 )
+            i_len--;
+    }
+
+    uint16_t i_size = psz ? i_len + 1 : 0;
+    if( fwrite( &i_size, sizeof(i_size), 1, file ) != 1 )
+        return VLC_EGENERIC;
+    if( psz && ( fwrite( psz, 1, i_len, file ) != i_len ||
+                 fputc( '\0', file ) == EOF ) )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+
+static int SaveEntries( FILE *file, const vlc_dictionary_t *p_entries,
+                        uint32_t i_count )
+{
+    if( fputs( METACACHE_STRING, file ) == EOF )
+        goto error;
+
+    int32_t i_marker = METACACHE_SUBVERSION_NUM;
+    if( fwrite( &i_marker, sizeof(i_marker), 1, file ) != 1
+     || fwrite( &i_count, sizeof(i_count), 1, file ) != 1 )
+        goto error;
+
+#define SAVE_IMMEDIATE( a ) \
+    if (fwrite (&a, sizeof(a), 1, file) != 1) \
+        goto error
+#define SAVE_STRING( a ) \
+    if (SaveString (file, a)) \
+        goto error
+
+    for( int i = 0; i < p_entries->i_size; i++ )
+    {
+        for( const vlc_dictionary_entry_t *p_dict = p_entries->p_entries[i];
+             p_dict != NULL; p_dict = p_dict->p_next )
+        {
+            const metacache_entry_t *p_entry = p_dict->p_value;
+
+            SAVE_STRING( p_dict->psz_key );
+            SAVE_IMMEDIATE( p_entry->i_size );
+            SAVE_IMMEDIATE( p_entry->i_mtime );
+            SAVE_IMMEDIATE( p_entry->i_used );
+            SAVE_IMMEDIATE( p_entry->i_duration );
+            SAVE_STRING( p_entry->psz_title );
+            SAVE_IMMEDIATE( p_entry->i_tracks );
+            for( uint32_t j = 0; j < p_entry->i_tracks; j++ )
+            {
+                const metacache_track_t *p_track = &p_entry->p_tracks[j];
+                SAVE_IMMEDIATE( p_track->i_cat );
+                SAVE_IMMEDIATE( p_track->i_codec );
+                SAVE_IMMEDIATE( p_track->i_id );
+                SAVE_IMMEDIATE( p_track->i_width );
+                SAVE_IMMEDIATE( p_track->i_height );
+                SAVE_STRING( p_track->psz_language );
+            }
+        }
+    }
+#undef SAVE_IMMEDIATE
+#undef SAVE_STRING
+
+    if( fflush( file ) )
+        goto error;
+    return 0;
+
+error:
+    return -1;
+}
+
+void playlist_metacache_Save( playlist_metacache_t *p_cache )
+{
+    char *psz_filename = NULL, *psz_tmpname = NULL;
+
+    vlc_mutex_lock( &p_cache->lock );
+    if( !p_cache->b_dirty || !p_cache->psz_dir )
+        goto out;
+    p_cache->b_dirty = false;
+
+    if( asprintf( &psz_filename, "%s"DIR_SEP METACACHE_NAME,
+                  p_cache->psz_dir ) == -1 )
+    {
+        psz_filename = NULL;
+        goto out;
+    }
+    if( asprintf( &psz_tmpname, "%s.%"PRIu32, psz_filename,
+                  (uint32_t)getpid() ) == -1 )
+    {
+        psz_tmpname = NULL;
+        goto out;
+    }
+
+    vlc_mkdir( p_cache->psz_dir, 0700 );
+    FILE *file = vlc_fopen( psz_tmpname, "wb" );
+    if( file == NULL )
+    {
+        if( errno != EACCES && errno != ENOENT )
+            msg_Warn( p_cache->p_obj, "cannot create %s (%m)", psz_tmpname );
+        goto out;
+    }
+
+    msg_Dbg( p_cache->p_obj, "saving preparse cache %s", psz_filename );
+    if( SaveEntries( file, &p_cache->entries, p_cache->i_entries ) )
+    {
+        msg_Warn( p_cache->p_obj, "cannot write %s (%m)", psz_tmpname );
+        clearerr( file );
+        fclose( file );
+        vlc_unlink( psz_tmpname );
+        goto out;
+    }
+
+#if !defined( WIN32 ) && !defined( __OS2__ )
+    vlc_rename( psz_tmpname, psz_filename ); /* atomically replace old cache */
+    fclose( file );
+#else
+    vlc_unlink( psz_filename );
+    fclose( file );
+    vlc_rename( psz_tmpname, psz_filename );
+#endif
+out:
+    vlc_mutex_unlock( &p_cache->lock );
+    free( psz_tmpname );
+    free( psz_filename );
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************
+ * metacache.h: persistent cache of the preparsed meta data
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _PLAYLIST_METACACHE_H
+#define _PLAYLIST_METACACHE_H 1
+
+/**
+ * Meta cache opaque structure.
+ *
+ * The meta cache keeps what the preparser found about local files (duration,
+ * title and tracks) across runs, keyed by path, size and modification time.
+ * It is thread-safe.
+ */
+typedef struct playlist_metacache_t playlist_metacache_t;
+
+/**
+ * This function creates the meta cache and loads it from the disk.
+ */
+playlist_metacache_t *playlist_metacache_New( vlc_object_t * );
+
+/**
+ * This function fills the item from the cache.
+ *
+ * \return true if the item is a local file whose entry is up to date
+ */
+bool playlist_metacache_Get( playlist_metacache_t *, input_item_t * );
+
+/**
+ * This function stores what was preparsed of the item.
+ */
+void playlist_metacache_Put( playlist_metacache_t *, input_item_t * );
+
+/**
+ * This function writes the cache to the disk if it was modified.
+ */
+void playlist_metacache_Save( playlist_metacache_t * );
+
+/**
+ * This function saves and destroys the meta cache.
+ */
+void playlist_metacache_Delete( playlist_metacache_t * );
+
+#endif
@@ -31,6 +31,7 @@
 #include "art.h"
 #include "fetcher.h"
 #include "preparser.h"
+#include "metacache.h"
 #include "../input/input_interface.h"
 
 
@@ -41,10 +42,12 @@ struct playlist_preparser_t
 {
     playlist_t          *p_playlist;
     playlist_fetcher_t  *p_fetcher;
+    playlist_metacache_t *p_cache;
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
+    int             i_live;
+    int             i_max;
     input_item_t  **pp_waiting;
     int             i_waiting;
 
@@ -53,6 +56,14 @@ struct playlist_preparser_t
 
 static void *Thread( void * );
 
+static int Find( playlist_preparser_t *p_preparser, input_item_t *p_item )
+{
+    for( int i = 0; i < p_preparser->i_waiting; i++ )
+        if( p_preparser->pp_waiting[i] == p_item )
+            return i;
+    return -1;
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -66,7 +77,13 @@ playlist_preparser_t *playlist_preparser_New( playlist_t *p_playlist, playlist_f
     p_preparser->p_fetcher = p_fetcher;
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    p_preparser->b_live = false;
+    p_preparser->i_live = 0;
+    p_preparser->i_max = var_InheritInteger( p_playlist, "preparse-threads" );
+    if( p_preparser->i_max <= 0 )
+        p_preparser->i_max = __MIN( vlc_GetCPUCount(), 4 );
+    p_preparser->p_cache = NULL;
+    if( var_InheritBool( p_playlist, "preparse-cache" ) )
+        p_preparser->p_cache = playlist_metacache_New( VLC_OBJECT(p_playlist) );
     p_preparser->i_art_policy = var_GetInteger( p_playlist, "album-art" );
     p_preparser->i_waiting = 0;
     p_preparser->pp_waiting = NULL;
@@ -74,25 +91,51 @@ playlist_preparser_t *playlist_preparser_New( playlist_t *p_playlist, playlist_f
     return p_preparser;
 }
 
-void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item )
+void playlist_preparser_Push( playlist_preparser_t *p_preparser,
+                              input_item_t *p_item, bool b_priority )
 {
-    vlc_gc_incref( p_item );
-
     vlc_mutex_lock( &p_preparser->lock );
+    const int i_old = Find( p_preparser, p_item );
+    if( i_old >= 0 )
+    {
+        /* Already queued, only move it ahead if asked to */
+        if( !b_priority )
+        {
+            vlc_mutex_unlock( &p_preparser->lock );
+            return;
+        }
+        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, i_old );
+    }
+    else
+        vlc_gc_incref( p_item );
+
     INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_item );
-    if( !p_preparser->b_live )
+                 b_priority ? 0 : p_preparser->i_waiting, p_item );
+    if( p_preparser->i_live < p_preparser->i_max )
     {
         if( vlc_clone_detach( NULL, Thread, p_preparser,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Warn( p_preparser->p_playlist,
                       "cannot spawn pre-parser thread" );
         else
-            p_preparser->b_live = true;
+            p_preparser->i_live++;
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
 
+void playlist_preparser_Cancel( playlist_preparser_t *p_preparser,
+                                input_item_t *p_item )
+{
+    vlc_mutex_lock( &p_preparser->lock );
+    const int i_old = Find( p_preparser, p_item );
+    if( i_old >= 0 )
+        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, i_old );
+    vlc_mutex_unlock( &p_preparser->lock );
+
+    if( i_old >= 0 )
+        vlc_gc_decref( p_item );
+}
+
 void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 {
     vlc_mutex_lock( &p_preparser->lock );
@@ -103,10 +146,13 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
         REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
     }
 
-    while( p_preparser->b_live )
+    while( p_preparser->i_live > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
+    if( p_preparser->p_cache )
+        playlist_metacache_Delete( p_preparser->p_cache );
+
     /* Destroy the item preparser */
     vlc_cond_destroy( &p_preparser->wait );
     vlc_mutex_destroy( &p_preparser->lock );
@@ -119,8 +165,11 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 /**
  * This function preparses an item when needed.
  */
-static void Preparse( playlist_t *p_playlist, input_item_t *p_item )
+static void Preparse( playlist_preparser_t *p_preparser, input_item_t *p_item )
 {
+    playlist_t *p_playlist = p_preparser->p_playlist;
+    playlist_metacache_t *p_cache = p_preparser->p_cache;
+
     vlc_mutex_lock( &p_item->lock );
     int i_type = p_item->i_type;
     vlc_mutex_unlock( &p_item->lock );
@@ -136,7 +185,13 @@ static void Preparse( playlist_t *p_playlist, input_item_t *p_item )
     /* Do not preparse if it is already done (like by playing it) */
     if( !input_item_IsPreparsed( p_item ) )
     {
-        input_Preparse( VLC_OBJECT(p_playlist), p_item );
+        /* Local files which did not change are not opened again */
+        if( !p_cache || !playlist_metacache_Get( p_cache, p_item ) )
+        {
+            input_Preparse( VLC_OBJECT(p_playlist), p_item );
+            if( p_cache )
+                playlist_metacache_Put( p_cache, p_item );
+        }
         input_item_SetPreparsed( p_item, true );
 
         var_SetAddress( p_playlist, "item-change", p_item );
@@ -187,16 +242,18 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
 }
 
 /**
- * This function does the preparsing and issues the art fetching requests
+ * This function does the preparsing and issues the art fetching requests.
+ * Up to i_max of them run at once, and exit when the queue is empty.
  */
 static void *Thread( void *data )
 {
     playlist_preparser_t *p_preparser = data;
-    playlist_t *p_playlist = p_preparser->p_playlist;
+    bool b_saved = false;
 
     for( ;; )
     {
         input_item_t *p_current;
+        bool b_save = false;
 
         /* */
         vlc_mutex_lock( &p_preparser->lock );
@@ -208,15 +265,30 @@ static void *Thread( void *data )
         else
         {
             p_current = NULL;
-            p_preparser->b_live = false;
-            vlc_cond_signal( &p_preparser->wait );
+            /* The last worker to go idle writes what was found, it stays
+             * live meanwhile so that the cache is not deleted under it */
+            b_save = p_preparser->i_live == 1 && p_preparser->p_cache &&
+                     !b_saved;
+            if( !b_save )
+            {
+                p_preparser->i_live--;
+                vlc_cond_signal( &p_preparser->wait );
+            }
         }
         vlc_mutex_unlock( &p_preparser->lock );
 
+        if( b_save )
+        {
+            /* The items queued meanwhile are handled before leaving */
+            playlist_metacache_Save( p_preparser->p_cache );
+            b_saved = true;
+            continue;
+        }
         if( !p_current )
             break;
 
-        Preparse( p_playlist, p_current );
+        b_saved = false;
+        Preparse( p_preparser, p_current );
 
         Art( p_preparser, p_current );
     }
@@ -29,7 +29,7 @@
  * Preparser opaque structure.
  *
  * The preparser object will retreive the meta data of any given input item in
- * an asynchronous way.
+ * an asynchronous way, with a few items at once.
  * It will also issue art fetching requests.
  */
 typedef struct playlist_preparser_t playlist_preparser_t;
@@ -43,9 +43,16 @@ playlist_preparser_t *playlist_preparser_New( playlist_t *, playlist_fetcher_t *
  * This function enqueues the provided item to be preparsed.
  *
  * The input item is retained until the preparsing is done or until the
- * preparser object is deleted.
+ * preparser object is deleted. With b_priority, the item is put (or moved
+ * if it is already queued) ahead of the others.
  */
-void playlist_preparser_Push( playlist_preparser_t *, input_item_t * );
+void playlist_preparser_Push( playlist_preparser_t *, input_item_t *, bool b_priority );
+
+/**
+ * This function removes the provided item from the queue, unless it is
+ * already being preparsed.
+ */
+void playlist_preparser_Cancel( playlist_preparser_t *, input_item_t * );
 
 /**
  * This function destroys the preparser object and thread.
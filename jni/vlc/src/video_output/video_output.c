@@ -700,8 +700,249 @@ static int VoutVideoFilterInteractiveAllocationSetup(filter_t *filter, void *dat
     filter->p_owner             = data; /* vout */
     return VLC_SUCCESS;
 }
+/*****************************************************************************
+ * Incremental subpicture blending
+ *
+ * When the same picture is rendered again (pause, redisplay) only the areas
+ * of the regions that have changed since the previous rendering are restored
+ * from the source picture and blended again.
+ *****************************************************************************/
+typedef struct {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} vout_blend_rect_t;
+
+static void ThreadBlendedClean(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    for (int i = 0; i < sys->blended.count; i++)
+        picture_Release(sys->blended.region[i].picture);
+    sys->blended.count = 0;
+
+    if (sys->blended.source)
+        picture_Release(sys->blended.source);
+    sys->blended.source = NULL;
+    if (sys->blended.output)
+        picture_Release(sys->blended.output);
+    sys->blended.output = NULL;
+}
+
+/* Returns the number of regions of the subpicture or -1 if too many */
+static int BlendedRegionsGet(vout_blended_region_t *region,
+                             const subpicture_t *subpic)
+{
+    int count = 0;
+
+    for (subpicture_region_t *r = subpic->p_region; r != NULL; r = r->p_next) {
+        if (count >= VOUT_MAX_BLENDED_REGIONS)
+            return -1;
+        vout_blended_region_t *dst = &region[count++];
+        dst->picture  = r->p_picture;
+        dst->x        = r->i_x;
+        dst->y        = r->i_y;
+        dst->x_offset = r->fmt.i_x_offset;
+        dst->y_offset = r->fmt.i_y_offset;
+        dst->width    = r->fmt.i_visible_width;
+        dst->height   = r->fmt.i_visible_height;
+        dst->alpha    = subpic->i_alpha * r->i_alpha / 255;
+    }
+    return count;
+}
+
+static bool BlendedRegionIsEqual(const vout_blended_region_t *a,
+                                 const vout_blended_region_t *b)
+{
+    return a->picture  == b->picture &&
+           a->x        == b->x && a->y == b->y &&
+           a->x_offset == b->x_offset && a->y_offset == b->y_offset &&
+           a->width    == b->width && a->height == b->height &&
+           a->alpha    == b->alpha;
+}
+
+/* The area is aligned on 2 pixels so that it always covers whole chroma
+ * samples of subsampled formats */
+static vout_blend_rect_t BlendedRegionArea(const vout_blended_region_t *region,
+                                           const video_format_t *fmt)
+{
+    const int x = fmt->i_x_offset + region->x;
+    const int y = fmt->i_y_offset + region->y;
+    vout_blend_rect_t rect = {
+        .x0 = __MAX(x & ~1, 0),
+        .y0 = __MAX(y & ~1, 0),
+        .x1 = __MIN((x + (int)region->width  + 1) & ~1, (int)fmt->i_width),
+        .y1 = __MIN((y + (int)region->height + 1) & ~1, (int)fmt->i_height),
+    };
+    return rect;
+}
+
+static bool BlendRectOverlap(const vout_blend_rect_t *a, const vout_blend_rect_t *b)
+{
+    return __MAX(a->x0, b->x0) < __MIN(a->x1, b->x1) &&
+           __MAX(a->y0, b->y0) < __MIN(a->y1, b->y1);
+}
+
+static void PictureCopyArea(picture_t *dst, const picture_t *src,
+                            const vout_blend_rect_t *rect)
+{
+    const int64_t width  = dst->format.i_width;
+    const int64_t height = dst->format.i_height;
+
+    if (rect->x0 >= rect->x1 || rect->y0 >= rect->y1)
+        return;
+
+    for (int i = 0; i < __MIN(dst->i_planes, src->i_planes); i++) {
+        plane_t       *d = &dst->p[i];
+        const plane_t *s = &src->p[i];
+
+        const int visible_pitch = __MIN(d->i_visible_pitch, s->i_visible_pitch);
+        const int visible_lines = __MIN(d->i_visible_lines, s->i_visible_lines);
+        const int x0 = rect->x0 * d->i_visible_pitch / width;
+        const int x1 = __MIN((rect->x1 * d->i_visible_pitch + width - 1) / width,
+                             visible_pitch);
+        const int y0 = rect->y0 * d->i_visible_lines / height;
+        const int y1 = __MIN((rect->y1 * d->i_visible_lines + height - 1) / height,
+                             visible_lines);
+
+        for (int y = y0; y < y1; y++)
+            memcpy(&d->p_pixels[y * d->i_pitch + x0],
+                   &s->p_pixels[y * s->i_pitch + x0], x1 - x0);
+    }
+}
+
+static void PictureBlendRegion(picture_t *dst, filter_t *blend,
+                               const vout_blended_region_t *region,
+                               const subpicture_region_t *r)
+{
+    if (filter_ConfigureBlend(blend, dst->format.i_width, dst->format.i_height,
+                              &r->fmt) ||
+        filter_Blend(blend, dst, region->x, region->y, region->picture,
+                     region->alpha))
+        msg_Err(blend, "blending %4.4s to %4.4s failed",
+                (char *)&blend->fmt_in.video.i_chroma,
+                (char *)&blend->fmt_out.video.i_chroma);
+}
+
+/* Redraws the changed areas of the last blended picture, returns false if
+ * it cannot be reused */
+static bool ThreadBlendedUpdate(vout_thread_t *vout, picture_t *filtered,
+                                subpicture_t *subpic,
+                                const vout_blended_region_t *region, int count)
+{
+    vout_thread_sys_t *sys = vout->p;
+    picture_t *output = sys->blended.output;
+
+    if (sys->blended.source != filtered || !output ||
+        picture_IsReferenced(output))
+        return false;
+
+    /* Find the areas that have changed */
+    vout_blend_rect_t dirty[2 * VOUT_MAX_BLENDED_REGIONS];
+    int dirty_count = 0;
+    bool kept[VOUT_MAX_BLENDED_REGIONS];
+    bool redraw[VOUT_MAX_BLENDED_REGIONS];
+
+    for (int i = 0; i < count; i++)
+        kept[i] = redraw[i] = false;
+    for (int i = 0; i < sys->blended.count; i++) {
+        const vout_blended_region_t *old = &sys->blended.region[i];
+        int j;
+        for (j = 0; j < count; j++) {
+            if (!kept[j] && BlendedRegionIsEqual(old, &region[j]))
+                break;
+        }
+        if (j < count)
+            kept[j] = true;
+        else
+            dirty[dirty_count++] = BlendedRegionArea(old, &output->format);
+    }
+    for (int i = 0; i < count; i++) {
+        if (!kept[i]) {
+            redraw[i] = true;
+            dirty[dirty_count++] = BlendedRegionArea(&region[i], &output->format);
+        }
+    }
+    if (dirty_count <= 0)
+        return true;
+
+    /* Unchanged regions overlapping a restored area are blended again, and
+     * so is the area they cover */
+    for (bool is_changed = true; is_changed; ) {
+        is_changed = false;
+        for (int i = 0; i < count; i++) {
+            if (redraw[i])
+                continue;
+            const vout_blend_rect_t area = BlendedRegionArea(&region[i], &output->format);
+            for (int j = 0; j < dirty_count; j++) {
+                if (BlendRectOverlap(&area, &dirty[j])) {
+                    redraw[i] = true;
+                    dirty[dirty_count++] = area;
+                    is_changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < dirty_count; i++)
+        PictureCopyArea(output, filtered, &dirty[i]);
+
+    int i = 0;
+    for (subpicture_region_t *r = subpic->p_region; r != NULL; r = r->p_next, i++) {
+        if (redraw[i])
+            PictureBlendRegion(output, sys->spu_blend, &region[i], r);
+    }
+    return true;
+}
+
+static picture_t *ThreadBlendSubpicture(vout_thread_t *vout, picture_t *filtered,
+                                        subpicture_t *subpic, bool is_direct)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    /* Direct pictures belong to the display and may not keep their content
+     * once displayed */
+    vout_blended_region_t region[VOUT_MAX_BLENDED_REGIONS];
+    const int count = !is_direct && sys->spu_blend ?
+                      BlendedRegionsGet(region, subpic) : -1;
+
+    if (count >= 0 &&
+        ThreadBlendedUpdate(vout, filtered, subpic, region, count)) {
+        for (int i = 0; i < sys->blended.count; i++)
+            picture_Release(sys->blended.region[i].picture);
+        for (int i = 0; i < count; i++)
+            picture_Hold(region[i].picture);
+        memcpy(sys->blended.region, region, count * sizeof(*region));
+        sys->blended.count = count;
+        return picture_Hold(sys->blended.output);
+    }
+    ThreadBlendedClean(vout);
+
+    picture_t *todisplay = picture_pool_Get(sys->private_pool);
+    if (!todisplay)
+        return NULL;
+    VideoFormatCopyCropAr(&todisplay->format, &filtered->format);
+    picture_Copy(todisplay, filtered);
+    if (sys->spu_blend)
+        picture_BlendSubpicture(todisplay, sys->spu_blend, subpic);
+
+    if (count >= 0) {
+        sys->blended.source = picture_Hold(filtered);
+        sys->blended.output = picture_Hold(todisplay);
+        for (int i = 0; i < count; i++)
+            picture_Hold(region[i].picture);
+        memcpy(sys->blended.region, region, count * sizeof(*region));
+        sys->blended.count = count;
+    }
+    return todisplay;
+}
+
 static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
 {
+    ThreadBlendedClean(vout);
+
     if (vout->p->displayed.current)
         picture_Release( vout->p->displayed.current );
     vout->p->displayed.current = NULL;
@@ -971,14 +1212,10 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
      */
     bool is_direct = vout->p->decoder_pool == vout->p->display_pool;
     picture_t *todisplay = filtered;
+    if (!do_early_spu || !subpic)
+        ThreadBlendedClean(vout);
     if (do_early_spu && subpic) {
-        todisplay = picture_pool_Get(vout->p->private_pool);
-        if (todisplay) {
-            VideoFormatCopyCropAr(&todisplay->format, &filtered->format);
-            picture_Copy(todisplay, filtered);
-            if (vout->p->spu_blend)
-                picture_BlendSubpicture(todisplay, vout->p->spu_blend, subpic);
-        }
+        todisplay = ThreadBlendSubpicture(vout, filtered, subpic, is_direct);
         picture_Release(filtered);
         subpicture_Delete(subpic);
         subpic = NULL;
@@ -1335,6 +1572,10 @@ static int ThreadStart(vout_thread_t *vout, const vout_display_state_t *state)
     vout->p->display_pool = NULL;
     vout->p->private_pool = NULL;
 
+    vout->p->blended.source = NULL;
+    vout->p->blended.output = NULL;
+    vout->p->blended.count  = 0;
+
     vout->p->filter.configuration = NULL;
     video_format_Copy(&vout->p->filter.format, &vout->p->original);
     vout->p->filter.chain_static =
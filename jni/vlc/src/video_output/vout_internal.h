@@ -43,6 +43,21 @@
  */
 #define VOUT_MAX_PICTURES (20)
 
+/* Maximum number of subpicture regions tracked to redraw only the changed
+ * areas of a picture rendered again */
+#define VOUT_MAX_BLENDED_REGIONS (32)
+
+typedef struct {
+    picture_t *picture;
+    int       x;
+    int       y;
+    unsigned  x_offset;
+    unsigned  y_offset;
+    unsigned  width;
+    unsigned  height;
+    int       alpha;
+} vout_blended_region_t;
+
 /* */
 struct vout_thread_sys_t
 {
@@ -68,6 +83,14 @@ struct vout_thread_sys_t
     vlc_fourcc_t    spu_blend_chroma;
     filter_t        *spu_blend;
 
+    /* Last picture the subpictures were blended into */
+    struct {
+        picture_t             *source;
+        picture_t             *output;
+        int                   count;
+        vout_blended_region_t region[VOUT_MAX_BLENDED_REGIONS];
+    } blended;
+
     /* Video output window */
     struct {
         bool              is_unused;
@@ -51,16 +51,43 @@
 /* Number of simultaneous subpictures */
 #define VOUT_MAX_SUBPICTURES (__MAX(VOUT_MAX_PICTURES, SPU_MAX_PREPARE_TIME/5000))
 
+/* How long before their start date the subtitles are rendered */
+#define SPU_PRERENDER_AHEAD (INT64_C(2000000))
+
+/* Maximum number of chromas given to the text renderer of the prerenderer */
+#define SPU_PRERENDER_CHROMAS (8)
+
 /* */
 typedef struct {
     subpicture_t *subpicture;
     bool          reject;
+    bool          is_prerendered;
 } spu_heap_entry_t;
 
 typedef struct {
     spu_heap_entry_t entry[VOUT_MAX_SUBPICTURES];
 } spu_heap_t;
 
+/* Scaled pictures kept across renders, so that a region referencing an
+ * already scaled picture (eg. an unchanged part of an animated subtitle)
+ * does not need to be scaled again */
+#define SPU_SCALED_MAX (16)
+
+typedef struct {
+    picture_t    *source;
+    unsigned     source_width;
+    unsigned     source_height;
+    unsigned     source_visible_width;
+    unsigned     source_visible_height;
+    unsigned     source_x_offset;
+    unsigned     source_y_offset;
+    unsigned     width;
+    unsigned     height;
+    vlc_fourcc_t chroma;
+    picture_t    *picture;
+    bool         is_used;
+} spu_scaled_t;
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     vlc_object_t *input;
@@ -93,8 +120,106 @@ struct spu_private_t {
 
     /* */
     mtime_t last_sort_date;
+
+    /* */
+    int          scaled_count;
+    spu_scaled_t scaled[SPU_SCALED_MAX];
+
+    /* Subtitles rendered ahead of their start date by a dedicated thread,
+     * the heap entry being rendered is only accessed by this thread */
+    struct {
+        bool           is_running;
+        bool           is_stopping;
+        vlc_thread_t   thread;
+        vlc_cond_t     wait;
+        vlc_cond_t     done;
+        filter_t       *text;
+        subpicture_t   *busy;
+
+        bool           has_fmt;
+        video_format_t fmt_src;
+        video_format_t fmt_dst;
+        vlc_fourcc_t   chroma_list[SPU_PRERENDER_CHROMAS + 1];
+
+        unsigned       count;
+        unsigned       miss_count;
+        mtime_t        margin_total;
+        mtime_t        margin_min;
+    } prerender;
 };
 
+/*****************************************************************************
+ * scaled picture cache
+ *****************************************************************************/
+static picture_t *SpuScaledGet(spu_private_t *sys,
+                               const subpicture_region_t *region,
+                               unsigned width, unsigned height,
+                               vlc_fourcc_t chroma)
+{
+    for (int i = 0; i < sys->scaled_count; i++) {
+        spu_scaled_t *scaled = &sys->scaled[i];
+
+        if (scaled->source == region->p_picture &&
+            scaled->source_width          == region->fmt.i_width &&
+            scaled->source_height         == region->fmt.i_height &&
+            scaled->source_visible_width  == region->fmt.i_visible_width &&
+            scaled->source_visible_height == region->fmt.i_visible_height &&
+            scaled->source_x_offset       == region->fmt.i_x_offset &&
+            scaled->source_y_offset       == region->fmt.i_y_offset &&
+            scaled->width  == width &&
+            scaled->height == height &&
+            scaled->chroma == chroma) {
+            scaled->is_used = true;
+            picture_Hold(scaled->picture);
+            return scaled->picture;
+        }
+    }
+    return NULL;
+}
+
+static void SpuScaledAdd(spu_private_t *sys,
+                         const subpicture_region_t *region,
+                         vlc_fourcc_t chroma, picture_t *picture)
+{
+    if (sys->scaled_count >= SPU_SCALED_MAX)
+        return;
+
+    spu_scaled_t *scaled = &sys->scaled[sys->scaled_count++];
+    scaled->source                = region->p_picture;
+    scaled->source_width          = region->fmt.i_width;
+    scaled->source_height         = region->fmt.i_height;
+    scaled->source_visible_width  = region->fmt.i_visible_width;
+    scaled->source_visible_height = region->fmt.i_visible_height;
+    scaled->source_x_offset       = region->fmt.i_x_offset;
+    scaled->source_y_offset       = region->fmt.i_y_offset;
+    scaled->width                 = picture->format.i_width;
+    scaled->height                = picture->format.i_height;
+    scaled->chroma                = chroma;
+    scaled->picture               = picture;
+    scaled->is_used               = true;
+    picture_Hold(scaled->source);
+    picture_Hold(scaled->picture);
+}
+
+/* Drops the pictures not used since the last call, or all of them */
+static void SpuScaledClean(spu_private_t *sys, bool all)
+{
+    int count = 0;
+
+    for (int i = 0; i < sys->scaled_count; i++) {
+        spu_scaled_t *scaled = &sys->scaled[i];
+
+        if (!all && scaled->is_used) {
+            scaled->is_used = false;
+            sys->scaled[count++] = *scaled;
+            continue;
+        }
+        picture_Release(scaled->source);
+        picture_Release(scaled->picture);
+    }
+    sys->scaled_count = count;
+}
+
 /*****************************************************************************
  * heap managment
  *****************************************************************************/
@@ -103,8 +228,9 @@ static void SpuHeapInit(spu_heap_t *heap)
     for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++) {
         spu_heap_entry_t *e = &heap->entry[i];
 
-        e->subpicture = NULL;
-        e->reject     = false;
+        e->subpicture     = NULL;
+        e->reject         = false;
+        e->is_prerendered = false;
     }
 }
 
@@ -116,8 +242,9 @@ static int SpuHeapPush(spu_heap_t *heap, subpicture_t *subpic)
         if (e->subpicture)
             continue;
 
-        e->subpicture = subpic;
-        e->reject     = false;
+        e->subpicture     = subpic;
+        e->reject         = false;
+        e->is_prerendered = false;
         return VLC_SUCCESS;
     }
     return VLC_EGENERIC;
@@ -253,13 +380,11 @@ static filter_t *SpuRenderCreateAndLoadScale(vlc_object_t *object,
     return scale;
 }
 
-static void SpuRenderText(spu_t *spu, bool *rerender_text,
+static void SpuRenderText(filter_t *text, bool *rerender_text,
                           subpicture_region_t *region,
                           const vlc_fourcc_t *chroma_list,
                           mtime_t elapsed_time)
 {
-    filter_t *text = spu->p->text;
-
     assert(region->fmt.i_chroma == VLC_CODEC_TEXT);
 
     if (!text || !text->p_module)
@@ -294,6 +419,191 @@ static void SpuRenderText(spu_t *spu, bool *rerender_text,
     *rerender_text = var_GetBool(text, "text-rerender");
 }
 
+static void SpuFixOriginalSize(spu_t *spu, subpicture_t *subpic,
+                               const video_format_t *fmt_src)
+{
+    if (subpic->i_original_picture_width  > 0 &&
+        subpic->i_original_picture_height > 0)
+        return;
+
+    if (subpic->i_original_picture_width  > 0 ||
+        subpic->i_original_picture_height > 0)
+        msg_Err(spu, "original picture size %dx%d is unsupported",
+                 subpic->i_original_picture_width,
+                 subpic->i_original_picture_height);
+    else
+        msg_Warn(spu, "original picture size is undefined");
+
+    subpic->i_original_picture_width  = fmt_src->i_width;
+    subpic->i_original_picture_height = fmt_src->i_height;
+}
+
+/*****************************************************************************
+ * Subtitles prerendering
+ *
+ * The subtitles are updated and their text regions rendered by a dedicated
+ * thread before their start date, so that the video output thread mostly
+ * has to blend them.
+ *
+ * Only the subtitles rendered independently of each other are prerendered:
+ * a renderer keeping a state across subpictures (eg. libass) must be driven
+ * in display order by the video output thread.
+ *****************************************************************************/
+static bool SpuPrerenderIsNeeded(const subpicture_t *subpic)
+{
+    if (!subpic->b_subtitle)
+        return false;
+    if (subpic->updater.pf_validate)
+        return subpic->updater.b_stateless;
+    for (subpicture_region_t *r = subpic->p_region; r != NULL; r = r->p_next) {
+        if (r->fmt.i_chroma == VLC_CODEC_TEXT)
+            return true;
+    }
+    return false;
+}
+
+/* Returns the next heap entry to be prerendered, or NULL and the date at
+ * which one will be */
+static spu_heap_entry_t *SpuPrerenderNext(spu_private_t *sys, mtime_t *deadline)
+{
+    spu_heap_entry_t *next = NULL;
+    const mtime_t now = mdate();
+
+    *deadline = VLC_TS_INVALID;
+    if (!sys->prerender.has_fmt)
+        return NULL;
+
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++) {
+        spu_heap_entry_t *entry = &sys->heap.entry[i];
+        subpicture_t *subpic = entry->subpicture;
+
+        if (!subpic || entry->reject || entry->is_prerendered)
+            continue;
+        if (!SpuPrerenderIsNeeded(subpic)) {
+            entry->is_prerendered = true;
+            continue;
+        }
+        if (subpic->i_start > now + SPU_PRERENDER_AHEAD) {
+            const mtime_t date = subpic->i_start - SPU_PRERENDER_AHEAD;
+            if (*deadline == VLC_TS_INVALID || date < *deadline)
+                *deadline = date;
+            continue;
+        }
+        if (!next || subpic->i_start < next->subpicture->i_start)
+            next = entry;
+    }
+    return next;
+}
+
+static void SpuPrerender(spu_t *spu, subpicture_t *subpic,
+                         const video_format_t *fmt_src,
+                         const video_format_t *fmt_dst,
+                         const vlc_fourcc_t *chroma_list)
+{
+    filter_t *text = spu->p->prerender.text;
+
+    subpicture_Update(subpic, fmt_src, fmt_dst, subpic->i_start);
+
+    SpuFixOriginalSize(spu, subpic, fmt_src);
+    if (!text)
+        return;
+
+    text->fmt_out.video.i_width          =
+    text->fmt_out.video.i_visible_width  = subpic->i_original_picture_width;
+    text->fmt_out.video.i_height         =
+    text->fmt_out.video.i_visible_height = subpic->i_original_picture_height;
+
+    for (subpicture_region_t *r = subpic->p_region; r != NULL; r = r->p_next) {
+        if (r->fmt.i_chroma != VLC_CODEC_TEXT)
+            continue;
+
+        video_format_t fmt_original = r->fmt;
+        bool rerender_text = false;
+        SpuRenderText(text, &rerender_text, r, chroma_list, 0);
+
+        /* Time dependent text is rendered by the video output thread */
+        if (rerender_text) {
+            if (r->p_picture)
+                picture_Release(r->p_picture);
+            r->p_picture = NULL;
+            r->fmt = fmt_original;
+        }
+    }
+}
+
+static void *SpuPrerenderThread(void *data)
+{
+    spu_t *spu = data;
+    spu_private_t *sys = spu->p;
+
+    vlc_mutex_lock(&sys->lock);
+    for (;;) {
+        spu_heap_entry_t *entry = NULL;
+        mtime_t deadline;
+
+        while (!sys->prerender.is_stopping &&
+               !(entry = SpuPrerenderNext(sys, &deadline))) {
+            if (deadline != VLC_TS_INVALID)
+                vlc_cond_timedwait(&sys->prerender.wait, &sys->lock, deadline);
+            else
+                vlc_cond_wait(&sys->prerender.wait, &sys->lock);
+        }
+        if (sys->prerender.is_stopping)
+            break;
+
+        subpicture_t *subpic = sys->prerender.busy = entry->subpicture;
+        video_format_t fmt_src = sys->prerender.fmt_src;
+        video_format_t fmt_dst = sys->prerender.fmt_dst;
+        vlc_fourcc_t chroma_list[SPU_PRERENDER_CHROMAS + 1];
+        memcpy(chroma_list, sys->prerender.chroma_list, sizeof(chroma_list));
+        vlc_mutex_unlock(&sys->lock);
+
+        SpuPrerender(spu, subpic, &fmt_src, &fmt_dst, chroma_list);
+        const mtime_t margin = subpic->i_start - mdate();
+
+        vlc_mutex_lock(&sys->lock);
+        /* The entry cannot have been removed from the heap while busy */
+        entry->is_prerendered = true;
+        sys->prerender.busy = NULL;
+        sys->prerender.count++;
+        sys->prerender.margin_total += margin;
+        if (sys->prerender.count == 1 || margin < sys->prerender.margin_min)
+            sys->prerender.margin_min = margin;
+        vlc_cond_broadcast(&sys->prerender.done);
+    }
+    vlc_mutex_unlock(&sys->lock);
+    return NULL;
+}
+
+/* Gives the rendering formats used by the video output to the prerenderer */
+static void SpuPrerenderSetFormat(spu_private_t *sys,
+                                  const vlc_fourcc_t *chroma_list,
+                                  const video_format_t *fmt_dst,
+                                  const video_format_t *fmt_src)
+{
+    vlc_fourcc_t list[SPU_PRERENDER_CHROMAS + 1];
+    int count;
+
+    for (count = 0; count < SPU_PRERENDER_CHROMAS && chroma_list[count]; count++)
+        list[count] = chroma_list[count];
+    list[count] = 0;
+
+    if (sys->prerender.has_fmt &&
+        video_format_IsSimilar(&sys->prerender.fmt_src, fmt_src) &&
+        video_format_IsSimilar(&sys->prerender.fmt_dst, fmt_dst) &&
+        !memcmp(sys->prerender.chroma_list, list, (count + 1) * sizeof(*list)))
+        return;
+
+    /* The palettes are not needed to render subtitles */
+    sys->prerender.fmt_src = *fmt_src;
+    sys->prerender.fmt_src.p_palette = NULL;
+    sys->prerender.fmt_dst = *fmt_dst;
+    sys->prerender.fmt_dst.p_palette = NULL;
+    memcpy(sys->prerender.chroma_list, list, sizeof(list));
+    sys->prerender.has_fmt = true;
+    vlc_cond_signal(&sys->prerender.wait);
+}
+
 /**
  * A few scale functions helpers.
  */
@@ -489,6 +799,40 @@ static void SpuRegionPlace(int *x, int *y,
     }
 }
 
+/**
+ * Copy the part of a picture shown by a region into a picture of its own.
+ *
+ * The converters and scalers work on whole pictures, they cannot be given a
+ * region showing only a part of a shared picture (eg. a texture atlas).
+ */
+static picture_t *SpuRegionExtract(const subpicture_region_t *region)
+{
+    const picture_t *source = region->p_picture;
+    const video_format_t *source_fmt = &source->format;
+
+    video_format_t fmt = region->fmt;
+    fmt.i_x_offset = 0;
+    fmt.i_y_offset = 0;
+
+    picture_t *picture = picture_NewFromFormat(&fmt);
+    if (!picture)
+        return NULL;
+
+    for (int i = 0; i < picture->i_planes && i < source->i_planes; i++) {
+        plane_t src = source->p[i];
+        const unsigned x = region->fmt.i_x_offset * src.i_visible_pitch /
+                           source_fmt->i_width;
+        const unsigned y = region->fmt.i_y_offset * src.i_visible_lines /
+                           source_fmt->i_height;
+
+        src.p_pixels        += y * src.i_pitch + x / src.i_pixel_pitch * src.i_pixel_pitch;
+        src.i_visible_pitch  = picture->p[i].i_visible_pitch;
+        src.i_visible_lines  = picture->p[i].i_visible_lines;
+        plane_CopyPixels(&picture->p[i], &src);
+    }
+    return picture;
+}
+
 /**
  * This function compares two 64 bits integers.
  * It can be used by qsort.
@@ -583,9 +927,10 @@ static void SpuSelectSubpictures(spu_t *spu,
             bool is_stop_valid;
             bool is_late;
 
-            if (!current || entry->reject) {
-                if (entry->reject)
-                    SpuHeapDeleteAt(&sys->heap, index);
+            if (!current || current == sys->prerender.busy)
+                continue;
+            if (entry->reject) {
+                SpuHeapDeleteAt(&sys->heap, index);
                 continue;
             }
 
@@ -618,6 +963,13 @@ static void SpuSelectSubpictures(spu_t *spu,
             if (current->b_subtitle && !is_late && !current->b_ephemer)
                 start_date = current->i_start;
 
+            /* Rendered by the video output thread if it was not prerendered */
+            if (!entry->is_prerendered) {
+                if (sys->prerender.is_running && SpuPrerenderIsNeeded(current))
+                    sys->prerender.miss_count++;
+                entry->is_prerendered = true;
+            }
+
             /* */
             available_subpic[available_count] = current;
             is_available_late[available_count] = is_late;
@@ -689,7 +1041,7 @@ static void SpuRenderRegion(spu_t *spu,
 
     /* Render text region */
     if (region->fmt.i_chroma == VLC_CODEC_TEXT) {
-        SpuRenderText(spu, &restore_text, region,
+        SpuRenderText(sys->text, &restore_text, region,
                       chroma_list,
                       render_date - subpic->i_start);
 
@@ -808,20 +1160,47 @@ static void SpuRenderRegion(spu_t *spu,
             }
         }
 
+        /* Reuse a picture scaled for a previous region */
+        const vlc_fourcc_t dst_chroma = convert_chroma ? chroma_list[0]
+                                                       : region->fmt.i_chroma;
+        if (!region->p_private && dst_width > 0 && dst_height > 0 &&
+            !using_palette) {
+            picture_t *picture = SpuScaledGet(sys, region,
+                                              dst_width, dst_height, dst_chroma);
+            if (picture) {
+                region->p_private = subpicture_region_private_New(&picture->format);
+                if (region->p_private)
+                    region->p_private->p_picture = picture;
+                else
+                    picture_Release(picture);
+            }
+        }
+
         /* Scale if needed into cache */
         if (!region->p_private && dst_width > 0 && dst_height > 0) {
             filter_t *scale = sys->scale;
 
-            picture_t *picture = region->p_picture;
-            picture_Hold(picture);
+            /* The region shows only a part of its picture */
+            video_format_t picture_fmt = region->fmt;
+            picture_t *picture;
+            if (region->fmt.i_x_offset != 0 || region->fmt.i_y_offset != 0 ||
+                region->fmt.i_width  != region->p_picture->format.i_width ||
+                region->fmt.i_height != region->p_picture->format.i_height) {
+                picture = SpuRegionExtract(region);
+                picture_fmt.i_x_offset = 0;
+                picture_fmt.i_y_offset = 0;
+            } else {
+                picture = region->p_picture;
+                picture_Hold(picture);
+            }
 
             /* Convert YUVP to YUVA/RGBA first for better scaling quality */
-            if (using_palette) {
+            if (using_palette && picture) {
                 filter_t *scale_yuvp = sys->scale_yuvp;
 
-                scale_yuvp->fmt_in.video = region->fmt;
+                scale_yuvp->fmt_in.video = picture_fmt;
 
-                scale_yuvp->fmt_out.video = region->fmt;
+                scale_yuvp->fmt_out.video = picture_fmt;
                 scale_yuvp->fmt_out.video.i_chroma = chroma_list[0];
 
                 picture = scale_yuvp->pf_video_filter(scale_yuvp, picture);
@@ -859,6 +1238,10 @@ static void SpuRenderRegion(spu_t *spu,
             }
 
             /* */
+            if (picture && picture != region->p_picture && !using_palette &&
+                !restore_text)
+                SpuScaledAdd(sys, region, dst_chroma, picture);
+
             if (picture) {
                 region->p_private = subpicture_region_private_New(&picture->format);
                 if (region->p_private) {
@@ -904,8 +1287,9 @@ static void SpuRenderRegion(spu_t *spu,
             y_end = __MIN(crop_y + crop_height,
                           y_offset + (int)region_fmt.i_visible_height);
 
-            region_fmt.i_x_offset       = x - x_offset;
-            region_fmt.i_y_offset       = y - y_offset;
+            /* The region may already show a part of its picture */
+            region_fmt.i_x_offset      += x - x_offset;
+            region_fmt.i_y_offset      += y - y_offset;
             region_fmt.i_visible_width  = x_end - x;
             region_fmt.i_visible_height = y_end - y;
 
@@ -914,14 +1298,14 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
-    subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
+    /* The output region only references the rendered picture, which may be
+     * shared by many regions (eg. a texture atlas) */
+    subpicture_region_t *dst = *dst_ptr =
+        subpicture_region_NewFromPicture(&region_fmt, region_picture);
     if (dst) {
         dst->i_x       = x_offset;
         dst->i_y       = y_offset;
         dst->i_align   = 0;
-        if (dst->p_picture)
-            picture_Release(dst->p_picture);
-        dst->p_picture = picture_Hold(region_picture);
         int fade_alpha = 255;
         if (subpic->b_fade) {
             mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
@@ -1009,19 +1393,7 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
         if (!subpic->p_region)
             continue;
 
-        if (subpic->i_original_picture_width  <= 0 ||
-            subpic->i_original_picture_height <= 0) {
-            if (subpic->i_original_picture_width  > 0 ||
-                subpic->i_original_picture_height > 0)
-                msg_Err(spu, "original picture size %dx%d is unsupported",
-                         subpic->i_original_picture_width,
-                         subpic->i_original_picture_height);
-            else
-                msg_Warn(spu, "original picture size is undefined");
-
-            subpic->i_original_picture_width  = fmt_src->i_width;
-            subpic->i_original_picture_height = fmt_src->i_height;
-        }
+        SpuFixOriginalSize(spu, subpic, fmt_src);
 
         if (sys->text) {
             /* FIXME aspect ratio ? */
@@ -1165,6 +1537,18 @@ static void sub_del_buffer(filter_t *filter, subpicture_t *subpic)
     subpicture_Delete(subpic);
 }
 
+static input_thread_t *sub_get_input(filter_t *filter)
+{
+    spu_t *spu = filter->p_owner->spu;
+
+    vlc_mutex_lock(&spu->p->lock);
+    vlc_object_t *input = spu->p->input;
+    if (input)
+        vlc_object_hold(input);
+    vlc_mutex_unlock(&spu->p->lock);
+    return (input_thread_t *)input;
+}
+
 static int SubSourceAllocationInit(filter_t *filter, void *data)
 {
     spu_t *spu = data;
@@ -1175,6 +1559,7 @@ static int SubSourceAllocationInit(filter_t *filter, void *data)
 
     filter->pf_sub_buffer_new = sub_new_buffer;
     filter->pf_sub_buffer_del = sub_del_buffer;
+    filter->pf_get_input      = sub_get_input;
 
     filter->p_owner = sys;
     sys->channel = spu_RegisterChannel(spu);
@@ -1254,6 +1639,24 @@ spu_t *spu_Create(vlc_object_t *object)
 
     /* */
     sys->last_sort_date = -1;
+    sys->scaled_count = 0;
+
+    /* The prerenderer uses its own text renderer */
+    vlc_cond_init(&sys->prerender.wait);
+    vlc_cond_init(&sys->prerender.done);
+    sys->prerender.is_stopping  = false;
+    sys->prerender.busy         = NULL;
+    sys->prerender.has_fmt      = false;
+    sys->prerender.count        = 0;
+    sys->prerender.miss_count   = 0;
+    sys->prerender.margin_total = 0;
+    sys->prerender.margin_min   = 0;
+    sys->prerender.text         = SpuRenderCreateAndLoadText(spu);
+    sys->prerender.is_running   =
+        !vlc_clone(&sys->prerender.thread, SpuPrerenderThread, spu,
+                   VLC_THREAD_PRIORITY_LOW);
+    if (!sys->prerender.is_running)
+        msg_Warn(spu, "cannot create the subtitles prerendering thread");
 
     return spu;
 }
@@ -1267,6 +1670,25 @@ void spu_Destroy(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
+    if (sys->prerender.is_running) {
+        vlc_mutex_lock(&sys->lock);
+        sys->prerender.is_stopping = true;
+        vlc_cond_signal(&sys->prerender.wait);
+        vlc_mutex_unlock(&sys->lock);
+        vlc_join(sys->prerender.thread, NULL);
+    }
+    if (sys->prerender.count > 0 || sys->prerender.miss_count > 0)
+        msg_Dbg(spu, "%u subtitles prerendered (margin average %"PRId64" ms, "
+                "minimum %"PRId64" ms), %u missed",
+                sys->prerender.count,
+                sys->prerender.count > 0 ? sys->prerender.margin_total / sys->prerender.count / 1000 : 0,
+                sys->prerender.margin_min / 1000,
+                sys->prerender.miss_count);
+    if (sys->prerender.text)
+        FilterRelease(sys->prerender.text);
+    vlc_cond_destroy(&sys->prerender.done);
+    vlc_cond_destroy(&sys->prerender.wait);
+
     if (sys->text)
         FilterRelease(sys->text);
 
@@ -1286,6 +1708,8 @@ void spu_Destroy(spu_t *spu)
     /* Destroy all remaining subpictures */
     SpuHeapClean(&sys->heap);
 
+    SpuScaledClean(sys, true);
+
     vlc_mutex_destroy(&sys->lock);
 
     vlc_object_release(spu);
@@ -1304,14 +1728,35 @@ void spu_Attach(spu_t *spu, vlc_object_t *input, bool attach)
         var_Create(input, "highlight", VLC_VAR_BOOL);
         var_AddCallback(input, "highlight", CropCallback, spu);
 
-        vlc_mutex_lock(&spu->p->lock);
-        spu->p->input = input;
+        spu_private_t *sys = spu->p;
 
-        if (spu->p->text)
-            FilterRelease(spu->p->text);
-        spu->p->text = SpuRenderCreateAndLoadText(spu);
+        vlc_mutex_lock(&sys->lock);
+        sys->input = input;
+
+        if (sys->text)
+            FilterRelease(sys->text);
+        sys->text = SpuRenderCreateAndLoadText(spu);
+
+        /* The prerenderer must load the fonts of the input too */
+        while (sys->prerender.busy)
+            vlc_cond_wait(&sys->prerender.done, &sys->lock);
+        if (sys->prerender.text)
+            FilterRelease(sys->prerender.text);
+        sys->prerender.text = SpuRenderCreateAndLoadText(spu);
+
+        /* and the subtitles rendered with the previous fonts again */
+        for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++) {
+            spu_heap_entry_t *entry = &sys->heap.entry[i];
+
+            if (entry->subpicture && entry->is_prerendered &&
+                SpuPrerenderIsNeeded(entry->subpicture)) {
+                subpicture_Invalidate(entry->subpicture);
+                entry->is_prerendered = false;
+            }
+        }
+        vlc_cond_signal(&sys->prerender.wait);
 
-        vlc_mutex_unlock(&spu->p->lock);
+        vlc_mutex_unlock(&sys->lock);
     } else {
         vlc_mutex_lock(&spu->p->lock);
         spu->p->input = NULL;
@@ -1408,6 +1853,7 @@ void spu_PutSubpicture(spu_t *spu, subpicture_t *subpic)
         subpicture_Delete(subpic);
         return;
     }
+    vlc_cond_signal(&sys->prerender.wait);
     vlc_mutex_unlock(&sys->lock);
 }
 
@@ -1458,6 +1904,19 @@ subpicture_t *spu_Render(spu_t *spu,
 
     vlc_mutex_lock(&sys->lock);
 
+    /* Wait for a subtitle to be displayed now that is being prerendered */
+    if (sys->prerender.is_running) {
+        SpuPrerenderSetFormat(sys, chroma_list, fmt_dst, fmt_src);
+
+        if (sys->prerender.busy &&
+            sys->prerender.busy->i_start <= render_subtitle_date) {
+            sys->prerender.miss_count++;
+            while (sys->prerender.busy &&
+                   sys->prerender.busy->i_start <= render_subtitle_date)
+                vlc_cond_wait(&sys->prerender.done, &sys->lock);
+        }
+    }
+
     unsigned int subpicture_count;
     subpicture_t *subpicture_array[VOUT_MAX_SUBPICTURES];
 
@@ -1465,6 +1924,7 @@ subpicture_t *spu_Render(spu_t *spu,
     SpuSelectSubpictures(spu, &subpicture_count, subpicture_array,
                          render_subtitle_date, render_osd_date, ignore_osd);
     if (subpicture_count <= 0) {
+        SpuScaledClean(sys, false);
         vlc_mutex_unlock(&sys->lock);
         return NULL;
     }
@@ -1489,6 +1949,7 @@ subpicture_t *spu_Render(spu_t *spu,
                                                 fmt_src,
                                                 render_subtitle_date,
                                                 render_osd_date);
+    SpuScaledClean(sys, false);
     vlc_mutex_unlock(&sys->lock);
 
     return render;
@@ -169,6 +169,142 @@ static void test_media_player_pause_stop(const char** argv, int argc)
     libvlc_release (vlc);
 }
 
+/* Prepare to first frame latency: a prepared player (started paused) must
+ * hold its first picture before it is started, so that starting it only has
+ * to resume the clock */
+static const char test_video_sample[] = SRCDIR"/samples/image.jpg";
+
+static volatile int64_t prepared_date;
+
+static void on_buffering (const libvlc_event_t *ev, void *data)
+{
+    (void) data;
+    if (ev->u.media_player_buffering.new_cache >= 100. && prepared_date == 0)
+        prepared_date = libvlc_clock ();
+}
+
+/* Waits for the first picture to reach a video output, in microseconds
+ * since start, or -1 after timeout */
+static int64_t wait_vout (libvlc_media_player_t *mp, int64_t start,
+                          int64_t timeout)
+{
+    while (!libvlc_media_player_has_vout (mp))
+    {
+        if (libvlc_clock () - start > timeout)
+            return -1;
+        usleep (1000);
+    }
+    return libvlc_clock () - start;
+}
+
+static void test_media_player_prepare(const char** argv, int argc)
+{
+    log ("Testing prepare to first frame latency with %s\n",
+         test_video_sample);
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    /* Play from scratch */
+    libvlc_media_t *md = libvlc_media_new_path (vlc, test_video_sample);
+    assert (md != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (md);
+    assert (mp != NULL);
+
+    int64_t start = libvlc_clock ();
+    libvlc_media_player_play (mp);
+    const int64_t cold = wait_vout (mp, start, 5000000);
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    if (cold < 0)
+    {
+        log ("No video output, skipping\n");
+        libvlc_media_release (md);
+        libvlc_release (vlc);
+        return;
+    }
+
+    /* Prepare, then start */
+    libvlc_media_add_option (md, ":start-paused");
+    mp = libvlc_media_player_new_from_media (md);
+    assert (mp != NULL);
+    libvlc_media_release (md);
+    libvlc_event_attach (libvlc_media_player_event_manager (mp),
+                         libvlc_MediaPlayerBuffering, on_buffering, NULL);
+
+    start = libvlc_clock ();
+    prepared_date = 0;
+    libvlc_media_player_play (mp);
+    wait_paused (mp);
+    while (prepared_date == 0)
+    {
+        assert (libvlc_clock () - start <= 5000000);
+        usleep (1000);
+    }
+    const int64_t prepare = prepared_date - start;
+
+    /* The first picture is decoded and the clock is not running yet */
+    assert (libvlc_media_player_has_vout (mp));
+    assert (libvlc_media_player_get_state (mp) == libvlc_Paused);
+
+    start = libvlc_clock ();
+    libvlc_media_player_play (mp);
+    wait_playing (mp);
+    const int64_t resume = libvlc_clock () - start;
+
+    log ("  first frame in %d ms when playing, prepared in %d ms then "
+         "playing in %d ms\n", (int)(cold / 1000), (int)(prepare / 1000),
+         (int)(resume / 1000));
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+}
+
+static void test_media_player_preload(const char** argv, int argc)
+{
+    const char * file = test_default_sample;
+
+    log ("Testing preload\n");
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    libvlc_media_t *md = libvlc_media_new_path (vlc, file);
+    assert (md != NULL);
+    libvlc_media_t *next = libvlc_media_new_path (vlc, file);
+    assert (next != NULL);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (md);
+    assert (mp != NULL);
+    assert (libvlc_media_player_get_transition_gap (mp) == -1);
+
+    libvlc_media_player_play (mp);
+    wait_playing (mp);
+
+    /* The preloaded media is taken over once set and played */
+    assert (libvlc_media_player_preload (mp, next) == 0);
+    libvlc_media_player_set_media (mp, next);
+    libvlc_media_player_play (mp);
+    wait_playing (mp);
+    log ("Transition gap: %d ms\n",
+         (int)libvlc_media_player_get_transition_gap (mp));
+
+    /* A media preloaded but never played is dropped on stop */
+    assert (libvlc_media_player_preload (mp, md) == 0);
+    libvlc_media_player_stop (mp);
+
+    /* A media played by hand is not a transition */
+    libvlc_media_player_play (mp);
+    wait_playing (mp);
+    assert (libvlc_media_player_get_transition_gap (mp) == -1);
+    libvlc_media_player_stop (mp);
+
+    libvlc_media_release (next);
+    libvlc_media_release (md);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+}
 
 int main (void)
 {
@@ -177,6 +313,8 @@ int main (void)
     test_media_player_set_media (test_defaults_args, test_defaults_nargs);
     test_media_player_play_stop (test_defaults_args, test_defaults_nargs);
     test_media_player_pause_stop (test_defaults_args, test_defaults_nargs);
+    test_media_player_prepare (test_defaults_args, test_defaults_nargs);
+    test_media_player_preload (test_defaults_args, test_defaults_nargs);
 
     return 0;
 }
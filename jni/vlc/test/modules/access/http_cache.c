@@ -0,0 +1,348 @@
+/*****************************************************************************
+ * http_cache.c: test of the disk cache of the HTTP access
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../http_server.h"
+#include <../src/control/libvlc_internal.h>
+#include <../modules/access/http_cache.h>
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_stream.h>
+
+#include <dirent.h>
+
+/* Two entries of the size limit test fit */
+#define ENTRY_SIZE          (48 << 10)
+#define MAX_SIZE            (5 * ENTRY_SIZE / 2)
+
+static void Fill( uint8_t *p_buf, size_t i_len, uint64_t i_pos )
+{
+    for( size_t i = 0; i < i_len; i++ )
+        p_buf[i] = ( i_pos + i ) * 7;
+}
+
+static bool Check( const uint8_t *p_buf, size_t i_len, uint64_t i_pos )
+{
+    for( size_t i = 0; i < i_len; i++ )
+        if( p_buf[i] != (uint8_t)( ( i_pos + i ) * 7 ) )
+            return false;
+    return true;
+}
+
+static void RemoveDir( const char *psz_dir )
+{
+    DIR *p_dir = opendir( psz_dir );
+    assert( p_dir != NULL );
+
+    struct dirent *p_entry;
+    while( ( p_entry = readdir( p_dir ) ) != NULL )
+    {
+        char *psz_path;
+        if( p_entry->d_name[0] == '.' ||
+            asprintf( &psz_path, "%s/%s", psz_dir, p_entry->d_name ) < 0 )
+            continue;
+        unlink( psz_path );
+        free( psz_path );
+    }
+    closedir( p_dir );
+    rmdir( psz_dir );
+}
+
+static void test_ranges( vlc_object_t *p_obj, const char *psz_dir )
+{
+    log( "Testing the range map\n" );
+
+    uint8_t p_buf[300];
+    uint64_t i_start, i_end;
+    http_cache_t *c = http_cache_New( p_obj, psz_dir, UINT64_MAX,
+                                      "http://example.com/ranges" );
+    assert( c != NULL );
+
+    /* Nothing is stored without the size */
+    Fill( p_buf, 100, 0 );
+    http_cache_Write( c, 0, p_buf, 100 );
+    assert( http_cache_Available( c, 0 ) == 0 );
+
+    http_cache_SetInfo( c, 300, "video/mp4" );
+    Fill( p_buf, 100, 0 );
+    http_cache_Write( c, 0, p_buf, 100 );
+    Fill( p_buf, 100, 200 );
+    http_cache_Write( c, 200, p_buf, 100 );
+    assert( http_cache_Available( c, 0 ) == 100 );
+    assert( http_cache_Available( c, 150 ) == 0 );
+    assert( http_cache_Available( c, 250 ) == 50 );
+    assert( !http_cache_IsComplete( c ) );
+
+    assert( http_cache_GetGap( c, 0, &i_start, &i_end ) );
+    assert( i_start == 100 && i_end == 200 );
+    assert( http_cache_GetGap( c, 150, &i_start, &i_end ) );
+    assert( i_start == 150 && i_end == 200 );
+    assert( !http_cache_GetGap( c, 200, &i_start, &i_end ) );
+
+    /* Reads stop at the end of the cached range */
+    assert( http_cache_Read( c, 50, p_buf, 100 ) == 50 );
+    assert( Check( p_buf, 50, 50 ) );
+    assert( http_cache_Read( c, 100, p_buf, 100 ) == 0 );
+
+    /* Overlapping writes merge the ranges */
+    Fill( p_buf, 150, 80 );
+    http_cache_Write( c, 80, p_buf, 150 );
+    assert( http_cache_IsComplete( c ) );
+    assert( http_cache_Available( c, 0 ) == 300 );
+    http_cache_Delete( c );
+
+    log( "Testing the persistence\n" );
+    c = http_cache_New( p_obj, psz_dir, UINT64_MAX,
+                        "http://example.com/ranges" );
+    assert( c != NULL );
+    assert( http_cache_IsComplete( c ) );
+    assert( http_cache_GetSize( c ) == 300 );
+    char *psz_mime = http_cache_GetContentType( c );
+    assert( psz_mime != NULL && !strcmp( psz_mime, "video/mp4" ) );
+    free( psz_mime );
+    assert( http_cache_Read( c, 0, p_buf, 300 ) == 300 );
+    assert( Check( p_buf, 300, 0 ) );
+
+    /* A new version of the resource */
+    http_cache_SetInfo( c, 400, "video/mp4" );
+    assert( http_cache_Available( c, 0 ) == 0 );
+    assert( http_cache_GetGap( c, 0, &i_start, &i_end ) );
+    assert( i_start == 0 && i_end == 400 );
+    http_cache_Delete( c );
+}
+
+static void WriteEntry( vlc_object_t *p_obj, const char *psz_dir,
+                        const char *psz_url )
+{
+    uint8_t *p_buf = malloc( ENTRY_SIZE );
+    assert( p_buf != NULL );
+    Fill( p_buf, ENTRY_SIZE, 0 );
+
+    http_cache_t *c = http_cache_New( p_obj, psz_dir, MAX_SIZE,
+                                      psz_url );
+    assert( c != NULL );
+    http_cache_SetInfo( c, ENTRY_SIZE, NULL );
+    http_cache_Write( c, 0, p_buf, ENTRY_SIZE );
+    assert( http_cache_IsComplete( c ) );
+    http_cache_Delete( c );
+    free( p_buf );
+}
+
+static bool IsCached( vlc_object_t *p_obj, const char *psz_dir,
+                      const char *psz_url )
+{
+    http_cache_t *c = http_cache_New( p_obj, psz_dir, MAX_SIZE,
+                                      psz_url );
+    assert( c != NULL );
+    const bool b_complete = http_cache_IsComplete( c );
+    http_cache_Delete( c );
+    return b_complete;
+}
+
+static void test_lru( vlc_object_t *p_obj, const char *psz_dir )
+{
+    log( "Testing the size limit\n" );
+
+    WriteEntry( p_obj, psz_dir, "http://example.com/a" );
+    WriteEntry( p_obj, psz_dir, "http://example.com/b" );
+
+    /* The dates of the files have a resolution of a second */
+    msleep( 1100000 );
+    assert( IsCached( p_obj, psz_dir, "http://example.com/a" ) );
+
+    /* b is the least recently used */
+    WriteEntry( p_obj, psz_dir, "http://example.com/c" );
+    assert( !IsCached( p_obj, psz_dir, "http://example.com/b" ) );
+    assert( IsCached( p_obj, psz_dir, "http://example.com/a" ) );
+    assert( IsCached( p_obj, psz_dir, "http://example.com/c" ) );
+}
+
+static void test_shared( vlc_object_t *p_obj, const char *psz_dir )
+{
+    log( "Testing two accesses to the same resource\n" );
+
+    uint8_t p_buf[100];
+    http_cache_t *c1 = http_cache_New( p_obj, psz_dir, MAX_SIZE,
+                                       "http://example.com/shared" );
+    http_cache_t *c2 = http_cache_New( p_obj, psz_dir, MAX_SIZE,
+                                       "http://example.com/shared" );
+    assert( c1 != NULL && c2 != NULL );
+    http_cache_SetInfo( c1, 200, NULL );
+    http_cache_SetInfo( c2, 200, NULL );
+
+    /* Each saves the ranges of the other with its own */
+    Fill( p_buf, 100, 0 );
+    http_cache_Write( c1, 0, p_buf, 100 );
+    Fill( p_buf, 100, 100 );
+    http_cache_Write( c2, 100, p_buf, 100 );
+    http_cache_Delete( c1 );
+    http_cache_Delete( c2 );
+    assert( IsCached( p_obj, psz_dir, "http://example.com/shared" ) );
+}
+
+static void test_open( vlc_object_t *p_obj )
+{
+    log( "Testing the size limit with an open entry\n" );
+
+    /* Of its own, for the order of the entries */
+    char psz_dir[] = "/tmp/vlc-http-cache-XXXXXX";
+    assert( mkdtemp( psz_dir ) != NULL );
+
+    uint8_t *p_buf = malloc( ENTRY_SIZE );
+    assert( p_buf != NULL );
+    Fill( p_buf, ENTRY_SIZE, 0 );
+    http_cache_t *c = http_cache_New( p_obj, psz_dir, MAX_SIZE,
+                                      "http://example.com/open" );
+    assert( c != NULL );
+    http_cache_SetInfo( c, ENTRY_SIZE, NULL );
+    http_cache_Write( c, 0, p_buf, ENTRY_SIZE );
+    free( p_buf );
+
+    /* The open entry is the least recently used, one of the others goes
+     * instead */
+    msleep( 1100000 );
+    WriteEntry( p_obj, psz_dir, "http://example.com/x" );
+    WriteEntry( p_obj, psz_dir, "http://example.com/y" );
+    http_cache_Delete( c );
+    assert( IsCached( p_obj, psz_dir, "http://example.com/open" ) );
+    assert( IsCached( p_obj, psz_dir, "http://example.com/x" ) !=
+            IsCached( p_obj, psz_dir, "http://example.com/y" ) );
+
+    RemoveDir( psz_dir );
+}
+
+static void Play( libvlc_instance_t *p_vlc, const char *psz_url )
+{
+    libvlc_media_t *p_md = libvlc_media_new_location( p_vlc, psz_url );
+    assert( p_md != NULL );
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_md );
+    assert( p_mp != NULL );
+    libvlc_media_release( p_md );
+
+    libvlc_media_player_play( p_mp );
+    libvlc_state_t state;
+    while( ( state = libvlc_media_player_get_state( p_mp ) ) != libvlc_Ended &&
+           state != libvlc_Error )
+        msleep( 10000 );
+    assert( state == libvlc_Ended );
+
+    libvlc_media_player_stop( p_mp );
+    libvlc_media_player_release( p_mp );
+}
+
+static void test_filler( vlc_object_t *p_obj, const char *psz_dir )
+{
+    log( "Testing the download of the missing parts\n" );
+
+    http_server_t server;
+    http_server_Start( &server, 1 );
+
+    char psz_url[64];
+    http_server_GetUrl( &server, 0, psz_url, sizeof(psz_url) );
+
+    /* The instance does not download in the background, the reader does */
+    vlc_object_t *p_reader = vlc_object_create( p_obj, sizeof(*p_reader) );
+    assert( p_reader != NULL );
+    var_Create( p_reader, "http-cache-rate", VLC_VAR_INTEGER );
+    var_SetInteger( p_reader, "http-cache-rate", 1024 );
+
+    /* The stream reads only what it prebuffers */
+    stream_t *s = stream_UrlNew( p_reader, psz_url );
+    assert( s != NULL );
+
+    bool b_complete = false;
+    for( unsigned i = 0; i < 100 && !b_complete; i++ )
+    {
+        msleep( 100000 );
+        b_complete = IsCached( p_obj, psz_dir, psz_url );
+    }
+    log( "  %u requests for the entry\n", http_server_Requests( &server, 0 ) );
+    assert( b_complete );
+
+    stream_Delete( s );
+    vlc_object_release( p_reader );
+    http_server_Stop( &server );
+}
+
+static void test_playback( libvlc_instance_t *p_vlc )
+{
+    log( "Testing the playback from the disk\n" );
+
+    http_server_t server;
+    http_server_Start( &server, 1 );
+
+    char psz_url[64];
+    http_server_GetUrl( &server, 0, psz_url, sizeof(psz_url) );
+
+    Play( p_vlc, psz_url );
+    const unsigned i_requests = http_server_Requests( &server, 0 );
+    log( "  %u requests on the first playback\n", i_requests );
+    assert( i_requests > 0 );
+
+    /* The whole movie went through the cache */
+    Play( p_vlc, psz_url );
+    log( "  %u requests on the second playback\n",
+         http_server_Requests( &server, 0 ) - i_requests );
+    assert( http_server_Requests( &server, 0 ) == i_requests );
+
+    http_server_Stop( &server );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 30 );
+
+    char psz_dir[] = "/tmp/vlc-http-cache-XXXXXX";
+    assert( mkdtemp( psz_dir ) != NULL );
+
+    char *psz_dir_arg;
+    assert( asprintf( &psz_dir_arg, "--http-cache-dir=%s", psz_dir ) >= 0 );
+    const char *ppsz_args[test_defaults_nargs + 3];
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        ppsz_args[i] = test_defaults_args[i];
+    ppsz_args[test_defaults_nargs] = "--http-cache";
+    ppsz_args[test_defaults_nargs + 1] = "--http-cache-rate=0";
+    ppsz_args[test_defaults_nargs + 2] = psz_dir_arg;
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs + 3,
+                                           ppsz_args );
+    assert( p_vlc != NULL );
+    vlc_object_t *p_obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    test_ranges( p_obj, psz_dir );
+    test_lru( p_obj, psz_dir );
+    test_shared( p_obj, psz_dir );
+    test_open( p_obj );
+
+    if( module_exists( "access_http" ) && module_exists( "wav" ) )
+    {
+        test_filler( p_obj, psz_dir );
+        test_playback( p_vlc );
+    }
+    else
+        log( "  http access or wav demux not available\n" );
+
+    libvlc_release( p_vlc );
+    free( psz_dir_arg );
+    RemoveDir( psz_dir );
+    return 0;
+}
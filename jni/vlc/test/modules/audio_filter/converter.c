@@ -0,0 +1,281 @@
+/*****************************************************************************
+ * converter.c: test and benchmark of the fused audio conversions
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The filter helpers log with the module name */
+#define MODULE_STRING "test"
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include "filter.h"
+
+#define AUDIO_RATE          48000
+#define AUDIO_DURATION      10 /* in seconds */
+#define BUFFER_SAMPLES      1024
+
+#define CHANS_STEREO (AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT)
+#define CHANS_5_1    (AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT | AOUT_CHAN_CENTER \
+                    | AOUT_CHAN_REARLEFT | AOUT_CHAN_REARRIGHT | AOUT_CHAN_LFE)
+
+typedef struct
+{
+    const char   *psz_module;
+    vlc_fourcc_t i_in_format;
+    uint32_t     i_in_channels;
+    vlc_fourcc_t i_out_format;
+    uint32_t     i_out_channels;
+    uint32_t     i_in_original; /* if not the physical channels */
+} conversion_t;
+
+/* What the audio output builds without the fused conversions */
+static const conversion_t p_downmix_chain[] = {
+    { "converter_fixed", VLC_CODEC_S16N, CHANS_5_1,    VLC_CODEC_FI32, CHANS_5_1 },
+    { "trivial_mixer",   VLC_CODEC_FI32, CHANS_5_1,    VLC_CODEC_FI32, CHANS_STEREO },
+    { "converter_fixed", VLC_CODEC_FI32, CHANS_STEREO, VLC_CODEC_S16N, CHANS_STEREO },
+};
+static const conversion_t p_downmix_fused[] = {
+    { "fused_converter", VLC_CODEC_S16N, CHANS_5_1,    VLC_CODEC_S16N, CHANS_STEREO },
+};
+static const conversion_t p_fixed_chain[] = {
+    { "converter_fixed", VLC_CODEC_FI32, CHANS_STEREO, VLC_CODEC_S16N, CHANS_STEREO },
+};
+static const conversion_t p_fixed_fused[] = {
+    { "fused_converter", VLC_CODEC_FI32, CHANS_STEREO, VLC_CODEC_S16N, CHANS_STEREO },
+};
+static const conversion_t p_fixed_from_s16[] = {
+    { "converter_fixed", VLC_CODEC_S16N, CHANS_STEREO, VLC_CODEC_FI32, CHANS_STEREO },
+};
+static const conversion_t p_original_fused[] = {
+    { "fused_converter", VLC_CODEC_S16N, CHANS_STEREO, VLC_CODEC_S16N, CHANS_STEREO,
+      CHANS_STEREO | AOUT_CHAN_DOLBYSTEREO },
+};
+
+static filter_t *CreateConversion( libvlc_int_t *p_libvlc,
+                                   const conversion_t *p_conv )
+{
+    audio_format_t in, out;
+
+    AudioFormat( &in, p_conv->i_in_format, AUDIO_RATE, p_conv->i_in_channels );
+    if( p_conv->i_in_original )
+        in.i_original_channels = p_conv->i_in_original;
+    AudioFormat( &out, p_conv->i_out_format, AUDIO_RATE,
+                 p_conv->i_out_channels );
+    return CreateFilter( p_libvlc, p_conv->psz_module, &in, &out );
+}
+
+/* Runs AUDIO_DURATION seconds of audio through a chain of filters, and
+ * reports the number of passes over the samples and of allocations */
+static int test_chain( libvlc_int_t *p_libvlc, const char *psz_name,
+                       const conversion_t *p_chain, unsigned i_chain )
+{
+    filter_t *pp_filters[i_chain];
+
+    for( unsigned i = 0; i < i_chain; i++ )
+    {
+        pp_filters[i] = CreateConversion( p_libvlc, &p_chain[i] );
+        if( !pp_filters[i] )
+        {
+            while( i > 0 )
+                DeleteFilter( pp_filters[--i] );
+            return 77;
+        }
+    }
+
+    const audio_format_t *p_in = &pp_filters[0]->fmt_in.audio;
+    const bool b_s16 = p_in->i_format == VLC_CODEC_S16N;
+    unsigned i_passes = 0;
+    mtime_t i_cpu = 0;
+
+    i_allocations = 0;
+    for( unsigned n = 0; n < AUDIO_DURATION * AUDIO_RATE; n += BUFFER_SAMPLES )
+    {
+        block_t *p_block = block_Alloc( BUFFER_SAMPLES * p_in->i_bytes_per_frame );
+        assert( p_block != NULL );
+        p_block->i_nb_samples = BUFFER_SAMPLES;
+        p_block->i_dts =
+        p_block->i_pts = VLC_TS_0 + (mtime_t)n * CLOCK_FREQ / AUDIO_RATE;
+        for( unsigned i = 0; i < BUFFER_SAMPLES * aout_FormatNbChannels( p_in ); i++ )
+        {
+            if( b_s16 )
+                ((int16_t *)p_block->p_buffer)[i] = (n + i) * 31;
+            else
+                ((int32_t *)p_block->p_buffer)[i] = (n + i) * 31 << 12;
+        }
+
+        const mtime_t i_begin = mdate();
+        for( unsigned i = 0; i < i_chain && p_block; i++ )
+        {
+            p_block = pp_filters[i]->pf_audio_filter( pp_filters[i], p_block );
+            i_passes++;
+        }
+        i_cpu += mdate() - i_begin;
+
+        assert( p_block != NULL );
+        assert( p_block->i_nb_samples == BUFFER_SAMPLES );
+        assert( p_block->i_buffer == BUFFER_SAMPLES *
+                pp_filters[i_chain-1]->fmt_out.audio.i_bytes_per_frame );
+        block_Release( p_block );
+    }
+
+    log( "  %s: %u passes and %u allocations per second of audio, "
+         "%.2f ms of CPU per second of audio\n", psz_name,
+         i_passes / AUDIO_DURATION, i_allocations / AUDIO_DURATION,
+         (double)i_cpu / AUDIO_DURATION / 1000. );
+
+    for( unsigned i = 0; i < i_chain; i++ )
+        DeleteFilter( pp_filters[i] );
+    return 0;
+}
+
+/* Checks the 5.1 to stereo down-mix of the fused conversion */
+static int test_downmix( libvlc_int_t *p_libvlc )
+{
+    filter_t *p_filter = CreateConversion( p_libvlc, &p_downmix_fused[0] );
+    if( !p_filter )
+        return 77;
+
+    /* In the order of the buffers: L R RL RR C LFE */
+    static const int16_t pi_frame[6] = { 8000, -8000, 4000, 0, 4000, 30000 };
+    block_t *p_block = block_Alloc( sizeof(pi_frame) * BUFFER_SAMPLES );
+    assert( p_block != NULL );
+    p_block->i_nb_samples = BUFFER_SAMPLES;
+    for( unsigned i = 0; i < BUFFER_SAMPLES; i++ )
+        memcpy( p_block->p_buffer + i * sizeof(pi_frame), pi_frame,
+                sizeof(pi_frame) );
+
+    i_allocations = 0;
+    p_block = p_filter->pf_audio_filter( p_filter, p_block );
+    assert( p_block != NULL );
+    assert( i_allocations == 0 );
+
+    /* Left is L + RL/sqrt(2) + C/sqrt(2), normalized by 1 + sqrt(2);
+     * the dither is at most one LSB */
+    const int16_t *p_out = (const int16_t *)p_block->p_buffer;
+    for( unsigned i = 0; i < BUFFER_SAMPLES; i++ )
+    {
+        assert( abs( p_out[2*i] - 5657 ) <= 2 );
+        assert( abs( p_out[2*i+1] - (-2142) ) <= 2 );
+    }
+    block_Release( p_block );
+
+    DeleteFilter( p_filter );
+    return 0;
+}
+
+/* Checks that all the conversions between S16N and FI32 keep the level */
+static int test_gain( libvlc_int_t *p_libvlc )
+{
+    filter_t *p_to = CreateConversion( p_libvlc, &p_fixed_from_s16[0] );
+    filter_t *p_from = CreateConversion( p_libvlc, &p_fixed_chain[0] );
+    filter_t *p_fused = CreateConversion( p_libvlc, &p_fixed_fused[0] );
+    if( !p_to || !p_from || !p_fused )
+    {
+        if( p_fused )
+            DeleteFilter( p_fused );
+        if( p_from )
+            DeleteFilter( p_from );
+        if( p_to )
+            DeleteFilter( p_to );
+        return 77;
+    }
+
+    const unsigned i_count = 2 * BUFFER_SAMPLES;
+    block_t *p_block = block_Alloc( i_count * sizeof(int16_t) );
+    assert( p_block != NULL );
+    p_block->i_nb_samples = BUFFER_SAMPLES;
+    int16_t *pi_in = (int16_t *)p_block->p_buffer;
+    for( unsigned i = 0; i < i_count; i++ )
+        pi_in[i] = INT16_MIN + i * (UINT16_MAX / (i_count - 1));
+    int16_t pi_ref[i_count];
+    memcpy( pi_ref, pi_in, sizeof(pi_ref) );
+
+    /* Full scale is -1.0 in both formats */
+    p_block = p_to->pf_audio_filter( p_to, p_block );
+    assert( p_block != NULL );
+    const vlc_fixed_t *pi_fixed = (const vlc_fixed_t *)p_block->p_buffer;
+    assert( pi_fixed[0] == -FIXED32_ONE );
+    for( unsigned i = 0; i < i_count; i++ )
+        assert( pi_fixed[i] == pi_ref[i] * (FIXED32_ONE >> 15) );
+
+    block_t *p_dup = block_Duplicate( p_block );
+    assert( p_dup != NULL );
+
+    p_block = p_from->pf_audio_filter( p_from, p_block );
+    assert( p_block != NULL );
+    const int16_t *pi_out = (const int16_t *)p_block->p_buffer;
+    for( unsigned i = 0; i < i_count; i++ )
+        assert( pi_out[i] == pi_ref[i] );
+    block_Release( p_block );
+
+    /* The dither is at most one LSB */
+    p_dup = p_fused->pf_audio_filter( p_fused, p_dup );
+    assert( p_dup != NULL );
+    pi_out = (const int16_t *)p_dup->p_buffer;
+    for( unsigned i = 0; i < i_count; i++ )
+        assert( abs( pi_out[i] - pi_ref[i] ) <= 2 );
+    block_Release( p_dup );
+
+    DeleteFilter( p_fused );
+    DeleteFilter( p_from );
+    DeleteFilter( p_to );
+    return 0;
+}
+
+/* Checks that the fused conversion leaves the formats that differ only by
+ * their original channels, as it would have nothing to convert */
+static void test_original( libvlc_int_t *p_libvlc )
+{
+    filter_t *p_filter = CreateConversion( p_libvlc, &p_original_fused[0] );
+    assert( p_filter == NULL );
+}
+
+int main( void )
+{
+    int i_ret;
+
+    test_init();
+    alarm( 60 );
+
+    log( "Testing the fused audio conversions\n" );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+    libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
+
+    test_original( p_libvlc );
+    i_ret = test_downmix( p_libvlc );
+    if( !i_ret )
+        i_ret = test_gain( p_libvlc );
+    if( !i_ret )
+    {
+        test_chain( p_libvlc, "S16N 5.1 -> S16N stereo, split", p_downmix_chain,
+                    sizeof(p_downmix_chain) / sizeof(*p_downmix_chain) );
+        test_chain( p_libvlc, "S16N 5.1 -> S16N stereo, fused", p_downmix_fused,
+                    sizeof(p_downmix_fused) / sizeof(*p_downmix_fused) );
+        test_chain( p_libvlc, "FI32 stereo -> S16N stereo, converter_fixed",
+                    p_fixed_chain, sizeof(p_fixed_chain) / sizeof(*p_fixed_chain) );
+        test_chain( p_libvlc, "FI32 stereo -> S16N stereo, fused",
+                    p_fixed_fused, sizeof(p_fixed_fused) / sizeof(*p_fixed_fused) );
+    }
+
+    libvlc_release( p_vlc );
+    return i_ret;
+}
@@ -0,0 +1,183 @@
+/*****************************************************************************
+ * equalizer.c: test and benchmark of the biquad based audio filters
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The filter helpers log with the module name */
+#define MODULE_STRING "test"
+
+/* Before the log() macro of the tests */
+#include <math.h>
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include "filter.h"
+
+#define AUDIO_RATE          48000
+#define AUDIO_DURATION      10 /* in seconds */
+#define BUFFER_SAMPLES      1024
+
+#define BANDS_FLAT          "0 0 0 0 0 0 0 0 0 0"
+#define BANDS_1KHZ_UP       "0 0 0 0 12 0 0 0 0 0"
+
+static const vlc_fourcc_t pi_formats[] = { VLC_CODEC_FL32, VLC_CODEC_FI32 };
+static const char *ppsz_modules[] = { "equalizer", "compressor", "normvol" };
+
+static filter_t *CreateStereoFilter( libvlc_int_t *p_libvlc,
+                                     const char *psz_module,
+                                     vlc_fourcc_t i_format )
+{
+    audio_format_t fmt;
+
+    AudioFormat( &fmt, i_format, AUDIO_RATE, AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT );
+    return CreateFilter( p_libvlc, psz_module, &fmt, NULL );
+}
+
+/* Runs AUDIO_DURATION seconds of a sine through the filter, returns the RMS
+ * level of the last second of the left channel */
+static double Run( filter_t *p_filter, double f_frequency, mtime_t *pi_cpu )
+{
+    const vlc_fourcc_t i_format = p_filter->fmt_in.audio.i_format;
+    double f_energy = 0.;
+
+    *pi_cpu = 0;
+    for( unsigned n = 0; n + BUFFER_SAMPLES <= AUDIO_DURATION * AUDIO_RATE; )
+    {
+        block_t *p_block = block_Alloc( BUFFER_SAMPLES *
+                                        p_filter->fmt_in.audio.i_bytes_per_frame );
+        assert( p_block != NULL );
+        p_block->i_nb_samples = BUFFER_SAMPLES;
+        p_block->i_dts =
+        p_block->i_pts = VLC_TS_0 + (mtime_t)n * CLOCK_FREQ / AUDIO_RATE;
+
+        const unsigned i_first = n;
+        for( unsigned i = 0; i < BUFFER_SAMPLES; i++, n++ )
+        {
+            const double f = 0.1 * sin( 2. * M_PI * f_frequency * n / AUDIO_RATE );
+            if( i_format == VLC_CODEC_FI32 )
+                ((int32_t *)p_block->p_buffer)[2*i] =
+                ((int32_t *)p_block->p_buffer)[2*i+1] = lrint( f * FIXED32_ONE );
+            else
+                ((float *)p_block->p_buffer)[2*i] =
+                ((float *)p_block->p_buffer)[2*i+1] = f;
+        }
+
+        const mtime_t i_begin = mdate();
+        p_block = p_filter->pf_audio_filter( p_filter, p_block );
+        *pi_cpu += mdate() - i_begin;
+
+        assert( p_block != NULL );
+        assert( p_block->i_nb_samples == BUFFER_SAMPLES );
+        if( i_first >= ( AUDIO_DURATION - 1 ) * AUDIO_RATE )
+        {
+            for( unsigned i = 0; i < BUFFER_SAMPLES; i++ )
+            {
+                const double f = i_format == VLC_CODEC_FI32
+                    ? ((int32_t *)p_block->p_buffer)[2*i] / (double)FIXED32_ONE
+                    : ((float *)p_block->p_buffer)[2*i];
+                f_energy += f * f;
+            }
+        }
+        block_Release( p_block );
+    }
+    return sqrt( f_energy / AUDIO_RATE );
+}
+
+static double Equalize( libvlc_int_t *p_libvlc, vlc_fourcc_t i_format,
+                        const char *psz_bands, double f_frequency )
+{
+    var_SetString( p_libvlc, "equalizer-bands", psz_bands );
+
+    filter_t *p_filter = CreateStereoFilter( p_libvlc, "equalizer", i_format );
+    if( !p_filter )
+        return -1.;
+
+    mtime_t i_cpu;
+    const double f_rms = Run( p_filter, f_frequency, &i_cpu );
+    DeleteFilter( p_filter );
+    return f_rms;
+}
+
+/* The band of 1 kHz must raise a 1 kHz tone and leave a 60 Hz one alone, and
+ * the fixed point chain must give the same levels as the float one */
+static int test_equalizer( libvlc_int_t *p_libvlc )
+{
+    double pf_boost[2];
+
+    var_Create( p_libvlc, "equalizer-bands", VLC_VAR_STRING );
+    for( unsigned i = 0; i < sizeof(pi_formats) / sizeof(*pi_formats); i++ )
+    {
+        const double f_flat = Equalize( p_libvlc, pi_formats[i], BANDS_FLAT, 1000. );
+        if( f_flat < 0. )
+            return 77;
+        const double f_up = Equalize( p_libvlc, pi_formats[i], BANDS_1KHZ_UP, 1000. );
+        const double f_low = Equalize( p_libvlc, pi_formats[i], BANDS_1KHZ_UP, 60. );
+        const double f_low_flat = Equalize( p_libvlc, pi_formats[i], BANDS_FLAT, 60. );
+
+        pf_boost[i] = 20. * log10( f_up / f_flat );
+        log( "  %4.4s: +%.1f dB at 1 kHz, %+.1f dB at 60 Hz\n",
+             (const char *)&pi_formats[i], pf_boost[i],
+             20. * log10( f_low / f_low_flat ) );
+        assert( pf_boost[i] > 11. && pf_boost[i] < 13. );
+        assert( fabs( 20. * log10( f_low / f_low_flat ) ) < 1. );
+    }
+    assert( fabs( pf_boost[0] - pf_boost[1] ) < 0.01 );
+
+    var_SetString( p_libvlc, "equalizer-bands", BANDS_FLAT );
+    return 0;
+}
+
+static int test_benchmark( libvlc_int_t *p_libvlc, const char *psz_module,
+                           vlc_fourcc_t i_format )
+{
+    filter_t *p_filter = CreateStereoFilter( p_libvlc, psz_module, i_format );
+    if( !p_filter )
+        return 77;
+
+    mtime_t i_cpu;
+    Run( p_filter, 440., &i_cpu );
+    log( "  %s %4.4s: %.2f ms of CPU per second of stereo audio\n", psz_module,
+         (const char *)&i_format, (double)i_cpu / AUDIO_DURATION / 1000. );
+
+    DeleteFilter( p_filter );
+    return 0;
+}
+
+int main( void )
+{
+    int i_ret;
+
+    test_init();
+    alarm( 60 );
+
+    log( "Testing the biquad based audio filters\n" );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+    libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
+
+    i_ret = test_equalizer( p_libvlc );
+    for( unsigned i = 0; i < sizeof(ppsz_modules) / sizeof(*ppsz_modules) && !i_ret; i++ )
+        for( unsigned j = 0; j < sizeof(pi_formats) / sizeof(*pi_formats) && !i_ret; j++ )
+            i_ret = test_benchmark( p_libvlc, ppsz_modules[i], pi_formats[j] );
+
+    libvlc_release( p_vlc );
+    return i_ret;
+}
@@ -0,0 +1,104 @@
+/*****************************************************************************
+ * filter.h: audio filter helpers for the tests
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef TEST_AUDIO_FILTER_H
+#define TEST_AUDIO_FILTER_H
+
+/* After the log() macro of the tests */
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+
+/* Buffers allocated by the filters, for the tests of the in place paths */
+static unsigned i_allocations;
+
+static inline block_t *AudioBufferNew( filter_t *p_filter, int i_size )
+{
+    (void)p_filter;
+    i_allocations++;
+    return block_Alloc( i_size );
+}
+
+static inline void AudioFormat( audio_format_t *p_fmt, vlc_fourcc_t i_format,
+                                unsigned i_rate, uint32_t i_channels )
+{
+    memset( p_fmt, 0, sizeof(*p_fmt) );
+    p_fmt->i_format = i_format;
+    p_fmt->i_rate = i_rate;
+    p_fmt->i_physical_channels =
+    p_fmt->i_original_channels = i_channels;
+    aout_FormatPrepare( p_fmt );
+}
+
+/* Creates a filter object from p_in to p_out, the same format if NULL. The
+ * caller can set the variables of the module before LoadFilter() */
+static inline filter_t *NewFilter( libvlc_int_t *p_libvlc,
+                                   const audio_format_t *p_in,
+                                   const audio_format_t *p_out )
+{
+    filter_t *p_filter = vlc_object_create( p_libvlc, sizeof(*p_filter) );
+    assert( p_filter != NULL );
+
+    if( p_out == NULL )
+        p_out = p_in;
+    es_format_Init( &p_filter->fmt_in, AUDIO_ES, p_in->i_format );
+    p_filter->fmt_in.audio = *p_in;
+    es_format_Init( &p_filter->fmt_out, AUDIO_ES, p_out->i_format );
+    p_filter->fmt_out.audio = *p_out;
+    p_filter->pf_audio_buffer_new = AudioBufferNew;
+    return p_filter;
+}
+
+/* Loads the module, or releases the filter and returns NULL */
+static inline filter_t *LoadFilter( filter_t *p_filter,
+                                    const char *psz_module )
+{
+    p_filter->p_module = module_need( p_filter, "audio filter",
+                                      psz_module, true );
+    if( !p_filter->p_module )
+    {
+        log( "  %s not available\n", psz_module );
+        es_format_Clean( &p_filter->fmt_out );
+        es_format_Clean( &p_filter->fmt_in );
+        vlc_object_release( p_filter );
+        return NULL;
+    }
+    return p_filter;
+}
+
+static inline filter_t *CreateFilter( libvlc_int_t *p_libvlc,
+                                      const char *psz_module,
+                                      const audio_format_t *p_in,
+                                      const audio_format_t *p_out )
+{
+    return LoadFilter( NewFilter( p_libvlc, p_in, p_out ), psz_module );
+}
+
+static inline void DeleteFilter( filter_t *p_filter )
+{
+    module_unneed( p_filter, p_filter->p_module );
+    es_format_Clean( &p_filter->fmt_out );
+    es_format_Clean( &p_filter->fmt_in );
+    vlc_object_release( p_filter );
+}
+
+#endif
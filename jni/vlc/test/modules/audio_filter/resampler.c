@@ -0,0 +1,270 @@
+/*****************************************************************************
+ * resampler.c: quality test and benchmark for the audio resamplers
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The filter helpers log with the module name */
+#define MODULE_STRING "test"
+
+/* Before the log() macro of the tests */
+#include <math.h>
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include "filter.h"
+
+/* A 997 Hz tone at -6 dBFS, 10 seconds in buffers of 1024 samples */
+#define TONE_FREQUENCY      997.
+#define TONE_AMPLITUDE      0.5
+#define TONE_DURATION       10 /* in seconds */
+#define BUFFER_SAMPLES      1024
+
+typedef struct
+{
+    const char   *psz_module;
+    int          i_quality;
+    vlc_fourcc_t i_format;
+    unsigned     i_in_rate;
+    unsigned     i_out_rate;
+    double       f_max_thdn; /* in dB */
+} resampler_test_t;
+
+static const resampler_test_t p_tests[] = {
+    { "ugly_resampler",      0, VLC_CODEC_S16N, 44100, 48000,   0. },
+    { "polyphase_resampler", 0, VLC_CODEC_S16N, 44100, 48000, -55. },
+    { "polyphase_resampler", 1, VLC_CODEC_S16N, 44100, 48000, -70. },
+    { "polyphase_resampler", 2, VLC_CODEC_S16N, 44100, 48000, -78. },
+    { "polyphase_resampler", 2, VLC_CODEC_S16N, 48000, 44100, -78. },
+    { "polyphase_resampler", 0, VLC_CODEC_FI32, 44100, 48000, -55. },
+    { "polyphase_resampler", 1, VLC_CODEC_FI32, 44100, 48000, -70. },
+    { "polyphase_resampler", 2, VLC_CODEC_FI32, 44100, 48000, -80. },
+    { "polyphase_resampler", 2, VLC_CODEC_FI32, 48000, 32000, -80. },
+};
+
+/* THD+N of a mono signal: power of what is left once the tone is removed,
+ * relatively to the tone */
+static double ThdN( const double *p_signal, unsigned i_count, double f_rate )
+{
+    double f_mean = 0., f_sin = 0., f_cos = 0.;
+
+    for( unsigned i = 0; i < i_count; i++ )
+        f_mean += p_signal[i];
+    f_mean /= i_count;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        const double w = 2. * M_PI * TONE_FREQUENCY * i / f_rate;
+        f_sin += ( p_signal[i] - f_mean ) * sin( w );
+        f_cos += ( p_signal[i] - f_mean ) * cos( w );
+    }
+    f_sin *= 2. / i_count;
+    f_cos *= 2. / i_count;
+
+    double f_tone = 0., f_noise = 0.;
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        const double w = 2. * M_PI * TONE_FREQUENCY * i / f_rate;
+        const double f = f_sin * sin( w ) + f_cos * cos( w );
+
+        f_tone += f * f;
+        f_noise += ( p_signal[i] - f_mean - f ) * ( p_signal[i] - f_mean - f );
+    }
+    return 10. * log10( f_noise / f_tone );
+}
+
+static int test_resampler( libvlc_int_t *p_libvlc, const resampler_test_t *p_test )
+{
+    audio_format_t in, out;
+    AudioFormat( &in, p_test->i_format, p_test->i_in_rate,
+                 AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT );
+    AudioFormat( &out, p_test->i_format, p_test->i_out_rate,
+                 AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT );
+
+    filter_t *p_filter = NewFilter( p_libvlc, &in, &out );
+    var_Create( p_filter, "polyphase-quality", VLC_VAR_INTEGER );
+    var_SetInteger( p_filter, "polyphase-quality", p_test->i_quality );
+    if( !LoadFilter( p_filter, p_test->psz_module ) )
+        return 77;
+
+    const bool b_s16 = p_test->i_format == VLC_CODEC_S16N;
+    const unsigned i_in_count = TONE_DURATION * p_test->i_in_rate;
+    const unsigned i_out_max = (TONE_DURATION + 1) * p_test->i_out_rate;
+    double *p_signal = malloc( i_out_max * sizeof(*p_signal) );
+    assert( p_signal != NULL );
+    unsigned i_out_count = 0;
+    mtime_t i_cpu = 0;
+
+    for( unsigned n = 0; n + BUFFER_SAMPLES <= i_in_count; )
+    {
+        block_t *p_block = block_Alloc( BUFFER_SAMPLES *
+                                        p_filter->fmt_in.audio.i_bytes_per_frame );
+        assert( p_block != NULL );
+        p_block->i_nb_samples = BUFFER_SAMPLES;
+        p_block->i_dts =
+        p_block->i_pts = VLC_TS_0 + (mtime_t)n * CLOCK_FREQ / p_test->i_in_rate;
+        for( unsigned i = 0; i < BUFFER_SAMPLES; i++, n++ )
+        {
+            const double f = TONE_AMPLITUDE *
+                sin( 2. * M_PI * TONE_FREQUENCY * n / p_test->i_in_rate );
+            if( b_s16 )
+                ((int16_t *)p_block->p_buffer)[2*i] =
+                ((int16_t *)p_block->p_buffer)[2*i+1] = lrint( f * INT16_MAX );
+            else
+                ((int32_t *)p_block->p_buffer)[2*i] =
+                ((int32_t *)p_block->p_buffer)[2*i+1] = lrint( f * FIXED32_ONE );
+        }
+
+        const mtime_t i_begin = mdate();
+        p_block = p_filter->pf_audio_filter( p_filter, p_block );
+        i_cpu += mdate() - i_begin;
+
+        if( !p_block )
+            continue;
+        for( unsigned i = 0; i < p_block->i_nb_samples && i_out_count < i_out_max; i++ )
+            p_signal[i_out_count++] = b_s16
+                ? ((int16_t *)p_block->p_buffer)[2*i] / (double)INT16_MAX
+                : ((int32_t *)p_block->p_buffer)[2*i] / (double)FIXED32_ONE;
+        block_Release( p_block );
+    }
+
+    /* Skip the first and last second, for the filter delay */
+    assert( i_out_count > 2 * p_test->i_out_rate );
+    const double f_thdn = ThdN( &p_signal[p_test->i_out_rate],
+                                i_out_count - 2 * p_test->i_out_rate,
+                                p_test->i_out_rate );
+
+    log( "  %s (quality %d) %4.4s %u->%u: THD+N %.1f dB, "
+         "%.2f ms of CPU per second of audio\n",
+         p_test->psz_module, p_test->i_quality, (const char *)&p_test->i_format,
+         p_test->i_in_rate, p_test->i_out_rate, f_thdn,
+         (double)i_cpu / TONE_DURATION / 1000. );
+    if( p_test->f_max_thdn < 0. )
+        assert( f_thdn <= p_test->f_max_thdn );
+
+    free( p_signal );
+    DeleteFilter( p_filter );
+    return 0;
+}
+
+/* Drift correction changes the input rate by 2 Hz for every buffer. The tone
+ * follows the rate, so that it stays at TONE_FREQUENCY in the output */
+#define DRIFT_QUALITY       1
+#define DRIFT_MAX_THDN      (-70.) /* of the quality at a static rate */
+#define DRIFT_MAX_ERROR     32     /* samples, the taps of any quality */
+
+static int test_drift( libvlc_int_t *p_libvlc )
+{
+    audio_format_t in, out;
+    AudioFormat( &in, VLC_CODEC_S16N, 48000 * 104 / 100,
+                 AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT );
+    AudioFormat( &out, VLC_CODEC_S16N, 48000,
+                 AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT );
+
+    filter_t *p_filter = NewFilter( p_libvlc, &in, &out );
+    var_Create( p_filter, "polyphase-quality", VLC_VAR_INTEGER );
+    var_SetInteger( p_filter, "polyphase-quality", DRIFT_QUALITY );
+    if( !LoadFilter( p_filter, "polyphase_resampler" ) )
+        return 77;
+
+    /* Like the audio output, start from the nominal rate */
+    p_filter->fmt_in.audio.i_rate = 48000;
+
+    const unsigned i_buffers = TONE_DURATION * 48000 / BUFFER_SAMPLES;
+    const unsigned i_out_max = (TONE_DURATION + 1) * 48000;
+    double *p_signal = malloc( i_out_max * sizeof(*p_signal) );
+    assert( p_signal != NULL );
+
+    mtime_t i_cpu = 0;
+    unsigned i_in = 0, i_out = 0;
+    double f_phase = 0., f_expected = 0.;
+    for( unsigned i = 0; i < i_buffers; i++ )
+    {
+        p_filter->fmt_in.audio.i_rate += i < 250 ? 2 : -2;
+        const unsigned i_rate = p_filter->fmt_in.audio.i_rate;
+
+        block_t *p_block = block_Alloc( BUFFER_SAMPLES *
+                                        p_filter->fmt_in.audio.i_bytes_per_frame );
+        assert( p_block != NULL );
+        p_block->i_nb_samples = BUFFER_SAMPLES;
+        p_block->i_dts =
+        p_block->i_pts = VLC_TS_0 + (mtime_t)i_in * CLOCK_FREQ / 48000;
+        for( unsigned j = 0; j < BUFFER_SAMPLES; j++ )
+        {
+            ((int16_t *)p_block->p_buffer)[2*j] =
+            ((int16_t *)p_block->p_buffer)[2*j+1] =
+                lrint( TONE_AMPLITUDE * sin( f_phase ) * INT16_MAX );
+            f_phase += 2. * M_PI * TONE_FREQUENCY / i_rate;
+        }
+        i_in += BUFFER_SAMPLES;
+        f_expected += (double)BUFFER_SAMPLES * 48000 / i_rate;
+
+        const mtime_t i_begin = mdate();
+        p_block = p_filter->pf_audio_filter( p_filter, p_block );
+        i_cpu += mdate() - i_begin;
+        if( !p_block )
+            continue;
+        for( unsigned j = 0; j < p_block->i_nb_samples && i_out < i_out_max; j++ )
+            p_signal[i_out++] = ((int16_t *)p_block->p_buffer)[2*j] /
+                                (double)INT16_MAX;
+        block_Release( p_block );
+    }
+
+    /* Skip the first and last second, for the filter delay */
+    assert( i_out > 2 * 48000 );
+    const double f_thdn = ThdN( &p_signal[48000], i_out - 2 * 48000, 48000 );
+
+    log( "  drift correction: %u samples in, %u out for %.0f expected, "
+         "THD+N %.1f dB, %.2f ms of CPU per second of audio\n", i_in, i_out,
+         f_expected, f_thdn, (double)i_cpu / TONE_DURATION / 1000. );
+
+    /* The output follows the integrated rate, short of the filter delay */
+    assert( fabs( i_out - f_expected ) <= DRIFT_MAX_ERROR );
+    assert( f_thdn <= DRIFT_MAX_THDN );
+
+    free( p_signal );
+    DeleteFilter( p_filter );
+    return 0;
+}
+
+int main( void )
+{
+    int i_ret = 0;
+
+    test_init();
+    alarm( 120 );
+
+    log( "Testing the audio resamplers\n" );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    for( unsigned i = 0; i < sizeof(p_tests) / sizeof(*p_tests); i++ )
+    {
+        int i_test = test_resampler( p_vlc->p_libvlc_int, &p_tests[i] );
+        /* The reference may not be built */
+        if( i_test && p_tests[i].f_max_thdn < 0. )
+            i_ret = i_test;
+    }
+    if( !i_ret )
+        i_ret = test_drift( p_vlc->p_libvlc_int );
+
+    libvlc_release( p_vlc );
+    return i_ret;
+}
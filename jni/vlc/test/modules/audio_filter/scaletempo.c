@@ -0,0 +1,202 @@
+/*****************************************************************************
+ * scaletempo.c: quality test and benchmark of the audio tempo scaler
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The filter helpers log with the module name */
+#define MODULE_STRING "test"
+
+/* Before the log() macro of the tests */
+#include <math.h>
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include "filter.h"
+
+/* 10 seconds of a synthetic vowel, in buffers of 1024 samples */
+#define SPEECH_RATE         48000
+#define SPEECH_PITCH        150. /* in Hz */
+#define SPEECH_DURATION     10 /* in seconds */
+#define BUFFER_SAMPLES      1024
+
+static const vlc_fourcc_t pi_formats[] = {
+    VLC_CODEC_S16N, VLC_CODEC_FI32, VLC_CODEC_FL32,
+};
+static const double pf_scales[] = { 0.5, 0.75, 1.5, 2.0, 3.0 };
+
+/* A voiced sound: harmonics of a pitch with a light vibrato, shaped by three
+ * formants, and a syllable rate amplitude envelope */
+static double Speech( unsigned n, double *pf_phase )
+{
+    const double t = (double)n / SPEECH_RATE;
+    const double f_pitch = SPEECH_PITCH * ( 1. + 0.03 * sin( 2. * M_PI * 3. * t ) );
+    double f = 0.;
+
+    *pf_phase += 2. * M_PI * f_pitch / SPEECH_RATE;
+    for( unsigned h = 1; h <= 20; h++ )
+    {
+        const double fh = h * SPEECH_PITCH;
+        const double g = 1.  / ( 1. + pow( ( fh -  700. ) / 150., 2 ) )
+                       + .6  / ( 1. + pow( ( fh - 1200. ) / 200., 2 ) )
+                       + .3  / ( 1. + pow( ( fh - 2500. ) / 300., 2 ) );
+        f += g * sin( h * *pf_phase ) / h;
+    }
+    return 0.4 * f * ( 0.5 + 0.5 * sin( 2. * M_PI * 4. * t ) );
+}
+
+/* Pitch from the highest normalized autocorrelation between 60 and 400 Hz,
+ * the correlation tells how periodic the splices left the signal */
+static double Pitch( const double *p_signal, unsigned i_count, double *pf_corr )
+{
+    unsigned i_best = 0;
+
+    *pf_corr = -1.;
+    for( unsigned i_lag = SPEECH_RATE / 400; i_lag <= SPEECH_RATE / 60; i_lag++ )
+    {
+        double f_corr = 0., f_e1 = 0., f_e2 = 0.;
+
+        for( unsigned i = 0; i + i_lag < i_count; i++ )
+        {
+            f_corr += p_signal[i] * p_signal[i + i_lag];
+            f_e1 += p_signal[i] * p_signal[i];
+            f_e2 += p_signal[i + i_lag] * p_signal[i + i_lag];
+        }
+        f_corr /= sqrt( f_e1 * f_e2 );
+        if( f_corr > *pf_corr )
+        {
+            *pf_corr = f_corr;
+            i_best = i_lag;
+        }
+    }
+    return (double)SPEECH_RATE / i_best;
+}
+
+static int test_scaletempo( libvlc_int_t *p_libvlc, vlc_fourcc_t i_format,
+                            double f_scale )
+{
+    audio_format_t fmt;
+    AudioFormat( &fmt, i_format, SPEECH_RATE, AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT );
+
+    filter_t *p_filter = CreateFilter( p_libvlc, "scaletempo", &fmt, NULL );
+    if( !p_filter )
+        return 77;
+
+    /* Like the audio output does for the playback rate */
+    p_filter->fmt_in.audio.i_rate = lrint( SPEECH_RATE * f_scale );
+
+    const unsigned i_in_count = SPEECH_DURATION * SPEECH_RATE;
+    const unsigned i_out_max = i_in_count / f_scale + SPEECH_RATE;
+    double *p_signal = malloc( i_out_max * sizeof(*p_signal) );
+    assert( p_signal != NULL );
+    unsigned i_out_count = 0;
+    double f_phase = 0.;
+    mtime_t i_cpu = 0;
+
+    for( unsigned n = 0; n + BUFFER_SAMPLES <= i_in_count; )
+    {
+        block_t *p_block = block_Alloc( BUFFER_SAMPLES *
+                                        p_filter->fmt_in.audio.i_bytes_per_frame );
+        assert( p_block != NULL );
+        p_block->i_nb_samples = BUFFER_SAMPLES;
+        p_block->i_dts =
+        p_block->i_pts = VLC_TS_0 + (mtime_t)n * CLOCK_FREQ / SPEECH_RATE;
+        for( unsigned i = 0; i < BUFFER_SAMPLES; i++, n++ )
+        {
+            const double f = Speech( n, &f_phase );
+            switch( i_format )
+            {
+                case VLC_CODEC_S16N:
+                    ((int16_t *)p_block->p_buffer)[2*i] =
+                    ((int16_t *)p_block->p_buffer)[2*i+1] = lrint( f * INT16_MAX );
+                    break;
+                case VLC_CODEC_FI32:
+                    ((int32_t *)p_block->p_buffer)[2*i] =
+                    ((int32_t *)p_block->p_buffer)[2*i+1] = lrint( f * FIXED32_ONE );
+                    break;
+                default:
+                    ((float *)p_block->p_buffer)[2*i] =
+                    ((float *)p_block->p_buffer)[2*i+1] = f;
+            }
+        }
+
+        const mtime_t i_begin = mdate();
+        p_block = p_filter->pf_audio_filter( p_filter, p_block );
+        i_cpu += mdate() - i_begin;
+
+        if( !p_block )
+            continue;
+        for( unsigned i = 0; i < p_block->i_nb_samples && i_out_count < i_out_max; i++ )
+        {
+            switch( i_format )
+            {
+                case VLC_CODEC_S16N:
+                    p_signal[i_out_count++] =
+                        ((int16_t *)p_block->p_buffer)[2*i] / (double)INT16_MAX;
+                    break;
+                case VLC_CODEC_FI32:
+                    p_signal[i_out_count++] =
+                        ((int32_t *)p_block->p_buffer)[2*i] / (double)FIXED32_ONE;
+                    break;
+                default:
+                    p_signal[i_out_count++] = ((float *)p_block->p_buffer)[2*i];
+            }
+        }
+        block_Release( p_block );
+    }
+
+    /* 100 ms in the middle, the pitch must not follow the playback rate */
+    double f_corr;
+    const double f_pitch = Pitch( &p_signal[i_out_count / 2],
+                                  SPEECH_RATE / 10, &f_corr );
+    const double f_length = i_out_count * f_scale / i_in_count;
+
+    log( "  %4.4s x%.2f: length %.3f, pitch %.1f Hz, periodicity %.3f, "
+         "%.2f ms of CPU per second of audio\n", (const char *)&i_format,
+         f_scale, f_length, f_pitch, f_corr,
+         (double)i_cpu / SPEECH_DURATION / 1000. );
+    assert( fabs( f_length - 1. ) < 0.02 );
+    assert( fabs( f_pitch - SPEECH_PITCH ) < SPEECH_PITCH * 0.05 );
+    assert( f_corr > 0.7 );
+
+    free( p_signal );
+    DeleteFilter( p_filter );
+    return 0;
+}
+
+int main( void )
+{
+    int i_ret = 0;
+
+    test_init();
+    alarm( 120 );
+
+    log( "Testing the audio tempo scaler\n" );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    for( unsigned i = 0; i < sizeof(pi_formats) / sizeof(*pi_formats); i++ )
+        for( unsigned j = 0; j < sizeof(pf_scales) / sizeof(*pf_scales) && !i_ret; j++ )
+            i_ret = test_scaletempo( p_vlc->p_libvlc_int, pi_formats[i],
+                                     pf_scales[j] );
+
+    libvlc_release( p_vlc );
+    return i_ret;
+}
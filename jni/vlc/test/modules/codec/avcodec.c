@@ -0,0 +1,209 @@
+/*****************************************************************************
+ * avcodec.c: benchmark of the threading modes of the avcodec video decoder
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+
+#include <dirent.h>
+#include <sys/resource.h>
+
+/* The folder of video clips to use for the benchmark, of several codecs and
+ * resolutions */
+#define AVCODEC_DIR_ENV     "VLC_TEST_AVCODEC_DIR"
+#define MAX_FILES           100
+
+/* The clips are played faster than the decoder can go, so that the pictures
+ * decoded per second measure its throughput */
+#define BENCH_RATE          32.f
+#define BENCH_DURATION      (5 * CLOCK_FREQ)
+
+/* The values of ffmpeg-threads-type */
+#define THREAD_AUTO         0
+#define THREAD_FRAME        1
+#define THREAD_SLICE        2
+
+static const struct
+{
+    int         i_threads;
+    int         i_type;
+    const char *psz_name;
+} p_configs[] = {
+    { 0, THREAD_AUTO,  "auto" },
+    { 1, THREAD_AUTO,  "single" },
+    { 2, THREAD_FRAME, "frame" },
+    { 2, THREAD_SLICE, "slice" },
+    { 4, THREAD_FRAME, "frame" },
+    { 4, THREAD_SLICE, "slice" },
+};
+#define CONFIGS (sizeof(p_configs) / sizeof(*p_configs))
+
+static mtime_t GetCpuTime( void )
+{
+    struct rusage usage;
+
+    assert( getrusage( RUSAGE_SELF, &usage ) == 0 );
+    return usage.ru_utime.tv_sec * CLOCK_FREQ + usage.ru_utime.tv_usec +
+           usage.ru_stime.tv_sec * CLOCK_FREQ + usage.ru_stime.tv_usec;
+}
+
+/* Logs the codec and the resolution of the first video track */
+static bool LogClip( libvlc_media_t *p_md, const char *psz_path )
+{
+    libvlc_media_track_info_t *p_tracks;
+    const int i_tracks = libvlc_media_get_tracks_info( p_md, &p_tracks );
+    const char *psz_name = strrchr( psz_path, '/' );
+    bool b_video = false;
+
+    for( int i = 0; i < i_tracks && !b_video; i++ )
+    {
+        if( p_tracks[i].i_type != libvlc_track_video )
+            continue;
+        log( "  %s: %4.4s %ux%u\n", psz_name ? psz_name + 1 : psz_path,
+             (const char *)&p_tracks[i].i_codec, p_tracks[i].u.video.i_width,
+             p_tracks[i].u.video.i_height );
+        b_video = true;
+    }
+    if( i_tracks > 0 )
+        free( p_tracks );
+    return b_video;
+}
+
+/* Decodes the clip for a while and logs the speed of the decoder */
+static void Bench( libvlc_instance_t *p_vlc, const char *psz_path,
+                   unsigned i_config )
+{
+    libvlc_media_t *p_md = libvlc_media_new_path( p_vlc, psz_path );
+    assert( p_md != NULL );
+
+    char psz_option[32];
+    libvlc_media_add_option( p_md, ":no-audio" );
+    libvlc_media_add_option( p_md, ":codec=avcodec" );
+    snprintf( psz_option, sizeof(psz_option), ":ffmpeg-threads=%d",
+              p_configs[i_config].i_threads );
+    libvlc_media_add_option( p_md, psz_option );
+    snprintf( psz_option, sizeof(psz_option), ":ffmpeg-threads-type=%d",
+              p_configs[i_config].i_type );
+    libvlc_media_add_option( p_md, psz_option );
+
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_md );
+    assert( p_mp != NULL );
+
+    const mtime_t i_begin = mdate();
+    const mtime_t i_cpu_begin = GetCpuTime();
+    libvlc_media_player_play( p_mp );
+
+    libvlc_state_t state;
+    while( ( state = libvlc_media_player_get_state( p_mp ) ) != libvlc_Playing &&
+           state != libvlc_Error && state != libvlc_Ended )
+        msleep( 10000 );
+    libvlc_media_player_set_rate( p_mp, BENCH_RATE );
+
+    while( libvlc_media_player_get_state( p_mp ) == libvlc_Playing &&
+           mdate() - i_begin < BENCH_DURATION )
+        msleep( 50000 );
+
+    const mtime_t i_duration = mdate() - i_begin;
+    const mtime_t i_cpu = GetCpuTime() - i_cpu_begin;
+    libvlc_media_player_stop( p_mp );
+
+    /* The statistics are updated when the input ends */
+    libvlc_media_stats_t stats;
+    if( i_config == 0 && !LogClip( p_md, psz_path ) )
+        log( "  %s: no video\n", psz_path );
+    if( libvlc_media_get_stats( p_md, &stats ) && stats.i_decoded_video > 0 )
+    {
+        log( "    %-6s %2d thread(s): %6.1f pictures/s, "
+             "%5.2f ms of CPU per picture\n", p_configs[i_config].psz_name,
+             p_configs[i_config].i_threads, stats.i_decoded_video *
+             (double)CLOCK_FREQ / i_duration,
+             i_cpu / 1000. / stats.i_decoded_video );
+    }
+    else
+    {
+        log( "    %-6s %2d thread(s): not decoded\n",
+             p_configs[i_config].psz_name, p_configs[i_config].i_threads );
+    }
+
+    libvlc_media_player_release( p_mp );
+    libvlc_media_release( p_md );
+}
+
+static unsigned ListFiles( const char *psz_dir, char **ppsz_paths )
+{
+    DIR *p_dir = opendir( psz_dir );
+    if( !p_dir )
+        return 0;
+
+    unsigned i_count = 0;
+    struct dirent *p_entry;
+    while( i_count < MAX_FILES && (p_entry = readdir( p_dir )) != NULL )
+    {
+        if( p_entry->d_name[0] == '.' )
+            continue;
+
+        if( asprintf( &ppsz_paths[i_count], "%s/%s", psz_dir,
+                      p_entry->d_name ) < 0 )
+            break;
+        i_count++;
+    }
+    closedir( p_dir );
+    return i_count;
+}
+
+int main( void )
+{
+    test_init();
+
+    const char *psz_dir = getenv( AVCODEC_DIR_ENV );
+    if( !psz_dir )
+    {
+        log( "Skipping the avcodec threading benchmark, "
+             "set "AVCODEC_DIR_ENV" to a folder of video clips\n" );
+        return 77;
+    }
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    if( !module_exists( "avcodec" ) )
+    {
+        log( "  avcodec decoder not available\n" );
+        libvlc_release( p_vlc );
+        return 77;
+    }
+
+    char *ppsz_paths[MAX_FILES];
+    const unsigned i_count = ListFiles( psz_dir, ppsz_paths );
+
+    alarm( 10 + i_count * CONFIGS * ( BENCH_DURATION / CLOCK_FREQ + 2 ) );
+    log( "Benchmarking the avcodec threading modes on %s\n", psz_dir );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        for( unsigned j = 0; j < CONFIGS; j++ )
+            Bench( p_vlc, ppsz_paths[i], j );
+        free( ppsz_paths[i] );
+    }
+
+    libvlc_release( p_vlc );
+    return 0;
+}
@@ -0,0 +1,272 @@
+/*****************************************************************************
+ * libass.c: benchmark for animated SSA/ASS subtitles rendering
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The filter helpers log with the module name */
+#define MODULE_STRING "test"
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_codec.h>
+#include <vlc_spu.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_subpicture.h>
+
+/* 8 karaoke lines on screen at once, sung one after the other, replaced
+ * every 8 seconds */
+#define KARAOKE_LINES       8
+#define KARAOKE_SYLLABLES   10 /* of 100 ms each */
+#define KARAOKE_DURATION    8 /* in seconds */
+#define TIMELINE_DURATION   24 /* in seconds */
+
+#define FRAME_RATE          25
+#define FRAME_WIDTH         1280
+#define FRAME_HEIGHT        720
+
+static const char psz_header[] =
+    "[Script Info]\n"
+    "ScriptType: v4.00+\n"
+    "PlayResX: 1280\n"
+    "PlayResY: 720\n"
+    "\n"
+    "[V4+ Styles]\n"
+    "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, "
+    "OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, "
+    "ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, "
+    "MarginL, MarginR, MarginV, Encoding\n"
+    "Style: Karaoke,Arial,40,&H0000FFFF,&H00FFFFFF,&H00400000,&H80000000,"
+    "-1,0,0,0,100,100,0,0,1,3,2,8,20,20,20,1\n"
+    "Style: Romaji,Arial,28,&H00FFC0C0,&H00FFFFFF,&H00000000,&H80000000,"
+    "0,-1,0,0,100,100,1,0,1,2,1,8,20,20,20,1\n"
+    "\n"
+    "[Events]\n"
+    "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, "
+    "Effect, Text\n";
+
+/*****************************************************************************
+ * Decoder owner: gives the subpictures to the SPU
+ *****************************************************************************/
+struct decoder_owner_sys_t
+{
+    spu_t   *p_spu;
+    int     i_channel;
+    int64_t i_order;
+};
+
+static subpicture_t *SpuNew( decoder_t *p_dec,
+                             const subpicture_updater_t *p_updater )
+{
+    subpicture_t *p_subpic = subpicture_New( p_updater );
+    if( p_subpic )
+    {
+        p_subpic->i_channel = p_dec->p_owner->i_channel;
+        p_subpic->i_order = p_dec->p_owner->i_order++;
+        p_subpic->b_subtitle = true;
+    }
+    return p_subpic;
+}
+
+static void SpuDel( decoder_t *p_dec, subpicture_t *p_subpic )
+{
+    (void)p_dec;
+    subpicture_Delete( p_subpic );
+}
+
+/* Sends a block of lines, each sung after the previous one */
+static void DecodeLines( decoder_t *p_dec, unsigned i_block, mtime_t i_origin )
+{
+    for( unsigned i = 0; i < KARAOKE_LINES; i++ )
+    {
+        char psz_text[1024];
+        int i_len;
+
+        /* Matroska style chunk: ReadOrder, Layer, Style, Name, MarginL,
+         * MarginR, MarginV, Effect, Text */
+        i_len = snprintf( psz_text, sizeof(psz_text),
+                          "%u,0,%s,,0,0,0,,{\\pos(640,%u)\\k%u}",
+                          i_block * KARAOKE_LINES + i, i % 2 ? "Romaji" : "Karaoke",
+                          40 + i * 80, i * KARAOKE_SYLLABLES * 10 );
+        for( unsigned j = 0; j < KARAOKE_SYLLABLES; j++ )
+            i_len += snprintf( &psz_text[i_len], sizeof(psz_text) - i_len,
+                               "{\\k10}%s%u ", j % 3 ? "la" : "{\\b1}ka{\\b0}", j );
+
+        block_t *p_block = block_Alloc( i_len );
+        assert( p_block != NULL );
+        memcpy( p_block->p_buffer, psz_text, i_len );
+        p_block->i_dts =
+        p_block->i_pts = i_origin + (mtime_t)i_block * KARAOKE_DURATION * CLOCK_FREQ;
+        p_block->i_length = KARAOKE_DURATION * CLOCK_FREQ;
+
+        subpicture_t *p_subpic = p_dec->pf_decode_sub( p_dec, &p_block );
+        if( p_subpic )
+            spu_PutSubpicture( p_dec->p_owner->p_spu, p_subpic );
+    }
+}
+
+/*****************************************************************************
+ * Renders the timeline into a memory picture, like a video output would
+ *****************************************************************************/
+static int test_libass( libvlc_int_t *p_libvlc )
+{
+    vlc_object_t *p_obj = vlc_object_create( p_libvlc, sizeof(*p_obj) );
+    assert( p_obj != NULL );
+
+    video_format_t fmt;
+    video_format_Setup( &fmt, VLC_CODEC_RGB32, FRAME_WIDTH, FRAME_HEIGHT, 1, 1 );
+    video_format_FixRgb( &fmt );
+
+    picture_t *p_picture = picture_NewFromFormat( &fmt );
+    assert( p_picture != NULL );
+    filter_t *p_blend = filter_NewBlend( p_obj, &fmt );
+    assert( p_blend != NULL );
+
+    spu_t *p_spu = spu_Create( p_obj );
+    assert( p_spu != NULL );
+
+    /* */
+    decoder_owner_sys_t owner = {
+        .p_spu = p_spu,
+        .i_channel = spu_RegisterChannel( p_spu ),
+        .i_order = 0,
+    };
+    decoder_t *p_dec = vlc_object_create( p_obj, sizeof(*p_dec) );
+    assert( p_dec != NULL );
+    es_format_Init( &p_dec->fmt_in, SPU_ES, VLC_CODEC_SSA );
+    p_dec->fmt_in.i_extra = sizeof(psz_header) - 1;
+    p_dec->fmt_in.p_extra = (void *)psz_header;
+    es_format_Init( &p_dec->fmt_out, UNKNOWN_ES, 0 );
+    p_dec->pf_spu_buffer_new = SpuNew;
+    p_dec->pf_spu_buffer_del = SpuDel;
+    p_dec->p_owner = &owner;
+
+    p_dec->p_module = module_need( p_dec, "decoder", "libass", true );
+    if( !p_dec->p_module )
+    {
+        log( "  libass decoder not available\n" );
+        p_dec->fmt_in.p_extra = NULL;
+        vlc_object_release( p_dec );
+        spu_Destroy( p_spu );
+        filter_DeleteBlend( p_blend );
+        picture_Release( p_picture );
+        vlc_object_release( p_obj );
+        return 77;
+    }
+
+    const mtime_t i_origin = mdate();
+    for( unsigned i = 0; i < TIMELINE_DURATION / KARAOKE_DURATION; i++ )
+        DecodeLines( p_dec, i, i_origin );
+
+    /* Play the timeline, then render the same date again as a paused video
+     * output does */
+    const unsigned i_play_frames = TIMELINE_DURATION * FRAME_RATE;
+    const unsigned i_pause_frames = 2 * FRAME_RATE;
+    mtime_t i_play = 0, i_pause = 0;
+    unsigned i_regions = 0, i_reused = 0;
+    picture_t *pp_last[16];
+    unsigned i_last = 0;
+    int i_ret = 0;
+
+    for( unsigned i = 0; i < i_play_frames + i_pause_frames; i++ )
+    {
+        const unsigned i_frame = __MIN( i, i_play_frames - FRAME_RATE );
+        const mtime_t i_date = i_origin + (mtime_t)i_frame * CLOCK_FREQ / FRAME_RATE;
+        const mtime_t i_begin = mdate();
+
+        subpicture_t *p_subpic = spu_Render( p_spu, NULL, &fmt, &fmt,
+                                             i_date, i_date, false );
+        picture_t *pp_current[16];
+        unsigned i_current = 0;
+        if( p_subpic )
+        {
+            for( subpicture_region_t *r = p_subpic->p_region; r; r = r->p_next )
+            {
+                for( unsigned j = 0; j < i_last; j++ )
+                    if( pp_last[j] == r->p_picture )
+                        i_reused++;
+                if( i_current < 16 )
+                    pp_current[i_current++] = picture_Hold( r->p_picture );
+                i_regions++;
+            }
+            picture_BlendSubpicture( p_picture, p_blend, p_subpic );
+            subpicture_Delete( p_subpic );
+        }
+        const mtime_t i_end = mdate();
+
+        for( unsigned j = 0; j < i_last; j++ )
+            picture_Release( pp_last[j] );
+        memcpy( pp_last, pp_current, i_current * sizeof(*pp_current) );
+        i_last = i_current;
+
+        if( i < i_play_frames )
+            i_play += i_end - i_begin;
+        else
+            i_pause += i_end - i_begin;
+    }
+    for( unsigned j = 0; j < i_last; j++ )
+        picture_Release( pp_last[j] );
+
+    if( i_regions == 0 )
+    {
+        log( "  nothing rendered, no usable font\n" );
+        i_ret = 77;
+    }
+    else
+    {
+        log( "  playing %.2f ms per frame, paused %.2f ms per frame, "
+             "%u of %u regions reused\n",
+             (double)i_play / i_play_frames / 1000.,
+             (double)i_pause / i_pause_frames / 1000.,
+             i_reused, i_regions );
+        /* Only one line is sung at a time, the others must not be redrawn */
+        assert( i_reused > 0 );
+    }
+
+    module_unneed( p_dec, p_dec->p_module );
+    es_format_Clean( &p_dec->fmt_out );
+    p_dec->fmt_in.p_extra = NULL;
+    es_format_Clean( &p_dec->fmt_in );
+    vlc_object_release( p_dec );
+
+    spu_Destroy( p_spu );
+    filter_DeleteBlend( p_blend );
+    picture_Release( p_picture );
+    vlc_object_release( p_obj );
+    return i_ret;
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 120 );
+
+    log( "Testing the libass subtitles renderer\n" );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    int i_ret = test_libass( p_vlc->p_libvlc_int );
+
+    libvlc_release( p_vlc );
+    return i_ret;
+}
@@ -0,0 +1,144 @@
+/*****************************************************************************
+ * concat.c: test of the split video demuxer against a local HTTP server
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../http_server.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+
+/* The episode is split in parts served by the local HTTP server */
+#define PARTS               3
+
+static libvlc_media_player_t *Play( libvlc_instance_t *p_vlc,
+                                    const char *psz_path )
+{
+    libvlc_media_t *p_md = libvlc_media_new_path( p_vlc, psz_path );
+    assert( p_md != NULL );
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_md );
+    assert( p_mp != NULL );
+    libvlc_media_release( p_md );
+
+    libvlc_media_player_play( p_mp );
+    libvlc_state_t state;
+    while( ( state = libvlc_media_player_get_state( p_mp ) ) != libvlc_Playing &&
+           state != libvlc_Error && state != libvlc_Ended )
+        msleep( 10000 );
+    assert( state == libvlc_Playing );
+    return p_mp;
+}
+
+static void test_continuous( libvlc_instance_t *p_vlc, const char *psz_path )
+{
+    log( "Testing the playback of %d parts as one stream\n", PARTS );
+
+    libvlc_media_player_t *p_mp = Play( p_vlc, psz_path );
+    assert( libvlc_media_player_get_length( p_mp ) == PARTS * 1000 );
+    const int i_tracks = libvlc_audio_get_track_count( p_mp );
+
+    libvlc_state_t state;
+    int i_last_tracks = i_tracks;
+    while( ( state = libvlc_media_player_get_state( p_mp ) ) == libvlc_Playing )
+    {
+        i_last_tracks = libvlc_audio_get_track_count( p_mp );
+        msleep( 50000 );
+    }
+    assert( state == libvlc_Ended );
+
+    /* The parts share the elementary stream of the first one */
+    log( "  %d audio tracks at the start, %d at the end\n", i_tracks,
+         i_last_tracks );
+    assert( i_last_tracks == i_tracks );
+
+    libvlc_media_t *p_md = libvlc_media_player_get_media( p_mp );
+    libvlc_media_stats_t stats;
+    assert( libvlc_media_get_stats( p_md, &stats ) );
+    log( "  %d buffers decoded, %d played, %d lost\n", stats.i_decoded_audio,
+         stats.i_played_abuffers, stats.i_lost_abuffers );
+    assert( stats.i_played_abuffers > 0 );
+
+    libvlc_media_release( p_md );
+    libvlc_media_player_stop( p_mp );
+    libvlc_media_player_release( p_mp );
+}
+
+static void test_seek( libvlc_instance_t *p_vlc, http_server_t *p_server,
+                       const char *psz_path )
+{
+    log( "Testing a seek to the last part\n" );
+
+    const unsigned i_requests = http_server_Requests( p_server, PARTS - 1 );
+    libvlc_media_player_t *p_mp = Play( p_vlc, psz_path );
+
+    /* The durations of the list map the date to the part */
+    libvlc_media_player_set_time( p_mp, PARTS * 1000 - 500 );
+    msleep( 200000 );
+
+    const libvlc_time_t i_time = libvlc_media_player_get_time( p_mp );
+    log( "  playing at %d ms after the seek\n", (int)i_time );
+    assert( i_time >= ( PARTS - 1 ) * 1000 );
+    assert( http_server_Requests( p_server, PARTS - 1 ) > i_requests );
+
+    libvlc_media_player_stop( p_mp );
+    libvlc_media_player_release( p_mp );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 30 );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    if( !module_exists( "concat" ) || !module_exists( "wav" ) )
+    {
+        log( "  concat or wav demux not available\n" );
+        libvlc_release( p_vlc );
+        return 77;
+    }
+
+    http_server_t server;
+    http_server_Start( &server, PARTS );
+
+    char psz_path[] = "/tmp/vlc-concat-XXXXXX";
+    int fd = mkstemp( psz_path );
+    assert( fd >= 0 );
+    FILE *p_file = fdopen( fd, "w" );
+    assert( p_file != NULL );
+    fprintf( p_file, "ffconcat version 1.0\n" );
+    for( unsigned i = 0; i < PARTS; i++ )
+    {
+        char psz_url[64];
+        http_server_GetUrl( &server, i, psz_url, sizeof(psz_url) );
+        fprintf( p_file, "file %s\nduration 1.0\n", psz_url );
+    }
+    fclose( p_file );
+
+    test_continuous( p_vlc, psz_path );
+    test_seek( p_vlc, &server, psz_path );
+
+    http_server_Stop( &server );
+
+    unlink( psz_path );
+    libvlc_release( p_vlc );
+    return 0;
+}
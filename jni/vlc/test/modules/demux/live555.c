@@ -0,0 +1,227 @@
+/*****************************************************************************
+ * live555.c: test of the low latency mode against a jittery RTP sender
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+#include <../src/control/media_player_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_input.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* 8 kHz mono L16 in packets of 20 ms */
+#define RTP_PORT            45004
+#define RTP_RATE            8000
+#define PACKET_SAMPLES      160
+#define PACKET_DURATION     INT64_C(20000)
+#define STREAM_DURATION     INT64_C(4000000)
+
+/* Network conditions of a busy wireless link */
+#define JITTER_MAX          INT64_C(30000)
+#define LOSS_PERCENT        2
+#define REORDER_PERCENT     5
+
+/* Bounds of the reordering delay of the demux: it starts at the upper one
+ * and four times the RFC 3550 jitter of the stream (about a third of
+ * JITTER_MAX) falls between them */
+#define REORDER_MIN         INT64_C(10000)
+#define REORDER_MAX         INT64_C(100000)
+
+static const char psz_sdp[] =
+    "v=0\r\n"
+    "o=- 0 0 IN IP4 127.0.0.1\r\n"
+    "s=live555 test\r\n"
+    "c=IN IP4 127.0.0.1\r\n"
+    "t=0 0\r\n"
+    "m=audio %d RTP/AVP 96\r\n"
+    "a=rtpmap:96 L16/%d/1\r\n";
+
+typedef struct
+{
+    int         fd;
+    mtime_t     i_first_date;   /* of the first packet sent */
+    unsigned    i_sent;
+    unsigned    i_dropped;
+    unsigned    i_swapped;
+} sender_t;
+
+static void SendPacket( sender_t *p_sender, unsigned i_seq )
+{
+    uint8_t p_packet[12 + 2 * PACKET_SAMPLES];
+    const uint32_t i_ts = i_seq * PACKET_SAMPLES;
+
+    p_packet[0] = 0x80;
+    p_packet[1] = 96;
+    SetWBE( &p_packet[2], i_seq );
+    SetDWBE( &p_packet[4], i_ts );
+    SetDWBE( &p_packet[8], 0x12345678 );
+
+    /* 500 Hz square wave */
+    for( unsigned i = 0; i < PACKET_SAMPLES; i++ )
+        SetWBE( &p_packet[12 + 2 * i],
+                ( ( i_ts + i ) / 8 ) % 2 ? 0x2000 : 0xe000 );
+
+    send( p_sender->fd, p_packet, sizeof(p_packet), 0 );
+    p_sender->i_sent++;
+}
+
+/* Sends the packets on time plus a random delay, drops some of them and
+ * swaps some pairs */
+static void *Sender( void *p_data )
+{
+    sender_t *p_sender = p_data;
+    const unsigned i_count = STREAM_DURATION / PACKET_DURATION;
+    const mtime_t i_start = mdate();
+
+    p_sender->i_first_date = i_start;
+    for( unsigned i_seq = 0; i_seq < i_count; i_seq++ )
+    {
+        mwait( i_start + i_seq * PACKET_DURATION + rand() % JITTER_MAX );
+
+        if( rand() % 100 < LOSS_PERCENT )
+        {
+            p_sender->i_dropped++;
+            continue;
+        }
+        if( i_seq + 1 < i_count && rand() % 100 < REORDER_PERCENT )
+        {
+            SendPacket( p_sender, i_seq + 1 );
+            SendPacket( p_sender, i_seq );
+            p_sender->i_swapped++;
+            i_seq++;
+            continue;
+        }
+        SendPacket( p_sender, i_seq );
+    }
+    return NULL;
+}
+
+static int test_low_latency( libvlc_instance_t *p_vlc, const char *psz_path )
+{
+    log( "Testing the low latency mode with %d ms of jitter and %d%% loss\n",
+         (int)(JITTER_MAX / 1000), LOSS_PERCENT );
+
+    sender_t sender = { .i_sent = 0, .i_dropped = 0, .i_swapped = 0 };
+    sender.fd = socket( AF_INET, SOCK_DGRAM, 0 );
+    assert( sender.fd >= 0 );
+
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons( RTP_PORT );
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    assert( connect( sender.fd, (struct sockaddr *)&addr, sizeof(addr) ) == 0 );
+
+    libvlc_media_t *p_md = libvlc_media_new_path( p_vlc, psz_path );
+    assert( p_md != NULL );
+    libvlc_media_add_option( p_md, ":demux=live555" );
+    libvlc_media_add_option( p_md, ":rtsp-low-latency" );
+
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_md );
+    assert( p_mp != NULL );
+    libvlc_media_player_play( p_mp );
+
+    /* Let the demux bind its socket before sending */
+    libvlc_state_t state;
+    while( ( state = libvlc_media_get_state( p_md ) ) != libvlc_Playing &&
+           state != libvlc_Error )
+        msleep( 10000 );
+    assert( state == libvlc_Playing );
+    msleep( 100000 );
+
+    vlc_thread_t thread;
+    assert( vlc_clone( &thread, Sender, &sender, VLC_THREAD_PRIORITY_LOW ) == 0 );
+
+    /* The first decoded audio tells how long the stream was buffered */
+    libvlc_media_stats_t stats;
+    mtime_t i_startup = 0;
+    do
+    {
+        msleep( 5000 );
+        assert( libvlc_media_get_stats( p_md, &stats ) );
+        if( stats.i_played_abuffers > 0 && i_startup == 0 )
+            i_startup = mdate() - sender.i_first_date;
+    }
+    while( i_startup == 0 && mdate() - sender.i_first_date < STREAM_DURATION );
+
+    vlc_join( thread, NULL );
+    msleep( 500000 );
+    assert( libvlc_media_get_stats( p_md, &stats ) );
+    assert( libvlc_media_get_state( p_md ) != libvlc_Error );
+
+    input_thread_t *p_input = libvlc_get_input_thread( p_mp );
+    assert( p_input != NULL );
+    const int64_t i_reorder = var_GetInteger( p_input, "rtsp-reorder" );
+    vlc_object_release( p_input );
+
+    log( "  %u packets sent, %u dropped, %u pairs swapped\n", sender.i_sent,
+         sender.i_dropped, sender.i_swapped );
+    log( "  %d ms to the first played buffer, %d played, %d lost\n",
+         (int)(i_startup / 1000), stats.i_played_abuffers,
+         stats.i_lost_abuffers );
+    log( "  reordering delay of %d ms\n", (int)(i_reorder / 1000) );
+
+    /* The delay follows the jitter, and the jitter is absorbed without
+     * dropping the stream */
+    assert( i_startup > 0 );
+    assert( i_reorder > REORDER_MIN && i_reorder < REORDER_MAX );
+    assert( stats.i_played_abuffers > 4 * stats.i_lost_abuffers );
+
+    libvlc_media_player_stop( p_mp );
+    libvlc_media_player_release( p_mp );
+    libvlc_media_release( p_md );
+    close( sender.fd );
+    return 0;
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 30 );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    if( !module_exists( "live555" ) )
+    {
+        log( "  live555 demux not available\n" );
+        libvlc_release( p_vlc );
+        return 77;
+    }
+
+    char psz_path[] = "/tmp/vlc-live555-XXXXXX";
+    int fd = mkstemp( psz_path );
+    assert( fd >= 0 );
+    FILE *p_file = fdopen( fd, "w" );
+    assert( p_file != NULL );
+    fprintf( p_file, psz_sdp, RTP_PORT, RTP_RATE );
+    fclose( p_file );
+
+    int i_ret = test_low_latency( p_vlc, psz_path );
+
+    unlink( psz_path );
+    libvlc_release( p_vlc );
+    return i_ret;
+}
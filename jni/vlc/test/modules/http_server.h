@@ -0,0 +1,191 @@
+/*****************************************************************************
+ * http_server.h: local HTTP server of WAV files for the tests
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef TEST_HTTP_SERVER_H
+#define TEST_HTTP_SERVER_H
+
+#include <vlc_common.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* The files are 1 second of 8 kHz mono audio, served as /<index>.wav */
+#define WAV_RATE            8000
+#define WAV_SIZE            (44 + 2 * WAV_RATE)
+#define HTTP_SERVER_FILES   8
+
+typedef struct
+{
+    int          fd;
+    int          i_port;
+    unsigned     i_files;
+    uint8_t      p_wav[WAV_SIZE];
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    unsigned     pi_requests[HTTP_SERVER_FILES];
+} http_server_t;
+
+static void BuildWav( uint8_t *p_wav )
+{
+    memcpy( &p_wav[0], "RIFF", 4 );
+    SetDWLE( &p_wav[4], WAV_SIZE - 8 );
+    memcpy( &p_wav[8], "WAVEfmt ", 8 );
+    SetDWLE( &p_wav[16], 16 );
+    SetWLE( &p_wav[20], 1 );                /* PCM */
+    SetWLE( &p_wav[22], 1 );                /* mono */
+    SetDWLE( &p_wav[24], WAV_RATE );
+    SetDWLE( &p_wav[28], 2 * WAV_RATE );
+    SetWLE( &p_wav[32], 2 );
+    SetWLE( &p_wav[34], 16 );
+    memcpy( &p_wav[36], "data", 4 );
+    SetDWLE( &p_wav[40], 2 * WAV_RATE );
+
+    /* 500 Hz square wave */
+    for( unsigned i = 0; i < WAV_RATE; i++ )
+        SetWLE( &p_wav[44 + 2 * i], ( i / 8 ) % 2 ? 0x2000 : 0xe000 );
+}
+
+/* Serves one request, with the byte ranges used to seek */
+static void HttpServe( http_server_t *p_server, int fd )
+{
+    char psz_request[1024];
+    size_t i_request = 0;
+
+    while( i_request < sizeof(psz_request) - 1 )
+    {
+        ssize_t i_ret = recv( fd, &psz_request[i_request],
+                              sizeof(psz_request) - 1 - i_request, 0 );
+        if( i_ret <= 0 )
+            return;
+        i_request += i_ret;
+        psz_request[i_request] = '\0';
+        if( strstr( psz_request, "\r\n\r\n" ) )
+            break;
+    }
+
+    unsigned i_file, i_offset = 0;
+    if( sscanf( psz_request, "GET /%u.wav ", &i_file ) != 1 ||
+        i_file >= p_server->i_files )
+    {
+        const char psz_error[] = "HTTP/1.0 404 Not Found\r\n\r\n";
+        send( fd, psz_error, strlen(psz_error), MSG_NOSIGNAL );
+        return;
+    }
+
+    vlc_mutex_lock( &p_server->lock );
+    p_server->pi_requests[i_file]++;
+    vlc_mutex_unlock( &p_server->lock );
+
+    const char *psz_range = strstr( psz_request, "Range: bytes=" );
+    if( psz_range != NULL )
+        sscanf( psz_range, "Range: bytes=%u-", &i_offset );
+    if( i_offset > WAV_SIZE )
+        i_offset = WAV_SIZE;
+
+    char psz_header[256];
+    if( psz_range != NULL )
+        snprintf( psz_header, sizeof(psz_header),
+                  "HTTP/1.0 206 Partial Content\r\n"
+                  "Content-Type: audio/x-wav\r\n"
+                  "Accept-Ranges: bytes\r\n"
+                  "Content-Range: bytes %u-%u/%u\r\n"
+                  "Content-Length: %u\r\n\r\n", i_offset, WAV_SIZE - 1,
+                  WAV_SIZE, WAV_SIZE - i_offset );
+    else
+        snprintf( psz_header, sizeof(psz_header),
+                  "HTTP/1.0 200 OK\r\n"
+                  "Content-Type: audio/x-wav\r\n"
+                  "Accept-Ranges: bytes\r\n"
+                  "Content-Length: %u\r\n\r\n", WAV_SIZE );
+
+    send( fd, psz_header, strlen(psz_header), MSG_NOSIGNAL );
+    send( fd, &p_server->p_wav[i_offset], WAV_SIZE - i_offset,
+          MSG_NOSIGNAL );
+}
+
+static void *HttpServer( void *p_data )
+{
+    http_server_t *p_server = p_data;
+    int fd;
+
+    /* The files are small enough to be sent at once */
+    while( ( fd = accept( p_server->fd, NULL, NULL ) ) >= 0 )
+    {
+        HttpServe( p_server, fd );
+        close( fd );
+    }
+    return NULL;
+}
+
+/* Serves i_files copies of the WAV file on a free port of the loopback */
+static void http_server_Start( http_server_t *p_server, unsigned i_files )
+{
+    assert( i_files <= HTTP_SERVER_FILES );
+    memset( p_server, 0, sizeof(*p_server) );
+    p_server->i_files = i_files;
+    BuildWav( p_server->p_wav );
+    vlc_mutex_init( &p_server->lock );
+
+    p_server->fd = socket( AF_INET, SOCK_STREAM, 0 );
+    assert( p_server->fd >= 0 );
+    struct sockaddr_in addr;
+    socklen_t i_addr = sizeof(addr);
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    assert( bind( p_server->fd, (struct sockaddr *)&addr,
+                  sizeof(addr) ) == 0 );
+    assert( listen( p_server->fd, 8 ) == 0 );
+    assert( getsockname( p_server->fd, (struct sockaddr *)&addr,
+                         &i_addr ) == 0 );
+    p_server->i_port = ntohs( addr.sin_port );
+
+    assert( vlc_clone( &p_server->thread, HttpServer, p_server,
+                       VLC_THREAD_PRIORITY_LOW ) == 0 );
+}
+
+static void http_server_Stop( http_server_t *p_server )
+{
+    /* Wakes the server up */
+    shutdown( p_server->fd, SHUT_RDWR );
+    vlc_join( p_server->thread, NULL );
+    close( p_server->fd );
+    vlc_mutex_destroy( &p_server->lock );
+}
+
+static void http_server_GetUrl( const http_server_t *p_server,
+                                unsigned i_file, char *psz_url,
+                                size_t i_url )
+{
+    snprintf( psz_url, i_url, "http://127.0.0.1:%d/%u.wav",
+              p_server->i_port, i_file );
+}
+
+static unsigned http_server_Requests( http_server_t *p_server,
+                                      unsigned i_file )
+{
+    vlc_mutex_lock( &p_server->lock );
+    const unsigned i_requests = p_server->pi_requests[i_file];
+    vlc_mutex_unlock( &p_server->lock );
+    return i_requests;
+}
+
+#endif
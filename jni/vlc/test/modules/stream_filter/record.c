@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * record.c: test of the stream recorder
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+#include <../src/input/stream.h>
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_stream.h>
+
+#include <sys/stat.h>
+
+/* Several chunks of the recorder, but less than its buffer */
+#define SOURCE_SIZE         (4 << 20)
+
+static uint8_t Byte( uint64_t i_pos )
+{
+    return ( i_pos * 31 ) ^ ( i_pos >> 12 );
+}
+
+static void test_record( vlc_object_t *p_obj, const char *psz_dir )
+{
+    log( "Testing the recording of the read and skipped data\n" );
+
+    char *psz_source;
+    assert( asprintf( &psz_source, "%s/source.dat", psz_dir ) >= 0 );
+    FILE *p_file = fopen( psz_source, "wb" );
+    assert( p_file != NULL );
+    for( uint64_t i = 0; i < SOURCE_SIZE; i++ )
+        fputc( Byte( i ), p_file );
+    fclose( p_file );
+
+    char *psz_url;
+    assert( asprintf( &psz_url, "file://%s", psz_source ) >= 0 );
+    stream_t *p_source = stream_UrlNew( p_obj, psz_url );
+    assert( p_source != NULL );
+    stream_t *s = stream_FilterNew( p_source, "stream_filter_record" );
+    assert( s != NULL );
+    assert( stream_Control( s, STREAM_SET_RECORD_STATE, true, "ts" ) == 0 );
+
+    /* Reads of all sizes, some of them skipped */
+    uint8_t *p_buf = malloc( 300000 );
+    assert( p_buf != NULL );
+    uint64_t i_pos = 0;
+    for( unsigned i = 0; i_pos < SOURCE_SIZE; i++ )
+    {
+        const unsigned i_len = 1 + ( i * 7919 ) % 300000;
+        const bool b_skip = i % 3 == 2;
+        const int i_read = stream_Read( s, b_skip ? NULL : p_buf, i_len );
+
+        assert( i_read > 0 );
+        if( !b_skip )
+            for( int j = 0; j < i_read; j++ )
+                assert( p_buf[j] == Byte( i_pos + j ) );
+        i_pos += i_read;
+    }
+    assert( i_pos == SOURCE_SIZE );
+    free( p_buf );
+
+    /* Waits for the writer */
+    assert( stream_Control( s, STREAM_SET_RECORD_STATE, false ) == 0 );
+    char *psz_record = var_GetNonEmptyString( p_obj, "record-file" );
+    assert( psz_record != NULL );
+    log( "  recorded into %s\n", psz_record );
+
+    /* The preallocated tail is gone */
+    struct stat st;
+    assert( stat( psz_record, &st ) == 0 );
+    assert( st.st_size == SOURCE_SIZE );
+
+    p_file = fopen( psz_record, "rb" );
+    assert( p_file != NULL );
+    for( uint64_t i = 0; i < SOURCE_SIZE; i++ )
+        assert( fgetc( p_file ) == Byte( i ) );
+    fclose( p_file );
+
+    stream_Delete( s );
+    unlink( psz_record );
+    unlink( psz_source );
+    free( psz_record );
+    free( psz_url );
+    free( psz_source );
+}
+
+int main( void )
+{
+    test_init();
+
+    char psz_dir[] = "/tmp/vlc-record-XXXXXX";
+    assert( mkdtemp( psz_dir ) != NULL );
+
+    char *psz_dir_arg;
+    assert( asprintf( &psz_dir_arg, "--input-record-path=%s", psz_dir ) >= 0 );
+    const char *ppsz_args[test_defaults_nargs + 1];
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        ppsz_args[i] = test_defaults_args[i];
+    ppsz_args[test_defaults_nargs] = psz_dir_arg;
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs + 1,
+                                           ppsz_args );
+    assert( p_vlc != NULL );
+
+    int i_ret = 0;
+    if( module_exists( "stream_filter_record" ) )
+        test_record( VLC_OBJECT(p_vlc->p_libvlc_int), psz_dir );
+    else
+    {
+        log( "  record stream filter not available\n" );
+        i_ret = 77;
+    }
+
+    libvlc_release( p_vlc );
+    free( psz_dir_arg );
+    rmdir( psz_dir );
+    return i_ret;
+}
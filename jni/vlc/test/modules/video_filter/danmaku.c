@@ -0,0 +1,191 @@
+/*****************************************************************************
+ * danmaku.c: benchmark for the scrolling comments overlay
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The filter helpers log with the module name */
+#define MODULE_STRING "test"
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_spu.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_subpicture.h>
+
+#include <limits.h>
+
+/* 125 new comments per second, each on screen for 4 seconds, gives 500
+ * comments on screen once the timeline is started */
+#define COMMENT_RATE        125
+#define COMMENT_DURATION    4 /* in seconds */
+#define TIMELINE_DURATION   10 /* in seconds */
+#define COMMENT_COUNT       (COMMENT_RATE * TIMELINE_DURATION)
+
+#define FRAME_RATE          60
+#define FRAME_WIDTH         1280
+#define FRAME_HEIGHT        720
+
+/*****************************************************************************
+ * Writes a bilibili comment file, with a few acfun style comments
+ *****************************************************************************/
+static void write_comments( FILE *p_file )
+{
+    static const char *const ppsz_words[] = {
+        "233333", "front row", "hello &amp; welcome", "lol", "nice",
+        "&lt;3", "this part again", "so fast", "wow", "again",
+    };
+    static const int pi_mode[] = { 1, 1, 1, 1, 1, 1, 1, 1, 4, 5, 6, 1 };
+
+    fprintf( p_file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><i>\n" );
+    for( unsigned i = 0; i < COMMENT_COUNT; i++ )
+    {
+        const double f_time = (double)i / COMMENT_RATE;
+        const int i_mode = pi_mode[i % (sizeof(pi_mode)/sizeof(*pi_mode))];
+        const unsigned i_color = (i * 2654435761u) & 0xffffff;
+        const char *psz_word = ppsz_words[i % (sizeof(ppsz_words)/sizeof(*ppsz_words))];
+
+        if( i % 16 == 15 )
+            fprintf( p_file, "<l i=\"%.3f,%u,%d,25,user,0\"><![CDATA[%u %s]]></l>\n",
+                     f_time, i_color, i_mode, i, "cdata <&>" );
+        else
+            fprintf( p_file, "<d p=\"%.3f,%d,%d,%u,0,0,user,%u\">%u %s</d>\n",
+                     f_time, i_mode, i % 7 ? 25 : 36, i_color, i, i, psz_word );
+    }
+    fprintf( p_file, "</i>\n" );
+}
+
+/*****************************************************************************
+ * Renders the timeline into a memory picture, like a video output would
+ *****************************************************************************/
+static int test_danmaku( libvlc_int_t *p_libvlc )
+{
+    vlc_object_t *p_obj = vlc_object_create( p_libvlc, sizeof(*p_obj) );
+    assert( p_obj != NULL );
+
+    video_format_t fmt;
+    video_format_Setup( &fmt, VLC_CODEC_RGB32, FRAME_WIDTH, FRAME_HEIGHT, 1, 1 );
+    video_format_FixRgb( &fmt );
+
+    picture_t *p_picture = picture_NewFromFormat( &fmt );
+    assert( p_picture != NULL );
+    filter_t *p_blend = filter_NewBlend( p_obj, &fmt );
+    assert( p_blend != NULL );
+
+    spu_t *p_spu = spu_Create( p_obj );
+    assert( p_spu != NULL );
+    spu_ChangeSources( p_spu, "danmaku" );
+
+    const mtime_t i_frame = CLOCK_FREQ / FRAME_RATE;
+    const mtime_t i_start = mdate();
+    mtime_t i_steady = 0;
+    unsigned i_steady_frames = 0;
+    unsigned i_regions_min = UINT_MAX, i_regions_max = 0;
+    int i_ret = 0;
+
+    for( unsigned i = 0; i < TIMELINE_DURATION * FRAME_RATE; i++ )
+    {
+        const mtime_t i_date = i_start + i * i_frame;
+        const mtime_t i_begin = mdate();
+
+        subpicture_t *p_subpic = spu_Render( p_spu, NULL, &fmt, &fmt,
+                                             i_date, i_date, false );
+        unsigned i_regions = 0;
+        if( p_subpic )
+        {
+            for( subpicture_region_t *r = p_subpic->p_region; r; r = r->p_next )
+                i_regions++;
+            picture_BlendSubpicture( p_picture, p_blend, p_subpic );
+            subpicture_Delete( p_subpic );
+        }
+        const mtime_t i_end = mdate();
+
+        if( i == FRAME_RATE && i_regions_max == 0 && i_regions == 0 )
+        {
+            log( "  no comment rendered, danmaku or text renderer missing\n" );
+            i_ret = 77;
+            break;
+        }
+        if( i_regions > i_regions_max )
+            i_regions_max = i_regions;
+
+        /* The screen is full once the first comments have left it */
+        if( i >= (COMMENT_DURATION + 1) * FRAME_RATE )
+        {
+            i_steady += i_end - i_begin;
+            i_steady_frames++;
+            if( i_regions < i_regions_min )
+                i_regions_min = i_regions;
+        }
+    }
+
+    if( i_ret == 0 )
+    {
+        log( "  %u to %u comments on screen, %.2f ms per frame "
+             "(%.1f fps, target %d fps)\n", i_regions_min, i_regions_max,
+             (double)i_steady / i_steady_frames / 1000.,
+             (double)i_steady_frames * CLOCK_FREQ / i_steady, FRAME_RATE );
+        assert( i_regions_min >= COMMENT_RATE * COMMENT_DURATION * 4 / 5 );
+    }
+
+    spu_Destroy( p_spu );
+    filter_DeleteBlend( p_blend );
+    picture_Release( p_picture );
+    vlc_object_release( p_obj );
+    return i_ret;
+}
+
+int main( void )
+{
+    char psz_file[] = "/tmp/danmakuXXXXXX";
+    char *psz_option;
+    int i_ret;
+
+    test_init();
+    alarm( 120 );
+
+    log( "Testing the danmaku overlay\n" );
+
+    int fd = mkstemp( psz_file );
+    assert( fd >= 0 );
+    FILE *p_file = fdopen( fd, "w" );
+    assert( p_file != NULL );
+    write_comments( p_file );
+    fclose( p_file );
+
+    i_ret = asprintf( &psz_option, "--danmaku-file=%s", psz_file );
+    assert( i_ret >= 0 );
+
+    const char *ppsz_args[test_defaults_nargs + 1];
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        ppsz_args[i] = test_defaults_args[i];
+    ppsz_args[test_defaults_nargs] = psz_option;
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs + 1, ppsz_args );
+    assert( p_vlc != NULL );
+
+    i_ret = test_danmaku( p_vlc->p_libvlc_int );
+
+    libvlc_release( p_vlc );
+    free( psz_option );
+    unlink( psz_file );
+
+    return i_ret;
+}
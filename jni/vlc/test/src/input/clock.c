@@ -0,0 +1,251 @@
+/*****************************************************************************
+ * clock.c: replay of PCR traces through the input clock
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Before the log() macro of the tests */
+#include <math.h>
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+#include <../src/input/clock.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+
+/* A recorded trace to replay, one "<stream date> <system date>" line in
+ * microseconds per PCR */
+#define CLOCK_TRACE_ENV     "VLC_TEST_CLOCK_TRACE"
+#define MAX_POINTS          100000
+
+/* Synthetic traces: 2 minutes of PCR every 40 ms */
+#define TRACE_DURATION      INT64_C(120000000)
+#define TRACE_PERIOD        INT64_C(40000)
+
+/* The clock settles first */
+#define WARMUP_DURATION     INT64_C(10000000)
+
+#define PTS_DELAY           INT64_C(300000)
+
+typedef struct
+{
+    mtime_t i_stream;
+    mtime_t i_system;
+} trace_point_t;
+
+typedef struct
+{
+    double   f_jitter;  /* of the converted dates, in microseconds */
+    unsigned i_resyncs; /* times the audio output would resynchronize */
+    unsigned i_late;    /* times the PCR was late for the buffering */
+    double   f_ppm;
+    double   f_confidence;
+} score_t;
+
+/* Deterministic random numbers, in [0, 1) */
+static double Random( uint32_t *pi_seed )
+{
+    *pi_seed = *pi_seed * 1103515245 + 12345;
+    return ( *pi_seed >> 8 ) / (double)( 1 << 24 );
+}
+
+/* A server clock fast by 80 ppm, behind up to 40 ms of network jitter */
+static unsigned TraceDrift( trace_point_t *p_trace )
+{
+    uint32_t i_seed = 1;
+    unsigned i_count = 0;
+
+    for( mtime_t i_stream = 0; i_stream < TRACE_DURATION; i_stream += TRACE_PERIOD )
+    {
+        p_trace[i_count].i_stream = VLC_TS_0 + i_stream;
+        p_trace[i_count].i_system = VLC_TS_0 + 1000000 + i_stream / 1.00008 +
+                                    40000 * Random( &i_seed );
+        i_count++;
+    }
+    return i_count;
+}
+
+/* A wireless link stalling for 300 ms every 15 seconds, the late packets
+ * then coming in a burst */
+static unsigned TraceBursts( trace_point_t *p_trace )
+{
+    uint32_t i_seed = 1;
+    unsigned i_count = 0;
+
+    for( mtime_t i_stream = 0; i_stream < TRACE_DURATION; i_stream += TRACE_PERIOD )
+    {
+        const mtime_t i_phase = i_stream % 15000000 - 5000000;
+        mtime_t i_delay = 10000 * Random( &i_seed );
+        if( i_phase >= 0 && i_phase < 1000000 )
+            i_delay += 300000 * ( 1000000 - i_phase ) / 1000000;
+
+        p_trace[i_count].i_stream = VLC_TS_0 + i_stream;
+        p_trace[i_count].i_system = VLC_TS_0 + 1000000 + i_stream + i_delay;
+        i_count++;
+    }
+    return i_count;
+}
+
+static unsigned TraceLoad( const char *psz_path, trace_point_t *p_trace )
+{
+    FILE *p_file = fopen( psz_path, "r" );
+    if( !p_file )
+        return 0;
+
+    unsigned i_count = 0;
+    long long i_stream, i_system;
+    while( i_count < MAX_POINTS &&
+           fscanf( p_file, "%lld %lld", &i_stream, &i_system ) == 2 )
+    {
+        p_trace[i_count].i_stream = VLC_TS_0 + i_stream;
+        p_trace[i_count].i_system = VLC_TS_0 + i_system;
+        i_count++;
+    }
+    fclose( p_file );
+    return i_count;
+}
+
+/* Scores the dates converted from the PCR against the best line through
+ * them: a perfect clock recovery removes all the network jitter */
+static score_t Replay( vlc_object_t *p_log, const trace_point_t *p_trace,
+                       unsigned i_count, bool b_regression )
+{
+    input_clock_t *p_clock = input_clock_New( INPUT_RATE_DEFAULT, b_regression );
+    assert( p_clock != NULL );
+    input_clock_SetJitter( p_clock, PTS_DELAY, 40 );
+
+    score_t score = { .i_resyncs = 0, .i_late = 0, .f_ppm = 0., .f_confidence = 0. };
+    double *pf_error = malloc( i_count * sizeof(*pf_error) );
+    assert( pf_error != NULL );
+
+    unsigned i_scored = 0;
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        bool b_late;
+        input_clock_Update( p_clock, p_log, &b_late, false, false,
+                            p_trace[i].i_stream, p_trace[i].i_system );
+        if( b_late )
+            score.i_late++;
+
+        mtime_t i_ts = p_trace[i].i_stream;
+        assert( input_clock_ConvertTS( p_clock, NULL, &i_ts, NULL,
+                                       INT64_MAX ) == VLC_SUCCESS );
+
+        if( p_trace[i].i_stream - p_trace[0].i_stream >= WARMUP_DURATION )
+            pf_error[i_scored++] = i_ts - p_trace[i].i_stream;
+    }
+    assert( i_scored > 2 );
+
+    /* Least squares over the whole trace */
+    double f_mean_x = ( i_scored - 1 ) / 2., f_mean_y = 0.;
+    for( unsigned i = 0; i < i_scored; i++ )
+        f_mean_y += pf_error[i] / i_scored;
+    double f_sxx = 0., f_sxy = 0.;
+    for( unsigned i = 0; i < i_scored; i++ )
+    {
+        f_sxx += ( i - f_mean_x ) * ( i - f_mean_x );
+        f_sxy += ( i - f_mean_x ) * ( pf_error[i] - f_mean_y );
+    }
+    const double f_slope = f_sxy / f_sxx;
+
+    double f_ssr = 0.;
+    bool b_resync = false;
+    for( unsigned i = 0; i < i_scored; i++ )
+    {
+        const double f_r = pf_error[i] - f_mean_y - f_slope * ( i - f_mean_x );
+        f_ssr += f_r * f_r;
+
+        /* The audio output resynchronizes beyond that */
+        const bool b_out = fabs( f_r ) > AOUT_MAX_PTS_ADVANCE;
+        if( b_out && !b_resync )
+            score.i_resyncs++;
+        b_resync = b_out;
+    }
+    score.f_jitter = sqrt( f_ssr / i_scored );
+
+    mtime_t i_jitter;
+    if( input_clock_GetDrift( p_clock, &score.f_ppm, &score.f_confidence,
+                              &i_jitter ) )
+        assert( !b_regression );
+
+    free( pf_error );
+    input_clock_Delete( p_clock );
+    return score;
+}
+
+static void Compare( vlc_object_t *p_log, const char *psz_name,
+                     const trace_point_t *p_trace, unsigned i_count,
+                     score_t *p_average, score_t *p_regression )
+{
+    *p_average = Replay( p_log, p_trace, i_count, false );
+    *p_regression = Replay( p_log, p_trace, i_count, true );
+
+    log( "  %s: average %.2f ms of jitter, %u resyncs, %u late\n", psz_name,
+         p_average->f_jitter / 1000., p_average->i_resyncs, p_average->i_late );
+    log( "  %s: regression %.2f ms of jitter, %u resyncs, %u late, "
+         "drift %.1f ppm (confidence %.2f)\n", psz_name,
+         p_regression->f_jitter / 1000., p_regression->i_resyncs,
+         p_regression->i_late, p_regression->f_ppm,
+         p_regression->f_confidence );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 60 );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+    vlc_object_t *p_log = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    trace_point_t *p_trace = malloc( MAX_POINTS * sizeof(*p_trace) );
+    assert( p_trace != NULL );
+    score_t average, regression;
+
+    log( "Replaying a drifting server clock\n" );
+    Compare( p_log, "drift", p_trace, TraceDrift( p_trace ),
+             &average, &regression );
+    assert( regression.f_jitter < average.f_jitter );
+    assert( fabs( regression.f_ppm - 80. ) < 15. );
+    assert( regression.f_confidence > 0. );
+
+    log( "Replaying bursts of network jitter\n" );
+    Compare( p_log, "bursts", p_trace, TraceBursts( p_trace ),
+             &average, &regression );
+    assert( regression.f_jitter < average.f_jitter );
+    assert( regression.i_resyncs <= average.i_resyncs );
+    assert( fabs( regression.f_ppm ) < 10. );
+
+    const char *psz_path = getenv( CLOCK_TRACE_ENV );
+    if( psz_path )
+    {
+        const unsigned i_count = TraceLoad( psz_path, p_trace );
+
+        log( "Replaying %u points of %s\n", i_count, psz_path );
+        if( i_count > 0 )
+            Compare( p_log, "trace", p_trace, i_count, &average, &regression );
+    }
+    else
+        log( "Skipping the recorded trace, "
+             "set "CLOCK_TRACE_ENV" to a file of PCR points\n" );
+
+    free( p_trace );
+    libvlc_release( p_vlc );
+    return 0;
+}
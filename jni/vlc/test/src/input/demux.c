@@ -0,0 +1,320 @@
+/*****************************************************************************
+ * demux.c: test and benchmark of the demuxer probing
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+#include <../src/control/media_internal.h>
+#include <../src/control/media_player_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_input_item.h>
+#include <vlc_demux.h>
+#include <vlc_modules.h>
+
+#include <dirent.h>
+
+/* The folder of media files to use for the benchmark, one per format */
+#define DEMUX_DIR_ENV       "VLC_TEST_DEMUX_DIR"
+#define MAX_FILES           100
+
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    mtime_t     i_date;     /* of the first state after opening */
+    bool        b_playing;
+} open_t;
+
+static void StateChanged( const libvlc_event_t *p_event, void *p_data )
+{
+    open_t *p_open = p_data;
+
+    vlc_mutex_lock( &p_open->lock );
+    if( p_open->i_date == 0 )
+    {
+        /* The input plays once the demuxer is ready to send packets */
+        p_open->i_date = mdate();
+        p_open->b_playing = p_event->type == libvlc_MediaPlayerPlaying;
+    }
+    vlc_cond_signal( &p_open->wait );
+    vlc_mutex_unlock( &p_open->lock );
+}
+
+/* Opens the file and returns how long it took until playing, or -1 */
+static mtime_t Open( libvlc_instance_t *p_vlc, const char *psz_path,
+                     mtime_t *pi_probe )
+{
+    open_t open = { .i_date = 0, .b_playing = false };
+    vlc_mutex_init( &open.lock );
+    vlc_cond_init( &open.wait );
+
+    libvlc_media_t *p_md = libvlc_media_new_path( p_vlc, psz_path );
+    assert( p_md != NULL );
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_md );
+    assert( p_mp != NULL );
+
+    libvlc_event_manager_t *p_em = libvlc_media_player_event_manager( p_mp );
+    libvlc_event_attach( p_em, libvlc_MediaPlayerPlaying, StateChanged, &open );
+    libvlc_event_attach( p_em, libvlc_MediaPlayerEndReached, StateChanged, &open );
+    libvlc_event_attach( p_em, libvlc_MediaPlayerEncounteredError,
+                         StateChanged, &open );
+
+    const mtime_t i_begin = mdate();
+    libvlc_media_player_play( p_mp );
+
+    vlc_mutex_lock( &open.lock );
+    while( open.i_date == 0 )
+        vlc_cond_wait( &open.wait, &open.lock );
+    vlc_mutex_unlock( &open.lock );
+
+    libvlc_media_player_stop( p_mp );
+    libvlc_event_detach( p_em, libvlc_MediaPlayerPlaying, StateChanged, &open );
+    libvlc_event_detach( p_em, libvlc_MediaPlayerEndReached, StateChanged, &open );
+    libvlc_event_detach( p_em, libvlc_MediaPlayerEncounteredError,
+                         StateChanged, &open );
+
+    /* The statistics are updated when the input ends */
+    input_stats_t *p_stats = p_md->p_input_item->p_stats;
+    if( p_stats != NULL )
+    {
+        vlc_mutex_lock( &p_stats->lock );
+        *pi_probe = p_stats->i_demux_probe_time;
+        vlc_mutex_unlock( &p_stats->lock );
+    }
+    else
+        *pi_probe = 0;
+
+    libvlc_media_player_release( p_mp );
+    libvlc_media_release( p_md );
+    vlc_cond_destroy( &open.wait );
+    vlc_mutex_destroy( &open.lock );
+
+    return open.b_playing ? open.i_date - i_begin : -1;
+}
+
+static void Bench( libvlc_instance_t *p_vlc, const char *const *ppsz_paths,
+                   unsigned i_count )
+{
+    mtime_t i_total = 0, i_total_probe = 0;
+    unsigned i_opened = 0;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        mtime_t i_probe;
+        const mtime_t i_open = Open( p_vlc, ppsz_paths[i], &i_probe );
+        const char *psz_name = strrchr( ppsz_paths[i], '/' );
+
+        if( i_open < 0 )
+        {
+            log( "  %s: not played\n", psz_name ? psz_name + 1 : ppsz_paths[i] );
+            continue;
+        }
+        log( "  %s: playing after %d ms, demux found in %d ms\n",
+             psz_name ? psz_name + 1 : ppsz_paths[i], (int)(i_open / 1000),
+             (int)(i_probe / 1000) );
+        assert( i_probe >= 0 && i_probe <= i_open );
+
+        i_total += i_open;
+        i_total_probe += i_probe;
+        i_opened++;
+    }
+    if( i_opened > 0 )
+        log( "  %u files, %.1f ms to play and %.1f ms to find the demux "
+             "on average\n", i_opened, i_total / 1000. / i_opened,
+             i_total_probe / 1000. / i_opened );
+}
+
+/* Writes a copy of the JPEG sample */
+static void WriteJpeg( FILE *p_file )
+{
+    FILE *p_sample = fopen( SRCDIR"/samples/image.jpg", "rb" );
+    assert( p_sample != NULL );
+
+    char p_buffer[4096];
+    size_t i_read;
+    while( ( i_read = fread( p_buffer, 1, sizeof(p_buffer), p_sample ) ) > 0 )
+        fwrite( p_buffer, 1, i_read, p_file );
+    fclose( p_sample );
+}
+
+/* Writes MPEG-TS null packets */
+static void WriteTs( FILE *p_file )
+{
+    for( unsigned i = 0; i < 8; i++ )
+    {
+        static const uint8_t p_header[] = { 0x47, 0x1F, 0xFF, 0x10 };
+
+        fwrite( p_header, 1, sizeof(p_header), p_file );
+        for( unsigned j = sizeof(p_header); j < 188; j++ )
+            fputc( 0xFF, p_file );
+    }
+}
+
+/* Gets the name of the demuxer module of the input */
+static char *GetDemux( input_thread_t *p_input )
+{
+    char *psz_demux = NULL;
+    vlc_list_t *p_list = vlc_list_children( p_input );
+
+    for( int i = 0; i < p_list->i_count && psz_demux == NULL; i++ )
+    {
+        vlc_object_t *p_obj = p_list->p_values[i].p_object;
+
+        if( !strcmp( p_obj->psz_object_type, "demux" ) )
+            psz_demux = strdup( module_get_object(
+                                    ((demux_t *)p_obj)->p_module ) );
+    }
+    vlc_list_release( p_list );
+    return psz_demux;
+}
+
+static void Sniff( libvlc_instance_t *p_vlc, const char *psz_dir,
+                   const char *psz_name, void (*pf_write)( FILE * ),
+                   const char *psz_expected )
+{
+    char *psz_path;
+    assert( asprintf( &psz_path, "%s/%s", psz_dir, psz_name ) >= 0 );
+    FILE *p_file = fopen( psz_path, "wb" );
+    assert( p_file != NULL );
+    pf_write( p_file );
+    fclose( p_file );
+
+    libvlc_media_t *p_md = libvlc_media_new_path( p_vlc, psz_path );
+    assert( p_md != NULL );
+    /* The demuxer stays open at the end of the file */
+    libvlc_media_add_option( p_md, ":play-and-pause" );
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_md );
+    assert( p_mp != NULL );
+
+    open_t open = { .i_date = 0, .b_playing = false };
+    vlc_mutex_init( &open.lock );
+    vlc_cond_init( &open.wait );
+    libvlc_event_manager_t *p_em = libvlc_media_player_event_manager( p_mp );
+    libvlc_event_attach( p_em, libvlc_MediaPlayerPlaying, StateChanged, &open );
+    libvlc_event_attach( p_em, libvlc_MediaPlayerEncounteredError,
+                         StateChanged, &open );
+    libvlc_media_player_play( p_mp );
+
+    vlc_mutex_lock( &open.lock );
+    while( open.i_date == 0 )
+        vlc_cond_wait( &open.wait, &open.lock );
+    vlc_mutex_unlock( &open.lock );
+    assert( open.b_playing );
+
+    input_thread_t *p_input = libvlc_get_input_thread( p_mp );
+    assert( p_input != NULL );
+    char *psz_demux = GetDemux( p_input );
+    vlc_object_release( p_input );
+
+    assert( psz_demux != NULL );
+    log( "  %s: opened by %s\n", psz_name, psz_demux );
+    assert( !strcmp( psz_demux, psz_expected ) );
+    free( psz_demux );
+
+    libvlc_media_player_stop( p_mp );
+    libvlc_event_detach( p_em, libvlc_MediaPlayerPlaying, StateChanged, &open );
+    libvlc_event_detach( p_em, libvlc_MediaPlayerEncounteredError,
+                         StateChanged, &open );
+    libvlc_media_player_release( p_mp );
+    libvlc_media_release( p_md );
+    vlc_cond_destroy( &open.wait );
+    vlc_mutex_destroy( &open.lock );
+    unlink( psz_path );
+    free( psz_path );
+}
+
+static void test_sniff( libvlc_instance_t *p_vlc )
+{
+    log( "Testing the sniffing of the containers\n" );
+
+    char psz_dir[] = "/tmp/vlc-demux-XXXXXX";
+    assert( mkdtemp( psz_dir ) != NULL );
+
+    /* Without extension, the content alone names the demuxer */
+    Sniff( p_vlc, psz_dir, "picture", WriteJpeg, "image" );
+    Sniff( p_vlc, psz_dir, "transport", WriteTs, "ts" );
+
+    /* The content goes before a misleading extension, which stays a hint */
+    Sniff( p_vlc, psz_dir, "picture.avi", WriteJpeg, "image" );
+    Sniff( p_vlc, psz_dir, "transport.ogg", WriteTs, "ts" );
+
+    rmdir( psz_dir );
+}
+
+static unsigned ListFiles( const char *psz_dir, char **ppsz_paths )
+{
+    DIR *p_dir = opendir( psz_dir );
+    if( !p_dir )
+        return 0;
+
+    unsigned i_count = 0;
+    struct dirent *p_entry;
+    while( i_count < MAX_FILES && (p_entry = readdir( p_dir )) != NULL )
+    {
+        if( p_entry->d_name[0] == '.' )
+            continue;
+
+        if( asprintf( &ppsz_paths[i_count], "%s/%s", psz_dir,
+                      p_entry->d_name ) < 0 )
+            break;
+        i_count++;
+    }
+    closedir( p_dir );
+    return i_count;
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 30 );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    log( "Testing the demuxer probing on the samples\n" );
+    const char *const ppsz_samples[] = {
+        SRCDIR"/samples/empty.voc",
+        SRCDIR"/samples/image.jpg",
+    };
+    Bench( p_vlc, ppsz_samples, sizeof(ppsz_samples) / sizeof(*ppsz_samples) );
+
+    test_sniff( p_vlc );
+
+    const char *psz_dir = getenv( DEMUX_DIR_ENV );
+    if( psz_dir )
+    {
+        char *ppsz_paths[MAX_FILES];
+        const unsigned i_count = ListFiles( psz_dir, ppsz_paths );
+
+        alarm( 10 + 5 * i_count );
+        log( "Benchmarking the demuxer probing on %s\n", psz_dir );
+        Bench( p_vlc, (const char *const *)ppsz_paths, i_count );
+
+        for( unsigned i = 0; i < i_count; i++ )
+            free( ppsz_paths[i] );
+    }
+    else
+        log( "Skipping the demuxer probing benchmark, "
+             "set "DEMUX_DIR_ENV" to a folder of media files\n" );
+
+    libvlc_release( p_vlc );
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * thumbnailer.c: benchmark of the keyframe thumbnailer
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_url.h>
+#include <vlc_thumbnailer.h>
+
+#include <dirent.h>
+
+/* The folder of media files to use, since there is none in the samples */
+#define THUMBNAIL_DIR_ENV   "VLC_TEST_THUMBNAIL_DIR"
+#define MAX_FILES           100
+
+static const unsigned pi_workers[] = { 1, 2, 4 };
+
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_done;
+    unsigned    i_failed;
+} bench_t;
+
+static void Done( void *p_data, const char *psz_mrl, picture_t *p_pic )
+{
+    bench_t *p_bench = p_data;
+
+    if( p_pic )
+    {
+        /* Fits in the box, with square pixels */
+        assert( p_pic->format.i_chroma == VLC_CODEC_RGB16 );
+        assert( p_pic->format.i_visible_width <= 160 );
+        assert( p_pic->format.i_visible_height <= 120 );
+        assert( p_pic->format.i_visible_width == 160 ||
+                p_pic->format.i_visible_height == 120 );
+        picture_Release( p_pic );
+    }
+    else
+        log( "  no thumbnail for %s\n", psz_mrl );
+
+    vlc_mutex_lock( &p_bench->lock );
+    p_bench->i_done++;
+    if( !p_pic )
+        p_bench->i_failed++;
+    vlc_cond_signal( &p_bench->wait );
+    vlc_mutex_unlock( &p_bench->lock );
+}
+
+static unsigned ListFiles( const char *psz_dir, char **ppsz_mrls )
+{
+    DIR *p_dir = opendir( psz_dir );
+    if( !p_dir )
+        return 0;
+
+    unsigned i_count = 0;
+    struct dirent *p_entry;
+    while( i_count < MAX_FILES && (p_entry = readdir( p_dir )) != NULL )
+    {
+        if( p_entry->d_name[0] == '.' )
+            continue;
+
+        char *psz_path;
+        if( asprintf( &psz_path, "%s/%s", psz_dir, p_entry->d_name ) < 0 )
+            break;
+        ppsz_mrls[i_count] = make_URI( psz_path, NULL );
+        free( psz_path );
+        if( ppsz_mrls[i_count] )
+            i_count++;
+    }
+    closedir( p_dir );
+    return i_count;
+}
+
+static void test_thumbnailer( libvlc_int_t *p_libvlc, char **ppsz_mrls,
+                              unsigned i_count, unsigned i_workers )
+{
+    bench_t bench = { .i_done = 0, .i_failed = 0 };
+    vlc_mutex_init( &bench.lock );
+    vlc_cond_init( &bench.wait );
+
+    video_format_t fmt;
+    memset( &fmt, 0, sizeof( fmt ) );
+    fmt.i_chroma = VLC_CODEC_RGB16;
+    fmt.i_width = fmt.i_visible_width = 160;
+    fmt.i_height = fmt.i_visible_height = 120;
+
+    vlc_thumbnailer_t *p_thumb = vlc_thumbnailer_Create( p_libvlc, i_workers );
+    assert( p_thumb != NULL );
+
+    const mtime_t i_begin = mdate();
+    for( unsigned i = 0; i < i_count; i++ )
+        assert( !vlc_thumbnailer_Request( p_thumb, ppsz_mrls[i], -1, &fmt,
+                                          Done, &bench ) );
+
+    vlc_mutex_lock( &bench.lock );
+    while( bench.i_done < i_count )
+        vlc_cond_wait( &bench.wait, &bench.lock );
+    vlc_mutex_unlock( &bench.lock );
+    const mtime_t i_duration = mdate() - i_begin;
+
+    vlc_thumbnailer_Delete( p_thumb );
+
+    log( "  %u workers: %u files, %u failed, %.1f ms per thumbnail\n",
+         i_workers, i_count, bench.i_failed,
+         (double)i_duration / i_count / 1000. );
+
+    vlc_cond_destroy( &bench.wait );
+    vlc_mutex_destroy( &bench.lock );
+}
+
+int main( void )
+{
+    test_init();
+
+    const char *psz_dir = getenv( THUMBNAIL_DIR_ENV );
+    if( !psz_dir )
+    {
+        log( "Skipping the thumbnailer benchmark, "
+             "set "THUMBNAIL_DIR_ENV" to a folder of media files\n" );
+        return 77;
+    }
+
+    char *ppsz_mrls[MAX_FILES];
+    const unsigned i_count = ListFiles( psz_dir, ppsz_mrls );
+    if( i_count == 0 )
+        return 77;
+
+    /* Every pass decodes all the files */
+    alarm( 60 * sizeof(pi_workers) / sizeof(*pi_workers) + i_count * 10 );
+
+    log( "Benchmarking the thumbnailer on %s\n", psz_dir );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    for( unsigned i = 0; i < sizeof(pi_workers) / sizeof(*pi_workers); i++ )
+        test_thumbnailer( p_vlc->p_libvlc_int, ppsz_mrls, i_count,
+                          pi_workers[i] );
+
+    libvlc_release( p_vlc );
+    for( unsigned i = 0; i < i_count; i++ )
+        free( ppsz_mrls[i] );
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*****************************************************************************
+ * timeshift.c: test and benchmark for the es out timeshift storage
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+#include <../src/input/input_internal.h>
+#include <../src/input/es_out.h>
+#include <../src/input/es_out_timeshift.h>
+
+#include <vlc_es_out.h>
+#include <vlc_block.h>
+
+/* Synthetic 10 Mbit/s live stream: 25 frames of 50000 bytes per second */
+#define STREAM_FPS          25
+#define STREAM_FRAME_SIZE   (10*1000*1000 / 8 / STREAM_FPS)
+#define STREAM_DURATION     20 /* in seconds */
+#define STREAM_FRAMES       (STREAM_DURATION * STREAM_FPS)
+
+/* The timeshift es_out is built into the test, the input is not needed */
+void input_ControlPush( input_thread_t *p_input, int i_type, vlc_value_t *p_val )
+{
+    (void)p_input; (void)i_type; (void)p_val;
+}
+
+/*****************************************************************************
+ * Sink es_out: checks the order of the received blocks
+ *****************************************************************************/
+struct es_out_sys_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_received;
+    int64_t     i_bytes;
+};
+
+static es_out_id_t *SinkAdd( es_out_t *p_out, const es_format_t *p_fmt )
+{
+    (void)p_out; (void)p_fmt;
+    return malloc( 1 );
+}
+
+static int SinkSend( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
+{
+    es_out_sys_t *p_sys = p_out->p_sys;
+    unsigned i_seq;
+
+    (void)p_es;
+    assert( p_block->i_buffer == STREAM_FRAME_SIZE );
+    memcpy( &i_seq, p_block->p_buffer, sizeof(i_seq) );
+
+    vlc_mutex_lock( &p_sys->lock );
+    assert( i_seq == p_sys->i_received );
+    assert( p_block->i_dts == (mtime_t)i_seq * CLOCK_FREQ / STREAM_FPS );
+    p_sys->i_received++;
+    p_sys->i_bytes += p_block->i_buffer;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    block_Release( p_block );
+    return VLC_SUCCESS;
+}
+
+static void SinkDel( es_out_t *p_out, es_out_id_t *p_es )
+{
+    (void)p_out;
+    free( p_es );
+}
+
+static int SinkControl( es_out_t *p_out, int i_query, va_list args )
+{
+    (void)p_out;
+    switch( i_query )
+    {
+    case ES_OUT_GET_BUFFERING:
+    case ES_OUT_GET_EMPTY:
+        *va_arg( args, bool * ) = i_query == ES_OUT_GET_EMPTY;
+        return VLC_SUCCESS;
+    default:
+        return VLC_SUCCESS;
+    }
+}
+
+/*****************************************************************************
+ * Pause, push the whole stream, resume and wait for it to be drained
+ *****************************************************************************/
+static void test_timeshift( libvlc_int_t *p_libvlc, int64_t i_memory,
+                            const char *psz_path )
+{
+    input_thread_t *p_input = vlc_object_create( p_libvlc, sizeof(*p_input) );
+    assert( p_input != NULL );
+    p_input->p = calloc( 1, sizeof(*p_input->p) );
+    assert( p_input->p != NULL );
+    p_input->p->b_can_pace_control = false;
+
+    var_Create( p_input, "input-timeshift-memory", VLC_VAR_INTEGER );
+    var_SetInteger( p_input, "input-timeshift-memory", i_memory );
+    var_Create( p_input, "input-timeshift-granularity", VLC_VAR_INTEGER );
+    var_SetInteger( p_input, "input-timeshift-granularity", 8*1024*1024 );
+    if( psz_path != NULL )
+    {
+        var_Create( p_input, "input-timeshift-path", VLC_VAR_STRING );
+        var_SetString( p_input, "input-timeshift-path", psz_path );
+    }
+
+    es_out_sys_t sink;
+    vlc_mutex_init( &sink.lock );
+    vlc_cond_init( &sink.wait );
+    sink.i_received = 0;
+    sink.i_bytes = 0;
+
+    es_out_t sink_out = {
+        .pf_add = SinkAdd, .pf_send = SinkSend, .pf_del = SinkDel,
+        .pf_control = SinkControl, .pf_destroy = NULL, .p_sys = &sink,
+    };
+
+    es_out_t *p_out = input_EsOutTimeshiftNew( p_input, &sink_out,
+                                               INPUT_RATE_DEFAULT );
+    assert( p_out != NULL );
+
+    es_format_t fmt;
+    es_format_Init( &fmt, VIDEO_ES, VLC_CODEC_H264 );
+    es_out_id_t *p_es = es_out_Add( p_out, &fmt );
+    assert( p_es != NULL );
+
+    assert( !es_out_SetPauseState( p_out, false, true, mdate() ) );
+
+    /* Push the stream as fast as possible while paused */
+    const mtime_t i_push_start = mdate();
+    for( unsigned i = 0; i < STREAM_FRAMES; i++ )
+    {
+        block_t *p_block = block_Alloc( STREAM_FRAME_SIZE );
+        assert( p_block != NULL );
+        memset( p_block->p_buffer, 0, p_block->i_buffer );
+        memcpy( p_block->p_buffer, &i, sizeof(i) );
+        p_block->i_dts =
+        p_block->i_pts = (mtime_t)i * CLOCK_FREQ / STREAM_FPS;
+        es_out_Send( p_out, p_es, p_block );
+    }
+    const mtime_t i_push = mdate() - i_push_start;
+
+    vlc_mutex_lock( &sink.lock );
+    assert( sink.i_received == 0 );
+    vlc_mutex_unlock( &sink.lock );
+
+    /* Resume and wait for all the blocks to be re-emitted */
+    const mtime_t i_pop_start = mdate();
+    assert( !es_out_SetPauseState( p_out, false, false, i_pop_start ) );
+
+    vlc_mutex_lock( &sink.lock );
+    while( sink.i_received < STREAM_FRAMES )
+        vlc_cond_wait( &sink.wait, &sink.lock );
+    vlc_mutex_unlock( &sink.lock );
+    const mtime_t i_pop = mdate() - i_pop_start;
+
+    assert( sink.i_bytes == (int64_t)STREAM_FRAMES * STREAM_FRAME_SIZE );
+
+    log( "  memory limit %"PRId64" KiB: push %.1f MiB/s, resume %.1f MiB/s\n",
+         i_memory / 1024,
+         (double)sink.i_bytes * CLOCK_FREQ / i_push / (1024*1024),
+         (double)sink.i_bytes * CLOCK_FREQ / i_pop / (1024*1024) );
+
+    es_out_Del( p_out, p_es );
+    es_out_Delete( p_out );
+
+    vlc_cond_destroy( &sink.wait );
+    vlc_mutex_destroy( &sink.lock );
+
+    free( p_input->p );
+    vlc_object_release( p_input );
+}
+
+int main( void )
+{
+    libvlc_instance_t *p_vlc;
+
+    test_init();
+    alarm( 60 );
+
+    log( "Testing the es out timeshift storage\n" );
+    p_vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( p_vlc != NULL );
+
+    /* Temporary files only */
+    test_timeshift( p_vlc->p_libvlc_int, 0, NULL );
+    /* Memory, spilling to temporary files past 8 MiB */
+    test_timeshift( p_vlc->p_libvlc_int, 8*1024*1024, NULL );
+    /* Memory only */
+    test_timeshift( p_vlc->p_libvlc_int, 64*1024*1024, NULL );
+#ifdef __linux__
+    /* Past 8 MiB, in memory still, as no file can be created in /proc */
+    test_timeshift( p_vlc->p_libvlc_int, 8*1024*1024, "/proc" );
+#endif
+
+    libvlc_release( p_vlc );
+
+    return 0;
+}
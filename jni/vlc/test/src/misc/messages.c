@@ -0,0 +1,133 @@
+/*****************************************************************************
+ * messages.c: test and benchmark of the message queue
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#define MODULE_STRING "test"
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+
+#define MESSAGES 100000
+
+struct msg_cb_data_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_count;
+    bool        b_marker;
+};
+
+static void Callback( msg_cb_data_t *p_data, const msg_item_t *p_item )
+{
+    /* LibVLC and its modules have their own messages */
+    if( strcmp( p_item->psz_module, MODULE_STRING ) )
+        return;
+
+    vlc_mutex_lock( &p_data->lock );
+    if( p_item->i_type == VLC_MSG_INFO && !strcmp( p_item->psz_msg, "marker" ) )
+        p_data->b_marker = true;
+    else
+        p_data->i_count++;
+    vlc_cond_signal( &p_data->wait );
+    vlc_mutex_unlock( &p_data->lock );
+}
+
+/* Waits until the messages emitted so far were delivered */
+static unsigned Flush( vlc_object_t *p_obj, msg_cb_data_t *p_data )
+{
+    msg_Info( p_obj, "marker" );
+
+    vlc_mutex_lock( &p_data->lock );
+    while( !p_data->b_marker )
+        vlc_cond_wait( &p_data->wait, &p_data->lock );
+    p_data->b_marker = false;
+    const unsigned i_count = p_data->i_count;
+    p_data->i_count = 0;
+    vlc_mutex_unlock( &p_data->lock );
+
+    return i_count;
+}
+
+static void test_messages( vlc_object_t *p_obj, msg_subscription_t *p_sub,
+                           msg_cb_data_t *p_data )
+{
+    log( "Testing the delivery of %d debug messages\n", MESSAGES );
+    msg_SubscriptionSetVerbosity( p_sub, 2 );
+
+    const mtime_t i_begin = mdate();
+    for( int i = 0; i < MESSAGES; i++ )
+        msg_Dbg( p_obj, "message %d of %s", i, "the benchmark" );
+    const mtime_t i_queued = mdate();
+    const unsigned i_count = Flush( p_obj, p_data );
+    const mtime_t i_delivered = mdate();
+
+    assert( i_count == MESSAGES );
+    log( "  emitted at %.0f messages/s, delivered at %.0f messages/s\n",
+         MESSAGES * 1000000. / ( i_queued - i_begin + 1 ),
+         MESSAGES * 1000000. / ( i_delivered - i_begin + 1 ) );
+}
+
+static void test_disabled( vlc_object_t *p_obj, msg_subscription_t *p_sub,
+                           msg_cb_data_t *p_data )
+{
+    log( "Testing the cost of disabled debug messages\n" );
+    msg_SubscriptionSetVerbosity( p_sub, 0 );
+
+    const mtime_t i_begin = mdate();
+    for( int i = 0; i < MESSAGES; i++ )
+        msg_Dbg( p_obj, "message %d of %s", i, "the benchmark" );
+    const mtime_t i_duration = mdate() - i_begin;
+
+    assert( Flush( p_obj, p_data ) == 0 );
+    log( "  %.1f ns per message\n", i_duration * 1000. / MESSAGES );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 60 );
+
+    /* Only the subscriber gets the messages */
+    const char *ppsz_args[test_defaults_nargs + 1];
+    memcpy( ppsz_args, test_defaults_args, sizeof(test_defaults_args) );
+    ppsz_args[test_defaults_nargs] = "--quiet";
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs + 1,
+                                           ppsz_args );
+    assert( p_vlc != NULL );
+    vlc_object_t *p_obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    msg_cb_data_t data = { .i_count = 0, .b_marker = false };
+    vlc_mutex_init( &data.lock );
+    vlc_cond_init( &data.wait );
+    msg_subscription_t *p_sub = msg_Subscribe( p_vlc->p_libvlc_int,
+                                               Callback, &data );
+    assert( p_sub != NULL );
+
+    test_messages( p_obj, p_sub, &data );
+    test_disabled( p_obj, p_sub, &data );
+
+    msg_Unsubscribe( p_sub );
+    vlc_cond_destroy( &data.wait );
+    vlc_mutex_destroy( &data.lock );
+    libvlc_release( p_vlc );
+    return 0;
+}
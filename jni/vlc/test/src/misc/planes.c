@@ -0,0 +1,164 @@
+/*****************************************************************************
+ * planes.c: test and bandwidth benchmark of the plane copy helpers
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+/* Pitches are rounded up like the video outputs do */
+#define PITCH(w) (((w) + 63) & ~63)
+
+static const struct
+{
+    const char *psz_name;
+    unsigned i_width;
+    unsigned i_height;
+} p_sizes[] = {
+    { "QCIF",  176,  144 },
+    { "CIF",   352,  288 },
+    { "SD",    720,  576 },
+    { "720p", 1280,  720 },
+    { "1080p", 1920, 1080 },
+};
+
+/* Odd sizes, to go through the tails of the line kernels */
+static const unsigned pi_widths[] = { 1, 15, 16, 17, 33, 100, 255 };
+
+static void Fill( uint8_t *p, size_t i_size, unsigned i_seed )
+{
+    for( size_t i = 0; i < i_size; i++ )
+        p[i] = ( i * 7 + i_seed ) ^ ( i >> 8 );
+}
+
+static void test_correctness( void )
+{
+    for( unsigned k = 0; k < sizeof(pi_widths) / sizeof(*pi_widths); k++ )
+    {
+        const unsigned w = pi_widths[k], h = 5;
+        const size_t pitch = PITCH( 2 * w ) + 7;
+        uint8_t *p_src = malloc( pitch * h );
+        uint8_t *p_a = malloc( pitch * h );
+        uint8_t *p_b = malloc( pitch * h );
+        uint8_t *p_dst = malloc( pitch * h );
+        assert( p_src && p_a && p_b && p_dst );
+
+        Fill( p_src, pitch * h, k );
+
+        vlc_CopyPlane( p_dst, pitch - 3, p_src, pitch, 2 * w, h );
+        for( unsigned y = 0; y < h; y++ )
+            assert( !memcmp( &p_dst[y * (pitch - 3)], &p_src[y * pitch], 2 * w ) );
+
+        vlc_SplitPlane( p_a, pitch, p_b, pitch, p_src, pitch, w, h );
+        for( unsigned y = 0; y < h; y++ )
+            for( unsigned x = 0; x < w; x++ )
+            {
+                assert( p_a[y * pitch + x] == p_src[y * pitch + 2*x] );
+                assert( p_b[y * pitch + x] == p_src[y * pitch + 2*x+1] );
+            }
+
+        vlc_InterleavePlanes( p_dst, pitch, p_a, pitch, p_b, pitch, w, h );
+        for( unsigned y = 0; y < h; y++ )
+            assert( !memcmp( &p_dst[y * pitch], &p_src[y * pitch], 2 * w ) );
+
+        vlc_SwapPlaneUV( p_dst, pitch, p_dst, pitch, w, h );
+        for( unsigned y = 0; y < h; y++ )
+            for( unsigned x = 0; x < w; x++ )
+            {
+                assert( p_dst[y * pitch + 2*x] == p_b[y * pitch + x] );
+                assert( p_dst[y * pitch + 2*x+1] == p_a[y * pitch + x] );
+            }
+
+        free( p_dst );
+        free( p_b );
+        free( p_a );
+        free( p_src );
+    }
+}
+
+/* Runs an operation over about 200 MB, and gives the bandwidth in MB/s of
+ * the bytes read */
+#define BENCH( f_rate, op, i_bytes ) \
+    do { \
+        const unsigned i_loops = 1 + ( 200 << 20 ) / (i_bytes); \
+        const mtime_t i_begin = mdate(); \
+        for( unsigned i = 0; i < i_loops; i++ ) \
+            op; \
+        f_rate = (double)(i_bytes) * i_loops / ( mdate() - i_begin + 1 ); \
+    } while( 0 )
+
+static void test_bandwidth( void )
+{
+    for( unsigned k = 0; k < sizeof(p_sizes) / sizeof(*p_sizes); k++ )
+    {
+        const unsigned w = p_sizes[k].i_width, h = p_sizes[k].i_height;
+        const size_t pitch = PITCH( w ), size = pitch * h;
+        uint8_t *p_src = malloc( size );
+        uint8_t *p_dst = malloc( size + h * 64 );
+        uint8_t *p_a = malloc( size / 2 );
+        uint8_t *p_b = malloc( size / 2 );
+        assert( p_src && p_dst && p_a && p_b );
+        Fill( p_src, size, k );
+
+        /* A luma plane, and a NV12 chroma plane of as many bytes */
+        double f_memcpy, f_vlc_memcpy, f_pitch, f_split, f_interleave, f_swap;
+        BENCH( f_memcpy, memcpy( p_dst, p_src, size ), size );
+        BENCH( f_vlc_memcpy, vlc_memcpy( p_dst, p_src, size ), size );
+        BENCH( f_pitch, vlc_CopyPlane( p_dst, pitch + 64, p_src, pitch, w, h ),
+               w * h );
+        BENCH( f_split, vlc_SplitPlane( p_a, pitch / 2, p_b, pitch / 2,
+                                        p_src, pitch, w / 2, h ), w * h );
+        BENCH( f_interleave, vlc_InterleavePlanes( p_dst, pitch, p_a, pitch / 2,
+                                                   p_b, pitch / 2, w / 2, h ),
+               w * h );
+        BENCH( f_swap, vlc_SwapPlaneUV( p_dst, pitch, p_src, pitch, w / 2, h ),
+               w * h );
+
+        log( "  %-5s %4ux%-4u MB/s: memcpy %.0f, vlc_memcpy %.0f, pitch %.0f, "
+             "split %.0f, interleave %.0f, swap %.0f\n",
+             p_sizes[k].psz_name, w, h, f_memcpy, f_vlc_memcpy, f_pitch,
+             f_split, f_interleave, f_swap );
+
+        free( p_b );
+        free( p_a );
+        free( p_dst );
+        free( p_src );
+    }
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 120 );
+
+    log( "Testing the plane copy helpers\n" );
+
+    /* The fast memory module is loaded by libvlc */
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+
+    test_correctness();
+    test_bandwidth();
+
+    libvlc_release( p_vlc );
+    return 0;
+}
@@ -401,6 +401,83 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+static void test_handles( libvlc_int_t *p_libvlc )
+{
+    vlc_value_t val;
+
+    var_Create( p_libvlc, psz_var_name[0], VLC_VAR_INTEGER );
+    var_AddCallback( p_libvlc, psz_var_name[0], callback, psz_var_name );
+    var_handle_t *p_var = var_Acquire( p_libvlc, psz_var_name[0] );
+    assert( p_var != NULL );
+    assert( var_Acquire( p_libvlc, "no such variable" ) == NULL );
+
+    /* Both ways give the same value, and the callbacks are triggered */
+    var_SetIntegerHandle( p_libvlc, p_var, 42 );
+    assert( var_value[0].i_int == 42 );
+    assert( var_GetInteger( p_libvlc, psz_var_name[0] ) == 42 );
+    var_SetInteger( p_libvlc, psz_var_name[0], 43 );
+    assert( var_GetIntegerHandle( p_libvlc, p_var ) == 43 );
+
+    /* Storing does not trigger them, but respects the limits */
+    val.i_int = 10;
+    var_Change( p_libvlc, psz_var_name[0], VLC_VAR_SETMAX, &val, NULL );
+    val.i_int = 44;
+    var_StoreHandle( p_libvlc, p_var, val );
+    assert( var_value[0].i_int == 43 );
+    assert( var_GetIntegerHandle( p_libvlc, p_var ) == 10 );
+
+    /* The handle keeps the variable alive */
+    var_DelCallback( p_libvlc, psz_var_name[0], callback, psz_var_name );
+    var_Destroy( p_libvlc, psz_var_name[0] );
+    assert( var_GetIntegerHandle( p_libvlc, p_var ) == 10 );
+    var_Release( p_libvlc, p_var );
+    assert( var_Type( p_libvlc, psz_var_name[0] ) == 0 );
+
+    /* Strings are duplicated */
+    var_Create( p_libvlc, psz_var_name[1], VLC_VAR_STRING );
+    p_var = var_Acquire( p_libvlc, psz_var_name[1] );
+    var_SetString( p_libvlc, psz_var_name[1], "value" );
+    assert( !var_GetHandle( p_libvlc, p_var, VLC_VAR_STRING, &val ) );
+    assert( !strcmp( val.psz_string, "value" ) );
+    free( val.psz_string );
+    var_Release( p_libvlc, p_var );
+    var_Destroy( p_libvlc, psz_var_name[1] );
+}
+
+#define BENCH_LOOPS 1000000
+
+#define BENCH( psz_name, op ) \
+    do { \
+        const mtime_t i_begin = mdate(); \
+        for( int i = 0; i < BENCH_LOOPS; i++ ) \
+            op; \
+        const mtime_t i_duration = mdate() - i_begin; \
+        log( "  %-24s %6.1f ns per call\n", psz_name, \
+             i_duration * 1000. / BENCH_LOOPS ); \
+    } while( 0 )
+
+/* Compares the named and handle accesses, among the many variables of the
+ * LibVLC instance, like the position updates of the input */
+static void bench_handles( libvlc_int_t *p_libvlc )
+{
+    vlc_value_t val = { .f_float = 0.5 };
+
+    var_Create( p_libvlc, "position", VLC_VAR_FLOAT );
+    var_handle_t *p_var = var_Acquire( p_libvlc, "position" );
+
+    BENCH( "var_GetFloat", (void)var_GetFloat( p_libvlc, "position" ) );
+    BENCH( "var_GetFloatHandle", (void)var_GetFloatHandle( p_libvlc, p_var ) );
+    BENCH( "var_Change(SETVALUE)",
+           var_Change( p_libvlc, "position", VLC_VAR_SETVALUE, &val, NULL ) );
+    BENCH( "var_StoreHandle", var_StoreHandle( p_libvlc, p_var, val ) );
+    BENCH( "var_SetFloat", var_SetFloat( p_libvlc, "position", 0.5 ) );
+    BENCH( "var_SetHandle",
+           var_SetHandle( p_libvlc, p_var, VLC_VAR_FLOAT, val ) );
+
+    var_Release( p_libvlc, p_var );
+    var_Destroy( p_libvlc, "position" );
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -438,6 +515,12 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    log( "Testing the handles\n" );
+    test_handles( p_libvlc );
+
+    log( "Benchmarking the handles\n" );
+    bench_handles( p_libvlc );
 }
 
 
@@ -0,0 +1,257 @@
+/*****************************************************************************
+ * preparser.c: test of the preparse cache and benchmark of the preparser
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+#include <../src/control/media_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_playlist.h>
+
+#include <dirent.h>
+
+/* The folder of media files to use for the benchmark */
+#define PREPARSE_DIR_ENV    "VLC_TEST_PREPARSE_DIR"
+#define MAX_FILES           500
+
+/* The last items queued are moved ahead, like the ones shown by a browser */
+#define VISIBLE_FILES       10
+
+static char psz_cache_home[] = "/tmp/vlc-preparse-XXXXXX";
+static char psz_cache_file[sizeof(psz_cache_home) + sizeof("/vlc/preparse.dat")];
+
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_done;
+    unsigned    i_visible_done;
+    mtime_t     i_visible_date;
+} scan_t;
+
+typedef struct
+{
+    scan_t     *p_scan;
+    bool        b_visible;
+    int64_t     i_duration;
+    int         i_tracks;
+} slot_t;
+
+static void Parsed( const libvlc_event_t *p_event, void *p_data )
+{
+    slot_t *p_slot = p_data;
+    scan_t *p_scan = p_slot->p_scan;
+    libvlc_media_t *p_md = p_event->p_obj;
+
+    if( !p_event->u.media_parsed_changed.new_status )
+        return;
+
+    libvlc_media_track_info_t *p_tracks;
+    p_slot->i_duration = libvlc_media_get_duration( p_md );
+    p_slot->i_tracks = libvlc_media_get_tracks_info( p_md, &p_tracks );
+    free( p_tracks );
+
+    vlc_mutex_lock( &p_scan->lock );
+    p_scan->i_done++;
+    if( p_slot->b_visible && ++p_scan->i_visible_done == VISIBLE_FILES )
+        p_scan->i_visible_date = mdate();
+    vlc_cond_signal( &p_scan->wait );
+    vlc_mutex_unlock( &p_scan->lock );
+}
+
+/* Preparses all the paths with a new instance, so that the cache is loaded
+ * and saved in between */
+static void Scan( const char *const *ppsz_paths, unsigned i_count,
+                  slot_t *p_slots, const char *psz_name )
+{
+    scan_t scan = { .i_done = 0, .i_visible_done = 0, .i_visible_date = 0 };
+    vlc_mutex_init( &scan.lock );
+    vlc_cond_init( &scan.wait );
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+    playlist_t *p_playlist = pl_Get( p_vlc->p_libvlc_int );
+
+    libvlc_media_t **pp_md = malloc( i_count * sizeof(*pp_md) );
+    assert( pp_md != NULL );
+
+    const mtime_t i_begin = mdate();
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        p_slots[i].p_scan = &scan;
+        p_slots[i].b_visible = i_count > VISIBLE_FILES &&
+                               i >= i_count - VISIBLE_FILES;
+        pp_md[i] = libvlc_media_new_path( p_vlc, ppsz_paths[i] );
+        assert( pp_md[i] != NULL );
+        libvlc_event_attach( libvlc_media_event_manager( pp_md[i] ),
+                             libvlc_MediaParsedChanged, Parsed, &p_slots[i] );
+        libvlc_media_parse_async( pp_md[i] );
+    }
+    for( unsigned i = 0; i < i_count; i++ )
+        if( p_slots[i].b_visible )
+            playlist_PreparsePrioritize( p_playlist, pp_md[i]->p_input_item );
+
+    vlc_mutex_lock( &scan.lock );
+    while( scan.i_done < i_count )
+        vlc_cond_wait( &scan.wait, &scan.lock );
+    vlc_mutex_unlock( &scan.lock );
+    const mtime_t i_duration = mdate() - i_begin;
+
+    for( unsigned i = 0; i < i_count; i++ )
+        libvlc_media_release( pp_md[i] );
+    free( pp_md );
+    libvlc_release( p_vlc );
+
+    log( "  %s scan: %u files in %d ms, %.2f ms per file", psz_name, i_count,
+         (int)(i_duration / 1000), (double)i_duration / i_count / 1000. );
+    if( scan.i_visible_date )
+        printf( ", %d ms to the visible ones",
+                (int)((scan.i_visible_date - i_begin) / 1000) );
+    printf( "\n" );
+
+    vlc_cond_destroy( &scan.wait );
+    vlc_mutex_destroy( &scan.lock );
+}
+
+/* Both scans must give the same results, the second one from the cache */
+static void test_cache( const char *const *ppsz_paths, unsigned i_count )
+{
+    slot_t *p_cold = calloc( i_count, sizeof(*p_cold) );
+    slot_t *p_warm = calloc( i_count, sizeof(*p_warm) );
+    assert( p_cold && p_warm );
+
+    unlink( psz_cache_file );
+    Scan( ppsz_paths, i_count, p_cold, "cold" );
+    assert( access( psz_cache_file, R_OK ) == 0 );
+    Scan( ppsz_paths, i_count, p_warm, "warm" );
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        assert( p_cold[i].i_duration == p_warm[i].i_duration );
+        assert( p_cold[i].i_tracks == p_warm[i].i_tracks );
+    }
+
+    free( p_warm );
+    free( p_cold );
+}
+
+static void CopyFile( const char *psz_src, const char *psz_dst )
+{
+    FILE *p_src = fopen( psz_src, "rb" );
+    FILE *p_dst = fopen( psz_dst, "wb" );
+    assert( p_src && p_dst );
+
+    char p_buf[4096];
+    size_t i_read;
+    while( (i_read = fread( p_buf, 1, sizeof(p_buf), p_src )) > 0 )
+        assert( fwrite( p_buf, 1, i_read, p_dst ) == i_read );
+    fclose( p_dst );
+    fclose( p_src );
+}
+
+/* A file modified since it was cached must be parsed again */
+static void test_modified( void )
+{
+    char psz_path[sizeof(psz_cache_home) + sizeof("/sample")];
+    snprintf( psz_path, sizeof(psz_path), "%s/sample", psz_cache_home );
+    const char *ppsz_paths[] = { psz_path };
+    slot_t before, after, fresh;
+
+    unlink( psz_cache_file );
+    CopyFile( SRCDIR"/samples/empty.voc", psz_path );
+    Scan( ppsz_paths, 1, &before, "original" );
+
+    /* The size differs, whatever the resolution of the modification date */
+    CopyFile( SRCDIR"/samples/image.jpg", psz_path );
+    Scan( ppsz_paths, 1, &after, "modified" );
+
+    unlink( psz_cache_file );
+    Scan( ppsz_paths, 1, &fresh, "uncached" );
+    assert( after.i_duration == fresh.i_duration );
+    assert( after.i_tracks == fresh.i_tracks );
+
+    unlink( psz_path );
+}
+
+static unsigned ListFiles( const char *psz_dir, char **ppsz_paths )
+{
+    DIR *p_dir = opendir( psz_dir );
+    if( !p_dir )
+        return 0;
+
+    unsigned i_count = 0;
+    struct dirent *p_entry;
+    while( i_count < MAX_FILES && (p_entry = readdir( p_dir )) != NULL )
+    {
+        if( p_entry->d_name[0] == '.' )
+            continue;
+
+        if( asprintf( &ppsz_paths[i_count], "%s/%s", psz_dir,
+                      p_entry->d_name ) < 0 )
+            break;
+        i_count++;
+    }
+    closedir( p_dir );
+    return i_count;
+}
+
+int main( void )
+{
+    test_init();
+
+    /* Keep the cache of the user out of the way */
+    assert( mkdtemp( psz_cache_home ) != NULL );
+    snprintf( psz_cache_file, sizeof(psz_cache_file), "%s/vlc/preparse.dat",
+              psz_cache_home );
+    setenv( "XDG_CACHE_HOME", psz_cache_home, 1 );
+
+    log( "Testing the preparse cache\n" );
+    const char *const ppsz_samples[] = {
+        SRCDIR"/samples/empty.voc",
+        SRCDIR"/samples/image.jpg",
+    };
+    test_cache( ppsz_samples, sizeof(ppsz_samples) / sizeof(*ppsz_samples) );
+    test_modified();
+
+    const char *psz_dir = getenv( PREPARSE_DIR_ENV );
+    if( psz_dir )
+    {
+        char *ppsz_paths[MAX_FILES];
+        const unsigned i_count = ListFiles( psz_dir, ppsz_paths );
+
+        alarm( 60 + i_count );
+        log( "Benchmarking the preparser on %s\n", psz_dir );
+        test_cache( (const char *const *)ppsz_paths, i_count );
+
+        for( unsigned i = 0; i < i_count; i++ )
+            free( ppsz_paths[i] );
+    }
+    else
+        log( "Skipping the preparser benchmark, "
+             "set "PREPARSE_DIR_ENV" to a folder of media files\n" );
+
+    unlink( psz_cache_file );
+    char psz_vlc_dir[sizeof(psz_cache_home) + sizeof("/vlc")];
+    snprintf( psz_vlc_dir, sizeof(psz_vlc_dir), "%s/vlc", psz_cache_home );
+    rmdir( psz_vlc_dir );
+    rmdir( psz_cache_home );
+    return 0;
+}
@@ -28,6 +28,12 @@ public class FileBrowserActivity extends Activity {
 		mFileList.setOnItemLongClickListener(mFileAdapter);
 	}
 
+	@Override
+	public void onDestroy() {
+		mFileAdapter.release();
+		super.onDestroy();
+	}
+
 	@Override
 	public boolean onKeyDown(int keyCode, KeyEvent event) {
 		if(mFileAdapter.onKey(null, keyCode, event))
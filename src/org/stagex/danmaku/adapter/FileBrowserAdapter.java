@@ -5,14 +5,17 @@ import java.io.FilenameFilter;
 import java.util.ArrayList;
 import java.util.Collections;
 import java.util.Comparator;
+import java.util.HashMap;
 
 import org.stagex.danmaku.R;
 import org.stagex.danmaku.activity.PlayerActivity;
 import org.stagex.danmaku.activity.TestActivity;
 import org.stagex.danmaku.helper.SystemUtility;
+import org.stagex.danmaku.player.VlcThumbnailer;
 
 import android.content.Context;
 import android.content.Intent;
+import android.graphics.Bitmap;
 import android.net.Uri;
 import android.view.KeyEvent;
 import android.view.LayoutInflater;
@@ -24,11 +27,12 @@ import android.widget.AdapterView;
 import android.widget.AdapterView.OnItemClickListener;
 import android.widget.AdapterView.OnItemLongClickListener;
 import android.widget.BaseAdapter;
+import android.widget.ImageView;
 import android.widget.TextView;
 
 public class FileBrowserAdapter extends BaseAdapter implements
 		OnItemClickListener, OnItemLongClickListener, OnKeyListener,
-		FilenameFilter {
+		FilenameFilter, VlcThumbnailer.OnThumbnailListener {
 
 	public final static String LOGTAG = "DANMAKU-FileBrowserAdapter";
 
@@ -39,6 +43,9 @@ public class FileBrowserAdapter extends BaseAdapter implements
 	private ArrayList<String> mBottom = new ArrayList<String>();
 	private ArrayList<String> mList = new ArrayList<String>();
 	private String mFilter = "3gp#amv#ape#asf#avi#flac#flv#hlv#mkv#mov#mp3#mp4#mpeg#mpg#rm#rmvb#tta#wav#wma#wmv#xml";
+	/* thumbnails by path, null when there is none */
+	private HashMap<String, Bitmap> mThumbnails = new HashMap<String, Bitmap>();
+	private VlcThumbnailer mThumbnailer = null;
 
 	public FileBrowserAdapter(Context context, String path) {
 		mContext = context;
@@ -108,10 +115,46 @@ public class FileBrowserAdapter extends BaseAdapter implements
 		String name = mList.get(position);
 		TextView tvFileName = (TextView) view.findViewById(R.id.file_item_name);
 		tvFileName.setText(name);
+		ImageView ivThumbnail = (ImageView) view
+				.findViewById(R.id.file_item_thumbnail);
+		Bitmap thumbnail = null;
+		if (position >= mTop.size())
+			thumbnail = getThumbnail(String.format("%s/%s", mCurrentPath, name));
+		ivThumbnail.setImageBitmap(thumbnail);
+		ivThumbnail.setVisibility(thumbnail != null ? View.VISIBLE : View.GONE);
 
 		return view;
 	}
 
+	private Bitmap getThumbnail(String path) {
+		if (mThumbnails.containsKey(path))
+			return mThumbnails.get(path);
+		if (mThumbnailer == null)
+			mThumbnailer = new VlcThumbnailer(2);
+		/* mark it as pending */
+		mThumbnails.put(path, null);
+		mThumbnailer.request(path, VlcThumbnailer.TIME_DEFAULT, 96, 54,
+				VlcThumbnailer.FORMAT_RGB_565, this);
+		return null;
+	}
+
+	@Override
+	public void onThumbnail(VlcThumbnailer thumbnailer, String path,
+			Bitmap bitmap) {
+		if (bitmap == null)
+			return;
+		mThumbnails.put(path, bitmap);
+		notifyDataSetChanged();
+	}
+
+	/* stops the thumbnail workers */
+	public void release() {
+		if (mThumbnailer != null) {
+			mThumbnailer.release();
+			mThumbnailer = null;
+		}
+	}
+
 	@Override
 	public void onItemClick(AdapterView<?> parent, View view, int position,
 			long id) {
@@ -0,0 +1,91 @@
+package org.stagex.danmaku.player;
+
+import java.nio.ByteBuffer;
+
+import android.graphics.Bitmap;
+import android.os.Handler;
+import android.os.Looper;
+
+public class VlcThumbnailer {
+
+	static {
+		System.loadLibrary("vlccore");
+	}
+
+	/* see native side */
+	public final static int FORMAT_RGB_565 = 0;
+	public final static int FORMAT_ARGB_8888 = 1;
+
+	/* time to use when none is given */
+	public final static long TIME_DEFAULT = -1;
+
+	public interface OnThumbnailListener {
+		/* bitmap is null if no keyframe could be decoded */
+		void onThumbnail(VlcThumbnailer thumbnailer, String path, Bitmap bitmap);
+	}
+
+	private class Request {
+		public String path;
+		public int format;
+		public OnThumbnailListener listener;
+	}
+
+	/* */
+	private int mNativeHandle = 0;
+	private Handler mHandler = new Handler(Looper.getMainLooper());
+
+	/* */
+	private native int nativeCreate(int workers);
+
+	private native void nativeRelease(int handle);
+
+	private native boolean nativeRequest(int handle, String path, long msec,
+			int width, int height, int format, Object request);
+
+	/* called by native side, from one of the worker threads */
+	private void onNativeThumbnail(Object object, byte[] pixels, int width,
+			int height) {
+		final Request request = (Request) object;
+		Bitmap bitmap = null;
+		if (pixels != null) {
+			bitmap = Bitmap.createBitmap(width, height,
+					request.format == FORMAT_RGB_565 ? Bitmap.Config.RGB_565
+							: Bitmap.Config.ARGB_8888);
+			bitmap.copyPixelsFromBuffer(ByteBuffer.wrap(pixels));
+		}
+		final Bitmap result = bitmap;
+		mHandler.post(new Runnable() {
+			@Override
+			public void run() {
+				request.listener.onThumbnail(VlcThumbnailer.this, request.path,
+						result);
+			}
+		});
+	}
+
+	/* workers is the number of thumbnails done in parallel, 0 for one per CPU */
+	public VlcThumbnailer(int workers) {
+		mNativeHandle = nativeCreate(workers);
+	}
+
+	/* the listener is called on the main thread */
+	public boolean request(String path, long msec, int width, int height,
+			int format, OnThumbnailListener listener) {
+		if (mNativeHandle == 0)
+			return false;
+		Request request = new Request();
+		request.path = path;
+		request.format = format;
+		request.listener = listener;
+		return nativeRequest(mNativeHandle, path, msec, width, height, format,
+				request);
+	}
+
+	/* pending requests are dropped, their listeners get a null bitmap */
+	public void release() {
+		if (mNativeHandle != 0) {
+			nativeRelease(mNativeHandle);
+			mNativeHandle = 0;
+		}
+	}
+}